@@ -150,7 +150,7 @@ void ImageProcessingApp::_loadScene() {
 
 	pbrMtl = skinMeshRenderer->materialAt(4).lock()->asType<PBRMaterial>();
 	pbrMtl->m_albedoMap = texMgr->addTexture("monster_albedo.jpg");
-	pbrMtl->m_normalMap = texMgr->addTexture("Nor OpenGL.jpg");
+	pbrMtl->m_normalMap = texMgr->addTexture("Nor OpenGL.jpg", "", TextureManager::Fallback::FlatNormal);
 	pbrMtl->m_metallicMap = texMgr->addTexture("monster_metallic.jpg");
 	pbrMtl->m_roughnessMap = texMgr->addTexture("monster_roughness.jpg");
 	pbrMtl->m_mainColor = { 1.f, 1.f, 1.f };
@@ -179,7 +179,7 @@ void ImageProcessingApp::_loadScene() {
 	meshRenderer->addMaterial(mtlMgr->addMaterial("matMan_body_mtl", MaterialType::PBR));
 	pbrMtl = meshRenderer->materialAt(0).lock()->asType<PBRMaterial>();
 	pbrMtl->m_albedoMap = texMgr->addTexture("03_Base_albedo.jpg");
-	pbrMtl->m_normalMap = texMgr->addTexture("03_Base_normal.jpg");
+	pbrMtl->m_normalMap = texMgr->addTexture("03_Base_normal.jpg", "", TextureManager::Fallback::FlatNormal);
 	pbrMtl->m_roughnessMap = texMgr->addTexture("03_Base_roughness.jpg");
 	pbrMtl->m_metallicMap = texMgr->addTexture("03_Base_metallic.jpg");
 	pbrMtl->m_mainColor = { 1.f, 1.f, 1.f };
@@ -188,7 +188,7 @@ void ImageProcessingApp::_loadScene() {
 
 	pbrMtl = meshRenderer->materialAt(1).lock()->asType<PBRMaterial>();
 	pbrMtl->m_albedoMap = texMgr->addTexture("01_Head_albedo.jpg");
-	pbrMtl->m_normalMap = texMgr->addTexture("01_Head_normal.jpg");
+	pbrMtl->m_normalMap = texMgr->addTexture("01_Head_normal.jpg", "", TextureManager::Fallback::FlatNormal);
 	pbrMtl->m_roughnessMap = texMgr->addTexture("01_Head_roughness.jpg");
 	pbrMtl->m_metallicMap = texMgr->addTexture("01_Head_metallic.jpg");
 	pbrMtl->m_mainColor = { 1.f, 1.f, 1.f };
@@ -197,7 +197,7 @@ void ImageProcessingApp::_loadScene() {
 
 	pbrMtl = meshRenderer->materialAt(2).lock()->asType<PBRMaterial>();
 	pbrMtl->m_albedoMap = texMgr->addTexture("02_Body_albedo.jpg");
-	pbrMtl->m_normalMap = texMgr->addTexture("02_Body_normal.jpg");
+	pbrMtl->m_normalMap = texMgr->addTexture("02_Body_normal.jpg", "", TextureManager::Fallback::FlatNormal);
 	pbrMtl->m_roughnessMap = texMgr->addTexture("02_Body_roughness.jpg");
 	pbrMtl->m_metallicMap = texMgr->addTexture("02_Body_metallic.jpg");
 	pbrMtl->m_mainColor = { 1.f, 1.f, 1.f };
@@ -5,6 +5,7 @@
 #include<common/HDRFilter2.h>
 #include<common/HDRFilter.h>
 #include<common/GaussianBlurFilter.h>
+#include<common/DeferredRenderer.h>
 
 
 MainGuiWindow::MainGuiWindow(const std::string& title, ImageProcessingApp* app): GuiWindow(title)
@@ -84,13 +85,22 @@ void MainGuiWindow::render() {
 
 
 
-	//ImGui::Text("Rendering Setting");
+	ImGui::Text("Rendering Setting");
 
-	//static const char* modes[] = { "Forward", "Deffered" };
-	//if (ImGui::Combo("Render Mode", &m_renderMode, modes, IM_ARRAYSIZE(modes)))
-	//	m_application->m_renderer->setRenderMode(Renderer::Mode(m_renderMode + 1));
-	//
-	//ImGui::Separator();
+	static const char* modes[] = { "Forward", "Deffered" };
+	if (ImGui::Combo("Render Mode", &m_renderMode, modes, IM_ARRAYSIZE(modes)))
+		m_application->m_renderer->setRenderMode(Renderer::Mode(m_renderMode + 1));
+
+	auto technique = m_application->m_renderer->getRenderTechnique();
+	if (technique && technique->identifier() == DeferredRenderer::s_identifier) {
+		auto deferred = static_cast<DeferredRenderer*>(technique);
+		static const char* lightingModes[] = { "Light Volume", "Tiled Compute" };
+		int lightingMode = int(deferred->getLightingMode());
+		if (ImGui::Combo("Lighting Mode", &lightingMode, lightingModes, IM_ARRAYSIZE(lightingModes)))
+			deferred->setLightingMode(DeferredRenderer::LightingMode(lightingMode));
+	}
+	
+	ImGui::Separator();
 	
 	if (!m_dirLight.expired() || !m_spotLight.expired() || !m_pointLight.expired() || !m_ambientLight.expired()) {
 		ImGui::Text("Lightting Setting");
@@ -287,6 +297,8 @@ void MainGuiWindow::render() {
 		ImGui::Checkbox("HDR Filter", &hdrFilter->m_isEnable);
 		ImGui::SliderFloat("Exposure", &hdrFilter->m_exposure, 0.f, 1.f);
 		ImGui::SliderFloat("White", &hdrFilter->m_white, 0.f, 1.f);
+		ImGui::SliderFloat("Adaptation Rate", &hdrFilter->m_adaptationRate, 0.1f, 10.f);
+		ImGui::Checkbox("Exposure Telemetry", &hdrFilter->m_isTelemetry);
 
 		ImGui::PopID();
 	}
@@ -314,6 +326,10 @@ void MainGuiWindow::render() {
 
 		if (ImGui::SliderFloat("Sigma", &m_sigma, blurFilter->sMinSigma, blurFilter->sMaxSigma))
 			blurFilter->setsigma(m_sigma);
+
+		bool pyramid = blurFilter->isPyramid();
+		if (ImGui::Checkbox("Pyramid", &pyramid))
+			blurFilter->setPyramid(pyramid);
 	}
 
 	ImGui::End();
@@ -1,9 +1,11 @@
 #include"ImageProcessingApp.h"
 
 
-int main()
+int main(int argc, char* argv[])
 {
 	auto app = std::unique_ptr<ImageProcessingApp>(new ImageProcessingApp("Image Processing", 1920, 1080, 4, 3));
+	if (!app->parseCommandLine(argc, argv))
+		exit(EXIT_FAILURE);
 
 	try {
 		app->run();
@@ -17,5 +19,5 @@ int main()
 		exit(EXIT_FAILURE);
 	}
 
-	return 0;
+	return app->numFailedBenchmarks() > 0 ? EXIT_FAILURE : 0;
 }
\ No newline at end of file
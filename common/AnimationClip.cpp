@@ -2,11 +2,15 @@
 #include"Util.h"
 
 AnimationClip::AnimationClip(const std::string& name, float duration): m_name(name)
-, m_duration(duration) {
+, m_duration(duration)
+, m_sampler() {
 
 }
 
-float AnimationClip::sample(const Pose& inPose, Pose& outPose, float time, LoopType loop) {
+float AnimationClip::sample(const Pose& inPose, Pose& outPose, float time, LoopType loop, ClipCursor* cursor) {
+	if (!m_sampler.isValid())
+		return sampleTracks(inPose, outPose, time, loop, cursor);
+
 	if (&inPose != &outPose)
 		outPose = inPose;
 
@@ -14,14 +18,49 @@ float AnimationClip::sample(const Pose& inPose, Pose& outPose, float time, LoopT
 		return 0.f;
 
 	float ajustedTime = ajustTimeToFitClip(time, loop);
+	m_sampler.sample(m_jointsTrack, inPose, outPose, ajustedTime, loop, prepareCursor(cursor, m_sampler.cursorCount()));
 
-	for (auto& track : m_jointsTrack) {
-		track.sample(inPose[track.getJointId()], outPose[track.getJointId()], ajustedTime, loop);
+	return ajustedTime / getDuration();
+}
+
+
+float AnimationClip::sampleTracks(const Pose& inPose, Pose& outPose, float time, LoopType loop, ClipCursor* cursor) {
+	if (&inPose != &outPose)
+		outPose = inPose;
+
+	if (!isValid())
+		return 0.f;
+
+	float ajustedTime = ajustTimeToFitClip(time, loop);
+	int* cursors = prepareCursor(cursor, m_jointsTrack.size() * 3);
+
+	for (size_t i = 0; i < m_jointsTrack.size(); i++) {
+		auto& track = m_jointsTrack[i];
+		track.sample(inPose[track.getJointId()], outPose[track.getJointId()], ajustedTime, loop, cursors ? cursors + i * 3 : nullptr);
 	}
 
 	return ajustedTime / getDuration();
 }
 
+
+int* AnimationClip::prepareCursor(ClipCursor* cursor, size_t count) const {
+	if (!cursor)
+		return nullptr;
+
+	// started on another clip or sampler layout changed, forget old state
+	if (cursor->clip != this || cursor->frames.size() != count) {
+		cursor->clip = this;
+		cursor->frames.assign(count, -1);
+	}
+
+	return cursor->frames.data();
+}
+
+
+void AnimationClip::buildSampler() {
+	m_sampler.build(m_jointsTrack);
+}
+
 bool AnimationClip::isValid() const {
 	bool isValid = false;
 	for (auto& track : m_jointsTrack) {
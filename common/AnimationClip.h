@@ -1,18 +1,42 @@
 #pragma once
 #include"TransformTrack.h"
 #include"Pose.h"
+#include"ClipSampler.h"
 #include<string>
 #include<vector>
 
 
 
+class AnimationClip;
+
+// key search state of every track of a clip, one per playback
+struct ClipCursor {
+	const AnimationClip* clip = nullptr;
+	std::vector<int> frames;
+
+	inline void reset() {
+		clip = nullptr;
+		frames.clear();
+	}
+};
+
+
 // a animation clip contain collection of joints transform tracks, to overwrite all 
 // or part of  bind pose's joints transform, sample a clip result a animated pose
 class AnimationClip {
 public:
 	AnimationClip(const std::string& name = "", float duration = 0.f);
 
-	float sample(const Pose& inPose, Pose& outPose, float time, LoopType loop);
+	// cursor let key search continue from previous sample instead of starting over, may be null
+	float sample(const Pose& inPose, Pose& outPose, float time, LoopType loop, ClipCursor* cursor = nullptr);
+	float sampleTracks(const Pose& inPose, Pose& outPose, float time, LoopType loop, ClipCursor* cursor = nullptr); // per track path, reference of batched sampling
+
+	// flatten tracks for batched sampling, call again after tracks are edited
+	void buildSampler();
+
+	inline void clearSampler() {
+		m_sampler.clear();
+	}
 
 	bool isValid() const;
 
@@ -53,9 +77,11 @@ public:
 
 protected:
 	float ajustTimeToFitClip(float time, LoopType loop);
+	int* prepareCursor(ClipCursor* cursor, size_t count) const;
 
 protected:
 	std::vector<TransformTrack> m_jointsTrack;
 	std::string m_name;
 	float m_duration;
+	ClipSampler m_sampler;
 };
\ No newline at end of file
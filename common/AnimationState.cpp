@@ -10,6 +10,7 @@ template void AnimationState::addTransition(AnimationState* dst, std::weak_ptr<B
 
 AnimationState::AnimationState(const std::string& name) : m_name(name)
 , m_clip()
+, m_cursor()
 , m_refPose()
 , m_loopMode(LoopType::Loop)
 , m_progress()
@@ -27,7 +28,7 @@ void AnimationState::onExit() {
 
 float AnimationState::update(Pose& outPose, float dt) {
 	if (m_clip) {
-		m_progress = m_clip->sample(m_refPose, outPose, dt, m_loopMode);
+		m_progress = m_clip->sample(m_refPose, outPose, dt, m_loopMode, &m_cursor);
 	}
 	
 	return m_progress;
@@ -62,6 +62,7 @@ public:
 
 	inline void setAnimationClip(AnimationClip* clip) {
 		m_clip = clip;
+		m_cursor.reset();
 	}
 
 	inline AnimationClip* getAnimationClip() const {
@@ -106,6 +107,7 @@ protected:
 	std::vector<std::unique_ptr<AnimationTransition>> m_transitions; //out transitions
 
 	AnimationClip* m_clip;
+	ClipCursor m_cursor; // key search state of this state's playback
 	Pose m_refPose;
 	LoopType m_loopMode;
 
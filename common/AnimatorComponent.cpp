@@ -20,6 +20,7 @@ template std::weak_ptr<TConditionVariable<bool>> AnimatorComponent::getCondition
 
 AnimatorComponent::AnimatorComponent(): m_avatar()
 , m_animatedPose()
+, m_skinPalette()
 , m_curState()
 , m_curAnimProgress()
 , m_startState()
@@ -43,7 +44,9 @@ void AnimatorComponent::setAvater(std::weak_ptr<Model> avatar) {
 	reset();
 	m_avatar = avatar;
 	if (!avatar.expired()) {
-		m_animatedPose = m_avatar.lock()->getSkeleton()->getResPose();
+		auto skeleton = m_avatar.lock()->getSkeleton();
+		m_animatedPose = skeleton->getResPose();
+		m_skinPalette.build(*skeleton);
 	}
 }
 
@@ -77,11 +80,13 @@ void AnimatorComponent::update(double dt) {
 	}
 
 	m_curAnimProgress = m_player.update(m_animatedPose, dt);
+	m_skinPalette.update(m_animatedPose);
 }
 
 
 void AnimatorComponent::reset() {
 	m_avatar.reset();
+	m_skinPalette.clear();
 	m_states.clear();
 	m_condVars.clear();
 
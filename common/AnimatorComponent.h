@@ -4,6 +4,7 @@
 #include"Component.h"
 #include"Util.h"
 #include"AnimationPlayer.h"
+#include"SkinPalette.h"
 #include<unordered_map>
 #include<memory>
 
@@ -24,6 +25,7 @@ public:
 	
 	void setAvater(std::weak_ptr<Model> avatar);
 	void update(double dt) override;
+	bool isConcurrentUpdate() const override { return true; }
 	void reset();
 
 	// states management
@@ -77,6 +79,11 @@ public:
 		return m_animatedPose;
 	}
 
+	// skin matrices of animated pose, evaluated at end of update
+	inline const SkinPalette& skinPalette() const {
+		return m_skinPalette;
+	}
+
 protected:
 	void removeAllTransitionToState(AnimationState* state);
 	bool isInitState(AnimationState* state);
@@ -84,6 +91,7 @@ protected:
 protected:
 	std::weak_ptr<Model> m_avatar;
 	Pose m_animatedPose;
+	SkinPalette m_skinPalette;
 
 	std::unique_ptr<AnimationState> m_startState;
 	std::shared_ptr<BoolConditionVar> m_startToInitCond;
@@ -0,0 +1,1463 @@
+#include"Benchmark.h"
+#include"Profiler.h"
+#include"ShaderProgamMgr.h"
+#include"SceneObject.h"
+#include"TransformSystem.h"
+#include"AnimationClip.h"
+#include"JobSystem.h"
+#include"LightClusterBuilder.h"
+#include"SkinPalette.h"
+#include"Skeleton.h"
+#include"RenderQueue.h"
+#include"FrameAllocator.h"
+#include"IMaterial.h"
+#include"MeshBufferPool.h"
+#include"MeshLoader.h"
+#include"ModelCache.h"
+#include"Model.h"
+#include"FileSystem.h"
+#include"TextureMgr.h"
+#include"TextureCooker.h"
+#include"GaussianBlurKernel.h"
+#include"RenderGraph.h"
+#include"Renderer.h"
+#include"DeferredRenderer.h"
+#include"MeshMgr.h"
+#include"MaterialMgr.h"
+#include"ShadowMapCache.h"
+#include"PointLightShadowMapping.h"
+#include"SpotLightShadowMapping.h"
+#include<glm/gtc/quaternion.hpp>
+#include<glm/gtc/matrix_transform.hpp>
+#include<algorithm>
+#include<iostream>
+#include<thread>
+#include<cmath>
+#include<random>
+
+
+bool BenchmarkRegistry::add(const std::string& name, Benchmark bench) {
+	return m_benchmarks.insert({ name, bench }).second;
+}
+
+
+bool BenchmarkRegistry::run(const std::string& name) {
+	auto pos = m_benchmarks.find(name);
+	if (pos == m_benchmarks.end()) {
+		std::cerr << "[Benchmark] Unknown benchmark: " << name << std::endl;
+		return false;
+	}
+
+	bool isPassed = pos->second();
+	if (!isPassed)
+		std::cerr << "[Benchmark] " << name << ": FAILED" << std::endl;
+
+	return isPassed;
+}
+
+
+std::vector<std::string> BenchmarkRegistry::names() const {
+	std::vector<std::string> result;
+	result.reserve(m_benchmarks.size());
+	for (auto& bench : m_benchmarks) {
+		result.push_back(bench.first);
+	}
+
+	return result;
+}
+
+
+
+//
+// benchmarks
+//
+
+// string lookup vs pre-resolved handle on the forward+ shading program
+static bool BenchUniformLookup() {
+	const size_t numIteration = 1000;
+	const size_t numLookupPerIteration = 64;
+
+	auto shader = ShaderProgramManager::getInstance()->addProgram("ForwardPluseShading").lock();
+	if (!shader) {
+		std::cerr << "[Benchmark] UniformLookup: failed to load shader program." << std::endl;
+		return false;
+	}
+
+	std::vector<std::string> names;
+	std::vector<UniformHandle> handles;
+	for (auto& uniform : shader->getUniforms()) {
+		names.push_back(uniform.name);
+		handles.push_back(UniformHandle(uniform.name));
+	}
+	names.push_back("u_NotExist");
+	handles.push_back(UniformHandle("u_NotExist"));
+
+	size_t found = 0;
+	for (size_t i = 0; i < numIteration; i++) {
+		{
+			PROFILE_SCOPE("UniformLookup::string");
+			for (size_t j = 0; j < numLookupPerIteration; j++) {
+				found += shader->hasUniform(names[j % names.size()]);
+			}
+		}
+		{
+			PROFILE_SCOPE("UniformLookup::handle");
+			for (size_t j = 0; j < numLookupPerIteration; j++) {
+				found += shader->hasUniform(handles[j % handles.size()]);
+			}
+		}
+	}
+
+	// every name but the last (u_NotExist) is found, by string & by handle
+	size_t expected = 0;
+	for (size_t j = 0; j < numLookupPerIteration; j++)
+		expected += j % names.size() != names.size() - 1;
+
+	// setters resolve location the same way, scalar float & int uniforms only so uploads match their type
+	std::vector<size_t> floats;
+	std::vector<size_t> ints;
+	const auto& uniforms = shader->getUniforms();
+	for (size_t j = 0; j < uniforms.size(); j++) {
+		if (uniforms[j].elementType == GL_FLOAT)
+			floats.push_back(j);
+		else if (uniforms[j].elementType == GL_INT || uniforms[j].elementType == GL_SAMPLER_2D)
+			ints.push_back(j);
+	}
+	floats.push_back(names.size() - 1);
+	ints.push_back(names.size() - 1);
+
+	size_t set = 0;
+	shader->bind();
+	for (size_t i = 0; i < numIteration; i++) {
+		{
+			PROFILE_SCOPE("UniformLookup::setString");
+			for (size_t j = 0; j < numLookupPerIteration; j++) {
+				set += shader->setUniform1(names[floats[j % floats.size()]], 0.5f);
+				set += shader->setUniform1(names[ints[j % ints.size()]], 0);
+			}
+		}
+		{
+			PROFILE_SCOPE("UniformLookup::setHandle");
+			for (size_t j = 0; j < numLookupPerIteration; j++) {
+				set += shader->setUniform1(handles[floats[j % floats.size()]], 0.5f);
+				set += shader->setUniform1(handles[ints[j % ints.size()]], 0);
+			}
+		}
+	}
+	shader->unbind();
+
+	size_t expectedSet = 0;
+	for (size_t j = 0; j < numLookupPerIteration; j++)
+		expectedSet += (j % floats.size() != floats.size() - 1) + (j % ints.size() != ints.size() - 1);
+
+	bool isPassed = found == expected * 2 * numIteration && set == expectedSet * 2 * numIteration;
+	std::cout << "[Benchmark] UniformLookup: " << names.size() << " uniforms, " << found << " hits, " << set << " set." << std::endl;
+	return isPassed;
+}
+
+REGISTER_BENCHMARK(UniformLookup, BenchUniformLookup);
+
+
+
+// world matrix queries over a 10k node graph: 100 chains of depth 100
+static bool BenchTransformHierarchy() {
+	const size_t numChain = 100;
+	const size_t chainDepth = 100;
+	const size_t numIteration = 100;
+
+	std::unique_ptr<SceneObject> root(new SceneObject("BenchRoot"));
+	std::vector<SceneObject*> nodes;
+	nodes.reserve(numChain * chainDepth);
+	for (size_t i = 0; i < numChain; i++) {
+		SceneObject* parent = root.get();
+		for (size_t j = 0; j < chainDepth; j++) {
+			SceneObject* obj = new SceneObject();
+			obj->m_transform.setPosition(glm::vec3(0.f, 1.f, 0.f));
+			obj->m_transform.setRotation(glm::vec3(0.f, float(j), 0.f));
+			parent->addChild(obj);
+			nodes.push_back(obj);
+			parent = obj;
+		}
+	}
+
+	float checksum = 0.f;
+	for (size_t i = 0; i < numIteration; i++) {
+		// animate chain roots, every node below becomes dirty
+		for (size_t c = 0; c < numChain; c++)
+			root->childAt(c)->m_transform.setRotation(glm::vec3(0.f, float(i), 0.f));
+
+		{
+			PROFILE_SCOPE("TransformHierarchy::parentWalk");
+			for (auto obj : nodes) {
+				glm::mat4 m = obj->m_transform.getMatrix();
+				for (SceneObject* parent = obj->getParent(); parent; parent = parent->getParent())
+					m = parent->m_transform.getMatrix() * m;
+				checksum += m[3].y;
+			}
+		}
+		{
+			PROFILE_SCOPE("TransformHierarchy::cachedDirty");
+			for (auto obj : nodes)
+				checksum += obj->m_transform.getMatrixWorld()[3].y;
+		}
+		{
+			PROFILE_SCOPE("TransformHierarchy::cachedClean");
+			for (auto obj : nodes)
+				checksum += obj->m_transform.getMatrixWorld()[3].y;
+		}
+	}
+
+	std::cout << "[Benchmark] TransformHierarchy: " << nodes.size() << " nodes, checksum " << checksum << std::endl;
+	return true;
+}
+
+REGISTER_BENCHMARK(TransformHierarchy, BenchTransformHierarchy);
+
+
+
+// flat level by level world matrix pass, 1000 roots x 10 children x 10 grand children
+static bool BenchTransformSystem() {
+	const size_t numRoot = 1000;
+	const size_t numChild = 10;
+	const size_t numIteration = 100;
+
+	TransformSystem system;
+	std::vector<TransformSystem::Handle> roots;
+	for (size_t i = 0; i < numRoot; i++) {
+		auto root = system.create();
+		system.setTRS(root, glm::vec3(float(i), 0.f, 0.f), glm::vec3(0.f), glm::vec3(1.f));
+		roots.push_back(root);
+		for (size_t j = 0; j < numChild; j++) {
+			auto child = system.create();
+			system.setParent(child, root);
+			system.setTRS(child, glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, float(j), 0.f), glm::vec3(1.f));
+			for (size_t k = 0; k < numChild; k++) {
+				auto grandChild = system.create();
+				system.setParent(grandChild, child);
+				system.setTRS(grandChild, glm::vec3(0.f, 0.f, 1.f), glm::vec3(float(k), 0.f, 0.f), glm::vec3(1.f));
+			}
+		}
+	}
+
+	{
+		PROFILE_SCOPE("TransformSystem::sort");
+		system.update();
+	}
+
+	for (size_t i = 0; i < numIteration; i++) {
+		for (auto root : roots)
+			system.setTRS(root, glm::vec3(0.f), glm::vec3(0.f, float(i), 0.f), glm::vec3(1.f));
+
+		PROFILE_SCOPE("TransformSystem::updateAll");
+		system.update();
+	}
+
+	for (size_t i = 0; i < numIteration; i++) {
+		for (size_t r = 0; r < roots.size(); r += 100)
+			system.setTRS(roots[r], glm::vec3(0.f), glm::vec3(float(i), 0.f, 0.f), glm::vec3(1.f));
+
+		PROFILE_SCOPE("TransformSystem::updatePartial");
+		system.update();
+	}
+
+	std::cout << "[Benchmark] TransformSystem: " << system.size() << " nodes, " << system.levelCount() << " levels." << std::endl;
+	return true;
+}
+
+REGISTER_BENCHMARK(TransformSystem, BenchTransformSystem);
+
+
+
+// animation sampling & skin palette of a skinned crowd, 1000 characters x 64 joints, on 1 to all cores
+static bool BenchJobScaling() {
+	const size_t numCharacter = 1000;
+	const size_t numJoint = 64;
+	const size_t numKeyFrame = 30;
+	const size_t numIteration = 50;
+
+	// synthetic binary tree skeleton, every joint animated
+	Pose restPose;
+	restPose.resize(numJoint);
+	for (size_t j = 1; j < numJoint; j++)
+		restPose.setJointParent(int(j), int(j - 1) / 2);
+
+	AnimationClip clip("BenchCrowd", 1.f);
+	clip.resize(numJoint);
+	for (size_t j = 0; j < numJoint; j++) {
+		auto& track = clip.trackAt(j);
+		track.setJointId(int(j));
+		auto& positions = track.getPositionTrack();
+		auto& rotations = track.getRotationTrack();
+		positions.resize(numKeyFrame);
+		rotations.resize(numKeyFrame);
+		for (size_t k = 0; k < numKeyFrame; k++) {
+			float t = float(k) / float(numKeyFrame - 1);
+			float wave = sinf(t * 6.2831853f + float(j));
+			positions[k].m_time = t;
+			positions[k].m_value = glm::vec3(0.f, 1.f, wave * 0.1f);
+			positions[k].m_in = positions[k].m_out = glm::vec3(0.f);
+			rotations[k].m_time = t;
+			rotations[k].m_value = glm::angleAxis(wave, glm::vec3(1.f, 0.f, 0.f));
+			rotations[k].m_in = rotations[k].m_out = glm::quat(0.f, 0.f, 0.f, 0.f);
+		}
+	}
+
+	std::vector<Pose> poses(numCharacter, restPose);
+	std::vector<std::vector<glm::mat4>> palettes(numCharacter);
+
+	auto jobSystem = JobSystem::getInstance();
+	auto profiler = Profiler::getInstance();
+	size_t prevWorkers = jobSystem->workerCount() - 1;
+	size_t maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads <= 0)
+		maxThreads = 1;
+
+	for (size_t numThread = 1; numThread <= maxThreads; numThread++) {
+		jobSystem->initialize(numThread - 1);
+		std::string sampleName = "JobScaling::threads" + std::to_string(numThread);
+		for (size_t i = 0; i < numIteration; i++) {
+			auto start = Profiler::Clock::now();
+			jobSystem->parallelFor(numCharacter, 8, [&](size_t begin, size_t end) {
+				for (size_t c = begin; c < end; c++) {
+					clip.sample(restPose, poses[c], float(i) / 60.f + float(c) * 0.01f, LoopType::Loop);
+					poses[c].getSkinMatrix(palettes[c]);
+				}
+			});
+			profiler->addSample(sampleName, std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count());
+		}
+	}
+
+	jobSystem->initialize(prevWorkers);
+
+	float checksum = 0.f;
+	for (auto& palette : palettes)
+		checksum += palette.back()[3].y;
+
+	std::cout << "[Benchmark] JobScaling: " << numCharacter << " characters, 1-" << maxThreads << " threads, checksum " << checksum << std::endl;
+	return true;
+}
+
+REGISTER_BENCHMARK(JobScaling, BenchJobScaling);
+
+
+
+// batched clip sampler vs per track reference, 64 joints x 120 keys (4 sec at 30 fps mocap)
+// the batched result is checked against the reference before timing
+static bool BenchClipSampling() {
+	const size_t numJoint = 64;
+	const size_t numKeyFrame = 120;
+	const size_t numIteration = 1000;
+	const float duration = 4.f;
+
+	Pose restPose;
+	restPose.resize(numJoint);
+	for (size_t j = 1; j < numJoint; j++)
+		restPose.setJointParent(int(j), int(j - 1) / 2);
+
+	AnimationClip clip("BenchMocap", duration);
+	clip.resize(numJoint);
+	for (size_t j = 0; j < numJoint; j++) {
+		auto& track = clip.trackAt(j);
+		track.setJointId(int(j));
+		auto& positions = track.getPositionTrack();
+		auto& scales = track.getScaleTrack();
+		auto& rotations = track.getRotationTrack();
+		positions.resize(numKeyFrame);
+		rotations.resize(numKeyFrame);
+		scales.resize(j % 4 == 0 ? numKeyFrame / 2 : 0);
+		for (size_t k = 0; k < numKeyFrame; k++) {
+			float t = duration * float(k) / float(numKeyFrame - 1);
+			float wave = sinf(t * 3.f + float(j));
+			positions[k].m_time = t;
+			positions[k].m_value = glm::vec3(wave, 1.f, cosf(t + float(j)));
+			rotations[k].m_time = t;
+			rotations[k].m_value = glm::angleAxis(wave * 3.f, glm::normalize(glm::vec3(1.f, float(j % 3), 0.5f)));
+		}
+		for (size_t k = 0; k < scales.size(); k++) {
+			scales[k].m_time = duration * float(k) / float(scales.size() - 1);
+			scales[k].m_value = glm::vec3(1.f + 0.1f * sinf(float(k)));
+		}
+	}
+
+	Pose reference;
+	Pose batched;
+	float maxError = 0.f;
+	clip.buildSampler();
+	for (LoopType loop : { LoopType::NoLoop, LoopType::Loop, LoopType::PingPong }) {
+		for (size_t i = 0; i < 500; i++) {
+			float time = -0.5f + float(i) * 0.0333f;
+			clip.sampleTracks(restPose, reference, time, loop);
+			clip.sample(restPose, batched, time, loop);
+			for (size_t j = 0; j < numJoint; j++) {
+				maxError = glm::max(maxError, glm::length(reference[j].position - batched[j].position));
+				maxError = glm::max(maxError, glm::length(reference[j].scale - batched[j].scale));
+				maxError = glm::max(maxError, glm::length(glm::vec4(reference[j].rotation.x - batched[j].rotation.x,
+					reference[j].rotation.y - batched[j].rotation.y, reference[j].rotation.z - batched[j].rotation.z, reference[j].rotation.w - batched[j].rotation.w)));
+			}
+		}
+	}
+
+	float checksum = 0.f;
+	{
+		PROFILE_SCOPE("ClipSampling::perTrack");
+		for (size_t i = 0; i < numIteration; i++) {
+			clip.sampleTracks(restPose, reference, float(i) * 0.0166f, LoopType::Loop);
+			checksum += reference[numJoint - 1].position.x;
+		}
+	}
+	{
+		PROFILE_SCOPE("ClipSampling::batched");
+		for (size_t i = 0; i < numIteration; i++) {
+			clip.sample(restPose, batched, float(i) * 0.0166f, LoopType::Loop);
+			checksum += batched[numJoint - 1].position.x;
+		}
+	}
+
+	std::cout << "[Benchmark] ClipSampling: " << numJoint << " joints, " << numKeyFrame << " keys, max error " << maxError << ", checksum " << checksum << std::endl;
+	return maxError <= 1e-4f;
+}
+
+REGISTER_BENCHMARK(ClipSampling, BenchClipSampling);
+
+
+
+// key search on a long mocap clip, 32 joints x 6000 keys (100 sec at 60 fps), played forward past the loop point
+static bool BenchKeyFrameCursor() {
+	const size_t numJoint = 32;
+	const size_t numKeyFrame = 6000;
+	const size_t numIteration = 8000;
+	const float duration = 100.f;
+
+	Pose restPose;
+	restPose.resize(numJoint);
+
+	AnimationClip clip("BenchLongMocap", duration);
+	clip.resize(numJoint);
+	for (size_t j = 0; j < numJoint; j++) {
+		auto& track = clip.trackAt(j);
+		track.setJointId(int(j));
+		auto& positions = track.getPositionTrack();
+		auto& rotations = track.getRotationTrack();
+		positions.resize(numKeyFrame);
+		rotations.resize(numKeyFrame);
+		for (size_t k = 0; k < numKeyFrame; k++) {
+			float t = duration * float(k) / float(numKeyFrame - 1);
+			positions[k].m_time = t;
+			positions[k].m_value = glm::vec3(sinf(t + float(j)), 1.f, 0.f);
+			rotations[k].m_time = t;
+			rotations[k].m_value = glm::angleAxis(t, glm::vec3(0.f, 1.f, 0.f));
+		}
+	}
+
+	// real time playback at 60 fps, wraps around once
+	const float step = 1.f / 60.f;
+	ClipCursor cursor;
+	Pose pose;
+	Pose check;
+	float maxError = 0.f;
+	float checksum = 0.f;
+
+	{
+		PROFILE_SCOPE("KeyFrameCursor::perTrackSearch");
+		for (size_t i = 0; i < numIteration; i++) {
+			clip.sampleTracks(restPose, pose, float(i) * step, LoopType::Loop);
+			checksum += pose[numJoint - 1].position.x;
+		}
+	}
+	{
+		PROFILE_SCOPE("KeyFrameCursor::perTrackCursor");
+		for (size_t i = 0; i < numIteration; i++) {
+			clip.sampleTracks(restPose, pose, float(i) * step, LoopType::Loop, &cursor);
+			checksum += pose[numJoint - 1].position.x;
+		}
+	}
+
+	clip.buildSampler();
+	cursor.reset();
+	{
+		PROFILE_SCOPE("KeyFrameCursor::batchedSearch");
+		for (size_t i = 0; i < numIteration; i++) {
+			clip.sample(restPose, pose, float(i) * step, LoopType::Loop);
+			checksum += pose[numJoint - 1].position.x;
+		}
+	}
+	{
+		PROFILE_SCOPE("KeyFrameCursor::batchedCursor");
+		for (size_t i = 0; i < numIteration; i++) {
+			clip.sample(restPose, pose, float(i) * step, LoopType::Loop, &cursor);
+			checksum += pose[numJoint - 1].position.x;
+		}
+	}
+
+	// cursor must not change results, including backward jumps
+	cursor.reset();
+	for (size_t i = 0; i < 500; i++) {
+		float time = (i % 50 == 0) ? float(i) * 0.37f : float(i) * step;
+		clip.sample(restPose, pose, time, LoopType::PingPong, &cursor);
+		clip.sampleTracks(restPose, check, time, LoopType::PingPong);
+		for (size_t j = 0; j < numJoint; j++)
+			maxError = glm::max(maxError, glm::length(pose[j].position - check[j].position));
+	}
+
+	std::cout << "[Benchmark] KeyFrameCursor: " << numJoint << " joints, " << numKeyFrame << " keys, max error " << maxError << ", checksum " << checksum << std::endl;
+	return maxError <= 1e-4f;
+}
+
+REGISTER_BENCHMARK(KeyFrameCursor, BenchKeyFrameCursor);
+
+
+
+// cpu cluster binning of 64 to 1024 point/spot lights. checked without the builder's own bounds or tests:
+// points spread over every cluster, placed from the grid definition, must find each light whose range & cone reach them
+// in their cluster's list, and points lit by each light must find that light in the cluster they look up
+static bool BenchLightClustering() {
+	const size_t numIteration = 20;
+	const size_t numTestPoint = 64;
+	const size_t numSamplePerAxis = 2; // per cluster
+	const float near = 0.1f;
+	const float far = 200.f;
+
+	glm::mat4 proj = glm::perspective(glm::radians(60.f), 16.f / 9.f, near, far);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.f, 5.f, 20.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+	glm::mat4 viewProj = proj * view;
+
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	auto profiler = Profiler::getInstance();
+	LightClusterBuilder builder;
+	size_t numMismatch = 0;
+	size_t numMissed = 0;
+
+	for (size_t numLight = 64; numLight <= 1024; numLight *= 2) {
+		std::vector<Light_t> lights(numLight);
+		for (size_t i = 0; i < numLight; i++) {
+			lights[i].type = i % 4 == 3 ? LightType::SpotLight : LightType::PointLight;
+			lights[i].position = glm::vec3(unit(rng) * 80.f - 40.f, unit(rng) * 10.f, unit(rng) * 80.f - 60.f);
+			lights[i].direction = glm::normalize(glm::vec3(unit(rng) - 0.5f, -1.f, unit(rng) - 0.5f));
+			lights[i].range = 2.f + unit(rng) * 6.f;
+			lights[i].outterCone = glm::radians(30.f + unit(rng) * 120.f);
+		}
+
+		std::string sampleName = "LightClustering::lights" + std::to_string(numLight);
+		for (size_t it = 0; it < numIteration; it++) {
+			auto start = Profiler::Clock::now();
+			builder.beginFrame(view, proj, near, far, 0);
+			for (auto& light : lights)
+				builder.addLight(light);
+			builder.build();
+			profiler->addSample(sampleName, std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count());
+		}
+
+		auto& ranges = builder.getClusterLightRanges();
+		auto& indices = builder.getClusterLightIndices();
+		auto isLit = [&](const Light_t& light, const glm::vec3& point) {
+			glm::vec3 toPoint = point - light.position;
+			float dist = glm::length(toPoint);
+			if (dist > light.range)
+				return false;
+
+			return light.type != LightType::SpotLight || dist <= 0.f || glm::dot(toPoint / dist, light.direction) >= cosf(light.outterCone * 0.5f);
+		};
+
+		// x/y split ndc evenly, z splits view depth exponentially from near to far
+		glm::mat4 invProj = glm::inverse(proj);
+		glm::mat4 invView = glm::inverse(view);
+		size_t numAssigned = 0;
+		for (size_t c = 0; c < builder.numClusters(); c++) {
+			const uint32_t* first = indices.data() + ranges[c].x;
+			const uint32_t* last = first + ranges[c].y;
+			numAssigned += ranges[c].y;
+			if (ranges[c].y >= MAX_LIGHTS_PER_CLUSTER) // full cluster drops lights
+				continue;
+
+			glm::vec3 coord(float(c % CLUSTER_GRID_X), float(c / CLUSTER_GRID_X % CLUSTER_GRID_Y), float(c / (CLUSTER_GRID_X * CLUSTER_GRID_Y)));
+			bool isMismatch = false;
+			for (size_t s = 0; s < numSamplePerAxis * numSamplePerAxis * numSamplePerAxis; s++) {
+				glm::vec3 cell = coord + (glm::vec3(float(s % numSamplePerAxis), float(s / numSamplePerAxis % numSamplePerAxis), float(s / (numSamplePerAxis * numSamplePerAxis))) + 0.5f) / float(numSamplePerAxis);
+				float depth = near * powf(far / near, cell.z / CLUSTER_GRID_Z);
+				glm::vec4 clip = proj * glm::vec4(0.f, 0.f, -depth, 1.f);
+				glm::vec4 viewPos = invProj * glm::vec4(cell.x / CLUSTER_GRID_X * 2.f - 1.f, cell.y / CLUSTER_GRID_Y * 2.f - 1.f, clip.z / clip.w, 1.f);
+				glm::vec3 point = glm::vec3(invView * (viewPos / viewPos.w));
+
+				for (uint32_t l = 0; l < numLight; l++) {
+					if (isLit(lights[l], point) && std::find(first, last, l) == last)
+						isMismatch = true;
+				}
+			}
+
+			if (isMismatch)
+				numMismatch++;
+		}
+
+		// lit points inside view frustum must see their light
+		for (size_t l = 0; l < numLight; l++) {
+			for (size_t p = 0; p < numTestPoint; p++) {
+				glm::vec3 offset = glm::vec3(unit(rng), unit(rng), unit(rng)) * 2.f - 1.f;
+				if (glm::length(offset) > 1.f)
+					continue;
+
+				glm::vec3 point = lights[l].position + offset * lights[l].range;
+				if (!isLit(lights[l], point))
+					continue;
+
+				glm::vec4 clip = viewProj * glm::vec4(point, 1.f);
+				if (clip.w <= near || glm::any(glm::greaterThan(glm::abs(glm::vec3(clip)), glm::vec3(clip.w))))
+					continue;
+
+				glm::vec2 screenPos = glm::vec2(clip) / clip.w * 0.5f + 0.5f;
+				glm::uvec2 range = ranges[builder.clusterIndex(screenPos, -(view * glm::vec4(point, 1.f)).z)];
+				if (range.y < MAX_LIGHTS_PER_CLUSTER && std::find(indices.begin() + range.x, indices.begin() + range.x + range.y, uint32_t(l)) == indices.begin() + range.x + range.y)
+					numMissed++;
+			}
+		}
+
+		profiler->addCounter("LightClustering::avgLightsPerCluster" + std::to_string(numLight), double(numAssigned) / double(builder.numClusters()));
+	}
+
+	std::cout << "[Benchmark] LightClustering: " << builder.numClusters() << " clusters, clusters missing a light " << numMismatch << ", missed lit points " << numMissed << std::endl;
+	return numMismatch == 0 && numMissed == 0;
+}
+
+REGISTER_BENCHMARK(LightClustering, BenchLightClustering);
+
+
+
+// skin matrices of 1000 characters x 64 joints drawn by 3 skinned renderers each:
+// every renderer composing its own palette vs one shared palette per animator.
+// both are checked against a per joint walk up the hierarchy
+static bool BenchSkinPalette() {
+	const size_t numCharacter = 1000;
+	const size_t numJoint = 64;
+	const size_t numRenderer = 3;
+	const size_t numIteration = 50;
+
+	// binary tree skeleton, ids shuffled so parents are not always before children
+	std::vector<int> ids(numJoint);
+	for (size_t j = 0; j < numJoint; j++)
+		ids[j] = int(j);
+	std::shuffle(ids.begin() + 1, ids.end(), std::mt19937(7));
+
+	Pose restPose;
+	restPose.resize(numJoint);
+	Pose invBindPose;
+	invBindPose.resize(numJoint);
+	for (size_t j = 0; j < numJoint; j++) {
+		restPose[ids[j]].position = glm::vec3(0.f, 1.f, 0.f);
+		restPose[ids[j]].rotation = glm::angleAxis(0.1f * float(j), glm::normalize(glm::vec3(1.f, float(j % 3), 0.5f)));
+		invBindPose[ids[j]].position = glm::vec3(0.f, -float(j), 0.f);
+		if (j > 0)
+			restPose.setJointParent(ids[j], ids[(j - 1) / 2]);
+	}
+
+	Skeleton skeleton;
+	skeleton.set(restPose, invBindPose, std::vector<std::string>(numJoint), glm::scale(glm::mat4(1.f), glm::vec3(0.01f)));
+	std::vector<glm::mat4> invBind;
+	invBindPose.getSkinMatrix(invBind);
+	glm::mat4 invRoot = skeleton.getInvRootTransform();
+
+	std::vector<Pose> poses(numCharacter, restPose);
+	for (size_t c = 0; c < numCharacter; c++) {
+		for (size_t j = 0; j < numJoint; j++)
+			poses[c][int(j)].rotation = glm::angleAxis(0.001f * float(c + j), glm::vec3(0.f, 0.f, 1.f)) * restPose[int(j)].rotation;
+	}
+
+	std::vector<std::vector<glm::mat4>> rendererPalettes(numCharacter * numRenderer);
+	std::vector<SkinPalette> palettes(numCharacter);
+	for (auto& palette : palettes)
+		palette.build(skeleton);
+
+	auto profiler = Profiler::getInstance();
+	for (size_t i = 0; i < numIteration; i++) {
+		auto start = Profiler::Clock::now();
+		for (size_t c = 0; c < numCharacter; c++) {
+			for (size_t r = 0; r < numRenderer; r++) {
+				auto& bones = rendererPalettes[c * numRenderer + r];
+				poses[c].getSkinMatrix(bones);
+				for (size_t j = 0; j < bones.size(); j++)
+					bones[j] = invRoot * bones[j] * invBind[j];
+			}
+		}
+		profiler->addSample("SkinPalette::perRenderer", std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count());
+
+		start = Profiler::Clock::now();
+		for (size_t c = 0; c < numCharacter; c++)
+			palettes[c].update(poses[c]);
+		profiler->addSample("SkinPalette::shared", std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count());
+	}
+
+	float maxError = 0.f;
+	for (size_t c = 0; c < numCharacter; c += 97) {
+		for (size_t j = 0; j < numJoint; j++) {
+			glm::mat4 global(1.f);
+			for (int k = int(j); k >= 0; k = poses[c].getJointParent(k))
+				global = transform2Mat(poses[c][k]) * global;
+
+			glm::mat4 expect = invRoot * global * invBind[j];
+			for (int k = 0; k < 4; k++) {
+				glm::vec4 d0 = glm::abs(palettes[c].getMatrices()[j][k] - expect[k]);
+				glm::vec4 d1 = glm::abs(rendererPalettes[c * numRenderer][j][k] - expect[k]);
+				maxError = std::max(maxError, std::max(glm::max(glm::max(d0.x, d0.y), glm::max(d0.z, d0.w)), glm::max(glm::max(d1.x, d1.y), glm::max(d1.z, d1.w))));
+			}
+		}
+	}
+
+	std::cout << "[Benchmark] SkinPalette: " << numCharacter << " characters x " << numJoint << " joints, " << numRenderer << " renderers each, max error " << maxError << std::endl;
+	return maxError <= 1e-4f;
+}
+
+REGISTER_BENCHMARK(SkinPalette, BenchSkinPalette);
+
+
+
+// 50k props of 16 meshes x 4 materials through an opaque queue: sort, instance slots, then instanced runs.
+// draws left are compared to one draw per prop, every run must share mesh & material over consecutive slots
+static bool BenchInstancing() {
+	const size_t numProp = 50000;
+	const size_t numMesh = 16;
+	const size_t numMaterial = 4;
+	const size_t numIteration = 50;
+
+	// only vao identity matters for batching, pointers into a dummy array stand for meshes
+	std::vector<uint64_t> vaos(numMesh);
+	std::vector<IMaterial> materials;
+	for (size_t m = 0; m < numMaterial; m++)
+		materials.emplace_back("prop" + std::to_string(m), MaterialType::Phong);
+
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::vector<MeshRenderItem_t> props(numProp);
+	for (auto& prop : props) {
+		size_t mesh = rng() % numMesh;
+		prop.vao = reinterpret_cast<const VertexArray*>(&vaos[mesh]);
+		prop.material = &materials[mesh % numMaterial];
+		prop.primitive = PrimitiveType::Triangles;
+		prop.indexCount = 36 * (mesh + 1);
+		prop.modelMatrix = glm::translate(glm::mat4(1.f), glm::vec3(unit(rng) * 400.f - 200.f, 0.f, unit(rng) * -400.f));
+	}
+
+	Camera_t camera;
+	FrameAllocator frameAlloc;
+	RenderQueue queue(&frameAlloc, 0, RenderQueue::SortOrder::FrontToBack);
+	std::vector<glm::mat4> instances(numProp);
+	size_t numDraw = 0;
+	size_t numMismatch = 0;
+	size_t numCovered = 0;
+
+	auto profiler = Profiler::getInstance();
+	for (size_t i = 0; i < numIteration; i++) {
+		auto start = Profiler::Clock::now();
+		for (const auto& prop : props)
+			queue.push(prop);
+		queue.sort(&camera);
+
+		MeshRenderItem_t* items = queue.items();
+		for (size_t j = 0; j < queue.size(); j++) {
+			items[j].instanceIndex = uint32_t(j);
+			instances[j] = items[j].modelMatrix;
+		}
+
+		numDraw = 0;
+		for (size_t j = 0; j < queue.size(); numDraw++)
+			j += instanceRunLength(items + j, queue.size() - j);
+		profiler->addSample("Instancing::queueAndBatch", std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count());
+
+		if (i == numIteration - 1) {
+			for (size_t j = 0; j < queue.size();) {
+				size_t n = instanceRunLength(items + j, queue.size() - j);
+				for (size_t k = 0; k < n; k++) {
+					const MeshRenderItem_t& item = items[j + k];
+					if (item.vao != items[j].vao || item.material != items[j].material || instances[items[j].instanceIndex + k] != item.modelMatrix)
+						numMismatch++;
+				}
+				numCovered += n;
+				j += n;
+			}
+		}
+
+		queue.reset();
+		frameAlloc.clearFrame();
+	}
+
+	profiler->addCounter("Instancing::draws", numDraw);
+	std::cout << "[Benchmark] Instancing: " << numProp << " props, " << numDraw << " draws, mismatched instances " << numMismatch << ", covered " << numCovered << std::endl;
+	return numMismatch == 0 && numCovered == numProp;
+}
+
+REGISTER_BENCHMARK(Instancing, BenchInstancing);
+
+
+
+// 50k props of 16 meshes x 4 materials sharing one pooled vao: sort, then multi draw runs split into per mesh commands.
+// one draw per material is expected, commands must cover every prop. mesh ranges are freed in random order to check coalescing
+static bool BenchMultiDraw() {
+	const size_t numProp = 50000;
+	const size_t numMesh = 16;
+	const size_t numMaterial = 4;
+	const size_t numIteration = 50;
+
+	// sub allocate meshes, then free in random order, coalescing must leave one free range
+	RangeAllocator vertexAlloc(MESH_POOL_STATIC_VERTICES);
+	RangeAllocator indexAlloc(MESH_POOL_INDICES);
+	std::vector<size_t> vertexOffsets(numMesh), indexOffsets(numMesh);
+	for (size_t m = 0; m < numMesh; m++) {
+		vertexAlloc.allocate(24 * (m + 1), vertexOffsets[m]);
+		indexAlloc.allocate(36 * (m + 1), indexOffsets[m]);
+	}
+
+	std::mt19937 rng(7);
+	std::vector<size_t> order(numMesh);
+	for (size_t m = 0; m < numMesh; m++)
+		order[m] = m;
+	std::shuffle(order.begin(), order.end(), rng);
+
+	RangeAllocator churn = indexAlloc;
+	for (size_t m : order)
+		churn.free(indexOffsets[m], 36 * (m + 1));
+	bool isCoalesced = churn.getUsed() == 0 && churn.getNumFreeRanges() == 1;
+
+	uint64_t sharedVAO = 0;
+	std::vector<IMaterial> materials;
+	for (size_t m = 0; m < numMaterial; m++)
+		materials.emplace_back("prop" + std::to_string(m), MaterialType::Phong);
+
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::vector<MeshRenderItem_t> props(numProp);
+	for (auto& prop : props) {
+		size_t mesh = rng() % numMesh;
+		prop.vao = reinterpret_cast<const VertexArray*>(&sharedVAO);
+		prop.material = &materials[mesh % numMaterial];
+		prop.primitive = PrimitiveType::Triangles;
+		prop.indexCount = 36 * (mesh + 1);
+		prop.indexOffset = indexOffsets[mesh];
+		prop.vertexOffset = vertexOffsets[mesh];
+		prop.modelMatrix = glm::translate(glm::mat4(1.f), glm::vec3(unit(rng) * 400.f - 200.f, 0.f, unit(rng) * -400.f));
+	}
+
+	Camera_t camera;
+	FrameAllocator frameAlloc;
+	RenderQueue queue(&frameAlloc, 0, RenderQueue::SortOrder::FrontToBack);
+	size_t numMultiDraw = 0;
+	size_t numCommand = 0;
+	size_t numCovered = 0;
+
+	auto profiler = Profiler::getInstance();
+	for (size_t i = 0; i < numIteration; i++) {
+		auto start = Profiler::Clock::now();
+		for (const auto& prop : props)
+			queue.push(prop);
+		queue.sort(&camera);
+
+		MeshRenderItem_t* items = queue.items();
+		for (size_t j = 0; j < queue.size(); j++)
+			items[j].instanceIndex = uint32_t(j);
+
+		numMultiDraw = 0;
+		numCommand = 0;
+		numCovered = 0;
+		for (size_t j = 0; j < queue.size(); numMultiDraw++) {
+			size_t n = multiDrawRunLength(items + j, queue.size() - j);
+			for (size_t k = 0; k < n; numCommand++) {
+				size_t run = instanceRunLength(items + j + k, n - k);
+				numCovered += run;
+				k += run;
+			}
+			j += n;
+		}
+		profiler->addSample("MultiDraw::queueAndBatch", std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count());
+
+		queue.reset();
+		frameAlloc.clearFrame();
+	}
+
+	profiler->addCounter("MultiDraw::draws", numMultiDraw);
+	profiler->addCounter("MultiDraw::commands", numCommand);
+	std::cout << "[Benchmark] MultiDraw: " << numProp << " props, " << numMultiDraw << " draws, " << numCommand << " commands, covered " << numCovered
+		<< ", allocator coalesced " << (isCoalesced ? "yes" : "no") << std::endl;
+	return numCovered == numProp && isCoalesced;
+}
+
+REGISTER_BENCHMARK(MultiDraw, BenchMultiDraw);
+
+
+
+// cpu stage of a model load, assimp import against mapping its cooked file. both must give the same meshes, joints & clips
+static bool BenchModelLoad() {
+	const size_t numIteration = 10;
+	const double maxCookedMs = 100.0;
+	const int options = MeshLoader::Option::LoadMaterials | MeshLoader::Option::LoadAnimations;
+	std::string file = (FileSystem::Default.getHomeDirectory() / "res" / "models" / "Red Fox.fbx").string();
+
+	auto loader = MeshLoader::getInstance();
+	std::unique_ptr<ModelImport_t> source(loader->import(file, options | MeshLoader::Option::IgnoreCache));
+	std::unique_ptr<ModelImport_t> cooked(loader->import(file, options)); // writes cooked file if missing or stale
+	cooked.reset(ModelCache::read(ModelCache::cookedPath(file), file, options, MeshLoader::Preset::Quality));
+	if (!source || !cooked) {
+		std::cerr << "[Benchmark] ModelLoad: failed to load \"" << file << "\"" << std::endl;
+		return false;
+	}
+
+	const Model* a = source->model.get();
+	const Model* b = cooked->model.get();
+	bool isMatch = a->meshCount() == b->meshCount() && a->animationCount() == b->animationCount()
+		&& a->hasSkeleton() == b->hasSkeleton() && (!a->hasSkeleton() || a->getSkeleton()->size() == b->getSkeleton()->size());
+	for (size_t i = 0; isMatch && i < a->meshCount(); i++) {
+		isMatch = a->meshAt(i)->verticesCount() == b->meshAt(i)->verticesCount()
+			&& a->meshAt(i)->indicesCount() == b->meshAt(i)->indicesCount()
+			&& a->meshAt(i)->getBounds().minimum == b->meshAt(i)->getBounds().minimum
+			&& a->meshAt(i)->getBounds().maximum == b->meshAt(i)->getBounds().maximum
+			&& source->materials[i].diffuseMap == cooked->materials[i].diffuseMap;
+	}
+	source.reset();
+	cooked.reset();
+
+	auto profiler = Profiler::getInstance();
+	double cookedMs = 0.0;
+	for (size_t i = 0; i < numIteration; i++) {
+		auto start = Profiler::Clock::now();
+		source.reset(loader->import(file, options | MeshLoader::Option::IgnoreCache));
+		profiler->addSample("ModelLoad::import", std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count());
+
+		start = Profiler::Clock::now();
+		cooked.reset(loader->import(file, options));
+		double ms = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count();
+		profiler->addSample("ModelLoad::cooked", ms);
+		cookedMs += ms;
+	}
+	cookedMs /= numIteration;
+
+	// cooked path has to stay under the load target, otherwise the cache is not paying for itself
+	bool isFast = cookedMs < maxCookedMs;
+	std::cout << "[Benchmark] ModelLoad: " << file << ", " << numIteration << " loads each path, cooked match " << (isMatch ? "yes" : "no")
+		<< ", cooked " << cookedMs << "ms avg (target < " << maxCookedMs << "ms)" << std::endl;
+	return isMatch && isFast;
+}
+
+REGISTER_BENCHMARK(ModelLoad, BenchModelLoad);
+
+
+
+// every image of res/images through texture manager, synchronous load against background decode with budgeted upload.
+// async main thread cost is addTexture() plus the longest single update, that is what a frame would hitch by
+static bool BenchTextureLoad() {
+	auto texMgr = TextureManager::getInstance();
+	std::vector<std::string> files;
+	for (const auto& entry : fs::directory_iterator(FileSystem::Default.getHomeDirectory() / "res" / "images")) {
+		if (entry.is_regular_file() && entry.path().extension() != COOKED_TEXTURE_EXT)
+			files.push_back(entry.path().filename().string());
+	}
+
+	auto profiler = Profiler::getInstance();
+	bool wasAsync = texMgr->isAsyncLoading();
+	texMgr->removeAllTextures();
+
+	// async first, its reads see a colder file cache than the synchronous pass after it
+	texMgr->setAsyncLoading(true);
+	auto start = Profiler::Clock::now();
+	for (const auto& file : files)
+		texMgr->addTexture(file);
+	double addMs = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count();
+
+	double maxUpdateMs = 0.0;
+	size_t numUpdates = 0;
+	while (texMgr->numLoading() > 0) {
+		auto updateStart = Profiler::Clock::now();
+		texMgr->updateLoading();
+		double updateMs = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - updateStart).count();
+		maxUpdateMs = MAX(maxUpdateMs, updateMs);
+		numUpdates++;
+		std::this_thread::yield();
+	}
+	glFinish();
+	double asyncMs = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count();
+	size_t numAsync = texMgr->textureCount();
+	texMgr->removeAllTextures();
+
+	texMgr->setAsyncLoading(false);
+	start = Profiler::Clock::now();
+	for (const auto& file : files)
+		texMgr->addTexture(file);
+	glFinish();
+	double syncMs = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count();
+	size_t numSync = texMgr->textureCount();
+	texMgr->removeAllTextures();
+	texMgr->setAsyncLoading(wasAsync);
+
+	profiler->addSample("TextureLoad::sync", syncMs);
+	profiler->addSample("TextureLoad::async", asyncMs);
+	profiler->addSample("TextureLoad::asyncAdd", addMs);
+	profiler->addSample("TextureLoad::asyncMaxUpdate", maxUpdateMs);
+	profiler->addCounter("TextureLoad::asyncUpdates", numUpdates);
+	std::cout << "[Benchmark] TextureLoad: " << files.size() << " images, sync " << syncMs << "ms (" << numSync << " loaded), async " << asyncMs << "ms ("
+		<< numAsync << " loaded) in " << numUpdates << " updates, add " << addMs << "ms, longest update " << maxUpdateMs << "ms" << std::endl;
+	return numAsync == numSync;
+}
+
+REGISTER_BENCHMARK(TextureLoad, BenchTextureLoad);
+
+
+
+// cook every image of res/images, report per texture memory against rgba8 with the same mip chain.
+// level 0 is decoded back to check encoder error, psnr over the channels the format keeps
+static bool BenchTextureCook() {
+	static const char* formatNames[] = { "BC1", "BC3", "BC5", "BC7" };
+	static const double minPSNR[] = { 30.0, 30.0, 25.0, 30.0 }; // dB, per format. bc5 normals lose more in flat 2 channel blocks
+	std::vector<fs::path> files;
+	for (const auto& entry : fs::directory_iterator(FileSystem::Default.getHomeDirectory() / "res" / "images")) {
+		if (entry.is_regular_file() && entry.path().extension() != COOKED_TEXTURE_EXT)
+			files.push_back(entry.path());
+	}
+
+	auto profiler = Profiler::getInstance();
+	size_t totalRaw = 0, totalCooked = 0;
+	bool isPassed = true;
+	for (const auto& file : files) {
+		TextureImage_t image;
+		if (!Texture::decodeImage(file.string(), image, true))
+			continue;
+
+		std::string name = file.filename().string();
+		TextureCooker::Options options(true, name.find("normal") != std::string::npos || name.find("Nor ") != std::string::npos);
+		CookedTexture_t cooked;
+		auto start = Profiler::Clock::now();
+		bool isCooked = TextureCooker::cook(image, options, cooked);
+		double cookMs = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count();
+		profiler->addSample("TextureCook::cook", cookMs);
+
+		std::vector<uint8_t> decoded;
+		if (!isCooked || !TextureCooker::decode(cooked, 0, decoded)) {
+			std::cerr << "[Benchmark] TextureCook: " << name << " failed to " << (isCooked ? "decode" : "cook") << std::endl;
+			isPassed = false;
+			continue;
+		}
+
+		int numChannels = cooked.format == CookedTexture_t::BlockFormat::BC1 ? 3 : (cooked.format == CookedTexture_t::BlockFormat::BC5 ? 2 : 4);
+		double squaredError = 0.0;
+		size_t numTexels = size_t(image.width) * image.height;
+		for (size_t i = 0; i < numTexels; i++) {
+			const uint8_t* src = image.pixels + i * image.numChannels;
+			for (int c = 0; c < numChannels; c++) {
+				int value = image.numChannels >= 3 ? (c < image.numChannels ? src[c] : 255) : (c < 3 ? src[0] : (image.numChannels == 2 ? src[1] : 255));
+				double d = double(value) - decoded[i * 4 + c];
+				squaredError += d * d;
+			}
+		}
+		double mse = squaredError / (double(numTexels) * numChannels);
+		double psnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : 99.0;
+		bool isAccurate = psnr >= minPSNR[int(cooked.format)];
+		isPassed = isPassed && isAccurate;
+
+		totalRaw += cooked.uncompressedSize();
+		totalCooked += cooked.size();
+		std::cout << "[Benchmark] TextureCook: " << name << " " << image.width << "x" << image.height << " " << formatNames[int(cooked.format)]
+			<< ", " << cooked.levels.size() << " levels, " << (cooked.uncompressedSize() / 1024) << "KB -> " << (cooked.size() / 1024) << "KB, saved "
+			<< ((cooked.uncompressedSize() - cooked.size()) / 1024) << "KB, psnr " << psnr << "dB" << (isAccurate ? "" : " (below floor)") << ", " << cookMs << "ms" << std::endl;
+	}
+
+	profiler->addCounter("TextureCook::savedBytes", double(totalRaw - totalCooked));
+	std::cout << "[Benchmark] TextureCook: " << files.size() << " images, " << (totalRaw / (1024 * 1024)) << "MB rgba8 -> " << (totalCooked / (1024 * 1024))
+		<< "MB compressed" << std::endl;
+	return isPassed;
+}
+
+REGISTER_BENCHMARK(TextureCook, BenchTextureCook);
+
+
+
+// cpu reference of the compute blur against every discrete tap at full resolution.
+// paired taps alone must match it, pyramid trades a little error for cost that stays flat as sigma grows
+static bool BenchGaussianBlur() {
+	const size_t width = 480;
+	const size_t height = 270;
+	const float sigmas[] = { 1.f, 2.f, 4.f, 8.f, 16.f, 25.f };
+	const double maxPairedError = 1e-5;
+	const double maxPyramidMeanError = 5e-3;
+
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::vector<glm::vec4> src(width * height), blurred(width * height), exact(width * height);
+	for (size_t y = 0; y < height; y++) {
+		for (size_t x = 0; x < width; x++) {
+			float checker = (x / 16 + y / 16) % 2 ? 1.f : 0.f;
+			src[y * width + x] = glm::vec4(checker, unit(rng), float(x) / width, 1.f);
+		}
+	}
+
+	auto profiler = Profiler::getInstance();
+	GaussianBlurKernelCache cache;
+	bool isPassed = true;
+	for (float sigma : sigmas) {
+		int kernelSize = int(std::ceil(sigma * 3.f)) * 2 + 1;
+		auto start = Profiler::Clock::now();
+		GaussianBlurKernelCache::blurExact(src.data(), exact.data(), width, height, sigma, kernelSize);
+		double exactMs = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count();
+
+		for (int isPyramid = 0; isPyramid < 2; isPyramid++) {
+			const GaussianBlurKernel_t& kernel = cache.getKernel(sigma, kernelSize, isPyramid != 0);
+			start = Profiler::Clock::now();
+			GaussianBlurKernelCache::blurReference(src.data(), blurred.data(), width, height, kernel);
+			double ms = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count();
+
+			double maxError = 0.0, sumError = 0.0;
+			for (size_t i = 0; i < src.size(); i++) {
+				for (int c = 0; c < 3; c++) {
+					double e = std::abs(double(blurred[i][c]) - exact[i][c]);
+					maxError = MAX(maxError, e);
+					sumError += e;
+				}
+			}
+
+			// paired taps are exact up to float rounding, downsampled levels only approximate
+			double meanError = sumError / (src.size() * 3);
+			isPassed = isPassed && (kernel.levels == 0 ? maxError <= maxPairedError : meanError <= maxPyramidMeanError);
+
+			std::string mode = isPyramid ? "pyramid" : "full";
+			profiler->addSample("GaussianBlur::" + mode + "Sigma" + std::to_string(int(sigma)), ms);
+			std::cout << "[Benchmark] GaussianBlur: sigma " << sigma << " kernel " << kernelSize << " " << mode << ", levels " << kernel.levels
+				<< ", taps " << kernel.tapOffsets.size() << "/" << (kernel.radius + 1) << ", max error " << maxError << ", mean error "
+				<< meanError << ", " << ms << "ms (exact " << exactMs << "ms)" << std::endl;
+		}
+	}
+
+	return isPassed;
+}
+
+REGISTER_BENCHMARK(GaussianBlur, BenchGaussianBlur);
+
+
+
+// deferred-like frame declared & compiled without gpu: debug view nobody reads is culled, transients with disjoint lifetimes
+// share textures, barriers land only before passes reading incoherent writes. recompiling identical declarations hits the cache
+static bool BenchRenderGraph() {
+	const size_t width = 1920;
+	const size_t height = 1080;
+	const size_t numLights = 4;
+	const size_t frames = 1000;
+
+	RenderGraph graph;
+	auto declare = [&]() {
+		graph.reset();
+		RenderGraphHandle gBuffers[4];
+		for (size_t i = 0; i < 4; i++)
+			gBuffers[i] = graph.createTexture("GBuffer" + std::to_string(i), Texture::Format::RGBA16F, width, height);
+		RenderGraphHandle depth = graph.createTexture("SceneDepth", Texture::Format::Depth24_Stencil8, width, height);
+		RenderGraphHandle color = graph.createTexture("SceneColor", Texture::Format::RGBA16F, width, height);
+		RenderGraphHandle bloom = graph.createTexture("Bloom", Texture::Format::RGBA16F, width, height);
+		RenderGraphHandle output = graph.createTexture("Output", Texture::Format::RGBA8, width, height);
+		RenderGraphHandle debug = graph.createTexture("Debug", Texture::Format::RGBA8, width, height);
+		RenderGraphHandle lights = graph.importBuffer("Lights", nullptr);
+		RenderGraphHandle shadowMap = graph.importBuffer("ShadowMap", nullptr);
+
+		size_t pass = graph.addPass("GeometryPass", false, nullptr);
+		for (size_t i = 0; i < 4; i++)
+			graph.writeAttachment(pass, gBuffers[i], RenderTarget::Slot::Color, i);
+		graph.writeAttachment(pass, depth, RenderTarget::Slot::Depth_Stencil);
+		graph.setClearFlags(pass, ClearFlags::Color | ClearFlags::Depth);
+
+		pass = graph.addPass("LightCulling", true, nullptr);
+		graph.write(pass, lights, RenderGraphAccess::Storage);
+
+		// shadow map & main light interleave the way they are declared, scheduler groups scene color passes
+		for (size_t i = 0; i < numLights; i++) {
+			pass = graph.addPass("ShadowMap" + std::to_string(i), false, nullptr);
+			graph.write(pass, shadowMap, RenderGraphAccess::Attachment);
+
+			pass = graph.addPass("MainLight" + std::to_string(i), false, nullptr);
+			for (size_t j = 0; j < 4; j++)
+				graph.read(pass, gBuffers[j], RenderGraphAccess::Sampled);
+			graph.read(pass, shadowMap, RenderGraphAccess::Sampled);
+			graph.writeAttachment(pass, color, RenderTarget::Slot::Color);
+			graph.readAttachment(pass, depth, RenderTarget::Slot::Depth_Stencil);
+			graph.setClearFlags(pass, i == 0 ? ClearFlags::Color : 0);
+		}
+
+		pass = graph.addPass("TiledLighting", true, nullptr);
+		for (size_t j = 0; j < 4; j++)
+			graph.read(pass, gBuffers[j], RenderGraphAccess::Sampled);
+		graph.read(pass, lights, RenderGraphAccess::Storage);
+		graph.read(pass, color, RenderGraphAccess::Image);
+		graph.write(pass, color, RenderGraphAccess::Image);
+
+		pass = graph.addPass("DebugView", false, nullptr);
+		graph.read(pass, gBuffers[1], RenderGraphAccess::Sampled);
+		graph.writeAttachment(pass, debug, RenderTarget::Slot::Color);
+
+		pass = graph.addPass("Bloom", false, nullptr);
+		graph.read(pass, color, RenderGraphAccess::Sampled);
+		graph.writeAttachment(pass, bloom, RenderTarget::Slot::Color);
+		graph.setClearFlags(pass, ClearFlags::Color);
+
+		pass = graph.addPass("Composite", false, nullptr);
+		graph.read(pass, color, RenderGraphAccess::Sampled);
+		graph.read(pass, bloom, RenderGraphAccess::Sampled);
+		graph.writeAttachment(pass, output, RenderTarget::Slot::Color);
+		graph.setClearFlags(pass, ClearFlags::Color);
+
+		graph.setOutput(output);
+	};
+
+	auto start = Profiler::Clock::now();
+	declare();
+	bool ok = graph.compile();
+	double coldMs = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count();
+
+	start = Profiler::Clock::now();
+	for (size_t i = 0; i < frames; i++) {
+		declare();
+		ok = graph.compile() && ok;
+	}
+	double cachedMs = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count() / frames;
+
+	const RenderGraphStats_t& stats = graph.getStats();
+	auto profiler = Profiler::getInstance();
+	profiler->addSample("RenderGraph::compile", coldMs);
+	profiler->addSample("RenderGraph::compileCached", cachedMs);
+	profiler->addCounter("RenderGraph::culled", stats.numCulled);
+	profiler->addCounter("RenderGraph::barriers", stats.numBarriers);
+
+	graph.dump(std::cout);
+	std::cout << "[Benchmark] RenderGraph: " << (ok ? "compiled" : "failed") << ", passes " << stats.numPasses << ", culled " << stats.numCulled
+		<< ", transients " << stats.numTransients << " in " << stats.numTextures << " textures (" << stats.memorySaved / (1024 * 1024) << "MB saved)"
+		<< ", barriers " << stats.numBarriers << ", target switches " << stats.numTargetSwitches << " (declared order " << stats.numTargetSwitchesDeclared
+		<< "), compile " << coldMs << "ms, cached " << cachedMs << "ms" << std::endl;
+
+	// debug view is the one pass nobody reads, tiled lighting & its reader after it are the incoherent writes
+	return ok && stats.numCulled == 1 && stats.numBarriers == 2 && stats.numTextures < stats.numTransients;
+}
+
+REGISTER_BENCHMARK(RenderGraph, BenchRenderGraph);
+
+
+
+// frames of the deferred technique through a real renderer, per lighting mode: its graph has to compile & every pass declared
+// for a scene with opaque & cut out cubes, a shadowed spot light and unshadowed lights of all types has to execute
+static bool BenchDeferredFrame() {
+	const glm::vec2 renderSz(640.f, 360.f);
+	const size_t frames = 4;
+
+	Renderer renderer(renderSz, Renderer::Mode::Deferred);
+	if (!renderer.isValid() || !renderer.initialize()) {
+		std::cerr << "[Benchmark] DeferredFrame: failed to set up deferred renderer." << std::endl;
+		return false;
+	}
+	auto deferred = static_cast<DeferredRenderer*>(renderer.getRenderTechnique());
+
+	auto model = MeshManager::getInstance()->createCube().lock();
+	if (!model || model->meshCount() <= 0) {
+		std::cerr << "[Benchmark] DeferredFrame: failed to create cube." << std::endl;
+		return false;
+	}
+	auto mesh = model->meshAt(0);
+
+	MeshRenderItem_t cube;
+	cube.vao = mesh->vertexArray();
+	cube.vertexCount = mesh->verticesCount();
+	cube.indexCount = mesh->indicesCount();
+	cube.indexOffset = mesh->getIndexOffset();
+	cube.vertexOffset = mesh->getVertexOffset();
+	cube.primitive = mesh->getPrimitiveType();
+	cube.material = MaterialManager::getInstance()->defaultPhongMaterial();
+
+	Camera_t camera;
+	camera.position = glm::vec3(0.f, 4.f, 12.f);
+	camera.lookDirection = glm::normalize(-camera.position);
+	camera.aspectRatio = renderSz.x / renderSz.y;
+	camera.viewMatrix = glm::lookAt(camera.position, glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+	camera.projMatrix = glm::perspective(camera.fov, camera.aspectRatio, camera.near, camera.far);
+	camera.viewport = Viewport_t(0.f, 0.f, renderSz.x, renderSz.y);
+
+	std::vector<Light_t> lights(5);
+	lights[0].type = LightType::DirectioanalLight;
+	lights[0].direction = glm::normalize(glm::vec3(-1.f, -1.f, -1.f));
+	lights[1].type = LightType::PointLight;
+	lights[1].position = glm::vec3(2.f, 2.f, 2.f);
+	lights[1].range = 10.f;
+	lights[2].type = LightType::SpotLight;
+	lights[2].position = glm::vec3(-2.f, 5.f, 0.f);
+	lights[2].direction = glm::vec3(0.f, -1.f, 0.f);
+	lights[2].range = 12.f;
+	lights[2].innerCone = glm::radians(30.f);
+	lights[2].outterCone = glm::radians(45.f);
+	lights[3] = lights[2];
+	lights[3].position = glm::vec3(2.f, 5.f, 0.f);
+	lights[3].shadowType = ShadowType::HardShadow;
+	lights[4].type = LightType::Ambient;
+	lights[4].color = glm::vec3(0.f, 0.f, 0.1f);
+	lights[4].colorEx = glm::vec3(0.f, 0.1f, 0.f);
+	for (auto& light : lights) {
+		light.color = light.type == LightType::Ambient ? light.color : glm::vec3(1.f);
+		light.intensity = 1.f;
+	}
+
+	const char* required[] = { "DepthPrepass", "GeometryPass", "ShadowMap0", "MainLight0", "Lighting", "CutOuts" };
+	DeferredRenderer::LightingMode modes[] = { DeferredRenderer::LightingMode::LightVolume, DeferredRenderer::LightingMode::TiledCompute };
+	bool isPassed = true;
+	for (auto mode : modes) {
+		deferred->setLightingMode(mode);
+		for (size_t i = 0; i < frames; i++) {
+			renderer.submitCamera(camera, true);
+			for (auto& light : lights)
+				renderer.submitLight(light);
+
+			for (int x = -2; x <= 2; x++) {
+				cube.modelMatrix = glm::translate(glm::mat4(1.f), glm::vec3(float(x) * 2.5f, 0.f, 0.f));
+				cube.bounds = mesh->getBounds().transform(cube.modelMatrix);
+				if (x == 0) {
+					renderer.submitCutOutItem(cube);
+				} else {
+					renderer.submitOpaqueItem(cube);
+				}
+			}
+
+			renderer.flush();
+		}
+
+		// every declared pass runs, none is culled away
+		const RenderGraph& graph = deferred->getRenderGraph();
+		const RenderGraphStats_t& stats = graph.getStats();
+		const auto& timings = graph.getTimings();
+		bool isExecuted = stats.numPasses > 0 && stats.numCulled == 0 && graph.getSchedule().size() == stats.numPasses;
+		for (auto name : required)
+			isExecuted = isExecuted && timings.find(name) != timings.end();
+		if (mode == DeferredRenderer::LightingMode::TiledCompute)
+			isExecuted = isExecuted && timings.find("TiledLighting") != timings.end();
+
+		Texture* frame = deferred->getRenderedFrame();
+		isExecuted = isExecuted && frame && frame->getWidth() == size_t(renderSz.x) && frame->getHeight() == size_t(renderSz.y);
+
+		std::cout << "[Benchmark] DeferredFrame: " << (mode == DeferredRenderer::LightingMode::TiledCompute ? "tiled compute" : "light volume")
+			<< ", passes " << stats.numPasses << ", culled " << stats.numCulled << ", transients " << stats.numTransients << " in " << stats.numTextures
+			<< " textures, barriers " << stats.numBarriers << (isExecuted ? "" : ", passes missing") << std::endl;
+		isPassed = isPassed && isExecuted;
+	}
+
+	return isPassed;
+}
+
+REGISTER_BENCHMARK(DeferredFrame, BenchDeferredFrame);
+
+
+
+// point & spot lights over a field of static casters with a few movers that come to rest halfway through.
+// maps are committed without drawing, what counts is how often a light's map has to be redrawn vs drawing every light every frame
+static bool BenchShadowCache() {
+	const size_t gridSize = 48; // casters per side
+	const size_t numMovers = 16;
+	const size_t numPointLights = 4;
+	const size_t numSpotLights = 4;
+	const size_t frames = 240;
+	const size_t moveFrames = frames / 2;
+
+	std::vector<MeshRenderItem_t> items(gridSize * gridSize + numMovers);
+	for (size_t i = 0; i < items.size(); i++) {
+		auto& item = items[i];
+		item.vao = (const VertexArray*)(uintptr_t(1) + i % 5); // a few meshes shared by many casters
+		item.indexCount = 36;
+		float x = float(i % gridSize) * 4.f - gridSize * 2.f;
+		float z = float(i / gridSize) * 4.f - gridSize * 2.f;
+		if (i >= gridSize * gridSize) { // movers start around lights
+			float angle = glm::two_pi<float>() * (i - gridSize * gridSize) / numMovers;
+			x = cosf(angle) * 30.f;
+			z = sinf(angle) * 30.f;
+		}
+		item.modelMatrix = glm::translate(glm::mat4(1.f), glm::vec3(x, 0.f, z));
+		item.bounds = AABB_t(glm::vec3(x - 1.f, 0.f, z - 1.f), glm::vec3(x + 1.f, 2.f, z + 1.f));
+	}
+
+	std::array<Light_t, numPointLights + numSpotLights> lights;
+	for (size_t i = 0; i < lights.size(); i++) {
+		float angle = glm::two_pi<float>() * i / lights.size();
+		lights[i].type = i < numPointLights ? LightType::PointLight : LightType::SpotLight;
+		lights[i].position = glm::vec3(cosf(angle), 0.3f, sinf(angle)) * 40.f;
+		lights[i].direction = glm::normalize(glm::vec3(-cosf(angle), -0.5f, -sinf(angle)));
+		lights[i].range = 30.f;
+		lights[i].outterCone = glm::radians(60.f);
+	}
+
+	Scene_t scene;
+	scene.opaqueItems = items.data();
+	scene.numOpaqueItems = items.size();
+	scene.numOpaqueCasters = items.size();
+
+	ShadowCasterTracker tracker;
+	ShadowMapCache pointCache(Texture::Target::Texture_CubeMap, 6, []() { return std::unique_ptr<RenderTarget>(); });
+	ShadowMapCache spotCache(Texture::Target::Texture_2D, 1, []() { return std::unique_ptr<RenderTarget>(); });
+
+	std::mt19937 rng(5);
+	std::uniform_real_distribution<float> unit(-1.f, 1.f);
+	// a light with a mover in reach this frame or last must not keep its map, tested on bounds without the casters cullers
+	auto isInReach = [](const Light_t& light, const AABB_t& bounds) {
+		if (light.type == LightType::PointLight) {
+			glm::vec3 d = light.position - glm::clamp(light.position, bounds.minimum, bounds.maximum);
+			return glm::length(d) <= light.range;
+		}
+
+		glm::vec3 toCenter = (bounds.minimum + bounds.maximum) * 0.5f - light.position;
+		float dist = glm::length(toCenter);
+		return dist <= light.range && glm::dot(toCenter / dist, glm::normalize(light.direction)) >= cosf(light.outterCone * 0.5f);
+	};
+
+	ShadowCacheStats_t total;
+	size_t numSelected = 0;
+	size_t numStale = 0;
+	std::vector<AABB_t> lastBounds(numMovers);
+	auto profiler = Profiler::getInstance();
+	auto start = Profiler::Clock::now();
+	for (size_t frame = 0; frame < frames; frame++) {
+		auto frameStart = Profiler::Clock::now();
+		if (frame < moveFrames) {
+			for (size_t i = gridSize * gridSize; i < items.size(); i++) {
+				lastBounds[i - gridSize * gridSize] = items[i].bounds;
+				glm::vec3 step(unit(rng), 0.f, unit(rng));
+				items[i].modelMatrix = glm::translate(items[i].modelMatrix, step);
+				items[i].bounds = AABB_t(items[i].bounds.minimum + step, items[i].bounds.maximum + step);
+			}
+		}
+
+		tracker.update(scene);
+		for (const auto& light : lights) {
+			bool isPoint = light.type == LightType::PointLight;
+			ShadowMapCache& cache = isPoint ? pointCache : spotCache;
+			auto culler = [&](const MeshRenderItem_t* casters, size_t count, uint8_t* masks) {
+				if (isPoint) {
+					PointLightShadowMapping::cullCasters(light, casters, count, masks);
+				}
+				else {
+					SpotLightShadowMapping::cullCasters(light, casters, count, masks);
+				}
+			};
+
+			bool isMoved = false;
+			for (size_t i = 0; frame > 0 && frame < moveFrames && i < numMovers; i++)
+				isMoved = isMoved || isInReach(light, items[gridSize * gridSize + i].bounds) || isInReach(light, lastBounds[i]);
+
+			if (cache.begin(scene, &tracker, ShadowCasterTracker::lightKey(light), ShadowCasterTracker::lightSignature(light), culler)) {
+				cache.commit(&tracker);
+			}
+			else if (isMoved) {
+				numStale++;
+			}
+			numSelected += cache.numSelected();
+		}
+
+		const ShadowCacheStats_t& stats = tracker.getStats();
+		total.numHits += stats.numHits;
+		total.numRendered += stats.numRendered;
+		total.numStaticRendered += stats.numStaticRendered;
+		total.numLightCulled += stats.numLightCulled;
+		profiler->addSample("ShadowCache::frame", std::chrono::duration<double, std::milli>(Profiler::Clock::now() - frameStart).count());
+		profiler->addCounter("ShadowCache::hits", stats.numHits);
+		profiler->addCounter("ShadowCache::rendered", stats.numRendered);
+	}
+	double ms = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count() / frames;
+	size_t numLastRendered = tracker.getStats().numRendered; // everything settled long before last frame
+
+	size_t numUncached = frames * lights.size();
+	std::cout << "[Benchmark] ShadowCache: " << lights.size() << " lights, " << items.size() << " casters (" << numMovers << " moving for "
+		<< moveFrames << " of " << frames << " frames), maps rendered " << total.numRendered << "/" << numUncached << ", hits " << total.numHits
+		<< ", static layers rendered " << total.numStaticRendered << ", casters per light " << double(numSelected) / numUncached << "/" << items.size()
+		<< ", tracked " << tracker.numTracked() << ", stale maps " << numStale << ", " << ms << "ms per frame" << std::endl;
+
+	return numStale == 0 && numLastRendered == 0 && total.numRendered < numUncached;
+}
+
+REGISTER_BENCHMARK(ShadowCache, BenchShadowCache);
@@ -0,0 +1,24 @@
+#pragma once
+#include"Singleton.h"
+#include<functional>
+#include<map>
+#include<string>
+#include<vector>
+
+
+// named micro benchmarks, run from headless mode (--bench name), timings go to Profiler.
+// a benchmark returns false when its result checks fail, headless run then exits with failure
+class BenchmarkRegistry : public Singleton<BenchmarkRegistry> {
+public:
+	typedef std::function<bool()> Benchmark;
+
+	bool add(const std::string& name, Benchmark bench);
+	bool run(const std::string& name); // false if unknown or failed
+	std::vector<std::string> names() const;
+
+private:
+	std::map<std::string, Benchmark> m_benchmarks;
+};
+
+
+#define REGISTER_BENCHMARK(name, func) static bool _benchmark_##name = BenchmarkRegistry::getInstance()->add(#name, func)
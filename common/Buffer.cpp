@@ -1,5 +1,7 @@
 #include"Buffer.h"
 #include"Util.h"
+#include"GLStateCache.h"
+#include<cstring>
 
 Buffer::Buffer(): m_handler(0)
 , m_size(0)
@@ -20,19 +22,19 @@ Buffer::~Buffer() {
 }
 
 void Buffer::bind(Target target) const {
-	GLCALL(glBindBuffer(int(target), m_handler));
+	GLStateCache::getInstance()->bindBuffer(GLenum(target), m_handler);
 	m_target = target;
 	m_targetIdx = -1;
 }
 
 void Buffer::bindBase(Target target, size_t index) const {
-	GLCALL(glBindBufferBase(int(target), index, m_handler));
+	GLStateCache::getInstance()->bindBufferBase(GLenum(target), index, m_handler);
 	m_target = target;
 	m_targetIdx = index;
 }
 
 void Buffer::bindRange(Target target, size_t index, size_t dataOffset, size_t dataSz) const {
-	GLCALL(glBindBufferRange(int(target), index, m_handler, dataOffset, dataSz));
+	GLStateCache::getInstance()->bindBufferRange(GLenum(target), index, m_handler, dataOffset, dataSz);
 	m_target = target;
 	m_targetIdx = index;
 }
@@ -40,10 +42,10 @@ void Buffer::bindRange(Target target, size_t index, size_t dataOffset, size_t da
 void Buffer::unbind() const {
 	if (m_target != Target::Unknown) {
 		if (m_targetIdx < 0) {
-			GLCALL(glBindBuffer(int(m_target), 0));
+			GLStateCache::getInstance()->bindBuffer(GLenum(m_target), 0);
 		}
 		else {
-			GLCALL(glBindBufferBase(GLenum(m_target), m_targetIdx, 0));
+			GLStateCache::getInstance()->bindBufferBase(GLenum(m_target), m_targetIdx, 0);
 		}
 		m_target = Target::Unknown;
 		m_targetIdx = -1;
@@ -70,6 +72,14 @@ bool Buffer::loadSubData(const void* data, size_t dataOffset, size_t dataSz) {
 	return true;
 }
 
+bool Buffer::clearData() {
+	if (m_target == Target::Unknown)
+		return false;
+
+	GLCALL(glClearBufferData(int(m_target), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr));
+	return true;
+}
+
 void* Buffer::map(Buffer::MapAccess access) {
 	GLCALL(void* mapped = glMapBuffer(int(m_target), GLenum(access)));
 	return mapped;
@@ -89,10 +99,133 @@ void Buffer::release() {
 	if (m_handler) {
 		unbind();
 		glDeleteBuffers(1, &m_handler);
+		GLStateCache::getInstance()->onDeleteBuffer(m_handler);
 		m_handler = 0;
 		m_size = 0;
 		m_elementCount = 0;
 		m_target = Target::Unknown;
 		m_usage = Usage::Unknown;
 	}
-}
\ No newline at end of file
+}
+
+
+
+RingBuffer::RingBuffer() :Buffer()
+, m_mapped(nullptr)
+, m_regionSize(0)
+, m_alignment(1)
+, m_region(0)
+, m_offset(0)
+, m_numOverflows(0)
+, m_fences() {
+
+}
+
+
+RingBuffer::~RingBuffer() {
+	releaseFences();
+}
+
+
+bool RingBuffer::initialize(size_t regionSize) {
+	if (m_mapped || regionSize == 0)
+		return false;
+
+	// block offsets must satisfy both uniform & storage buffer binding alignment
+	GLint uboAlignment = 1, ssboAlignment = 1;
+	GLCALL(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment));
+	GLCALL(glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssboAlignment));
+	m_alignment = size_t(MAX(MAX(uboAlignment, ssboAlignment), 1));
+	m_regionSize = (regionSize + m_alignment - 1) / m_alignment * m_alignment;
+
+	size_t size = m_regionSize * RING_BUFFER_NUM_REGIONS;
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	bind(Target::CopyWriteBuffer);
+	GLCALL(glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags));
+	GLCALL(m_mapped = (uint8_t*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+	unbind();
+
+	if (!m_mapped)
+		return false;
+
+	m_size = size;
+	m_usage = Usage::StreamDraw;
+	m_region = 0;
+	m_offset = 0;
+
+	return true;
+}
+
+
+void RingBuffer::beginFrame() {
+	m_offset = 0;
+	m_numOverflows = 0;
+
+	GLsync& fence = m_fences[m_region];
+	if (!fence)
+		return;
+
+	// flush on first wait so the fence is sure to signal
+	GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	while (true) {
+		GLCALL(GLenum result = glClientWaitSync(fence, waitFlags, 1000000));
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+			break;
+		waitFlags = 0;
+	}
+
+	GLCALL(glDeleteSync(fence));
+	fence = nullptr;
+}
+
+
+void RingBuffer::endFrame() {
+	if (!m_mapped)
+		return;
+
+	GLsync& fence = m_fences[m_region];
+	if (fence) {
+		GLCALL(glDeleteSync(fence));
+	}
+	GLCALL(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+	m_region = (m_region + 1) % RING_BUFFER_NUM_REGIONS;
+}
+
+
+bool RingBuffer::bindData(Target target, size_t index, const void* data, size_t dataSz, size_t bindSz) {
+	bindSz = MAX(bindSz, dataSz);
+	size_t offset = 0;
+	void* dst = allocate(bindSz, offset);
+	if (!dst)
+		return false;
+
+	memcpy(dst, data, dataSz);
+	bindRange(target, index, offset, bindSz);
+
+	return true;
+}
+
+
+void* RingBuffer::allocate(size_t dataSz, size_t& offset) {
+	if (!m_mapped || m_offset + dataSz > m_regionSize) {
+		m_numOverflows++;
+		return nullptr;
+	}
+
+	offset = m_region * m_regionSize + m_offset;
+	m_offset = MIN((m_offset + dataSz + m_alignment - 1) / m_alignment * m_alignment, m_regionSize);
+
+	return m_mapped + offset;
+}
+
+
+void RingBuffer::releaseFences() {
+	for (auto& fence : m_fences) {
+		if (fence) {
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	m_mapped = nullptr;
+}
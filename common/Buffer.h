@@ -1,7 +1,11 @@
 #pragma once
 #include<glad/glad.h>
+#include<cstdint>
 
 
+// frames in flight a ring buffer keeps separate regions for
+#define RING_BUFFER_NUM_REGIONS 3
+
 
 class Buffer {
 public:
@@ -18,6 +22,7 @@ public:
 		PixelPackBuffer = GL_PIXEL_PACK_BUFFER,
 		PixelUnpackBuffer = GL_PIXEL_UNPACK_BUFFER,
 		AtomicCounterBuffer = GL_ATOMIC_COUNTER_BUFFER,
+		DrawIndirectBuffer = GL_DRAW_INDIRECT_BUFFER,
 	};
 
 	enum class Usage {
@@ -68,6 +73,7 @@ public:
 
 	bool loadData(const void* data, size_t dataSz, Usage usage, size_t elementCnt = 0);
 	bool loadSubData(const void* data, size_t dataOffset, size_t dataSz); //updates a subset of a buffer's data store
+	bool clearData(); // zero whole data store on gpu, no cpu sync
 
 	void* map(MapAccess access);
 	void* mapRange(MapBitFiled mbf, size_t offset, size_t len);
@@ -105,4 +111,53 @@ protected:
 	mutable int m_targetIdx;
 	Usage m_usage;
 
-};
\ No newline at end of file
+};
+
+
+
+//
+// persistently mapped buffer cut into one region per frame in flight.
+// small per draw blocks are copied into the current region and bound by range, so no upload goes through driver.
+// region is fenced at end of frame, cpu waits for the fence before the region is written again.
+//
+class RingBuffer : public Buffer {
+public:
+	RingBuffer();
+	~RingBuffer();
+
+	bool initialize(size_t regionSize); // bytes available per frame
+	void beginFrame(); // wait until gpu released current region
+	void endFrame(); // fence current region and move to next
+
+	// copy data into current region and bind it to indexed target, false if region is full.
+	// bindSz larger than dataSz binds a range of the size the shader declares, bytes past data are left undefined
+	bool bindData(Target target, size_t index, const void* data, size_t dataSz, size_t bindSz = 0);
+
+	// reserve bytes in current region for caller to write directly, offset is from buffer start. nullptr if region is full
+	void* allocate(size_t dataSz, size_t& offset);
+
+	inline size_t getRegionSize() const {
+		return m_regionSize;
+	}
+
+	// since beginFrame()
+	inline size_t getBytesStreamed() const {
+		return m_offset;
+	}
+
+	inline size_t getNumOverflows() const {
+		return m_numOverflows;
+	}
+
+protected:
+	void releaseFences();
+
+private:
+	uint8_t* m_mapped;
+	size_t m_regionSize;
+	size_t m_alignment;
+	size_t m_region;
+	size_t m_offset;
+	size_t m_numOverflows;
+	GLsync m_fences[RING_BUFFER_NUM_REGIONS];
+};
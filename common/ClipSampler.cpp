@@ -0,0 +1,312 @@
+#include"ClipSampler.h"
+#include"Util.h"
+#include<cmath>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include<emmintrin.h>
+#define CLIP_SAMPLER_SSE
+#endif
+
+
+#define DEFAULT_BEHAVIOR_PRE 0x1
+#define DEFAULT_BEHAVIOR_POST 0x2
+
+
+ClipSampler::Channel::Channel(ChannelType t) :type(t)
+, jointIds()
+, keyOffsets()
+, keyCounts()
+, defaultBehaviors()
+, times()
+, values() {
+
+}
+
+
+void ClipSampler::Channel::clear() {
+	jointIds.clear();
+	keyOffsets.clear();
+	keyCounts.clear();
+	defaultBehaviors.clear();
+	times.clear();
+	for (auto& v : values)
+		v.clear();
+}
+
+
+
+ClipSampler::ClipSampler() :m_positions(ChannelType::Position)
+, m_scales(ChannelType::Scale)
+, m_rotations(ChannelType::Rotation)
+, m_scalarTracks()
+, m_isValid(false) {
+
+}
+
+
+void ClipSampler::clear() {
+	m_positions.clear();
+	m_scales.clear();
+	m_rotations.clear();
+	m_scalarTracks.clear();
+	m_isValid = false;
+}
+
+
+void ClipSampler::build(std::vector<TransformTrack>& tracks) {
+	clear();
+
+	for (size_t i = 0; i < tracks.size(); i++) {
+		TransformTrack& track = tracks[i];
+		if (!track.isValid())
+			continue;
+
+		VectorTrack& positions = track.getPositionTrack();
+		VectorTrack& scales = track.getScaleTrack();
+		QuaternionTrack& rotations = track.getRotationTrack();
+		bool isLinear = (!positions.isValid() || positions.getInterpolationType() == InterpolationType::Linear)
+			&& (!scales.isValid() || scales.getInterpolationType() == InterpolationType::Linear)
+			&& (!rotations.isValid() || rotations.getInterpolationType() == InterpolationType::Linear);
+
+		if (!isLinear) {
+			m_scalarTracks.push_back(uint32_t(i));
+			continue;
+		}
+
+		if (positions.isValid())
+			addTrack(m_positions, track.getJointId(), positions);
+		if (scales.isValid())
+			addTrack(m_scales, track.getJointId(), scales);
+		if (rotations.isValid())
+			addTrack(m_rotations, track.getJointId(), rotations);
+	}
+
+	m_isValid = true;
+}
+
+
+template<typename T>
+void ClipSampler::addTrack(Channel& channel, int jointId, KeyFrameTrack<T>& track) {
+	uint8_t behaviors = 0;
+	if (track.m_preBehavior == KeyFrameTrack<T>::Behavior::Defualt)
+		behaviors |= DEFAULT_BEHAVIOR_PRE;
+	if (track.m_postBehavior == KeyFrameTrack<T>::Behavior::Defualt)
+		behaviors |= DEFAULT_BEHAVIOR_POST;
+
+	channel.jointIds.push_back(jointId);
+	channel.keyOffsets.push_back(uint32_t(channel.times.size()));
+	channel.keyCounts.push_back(uint32_t(track.size()));
+	channel.defaultBehaviors.push_back(behaviors);
+
+	for (size_t k = 0; k < track.size(); k++) {
+		channel.times.push_back(track[k].m_time);
+		storeValue(channel, track[k].m_value);
+	}
+
+	channel.times.push_back(track.getEndTime());
+	storeValue(channel, track.m_defualtVal);
+}
+
+
+void ClipSampler::storeValue(Channel& channel, const glm::vec3& v) {
+	channel.values[0].push_back(v.x);
+	channel.values[1].push_back(v.y);
+	channel.values[2].push_back(v.z);
+	channel.values[3].push_back(0.f);
+}
+
+
+void ClipSampler::storeValue(Channel& channel, const glm::quat& q) {
+	channel.values[0].push_back(q.x);
+	channel.values[1].push_back(q.y);
+	channel.values[2].push_back(q.z);
+	channel.values[3].push_back(q.w);
+}
+
+
+void ClipSampler::sample(const std::vector<TransformTrack>& tracks, const Pose& inPose, Pose& outPose, float time, LoopType loop, int* cursors) const {
+	if (&inPose != &outPose)
+		outPose = inPose;
+
+	// cursors: positions, scales, rotations, then 3 per scalar track
+	int* positionCursors = cursors;
+	int* scaleCursors = cursors ? positionCursors + m_positions.size() : nullptr;
+	int* rotationCursors = cursors ? scaleCursors + m_scales.size() : nullptr;
+	int* scalarCursors = cursors ? rotationCursors + m_rotations.size() : nullptr;
+
+	sampleChannel(m_positions, outPose, time, loop, positionCursors);
+	sampleChannel(m_scales, outPose, time, loop, scaleCursors);
+	sampleChannel(m_rotations, outPose, time, loop, rotationCursors);
+
+	for (size_t i = 0; i < m_scalarTracks.size(); i++) {
+		const TransformTrack& track = tracks[m_scalarTracks[i]];
+		track.sample(inPose[track.getJointId()], outPose[track.getJointId()], time, loop, scalarCursors ? scalarCursors + i * 3 : nullptr);
+	}
+}
+
+
+void ClipSampler::resolveKeys(const Channel& channel, size_t track, float time, LoopType loop, uint32_t& key0, uint32_t& key1, float& t, int* cursor) const {
+	// same rules as KeyFrameTrack::sample, result is lerp(key0, key1, t)
+	uint32_t offset = channel.keyOffsets[track];
+	uint32_t count = channel.keyCounts[track];
+	const float* times = &channel.times[offset];
+	float startTime = times[0];
+	float endTime = times[count - 1];
+	uint8_t behaviors = channel.defaultBehaviors[track];
+
+	t = 0.f;
+	if ((time < startTime && (behaviors & DEFAULT_BEHAVIOR_PRE))
+		|| (time > endTime && loop == LoopType::NoLoop && (behaviors & DEFAULT_BEHAVIOR_POST))) {
+		key0 = key1 = offset + count;
+		return;
+	}
+
+	// fit to track, play direction of ping pong doesn't matter to linear interpolation
+	if (time < startTime) {
+		time = startTime;
+	} else if (loop == LoopType::NoLoop) {
+		time = MIN(time, endTime);
+	} else {
+		float duration = endTime - startTime;
+		float relativeTime = time - startTime;
+		float remainder = fmodf(relativeTime, duration);
+		if (remainder < 0.f)
+			remainder += duration;
+
+		if (loop == LoopType::Loop) {
+			time = remainder + startTime;
+		} else {
+			int loopCnt = relativeTime / duration;
+			time = loopCnt % 2 == 0 ? remainder + startTime : endTime - remainder;
+		}
+	}
+
+	// last key at or before time, a key within epsilon after time counts as hit
+	int frame = searchKeyFrame(int(count), [times, time](int k) { return times[k] <= time; }, cursor);
+	if (frame + 1 < int(count) && epslion_equal(times[frame + 1], time)) {
+		key0 = key1 = offset + frame + 1;
+		return;
+	}
+
+	if (frame < 0 || frame >= int(count) - 1 || epslion_equal(times[frame], time)) {
+		frame = frame < 0 ? 0 : frame;
+		key0 = key1 = offset + frame;
+		return;
+	}
+
+	key0 = offset + frame;
+	key1 = key0 + 1;
+	t = (time - times[frame]) / (times[frame + 1] - times[frame]);
+}
+
+
+void ClipSampler::sampleChannel(const Channel& channel, Pose& outPose, float time, LoopType loop, int* cursors) const {
+	const bool isRotation = channel.type == ChannelType::Rotation;
+	const size_t numComponents = isRotation ? 4 : 3;
+	const size_t numTracks = channel.size();
+
+	for (size_t base = 0; base < numTracks; base += 4) {
+		size_t numLanes = MIN(numTracks - base, 4);
+
+		// scalar key search, unused lanes repeat the first one
+		uint32_t key0[4];
+		uint32_t key1[4];
+		float t[4];
+		for (size_t lane = 0; lane < numLanes; lane++) {
+			size_t track = base + lane;
+			resolveKeys(channel, track, time, loop, key0[lane], key1[lane], t[lane], cursors ? cursors + track : nullptr);
+		}
+		for (size_t lane = numLanes; lane < 4; lane++) {
+			key0[lane] = key0[0];
+			key1[lane] = key1[0];
+			t[lane] = t[0];
+		}
+
+		float a[4][4];
+		float b[4][4];
+		for (size_t c = 0; c < numComponents; c++) {
+			const float* values = channel.values[c].data();
+			for (size_t lane = 0; lane < 4; lane++) {
+				a[c][lane] = values[key0[lane]];
+				b[c][lane] = values[key1[lane]];
+			}
+		}
+
+		float result[4][4];
+#ifdef CLIP_SAMPLER_SSE
+		__m128 weight = _mm_loadu_ps(t);
+		if (!isRotation) {
+			for (size_t c = 0; c < 3; c++) {
+				__m128 va = _mm_loadu_ps(a[c]);
+				__m128 vb = _mm_loadu_ps(b[c]);
+				_mm_storeu_ps(result[c], _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), weight)));
+			}
+		} else {
+			__m128 ax = _mm_loadu_ps(a[0]), ay = _mm_loadu_ps(a[1]), az = _mm_loadu_ps(a[2]), aw = _mm_loadu_ps(a[3]);
+			__m128 bx = _mm_loadu_ps(b[0]), by = _mm_loadu_ps(b[1]), bz = _mm_loadu_ps(b[2]), bw = _mm_loadu_ps(b[3]);
+
+			// take the short way, flip b when it's in the other hemisphere
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+			__m128 flip = _mm_and_ps(_mm_cmplt_ps(d, _mm_setzero_ps()), _mm_set1_ps(-0.f));
+			bx = _mm_xor_ps(bx, flip);
+			by = _mm_xor_ps(by, flip);
+			bz = _mm_xor_ps(bz, flip);
+			bw = _mm_xor_ps(bw, flip);
+
+			__m128 invWeight = _mm_sub_ps(_mm_set1_ps(1.f), weight);
+			__m128 rx = _mm_add_ps(_mm_mul_ps(ax, invWeight), _mm_mul_ps(bx, weight));
+			__m128 ry = _mm_add_ps(_mm_mul_ps(ay, invWeight), _mm_mul_ps(by, weight));
+			__m128 rz = _mm_add_ps(_mm_mul_ps(az, invWeight), _mm_mul_ps(bz, weight));
+			__m128 rw = _mm_add_ps(_mm_mul_ps(aw, invWeight), _mm_mul_ps(bw, weight));
+
+			__m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw))));
+			rx = _mm_div_ps(rx, len);
+			ry = _mm_div_ps(ry, len);
+			rz = _mm_div_ps(rz, len);
+			rw = _mm_div_ps(rw, len);
+
+			// a key hit is returned as stored, without normalization
+			__m128i hitI = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(key0)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(key1)));
+			__m128 hit = _mm_castsi128_ps(hitI);
+			_mm_storeu_ps(result[0], _mm_or_ps(_mm_and_ps(hit, ax), _mm_andnot_ps(hit, rx)));
+			_mm_storeu_ps(result[1], _mm_or_ps(_mm_and_ps(hit, ay), _mm_andnot_ps(hit, ry)));
+			_mm_storeu_ps(result[2], _mm_or_ps(_mm_and_ps(hit, az), _mm_andnot_ps(hit, rz)));
+			_mm_storeu_ps(result[3], _mm_or_ps(_mm_and_ps(hit, aw), _mm_andnot_ps(hit, rw)));
+		}
+#else
+		for (size_t lane = 0; lane < 4; lane++) {
+			if (!isRotation) {
+				for (size_t c = 0; c < 3; c++)
+					result[c][lane] = a[c][lane] + (b[c][lane] - a[c][lane]) * t[lane];
+				continue;
+			}
+
+			glm::quat qa(a[3][lane], a[0][lane], a[1][lane], a[2][lane]);
+			glm::quat qb(b[3][lane], b[0][lane], b[1][lane], b[2][lane]);
+			glm::quat q = key0[lane] == key1[lane] ? qa : nlerp(qa, qb, t[lane]);
+			result[0][lane] = q.x;
+			result[1][lane] = q.y;
+			result[2][lane] = q.z;
+			result[3][lane] = q.w;
+		}
+#endif // CLIP_SAMPLER_SSE
+
+		for (size_t lane = 0; lane < numLanes; lane++) {
+			int jointId = channel.jointIds[base + lane];
+			if (jointId < 0 || jointId >= int(outPose.size()))
+				continue;
+
+			Transform& joint = outPose[jointId];
+			switch (channel.type) {
+			case ChannelType::Position:
+				joint.position = glm::vec3(result[0][lane], result[1][lane], result[2][lane]);
+				break;
+			case ChannelType::Scale:
+				joint.scale = glm::vec3(result[0][lane], result[1][lane], result[2][lane]);
+				break;
+			case ChannelType::Rotation:
+				joint.rotation = glm::quat(result[3][lane], result[0][lane], result[1][lane], result[2][lane]);
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include"TransformTrack.h"
+#include"Pose.h"
+#include<vector>
+#include<cstdint>
+
+
+//
+// batched sampler of all joint tracks of a clip.
+// linear position/scale/rotation tracks are flattened into structure of arrays key storage,
+// keys are located per track, then lerp/nlerp is evaluated 4 joints at a time with sse.
+// tracks using other interpolation are kept on the per track path.
+// must be rebuilt after tracks are edited.
+//
+class ClipSampler {
+public:
+	ClipSampler();
+
+	void build(std::vector<TransformTrack>& tracks);
+	void clear();
+
+	// time is already fit to clip, tracks must be the ones used to build.
+	// cursors is null or cursorCount() key search states kept by the caller between samples
+	void sample(const std::vector<TransformTrack>& tracks, const Pose& inPose, Pose& outPose, float time, LoopType loop, int* cursors = nullptr) const;
+
+	inline bool isValid() const {
+		return m_isValid;
+	}
+
+	inline size_t cursorCount() const {
+		return m_positions.size() + m_scales.size() + m_rotations.size() + m_scalarTracks.size() * 3;
+	}
+
+protected:
+	enum class ChannelType {
+		Position,
+		Scale,
+		Rotation,
+	};
+
+	// one kind of key frame track of every joint, keys of all tracks packed back to back
+	struct Channel {
+		ChannelType type;
+		std::vector<int> jointIds;
+		std::vector<uint32_t> keyOffsets; // first key of each track, default value is stored after the last key
+		std::vector<uint32_t> keyCounts;
+		std::vector<uint8_t> defaultBehaviors; // bit 0: pre, bit 1: post
+		std::vector<float> times;
+		std::vector<float> values[4]; // x, y, z, w
+
+		Channel(ChannelType t);
+		void clear();
+		size_t size() const { return jointIds.size(); }
+	};
+
+	template<typename T>
+	void addTrack(Channel& channel, int jointId, KeyFrameTrack<T>& track);
+
+	static void storeValue(Channel& channel, const glm::vec3& v);
+	static void storeValue(Channel& channel, const glm::quat& q);
+
+	void sampleChannel(const Channel& channel, Pose& outPose, float time, LoopType loop, int* cursors) const;
+	void resolveKeys(const Channel& channel, size_t track, float time, LoopType loop, uint32_t& key0, uint32_t& key1, float& t, int* cursor) const;
+
+private:
+	Channel m_positions;
+	Channel m_scales;
+	Channel m_rotations;
+	std::vector<uint32_t> m_scalarTracks; // index of tracks sampled one by one
+	bool m_isValid;
+};
@@ -16,6 +16,7 @@ public:
 	
 	virtual bool initialize() { return true; }
 	virtual void update(double dt) {}
+	virtual bool isConcurrentUpdate() const { return false; } // update() touches nothing but itself, may run on job threads
 	virtual Component* copy() const = 0;
 	virtual void onAttached();
 	virtual void onDetached();
@@ -10,16 +10,33 @@
 #include"SpotLightShadowMapping.h"
 #include"DirectionalLightShadowMapping.h"
 #include"PointLightShadowMapping.h"
+#include"LightClusterBuilder.h"
+#include"GLStateCache.h"
 #include<sstream>
 #include<glm/gtc/type_ptr.hpp>
+#include<glm/gtc/matrix_transform.hpp>
+#include<glm/gtc/constants.hpp>
+
+
+// light volume tessellation, the sphere has rings from pole to pole
+#define LIGHT_VOLUME_RINGS 8
+#define LIGHT_VOLUME_SEGMENTS 12
+
+// spot lights wider than this (60 degrees) are bounded by the point light sphere instead of a cone
+#define MAX_SPOT_VOLUME_HALF_ANGLE 1.0472f
+
+// screen tile per work group of tiled lighting, must match TiledDeferredLighting.shader
+#define TILED_LIGHTING_TILE_SIZE 16.f
 
 
 const std::string DeferredRenderer::s_identifier = "DeferredRenderer";
 
 
 DeferredRenderer::DeferredRenderer(Renderer* renderer): RenderTechniqueBase(renderer)
-, m_gBufferTarget(renderer->getRenderSize())
-, m_outputTarget(renderer->getRenderSize())
+, m_renderGraph(renderer)
+, m_sceneDepth(RENDER_GRAPH_NULL_HANDLE)
+, m_sceneColor(RENDER_GRAPH_NULL_HANDLE)
+, m_renderedFrame(nullptr)
 , m_directionalLightUBO(nullptr)
 , m_pointLightUBO(nullptr)
 , m_spotLightUBO(nullptr)
@@ -27,11 +44,25 @@ DeferredRenderer::DeferredRenderer(Renderer* renderer): RenderTechniqueBase(rend
 , m_geometryPassPipelineState()
 , m_shadowPassPipelineState()
 , m_lightPassPipelineState()
+, m_lightVolumePipelineState()
 , m_unlitPassPipelineState()
 , m_cutOutPipelineState1()
 , m_cutOutPipelineState2()
-, m_shadowMappings() {
-
+, m_shadowMappings()
+, m_lightingMode(LightingMode::LightVolume)
+, m_sphereVAO(nullptr)
+, m_sphereVBO(nullptr)
+, m_sphereIBO(nullptr)
+, m_coneVAO(nullptr)
+, m_coneVBO(nullptr)
+, m_coneIBO(nullptr)
+, m_numSphereIndices(0)
+, m_numConeIndices(0)
+, m_isTiledLighting(false)
+, m_tiledLightsSSBO(nullptr)
+, m_tiledLights() {
+	for (size_t i = 0; i < DEFERRED_NUM_GBUFFERS; i++)
+		m_gBuffers[i] = RENDER_GRAPH_NULL_HANDLE;
 }
 
 DeferredRenderer::~DeferredRenderer() {
@@ -63,6 +94,18 @@ bool DeferredRenderer::intialize() {
 	m_lightPassPipelineState.blendDstFactor = BlendFactor::One;
 	m_lightPassPipelineState.blendFunc = BlendFunc::Add;
 
+	// only back faces in front of nothing pass, rejects pixels behind the volume and background,
+	// still correct with camera inside the volume
+	m_lightVolumePipelineState.depthMode = DepthMode::Enable;
+	m_lightVolumePipelineState.depthFunc = DepthFunc::GEqual;
+	m_lightVolumePipelineState.depthMask = 0;
+	m_lightVolumePipelineState.cullMode = CullFaceMode::Front;
+	m_lightVolumePipelineState.cullFaceWindingOrder = FaceWindingOrder::CCW;
+	m_lightVolumePipelineState.blendMode = BlendMode::Enable;
+	m_lightVolumePipelineState.blendSrcFactor = BlendFactor::One;
+	m_lightVolumePipelineState.blendDstFactor = BlendFactor::One;
+	m_lightVolumePipelineState.blendFunc = BlendFunc::Add;
+
 	m_cutOutPipelineState1.depthMode = DepthMode::Enable;
 	m_cutOutPipelineState1.depthFunc = DepthFunc::LEqual;
 	m_cutOutPipelineState1.depthMask = 0;
@@ -77,15 +120,6 @@ bool DeferredRenderer::intialize() {
 	m_cutOutPipelineState2.blendMode = BlendMode::Disable;
 
 	bool ok = true;
-	// g-buffers
-	ok = setupRenderTargets();
-
-#ifdef _DEBUG
-	ASSERT(ok);
-#endif // _DEBUG
-	
-	if (!ok)
-		return false;
 
 	// light ubo
 	m_directionalLightUBO.reset(new Buffer());
@@ -103,6 +137,17 @@ bool DeferredRenderer::intialize() {
 	m_spotLightUBO->loadData(nullptr, sizeof(SpotLightBlock), Buffer::Usage::StaticDraw);
 	m_spotLightUBO->unbind();
 
+	// light volumes
+	ok = setupLightVolumes();
+#ifdef _DEBUG
+	ASSERT(ok);
+#endif // _DEBUG
+
+	if (!ok)
+		return false;
+
+	m_tiledLightsSSBO.reset(new Buffer());
+
 	// render task executor
 	m_taskExecutors[RenderPass::DepthPass] = std::unique_ptr<RenderTaskExecutor>(new DepthPassRenderTaskExecutor(this));
 	m_taskExecutors[RenderPass::GeometryPass] = std::unique_ptr<RenderTaskExecutor>(new GeometryPassRenderTaskExecutor(this));
@@ -128,31 +173,164 @@ bool DeferredRenderer::intialize() {
 
 
 void DeferredRenderer::cleanUp() {
-	m_directionalLightUBO.release();
-	m_pointLightUBO.release();
-	m_spotLightUBO.release();
+	m_directionalLightUBO.reset(nullptr);
+	m_pointLightUBO.reset(nullptr);
+	m_spotLightUBO.reset(nullptr);
+
+	m_sphereVAO.reset(nullptr);
+	m_sphereVBO.reset(nullptr);
+	m_sphereIBO.reset(nullptr);
+	m_coneVAO.reset(nullptr);
+	m_coneVBO.reset(nullptr);
+	m_coneIBO.reset(nullptr);
+	m_tiledLightsSSBO.reset(nullptr);
 
 	m_shadowMappings.clear();
 
-	m_gBufferTarget.detachAllTexture();
-	m_outputTarget.detachAllTexture();
+	m_renderGraph.releaseResources();
+	m_renderedFrame = nullptr;
+}
+
+
+void DeferredRenderer::render(const Scene_t& scene) {
+	beginFrame();
+	setupRenderGraph(scene);
+
+	if (m_renderGraph.compile())
+		m_renderGraph.execute();
+
+	endFrame();
+}
+
+
+void DeferredRenderer::setupRenderGraph(const Scene_t& scene) {
+	static const Texture::Format gBufferFormats[DEFERRED_NUM_GBUFFERS] = {
+		Texture::Format::RGB32F, // world position
+		Texture::Format::RGB16F, // world normal
+		Texture::Format::RGBA8, // albedo color
+		Texture::Format::RGBA8, // specular color
+		Texture::Format::RGB32F, // emissive/metallic/roughness
+		Texture::Format::R8, // shading mode (1.phong 2. pbr)
+	};
+
+	auto renderSz = m_renderer->getRenderSize();
+	size_t width = size_t(renderSz.x), height = size_t(renderSz.y);
+	auto& graph = m_renderGraph;
+
+	for (size_t i = 0; i < DEFERRED_NUM_GBUFFERS; i++)
+		m_gBuffers[i] = graph.createTexture("GBuffer" + std::to_string(i), gBufferFormats[i], width, height);
+	m_sceneDepth = graph.createTexture("SceneDepth", Texture::Format::Depth24_Stencil8, width, height);
+	m_sceneColor = graph.createTexture("SceneColor", Texture::Format::RGBA16F, width, height);
+
+	m_isTiledLighting = false;
+	if (m_lightingMode == LightingMode::TiledCompute) {
+		auto shader = ShaderProgramManager::getInstance()->getProgram("TiledDeferredLighting");
+		if (shader.expired())
+			shader = ShaderProgramManager::getInstance()->addProgram("TiledDeferredLighting");
+		m_isTiledLighting = !shader.expired();
+	}
+
+	auto readGBuffers = [&](size_t pass) {
+		for (size_t i = 0; i < DEFERRED_NUM_GBUFFERS; i++)
+			graph.read(pass, m_gBuffers[i], RenderGraphAccess::Sampled);
+	};
+
+	// first pass shading scene color clears it
+	int sceneColorClear = ClearFlags::Color;
+	auto shadeSceneColor = [&](size_t pass, bool isDepthWritten) {
+		graph.writeAttachment(pass, m_sceneColor, RenderTarget::Slot::Color);
+		if (isDepthWritten) {
+			graph.writeAttachment(pass, m_sceneDepth, RenderTarget::Slot::Depth_Stencil);
+		}
+		else {
+			graph.readAttachment(pass, m_sceneDepth, RenderTarget::Slot::Depth_Stencil);
+		}
+		graph.setClearFlags(pass, sceneColorClear);
+		sceneColorClear = 0;
+	};
+
+	// g-buffers are cleared along with depth, geometry pass fills them on the same target
+	size_t pass = graph.addPass("DepthPrepass", false, [this, &scene]() { drawDepthPass(scene); });
+	for (size_t i = 0; i < DEFERRED_NUM_GBUFFERS; i++)
+		graph.writeAttachment(pass, m_gBuffers[i], RenderTarget::Slot::Color, i);
+	graph.writeAttachment(pass, m_sceneDepth, RenderTarget::Slot::Depth_Stencil);
+	graph.setClearFlags(pass, ClearFlags::Color | ClearFlags::Depth | ClearFlags::Stencil);
+
+	pass = graph.addPass("GeometryPass", false, [this, &scene]() { drawGeometryPass(scene); });
+	for (size_t i = 0; i < DEFERRED_NUM_GBUFFERS; i++)
+		graph.writeAttachment(pass, m_gBuffers[i], RenderTarget::Slot::Color, i);
+	graph.readAttachment(pass, m_sceneDepth, RenderTarget::Slot::Depth_Stencil);
+
+	// main lights of one type share a shadow map, next one is rendered after the light before it is shaded
+	if (scene.numOpaqueItems > 0) {
+		std::unordered_map<LightType, RenderGraphHandle> shadowMaps;
+		for (size_t i = 0; i < scene.numMainLights; i++) {
+			auto& light = scene.mainLights[i];
+			auto shadowMap = shadowMaps.find(light.type);
+			if (shadowMap == shadowMaps.end())
+				shadowMap = shadowMaps.insert(std::make_pair(light.type, graph.importBuffer("ShadowMap" + std::to_string(int(light.type)), nullptr))).first;
+
+			pass = graph.addPass("ShadowMap" + std::to_string(i), false, [this, &scene, &light]() { drawLightShadow(scene, light); });
+			graph.write(pass, shadowMap->second, RenderGraphAccess::Attachment);
+
+			pass = graph.addPass("MainLight" + std::to_string(i), false, [this, &scene, &light]() {
+				bindGBuffer();
+				drawSolidsLight(scene, light);
+				unbindGBuffer();
+			});
+			readGBuffers(pass);
+			graph.read(pass, shadowMap->second, RenderGraphAccess::Sampled);
+			shadeSceneColor(pass, false);
+		}
+	}
+
+	pass = graph.addPass("Lighting", false, [this, &scene]() { drawOpaquePass(scene); });
+	readGBuffers(pass);
+	shadeSceneColor(pass, false);
+
+	// unshadowed point/spot lights of all tiles in one dispatch, accumulated onto scene color by image load/store
+	if (m_isTiledLighting && scene.numOpaqueItems > 0) {
+		pass = graph.addPass("TiledLighting", true, [this, &scene]() {
+			bindGBuffer();
+			drawSolidsLightsTiled(scene);
+			unbindGBuffer();
+		});
+		readGBuffers(pass);
+		graph.read(pass, m_sceneColor, RenderGraphAccess::Image);
+		graph.write(pass, m_sceneColor, RenderGraphAccess::Image);
+	}
+
+	// cut outs are shaded forward, the first light writes depth
+	if (scene.numCutOutItems > 0) {
+		pass = graph.addPass("CutOuts", false, [this, &scene]() {
+			size_t numLit = drawCutOutsLights(scene);
+			drawCutOutsAmbient(scene, numLit == 0);
+		});
+		shadeSceneColor(pass, true);
+	}
+
+	if (scene.skyBox) {
+		pass = graph.addPass("SkyBox", false, [this, &scene]() { drawSkyBox(*scene.skyBox, *scene.mainCamera); });
+		shadeSceneColor(pass, false);
+	}
+
+	graph.setOutput(m_sceneColor);
 }
 
 
 void DeferredRenderer::beginFrame() {
-	m_renderer->pushRenderTarget(&m_gBufferTarget); // push Gbuffers target
-	m_renderer->clearScreen(ClearFlags::Color | ClearFlags::Depth | ClearFlags::Stencil);
+	m_renderGraph.reset();
 }
 
 void DeferredRenderer::endFrame() {
-	m_renderer->popRenderTarget(); // pop Gbuffers target
+	m_renderedFrame = m_renderGraph.getTexture(m_sceneColor);
 
+	auto stateCache = GLStateCache::getInstance();
 	for (size_t unit = size_t(Texture::Unit::Defualt); unit < size_t(Texture::Unit::MaxUnit); unit++) {
-		GLCALL(glActiveTexture(GL_TEXTURE0 + unit));
-		GLCALL(glBindTexture(GL_TEXTURE_2D, 0));
+		stateCache->bindTexture(GLuint(unit), GL_TEXTURE_2D, 0);
 	}
 
-	GLCALL(glBindVertexArray(0));
+	stateCache->bindVertexArray(0);
 
 	if (m_passShader) {
 		m_passShader->unbind();
@@ -181,9 +359,7 @@ void DeferredRenderer::drawDepthPass(const Scene_t& scene) {
 		m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
 	}
 
-	for (size_t i = 0; i < scene.numOpaqueItems; i++) {
-		render(scene.opaqueItems[i]);
-	}
+	renderBatch(scene.opaqueItems, scene.numOpaqueItems);
 
 	m_renderer->popGPUPipelineState();
 	m_renderer->setColorMask(true);
@@ -213,9 +389,7 @@ void DeferredRenderer::drawGeometryPass(const Scene_t& scene) {
 		m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
 	}
 
-	for (size_t i = 0; i < scene.numOpaqueItems; i++) {
-		render(scene.opaqueItems[i]);
-	}
+	renderBatch(scene.opaqueItems, scene.numOpaqueItems);
 	
 	m_renderer->popGPUPipelineState();
 	m_renderer->popShadrProgram();
@@ -227,15 +401,8 @@ void DeferredRenderer::drawGeometryPass(const Scene_t& scene) {
 
 
 void DeferredRenderer::drawOpaquePass(const Scene_t& scene) {
-	m_renderer->pushRenderTarget(&m_outputTarget);
-	m_renderer->clearScreen(ClearFlags::Color);
-	
 	drawSolidsLights(scene);
 	drawSolidsAmbient(scene);
-	drawCutOutsLights(scene);
-	drawCutOutsAmbient(scene);
-
-	m_renderer->popRenderTarget();
 }
 
 void DeferredRenderer::drawUnlitScene(const Scene_t& scene) {
@@ -250,20 +417,20 @@ void DeferredRenderer::drawUnlitScene(const Scene_t& scene) {
 	m_passShader = unlitShader.lock();
 	m_renderer->pushShaderProgram(m_passShader.get());
 
-	Texture* diffuse = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 2);
-	Texture* emissive = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 4);
+	Texture* diffuse = m_renderGraph.getTexture(m_gBuffers[2]);
+	Texture* emissive = m_renderGraph.getTexture(m_gBuffers[4]);
 	
 #ifdef _DEBUG
 	ASSERT(diffuse && emissive);
 #endif // _DEBUG
 
 	if (diffuse) {
-		diffuse->bind(Texture::Unit::DiffuseMap);
+		diffuse->bindToTextureUnit(Texture::Unit::DiffuseMap, Texture::Target::Texture_2D);
 		m_passShader->setUniform1("u_diffuse", int(Texture::Unit::DiffuseMap));
 	}
 
 	if (emissive) {
-		emissive->bind(Texture::Unit::EmissiveMap);
+		emissive->bindToTextureUnit(Texture::Unit::EmissiveMap, Texture::Target::Texture_2D);
 		m_passShader->setUniform1("u_emissive", int(Texture::Unit::EmissiveMap));
 	}
 	//draw a full screen quad
@@ -271,8 +438,8 @@ void DeferredRenderer::drawUnlitScene(const Scene_t& scene) {
 
 	m_renderer->popGPUPipelineState();
 	m_renderer->popShadrProgram();
-	if (diffuse) diffuse->unbind();
-	if (emissive) emissive->unbind();
+	if (diffuse) diffuse->unbindFromTextureUnit();
+	if (emissive) emissive->unbindFromTextureUnit();
 	m_passShader = nullptr;
 	m_pass = RenderPass::None;
 }
@@ -282,313 +449,411 @@ void DeferredRenderer::drawSolidsLights(const Scene_t& scene) {
 	if (scene.numOpaqueItems <= 0)
 		return;
 
-	m_renderer->pushGPUPipelineState(&m_lightPassPipelineState);
+	// shadowed main lights have their own passes, unshadowed point/spot lights are left to tiled pass if it runs,
+	// otherwise they draw volumes
+	bindGBuffer();
 
 	for (size_t lightIdx = 0; lightIdx < scene.numLights; lightIdx++) {
 		auto& light = scene.lights[lightIdx];
+		if (light.type == LightType::Ambient)
+			continue;
+		if (m_isTiledLighting && (light.type == LightType::PointLight || light.type == LightType::SpotLight))
+			continue;
 
-		drawLightShadow(scene, light);
+		drawLightShadow(scene, light); // no shadow rendered, only makes sure light type's shadow mapping exist
+		drawSolidsLight(scene, light);
+	}
 
-		Buffer* lightUBO = nullptr;
-		m_pass = RenderPass::LightPass;
-		switch (light.type) {
-		case LightType::DirectioanalLight: {
-			auto directionalLightShader = ShaderProgramManager::getInstance()->getProgram("DirectionalLightDeferred");
-			if (directionalLightShader.expired())
-				directionalLightShader = ShaderProgramManager::getInstance()->addProgram("DirectionalLightDeferred.shader");
-			ASSERT(!directionalLightShader.expired());
+	unbindGBuffer();
+}
 
-			m_passShader = directionalLightShader.lock();
-			m_renderer->pushShaderProgram(m_passShader.get());
 
-			// set directional light block
-			if (m_passShader->hasUniformBlock("LightBlock")) {
-				static DirectionalLightBlock dlb;
-				dlb.color = glm::vec4(glm::vec3(light.color), light.intensity);
-				dlb.inverseDiretion = -light.direction;
-				m_directionalLightUBO->bind(Buffer::Target::UniformBuffer);
-				m_directionalLightUBO->loadSubData(&dlb, 0, sizeof(dlb));
-
-				m_directionalLightUBO->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::LightBlock));
-				m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
-
-				lightUBO = m_directionalLightUBO.get();
-			}
-
-			if (m_passShader->hasUniform("u_VPMat")) {
-				auto& camera = *scene.mainCamera;
-				glm::mat4 vp = camera.projMatrix * camera.viewMatrix;
-				m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
-			}
-		} break;
-
-		case LightType::PointLight: {
-			auto pointLightShader = ShaderProgramManager::getInstance()->getProgram("PointLightDeferred");
-			if (pointLightShader.expired())
-				pointLightShader = ShaderProgramManager::getInstance()->addProgram("PointLightDeferred.shader");
-			ASSERT(!pointLightShader.expired());
-
-			m_passShader = pointLightShader.lock();
-			m_renderer->pushShaderProgram(m_passShader.get());
+void DeferredRenderer::drawSolidsLight(const Scene_t& scene, const Light_t& light) {
+	Buffer* lightUBO = nullptr;
+	m_pass = RenderPass::LightPass;
+	switch (light.type) {
+	case LightType::DirectioanalLight: {
+		auto directionalLightShader = ShaderProgramManager::getInstance()->getProgram("DirectionalLightDeferred");
+		if (directionalLightShader.expired())
+			directionalLightShader = ShaderProgramManager::getInstance()->addProgram("DirectionalLightDeferred.shader");
+		ASSERT(!directionalLightShader.expired());
+
+		m_passShader = directionalLightShader.lock();
+		m_renderer->pushShaderProgram(m_passShader.get());
+
+		// set directional light block
+		if (m_passShader->hasUniformBlock("LightBlock")) {
+			static DirectionalLightBlock dlb;
+			dlb.color = glm::vec4(glm::vec3(light.color), light.intensity);
+			dlb.inverseDiretion = -light.direction;
+			bindLightBlock(m_directionalLightUBO.get(), &dlb, sizeof(dlb));
+			m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
+
+			lightUBO = m_directionalLightUBO.get();
+		}
 
-			// set point light block
-			if (m_passShader->hasUniformBlock("LightBlock")) {
-				static PointLightBlock plb;
-				plb.position = glm::vec4(light.position, light.range);
-				plb.color = glm::vec4(light.color, light.intensity);
+		if (m_passShader->hasUniform("u_VPMat")) {
+			auto& camera = *scene.mainCamera;
+			glm::mat4 vp = camera.projMatrix * camera.viewMatrix;
+			m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
+		}
+	} break;
 
-				m_pointLightUBO->bind(Buffer::Target::UniformBuffer);
-				m_pointLightUBO->loadSubData(&plb, 0, sizeof(plb));
-				m_pointLightUBO->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::LightBlock));
-				m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
+	case LightType::PointLight: {
+		auto pointLightShader = ShaderProgramManager::getInstance()->getProgram("PointLightDeferred");
+		if (pointLightShader.expired())
+			pointLightShader = ShaderProgramManager::getInstance()->addProgram("PointLightDeferred.shader");
+		ASSERT(!pointLightShader.expired());
 
-				lightUBO = m_pointLightUBO.get();
-			}
-		}break;
+		m_passShader = pointLightShader.lock();
+		m_renderer->pushShaderProgram(m_passShader.get());
 
-		case LightType::SpotLight: {
-			auto spotLightShader = ShaderProgramManager::getInstance()->getProgram("SpotLightDeferred");
-			if (spotLightShader.expired())
-				spotLightShader = ShaderProgramManager::getInstance()->addProgram("SpotLightDeferred.shader");
-			ASSERT(!spotLightShader.expired());
+		// set point light block
+		if (m_passShader->hasUniformBlock("LightBlock")) {
+			static PointLightBlock plb;
+			plb.position = glm::vec4(light.position, light.range);
+			plb.color = glm::vec4(light.color, light.intensity);
 
-			m_passShader = spotLightShader.lock();
-			m_renderer->pushShaderProgram(m_passShader.get());
+			bindLightBlock(m_pointLightUBO.get(), &plb, sizeof(plb));
+			m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
+
+			lightUBO = m_pointLightUBO.get();
+		}
+	}break;
+
+	case LightType::SpotLight: {
+		auto spotLightShader = ShaderProgramManager::getInstance()->getProgram("SpotLightDeferred");
+		if (spotLightShader.expired())
+			spotLightShader = ShaderProgramManager::getInstance()->addProgram("SpotLightDeferred.shader");
+		ASSERT(!spotLightShader.expired());
 
-			// set spot light block
-			if (m_passShader->hasUniformBlock("LightBlock")) {
-				static SpotLightBlock slb;
-				slb.position = glm::vec4(light.position, light.range);
-				slb.color = glm::vec4(light.color, light.intensity);
-				slb.inverseDirection = -light.direction;
-				slb.angles = glm::vec2(light.innerCone, light.outterCone);
+		m_passShader = spotLightShader.lock();
+		m_renderer->pushShaderProgram(m_passShader.get());
 
-				m_spotLightUBO->bind(Buffer::Target::UniformBuffer);
-				m_spotLightUBO->loadSubData(&slb, 0, sizeof(slb));
-				m_spotLightUBO->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::LightBlock));
-				m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
+		// set spot light block
+		if (m_passShader->hasUniformBlock("LightBlock")) {
+			static SpotLightBlock slb;
+			slb.position = glm::vec4(light.position, light.range);
+			slb.color = glm::vec4(light.color, light.intensity);
+			slb.inverseDirection = -light.direction;
+			slb.angles = glm::vec2(light.innerCone, light.outterCone);
 
-				lightUBO = m_spotLightUBO.get();
-			}
-		}break;
+			bindLightBlock(m_spotLightUBO.get(), &slb, sizeof(slb));
+			m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
 
-		default:
+			lightUBO = m_spotLightUBO.get();
+		}
+	}break;
+
+	default:
 #ifdef _DEBUG
-			ASSERT(false);
+		ASSERT(false);
 #endif // _DEBUG
-			return;
-		}
+		m_pass = RenderPass::None;
+		return;
+	}
 
-		m_shadowMappings[light.type]->beginRenderLight(light, m_passShader.get());
+	m_shadowMappings[light.type]->beginRenderLight(light, m_passShader.get());
 
-		// set camera position
-		if (m_passShader->hasUniform("u_cameraPosW")) {
-			glm::vec3 camPos = scene.mainCamera->position;
-			m_passShader->setUniform3v("u_cameraPosW", &camPos[0]);
-		}
+	// set camera position
+	if (m_passShader->hasUniform("u_cameraPosW")) {
+		glm::vec3 camPos = scene.mainCamera->position;
+		m_passShader->setUniform3v("u_cameraPosW", &camPos[0]);
+	}
 
-		// set max shininess
-		if (m_passShader->hasUniform("u_maxShininess")) {
-			m_passShader->setUniform1("u_maxShininess", float(PhongMaterial::s_maxShininess));
+	// set max shininess
+	if (m_passShader->hasUniform("u_maxShininess")) {
+		m_passShader->setUniform1("u_maxShininess", float(PhongMaterial::s_maxShininess));
+	}
+
+	setGBufferUniforms(m_passShader.get());
+	m_passShader->bindSubroutineUniforms();
+
+	// local lights only shade pixels covered by their volume, directional light covers whole screen
+	glm::mat4 mvp;
+	VertexArray* volume = nullptr;
+	size_t numIndex = 0;
+	if (calcLightVolume(scene, light, mvp, volume, numIndex)) {
+		m_renderer->pushGPUPipelineState(&m_lightVolumePipelineState);
+		if (m_passShader->hasUniform("u_MVP"))
+			m_passShader->setUniformMat4v("u_MVP", &mvp[0][0]);
+
+		if (m_passShader->hasUniform("u_ScreenSize")) {
+			glm::vec2 screenSz = m_renderer->getRenderSize();
+			m_passShader->setUniform2("u_ScreenSize", screenSz.x, screenSz.y);
 		}
 
-		// set g-buffers
-		Texture* pos = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 0);
-		Texture* normal = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 1);
-		Texture* diffuse = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 2);
-		Texture* specular = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 3);
-		Texture* emr = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 4);
-		Texture* mode = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 5);
+		// back faces past far plane would be clipped away and drop the pixels behind them, clamp their depth instead
+		GLCALL(glEnable(GL_DEPTH_CLAMP));
+		m_renderer->executeDrawCommand(volume, PrimitiveType::Triangles, 0, numIndex);
+		GLCALL(glDisable(GL_DEPTH_CLAMP));
+	}
+	else {
+		m_renderer->pushGPUPipelineState(&m_lightPassPipelineState);
+		m_renderer->drawFullScreenQuad();
+	}
+	m_renderer->popGPUPipelineState();
+
+	m_shadowMappings[light.type]->endRenderLight(light, m_passShader.get());
+
+	if (lightUBO) lightUBO->unbind();
+
+	m_renderer->popShadrProgram();
+	m_passShader->unbindSubroutineUniforms();
+	m_passShader = nullptr;
+	m_pass = RenderPass::None;
+}
+
+
+bool DeferredRenderer::drawSolidsLightsTiled(const Scene_t& scene) {
+	auto shader = ShaderProgramManager::getInstance()->getProgram("TiledDeferredLighting");
+	if (shader.expired())
+		shader = ShaderProgramManager::getInstance()->addProgram("TiledDeferredLighting");
+	if (shader.expired())
+		return false;
+
+	m_tiledLights.clear();
+	for (size_t lightIdx = 0; lightIdx < scene.numLights; lightIdx++) {
+		auto& light = scene.lights[lightIdx];
+		if (light.type != LightType::PointLight && light.type != LightType::SpotLight)
+			continue;
+
+		TiledLight tl;
+		tl.position = glm::vec4(light.position, light.range);
+		tl.color = glm::vec4(light.color, light.intensity);
+		tl.toLight = -glm::normalize(light.direction);
+		tl._padding = 0.f;
+		tl.angles = glm::vec3(light.innerCone, light.outterCone, 0.f);
+		tl.type = int(light.type);
+		tl.bounds = LightClusterBuilder::lightBoundingSphere(light);
+		m_tiledLights.push_back(tl);
+	}
+
+	if (m_tiledLights.empty())
+		return true;
+
+	auto tiledShader = shader.lock();
+	m_renderer->pushShaderProgram(tiledShader.get());
+
+	m_tiledLightsSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+	m_tiledLightsSSBO->loadData(m_tiledLights.data(), sizeof(TiledLight) * m_tiledLights.size(), Buffer::Usage::DynamicDraw, m_tiledLights.size());
+	m_tiledLightsSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 0);
+	tiledShader->bindShaderStorageBlock("Lights", 0);
+
+	Texture* output = m_renderGraph.getTexture(m_sceneColor);
+	output->bindToImageUnit(0, Texture::Format::RGBA16F, Texture::Access::ReadWrite);
+	tiledShader->setUniform1("u_OutputImage", 0);
+
+	setGBufferUniforms(tiledShader.get());
+
+	auto& camera = *scene.mainCamera;
+	glm::mat4 invProj = glm::inverse(camera.projMatrix);
+	glm::vec2 screenSz = m_renderer->getRenderSize();
+	tiledShader->setUniform1("u_NumLights", unsigned(m_tiledLights.size()));
+	tiledShader->setUniform1("u_maxShininess", float(PhongMaterial::s_maxShininess));
+	tiledShader->setUniform3v("u_cameraPosW", &camera.position[0]);
+	tiledShader->setUniformMat4v("u_ViewMat", &camera.viewMatrix[0][0]);
+	tiledShader->setUniformMat4v("u_InvProjMat", &invProj[0][0]);
+	tiledShader->setUniform2("u_ScreenSize", screenSz.x, screenSz.y);
+
+	// graph places barriers for passes blending over results & post processing fetching them
+	m_renderer->dispatchCompute(glm::ceil(screenSz.x / TILED_LIGHTING_TILE_SIZE), glm::ceil(screenSz.y / TILED_LIGHTING_TILE_SIZE));
+
+	output->unbindFromImageUnit();
+	tiledShader->unbindShaderStorageBlock("Lights");
+	m_tiledLightsSSBO->unbind();
+	m_renderer->popShadrProgram();
+
+	return true;
+}
+
+
+void DeferredRenderer::bindGBuffer() {
+	Texture* pos = m_renderGraph.getTexture(m_gBuffers[0]);
+	Texture* normal = m_renderGraph.getTexture(m_gBuffers[1]);
+	Texture* diffuse = m_renderGraph.getTexture(m_gBuffers[2]);
+	Texture* specular = m_renderGraph.getTexture(m_gBuffers[3]);
+	Texture* emr = m_renderGraph.getTexture(m_gBuffers[4]);
+	Texture* mode = m_renderGraph.getTexture(m_gBuffers[5]);
 
 #ifdef _DEBUG
-		ASSERT(pos && normal && diffuse && specular && emr && mode);
+	ASSERT(pos && normal && diffuse && specular && emr && mode);
 #endif // _DEBUG
 
-		if (m_passShader->hasUniform("u_PosW") && pos) {
-			pos->bind(Texture::Unit::Texture0);
-			m_passShader->setUniform1("u_PosW", int(Texture::Unit::Texture0));
-		}
+	if (pos) pos->bindToTextureUnit(Texture::Unit::Texture0, Texture::Target::Texture_2D);
+	if (normal) normal->bindToTextureUnit(Texture::Unit::NormalMap, Texture::Target::Texture_2D);
+	if (diffuse) diffuse->bindToTextureUnit(Texture::Unit::DiffuseMap, Texture::Target::Texture_2D);
+	if (specular) specular->bindToTextureUnit(Texture::Unit::SpecularMap, Texture::Target::Texture_2D);
+	if (emr) emr->bindToTextureUnit(Texture::Unit::Texture1, Texture::Target::Texture_2D);
+	if (mode) mode->bindToTextureUnit(Texture::Unit::Texture2, Texture::Target::Texture_2D);
+}
 
-		if (m_passShader->hasUniform("u_NormalW") && normal) {
-			normal->bind(Texture::Unit::NormalMap);
-			m_passShader->setUniform1("u_NormalW", int(Texture::Unit::NormalMap));
-		}
 
-		if (m_passShader->hasUniform("u_Albedo") && diffuse) {
-			diffuse->bind(Texture::Unit::DiffuseMap);
-			m_passShader->setUniform1("u_Albedo", int(Texture::Unit::DiffuseMap));
-		}
+void DeferredRenderer::unbindGBuffer() {
+	for (size_t i = 0; i < DEFERRED_NUM_GBUFFERS; i++) {
+		Texture* buffer = m_renderGraph.getTexture(m_gBuffers[i]);
+		if (buffer) buffer->unbindFromTextureUnit();
+	}
+}
 
-		if (m_passShader->hasUniform("u_Specular") && specular) {
-			specular->bind(Texture::Unit::SpecularMap);
-			m_passShader->setUniform1("u_Specular", int(Texture::Unit::SpecularMap));
-		}
 
-		if (m_passShader->hasUniform("u_EMR") && emr) {
-			emr->bind(Texture::Unit::Texture1);
-			m_passShader->setUniform1("u_EMR", int(Texture::Unit::Texture1));
-		}
+void DeferredRenderer::setGBufferUniforms(ShaderProgram* shader) {
+	if (shader->hasUniform("u_PosW"))
+		shader->setUniform1("u_PosW", int(Texture::Unit::Texture0));
 
-		if (m_passShader->hasUniform("u_ShadeMode") && mode) {
-			mode->bind(Texture::Unit::Texture2, Texture::Target::Texture_2D);
-			m_passShader->setUniform1("u_ShadeMode", int(Texture::Unit::Texture2));
-		}
+	if (shader->hasUniform("u_NormalW"))
+		shader->setUniform1("u_NormalW", int(Texture::Unit::NormalMap));
 
-		m_passShader->bindSubroutineUniforms();
+	if (shader->hasUniform("u_Albedo"))
+		shader->setUniform1("u_Albedo", int(Texture::Unit::DiffuseMap));
 
-		m_renderer->drawFullScreenQuad();
+	if (shader->hasUniform("u_Specular"))
+		shader->setUniform1("u_Specular", int(Texture::Unit::SpecularMap));
 
-		m_shadowMappings[light.type]->endRenderLight(light, m_passShader.get());
+	if (shader->hasUniform("u_EMR"))
+		shader->setUniform1("u_EMR", int(Texture::Unit::Texture1));
 
-		if (lightUBO) lightUBO->unbind();
-		if (pos) pos->unbind();
-		if (normal) normal->unbind();
-		if (diffuse) diffuse->unbind();
-		if (specular) specular->unbind();
-		if (emr) emr->unbind();
-		if (mode) mode->unbind();
+	if (shader->hasUniform("u_ShadeMode"))
+		shader->setUniform1("u_ShadeMode", int(Texture::Unit::Texture2));
+}
 
-		m_renderer->popShadrProgram();
-		m_passShader->unbindSubroutineUniforms();
-		m_passShader = nullptr;
-		m_pass = RenderPass::None;
+
+bool DeferredRenderer::calcLightVolume(const Scene_t& scene, const Light_t& light, glm::mat4& mvp, VertexArray*& volume, size_t& numIndex) const {
+	if (light.type != LightType::PointLight && light.type != LightType::SpotLight)
+		return false;
+
+	glm::mat4 model(1.f);
+	float halfAngle = light.outterCone * 0.5f;
+	if (light.type == LightType::SpotLight && halfAngle < MAX_SPOT_VOLUME_HALF_ANGLE) {
+		// unit cone along z, scaled to light range and opening
+		glm::vec3 z = glm::normalize(light.direction);
+		glm::vec3 up = fabsf(z.y) < 0.99f ? glm::vec3(0.f, 1.f, 0.f) : glm::vec3(1.f, 0.f, 0.f);
+		glm::vec3 x = glm::normalize(glm::cross(up, z));
+		glm::vec3 y = glm::cross(z, x);
+		float radius = light.range * tanf(halfAngle);
+		model = glm::mat4(glm::vec4(x * radius, 0.f), glm::vec4(y * radius, 0.f), glm::vec4(z * light.range, 0.f), glm::vec4(light.position, 1.f));
+		volume = m_coneVAO.get();
+		numIndex = m_numConeIndices;
+	}
+	else {
+		model = glm::translate(glm::mat4(1.f), light.position) * glm::scale(glm::mat4(1.f), glm::vec3(light.range));
+		volume = m_sphereVAO.get();
+		numIndex = m_numSphereIndices;
 	}
 
-	m_renderer->popGPUPipelineState();
+	auto& camera = *scene.mainCamera;
+	mvp = camera.projMatrix * camera.viewMatrix * model;
+
+	return true;
 }
 
 
-void DeferredRenderer::drawCutOutsLights(const Scene_t& scene) {
+size_t DeferredRenderer::drawCutOutsLights(const Scene_t& scene) {
 	if (scene.numCutOutItems <= 0)
-		return;
+		return 0;
 
 	m_renderer->pushGPUPipelineState(&m_cutOutPipelineState1);
-	
-	for (size_t lightIdx = 0; lightIdx < scene.numLights; lightIdx++) {
-		auto& light = scene.lights[lightIdx];
-		drawLightShadow(scene, light);
-
-		m_pass = RenderPass::LightPass;
-		Buffer* lightUBO = nullptr;
-		switch (light.type) {
-		case LightType::DirectioanalLight: {
-			auto directionalLightShader = ShaderProgramManager::getInstance()->getProgram("DirectionalLight");
-			if (directionalLightShader.expired())
-				directionalLightShader = ShaderProgramManager::getInstance()->addProgram("DirectionalLight.shader");
-			ASSERT(!directionalLightShader.expired());
-
-			m_passShader = directionalLightShader.lock();
-			m_renderer->pushShaderProgram(m_passShader.get());
-			// set directional light block
-			if (m_passShader->hasUniformBlock("LightBlock")) {
-				static DirectionalLightBlock dlb;
-				dlb.color = glm::vec4(glm::vec3(light.color), light.intensity);
-				dlb.inverseDiretion = -light.direction;
-				m_directionalLightUBO->bind(Buffer::Target::UniformBuffer);
-				m_directionalLightUBO->loadSubData(&dlb, 0, sizeof(dlb));
-
-				m_directionalLightUBO->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::LightBlock));
-				m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
-
-				lightUBO = m_directionalLightUBO.get();
-			}
-		}break;
-
-		case LightType::PointLight: {
-			auto pointLightShader = ShaderProgramManager::getInstance()->getProgram("PointLight");
-			if (pointLightShader.expired())
-				pointLightShader = ShaderProgramManager::getInstance()->addProgram("PointLight.shader");
-			ASSERT(!pointLightShader.expired());
-
-			m_passShader = pointLightShader.lock();
-			m_renderer->pushShaderProgram(m_passShader.get());
-			// set point light block
-			if (m_passShader->hasUniformBlock("LightBlock")) {
-				static PointLightBlock plb;
-				plb.position = glm::vec4(light.position, light.range);
-				plb.color = glm::vec4(light.color, light.intensity);
 
-				m_pointLightUBO->bind(Buffer::Target::UniformBuffer);
-				m_pointLightUBO->loadSubData(&plb, 0, sizeof(plb));
-				m_pointLightUBO->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::LightBlock));
-				m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
+	// shadow casting main lights as well, the first light drawn writes depth
+	size_t numLit = 0;
+	for (size_t lightIdx = 0; lightIdx < scene.numMainLights; lightIdx++)
+		drawCutOutsLight(scene, scene.mainLights[lightIdx], numLit++ == 0);
 
-				lightUBO = m_pointLightUBO.get();
-			}
+	for (size_t lightIdx = 0; lightIdx < scene.numLights; lightIdx++) {
+		if (scene.lights[lightIdx].type != LightType::Ambient)
+			drawCutOutsLight(scene, scene.lights[lightIdx], numLit++ == 0);
+	}
 
-		}break;
+	m_renderer->popGPUPipelineState();
 
-		case LightType::SpotLight: {
-			auto spotLightShader = ShaderProgramManager::getInstance()->getProgram("SpotLight");
-			if (spotLightShader.expired())
-				spotLightShader = ShaderProgramManager::getInstance()->addProgram("SpotLight.shader");
-			ASSERT(!spotLightShader.expired());
+	return numLit;
+}
 
-			m_passShader = spotLightShader.lock();
-			m_renderer->pushShaderProgram(m_passShader.get());
-			// set spot light block
-			if (m_passShader->hasUniformBlock("LightBlock")) {
-				static SpotLightBlock slb;
-				slb.position = glm::vec4(light.position, light.range);
-				slb.color = glm::vec4(light.color, light.intensity);
-				slb.inverseDirection = -light.direction;
-				slb.angles = glm::vec2(light.innerCone, light.outterCone);
-
-				m_spotLightUBO->bind(Buffer::Target::UniformBuffer);
-				m_spotLightUBO->loadSubData(&slb, 0, sizeof(slb));
-				m_spotLightUBO->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::LightBlock));
-				m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
-
-				lightUBO = m_spotLightUBO.get();
-			}
-		}break;
-
-		default:
+
+void DeferredRenderer::drawCutOutsLight(const Scene_t& scene, const Light_t& light, bool isFirst) {
+	drawLightShadow(scene, light);
+
+	// forward light shaders take light as plain uniforms
+	m_pass = RenderPass::LightPass;
+	glm::vec4 lightPos(light.position, light.range);
+	glm::vec4 lightColor(light.color, light.intensity);
+	glm::vec3 toLight = -light.direction;
+	switch (light.type) {
+	case LightType::DirectioanalLight: {
+		auto directionalLightShader = ShaderProgramManager::getInstance()->getProgram("DirectionalLight");
+		if (directionalLightShader.expired())
+			directionalLightShader = ShaderProgramManager::getInstance()->addProgram("DirectionalLight.shader");
+		ASSERT(!directionalLightShader.expired());
+
+		m_passShader = directionalLightShader.lock();
+		m_renderer->pushShaderProgram(m_passShader.get());
+		m_passShader->setUniform4v("u_lightColor", &lightColor[0]);
+		m_passShader->setUniform3v("u_toLight", &toLight[0]);
+	}break;
+
+	case LightType::PointLight: {
+		auto pointLightShader = ShaderProgramManager::getInstance()->getProgram("PointLight");
+		if (pointLightShader.expired())
+			pointLightShader = ShaderProgramManager::getInstance()->addProgram("PointLight.shader");
+		ASSERT(!pointLightShader.expired());
+
+		m_passShader = pointLightShader.lock();
+		m_renderer->pushShaderProgram(m_passShader.get());
+		m_passShader->setUniform4v("u_lightPos", &lightPos[0]);
+		m_passShader->setUniform4v("u_lightColor", &lightColor[0]);
+	}break;
+
+	case LightType::SpotLight: {
+		auto spotLightShader = ShaderProgramManager::getInstance()->getProgram("SpotLight");
+		if (spotLightShader.expired())
+			spotLightShader = ShaderProgramManager::getInstance()->addProgram("SpotLight.shader");
+		ASSERT(!spotLightShader.expired());
+
+		m_passShader = spotLightShader.lock();
+		m_renderer->pushShaderProgram(m_passShader.get());
+		m_passShader->setUniform4v("u_lightPos", &lightPos[0]);
+		m_passShader->setUniform4v("u_lightColor", &lightColor[0]);
+		m_passShader->setUniform3v("u_toLight", &toLight[0]);
+		m_passShader->setUniform2("u_angles", light.innerCone, light.outterCone);
+	}break;
+
+	default:
 #ifdef _DEBUG
-			ASSERT(false);
+		ASSERT(false);
 #endif // _DEBUG
-			break;
-		}
-
-		auto& camera = *scene.mainCamera;
-		// set view project matrix
-		if (m_passShader->hasUniform("u_VPMat")) {
-			glm::mat4 vp = camera.projMatrix * camera.viewMatrix;
-			m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
-		}
+		m_pass = RenderPass::None;
+		return;
+	}
 
-		// set camera position
-		if (m_passShader->hasUniform("u_cameraPosW")) {
-			m_passShader->setUniform3v("u_cameraPosW", const_cast<float*>(glm::value_ptr(camera.position)));
-		}
+	auto& camera = *scene.mainCamera;
+	// set view project matrix
+	if (m_passShader->hasUniform("u_VPMat")) {
+		glm::mat4 vp = camera.projMatrix * camera.viewMatrix;
+		m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
+	}
 
-		m_shadowMappings[light.type]->beginRenderLight(light, m_passShader.get());
-		
-		if (lightIdx == 0) m_renderer->pushGPUPipelineState(&m_cutOutPipelineState2);
-		for (size_t i = 0; i < scene.numCutOutItems; i++) {
-			render(scene.cutOutItems[i]);
-		}
-		if (lightIdx == 0) m_renderer->popGPUPipelineState();
+	// set camera position
+	if (m_passShader->hasUniform("u_cameraPosW")) {
+		m_passShader->setUniform3v("u_cameraPosW", const_cast<float*>(glm::value_ptr(camera.position)));
+	}
 
-		m_shadowMappings[light.type]->endRenderLight(light, m_passShader.get());
+	m_shadowMappings[light.type]->beginRenderLight(light, m_passShader.get());
+	
+	if (isFirst) m_renderer->pushGPUPipelineState(&m_cutOutPipelineState2);
+	renderBatch(scene.cutOutItems, scene.numCutOutItems);
+	if (isFirst) m_renderer->popGPUPipelineState();
 
-		if (lightUBO)lightUBO->unbind();
-		m_passShader->unbindUniformBlock("LightBlock");
-		m_renderer->popShadrProgram();
-		m_passShader->unbindSubroutineUniforms();
-		m_passShader = nullptr;
-		m_pass = RenderPass::None;
-	}
+	m_shadowMappings[light.type]->endRenderLight(light, m_passShader.get());
 
-	m_renderer->popGPUPipelineState();
+	m_renderer->popShadrProgram();
+	m_passShader->unbindSubroutineUniforms();
+	m_passShader = nullptr;
+	m_pass = RenderPass::None;
 }
 
 
 void DeferredRenderer::drawSolidsAmbient(const Scene_t& scene) {
-	if (scene.numAmbientLights <= 0)
-		return;
-
-	if (scene.numCutOutItems <= 0)
+	if (scene.numOpaqueItems <= 0)
 		return;
 
 	auto shader = ShaderProgramManager::getInstance()->getProgram("HemiSphericalAmibentLightDefferred");
@@ -597,31 +862,44 @@ void DeferredRenderer::drawSolidsAmbient(const Scene_t& scene) {
 		ASSERT(!shader.expired());
 	}
 
-	m_pass = RenderPass::AmbientPass;
-	m_passShader = shader.lock();
-	m_renderer->pushShaderProgram(m_passShader.get());
-	m_renderer->pushGPUPipelineState(&m_lightPassPipelineState);
-
-	Texture* normalTex = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 1);
-	Texture* diffuseTex = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 2);
+	Texture* normalTex = m_renderGraph.getTexture(m_gBuffers[1]);
+	Texture* diffuseTex = m_renderGraph.getTexture(m_gBuffers[2]);
+#ifdef _DEBUG
 	ASSERT(normalTex && diffuseTex);
-	normalTex->bind(Texture::Unit::NormalMap);
-	m_passShader->setUniform1("u_NormalMap", int(Texture::Unit::NormalMap));
-	diffuseTex->bind(Texture::Unit::DiffuseMap);
-	m_passShader->setUniform1("u_DiffuseMap", int(Texture::Unit::DiffuseMap));
+#endif // _DEBUG
 
-	m_passShader->bindSubroutineUniforms();
+	bool isBound = false;
+	for (size_t i = 0; i < scene.numLights; i++) {
+		auto& light = scene.lights[i];
+		if (light.type != LightType::Ambient)
+			continue;
 
-	for (size_t i = 0; i < scene.numAmbientLights; i++) {
-		glm::vec3 skyColor = scene.ambientLights[i].color;
-		glm::vec3 groundColor = scene.ambientLights[i].colorEx;
+		if (!isBound) {
+			m_pass = RenderPass::AmbientPass;
+			m_passShader = shader.lock();
+			m_renderer->pushShaderProgram(m_passShader.get());
+			m_renderer->pushGPUPipelineState(&m_lightPassPipelineState);
+
+			normalTex->bindToTextureUnit(Texture::Unit::NormalMap, Texture::Target::Texture_2D);
+			m_passShader->setUniform1("u_NormalMap", int(Texture::Unit::NormalMap));
+			diffuseTex->bindToTextureUnit(Texture::Unit::DiffuseMap, Texture::Target::Texture_2D);
+			m_passShader->setUniform1("u_DiffuseMap", int(Texture::Unit::DiffuseMap));
+			m_passShader->bindSubroutineUniforms();
+			isBound = true;
+		}
+
+		glm::vec3 skyColor = light.color * light.intensity;
+		glm::vec3 groundColor = light.colorEx * light.intensity;
 		m_passShader->setUniform3v("u_AmbientSky", &skyColor[0]);
 		m_passShader->setUniform3v("u_AmbientGround", &groundColor[0]);
 		m_renderer->drawFullScreenQuad();
 	}
 
-	normalTex->unbind();
-	diffuseTex->unbind();
+	if (!isBound)
+		return;
+
+	normalTex->unbindFromTextureUnit();
+	diffuseTex->unbindFromTextureUnit();
 	m_renderer->popGPUPipelineState();
 	m_renderer->popShadrProgram();
 	m_passShader->unbindSubroutineUniforms();
@@ -630,10 +908,7 @@ void DeferredRenderer::drawSolidsAmbient(const Scene_t& scene) {
 }
 
 
-void DeferredRenderer::drawCutOutsAmbient(const Scene_t& scene) {
-	if (scene.numAmbientLights <= 0)
-		return;
-	
+void DeferredRenderer::drawCutOutsAmbient(const Scene_t& scene, bool isFirst) {
 	if (scene.numCutOutItems <= 0)
 		return;
 
@@ -643,21 +918,37 @@ void DeferredRenderer::drawCutOutsAmbient(const Scene_t& scene) {
 		ASSERT(!shader.expired());
 	}
 
-	m_pass = RenderPass::AmbientPass;
-	m_passShader = shader.lock();
-	m_renderer->pushShaderProgram(m_passShader.get());
-	m_renderer->pushGPUPipelineState(&m_cutOutPipelineState1);
+	bool isBound = false;
+	for (size_t i = 0; i < scene.numLights; i++) {
+		auto& light = scene.lights[i];
+		if (light.type != LightType::Ambient)
+			continue;
 
-	glm::mat4 vp = scene.mainCamera->projMatrix * scene.mainCamera->viewMatrix;
-	m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
+		if (!isBound) {
+			m_pass = RenderPass::AmbientPass;
+			m_passShader = shader.lock();
+			m_renderer->pushShaderProgram(m_passShader.get());
+			m_renderer->pushGPUPipelineState(&m_cutOutPipelineState1);
 
-	if (scene.numLights <= 0 ) m_renderer->pushGPUPipelineState(&m_cutOutPipelineState2);
+			glm::mat4 vp = scene.mainCamera->projMatrix * scene.mainCamera->viewMatrix;
+			m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
+			isBound = true;
+		}
 
-	for (size_t i = 0; i < scene.numCutOutItems; i++) {
-		render(scene.cutOutItems[i]);
+		glm::vec3 skyColor = light.color * light.intensity;
+		glm::vec3 groundColor = light.colorEx * light.intensity;
+		m_passShader->setUniform3v("u_AmbientSky", &skyColor[0]);
+		m_passShader->setUniform3v("u_AmbientGround", &groundColor[0]);
+
+		// no light drew cut outs before, first ambient writes their depth
+		if (isFirst) m_renderer->pushGPUPipelineState(&m_cutOutPipelineState2);
+		renderBatch(scene.cutOutItems, scene.numCutOutItems);
+		if (isFirst) m_renderer->popGPUPipelineState();
+		isFirst = false;
 	}
 
-	if (scene.numLights <= 0) m_renderer->popGPUPipelineState();
+	if (!isBound)
+		return;
 
 	m_renderer->popGPUPipelineState();
 	m_renderer->popShadrProgram();
@@ -699,13 +990,6 @@ void DeferredRenderer::drawLightShadow(const Scene_t& scene, const Light_t& ligh
 }
 
 
-void DeferredRenderer::render(const SkyBox_t& skyBox) {
-	m_renderer->pushRenderTarget(&m_outputTarget);
-	__super::render(skyBox);
-	m_renderer->popRenderTarget();
-}
-
-
 void DeferredRenderer::render(const MeshRenderItem_t& task) {
 	auto taskExecutor = m_taskExecutors.find(m_pass);
 	if (taskExecutor == m_taskExecutors.end()) {
@@ -723,14 +1007,7 @@ void DeferredRenderer::render(const MeshRenderItem_t& task) {
 
 
 void DeferredRenderer::onWindowResize(float w, float h) {
-	if (w <= 0 || h <= 0)
-		return;
-
-	m_gBufferTarget.resize({ w, h });
-	m_outputTarget.resize({ w, h });
-
-	Texture* dsTex = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Depth_Stencil);
-	m_outputTarget.attachProxyTexture(dsTex, RenderTarget::Slot::Depth_Stencil);
+	// graph textures follow render size on their own
 }
 
 
@@ -741,69 +1018,79 @@ void DeferredRenderer::onShadowMapResolutionChange(float w, float h) {
 }
 
 
-bool DeferredRenderer::setupRenderTargets() {
-	// world position
-	ASSERT(m_gBufferTarget.attachTexture2D(Texture::Format::RGB32F, RenderTarget::Slot::Color, 0));
-	Texture* buffer = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 0);
-	buffer->bind();
-	buffer->setFilterMode(Texture::FilterType::Minification, Texture::FilterMode::Nearest);
-	buffer->setFilterMode(Texture::FilterType::Magnification, Texture::FilterMode::Nearest);
-	buffer->unbind();
-
-	// world normal
-	ASSERT(m_gBufferTarget.attachTexture2D(Texture::Format::RGB16F, RenderTarget::Slot::Color, 1));
-	buffer = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 1);
-	buffer->bind();
-	buffer->setFilterMode(Texture::FilterType::Minification, Texture::FilterMode::Nearest);
-	buffer->setFilterMode(Texture::FilterType::Magnification, Texture::FilterMode::Nearest);
-	buffer->unbind();
-
-	// albedo color
-	ASSERT(m_gBufferTarget.attachTexture2D(Texture::Format::RGBA8, RenderTarget::Slot::Color, 2));
-	buffer = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 2);
-	buffer->bind();
-	buffer->setFilterMode(Texture::FilterType::Minification, Texture::FilterMode::Nearest);
-	buffer->setFilterMode(Texture::FilterType::Magnification, Texture::FilterMode::Nearest);
-	buffer->unbind();
-
-	// specular color
-	ASSERT(m_gBufferTarget.attachTexture2D(Texture::Format::RGBA8, RenderTarget::Slot::Color, 3));
-	buffer = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 3);
-	buffer->bind();
-	buffer->setFilterMode(Texture::FilterType::Minification, Texture::FilterMode::Nearest);
-	buffer->setFilterMode(Texture::FilterType::Magnification, Texture::FilterMode::Nearest);
-	buffer->unbind();
-
-	// emissive/metallic/roughness
-	ASSERT(m_gBufferTarget.attachTexture2D(Texture::Format::RGB32F, RenderTarget::Slot::Color, 4));
-	buffer = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 4);
-	buffer->bind();
-	buffer->setFilterMode(Texture::FilterType::Magnification, Texture::FilterMode::Nearest);
-	buffer->setFilterMode(Texture::FilterType::Minification, Texture::FilterMode::Nearest);
-	buffer->unbind();
-
-	// shading mode (1.phong 2. pbr)
-	ASSERT(m_gBufferTarget.attachTexture2D(Texture::Format::R8, RenderTarget::Slot::Color, 5));
-	buffer = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Color, 5);
-	buffer->bind();
-	buffer->setFilterMode(Texture::FilterType::Magnification, Texture::FilterMode::Nearest);
-	buffer->setFilterMode(Texture::FilterType::Minification, Texture::FilterMode::Nearest);
-	buffer->unbind();
-
-	// depth/stcencil
-	ASSERT(m_gBufferTarget.attachTexture2D(Texture::Format::Depth24_Stencil8, RenderTarget::Slot::Depth_Stencil));
-	buffer = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Depth_Stencil);
-	buffer->bind();
-	buffer->setFilterMode(Texture::FilterType::Minification, Texture::FilterMode::Nearest);
-	buffer->setFilterMode(Texture::FilterType::Magnification, Texture::FilterMode::Nearest);
-	buffer->unbind();
-	
-	m_gBufferTarget.setDrawLocations({ 0, 1, 2, 3, 4, 5 });
-	ASSERT(m_gBufferTarget.isValid());
+bool DeferredRenderer::setupLightVolumes() {
+	VertexLayoutDescription vertLayoutDesc;
+	vertLayoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 3, 0);
+
+	// unit sphere, pushed out so flat faces still enclose the sphere
+	float inflate = 1.f / (cosf(glm::pi<float>() / LIGHT_VOLUME_SEGMENTS) * cosf(glm::half_pi<float>() / LIGHT_VOLUME_RINGS));
+	std::vector<glm::vec3> vertices;
+	std::vector<unsigned int> indices;
+	for (int r = 0; r <= LIGHT_VOLUME_RINGS; r++) {
+		float phi = glm::pi<float>() * r / LIGHT_VOLUME_RINGS;
+		for (int s = 0; s < LIGHT_VOLUME_SEGMENTS; s++) {
+			float theta = glm::two_pi<float>() * s / LIGHT_VOLUME_SEGMENTS;
+			vertices.push_back(glm::vec3(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta)) * inflate);
+		}
+	}
+
+	for (int r = 0; r < LIGHT_VOLUME_RINGS; r++) {
+		for (int s = 0; s < LIGHT_VOLUME_SEGMENTS; s++) {
+			unsigned int a = r * LIGHT_VOLUME_SEGMENTS + s;
+			unsigned int b = r * LIGHT_VOLUME_SEGMENTS + (s + 1) % LIGHT_VOLUME_SEGMENTS;
+			unsigned int c = a + LIGHT_VOLUME_SEGMENTS;
+			unsigned int d = b + LIGHT_VOLUME_SEGMENTS;
+			indices.insert(indices.end(), { a, b, c, b, d, c });
+		}
+	}
+
+	m_numSphereIndices = indices.size();
+	m_sphereVAO.reset(new VertexArray());
+	m_sphereVBO.reset(new Buffer());
+	m_sphereIBO.reset(new Buffer());
+
+	m_sphereVAO->bind();
+	m_sphereVBO->bind(Buffer::Target::VertexBuffer);
+	m_sphereIBO->bind(Buffer::Target::IndexBuffer);
+	m_sphereVBO->loadData(vertices.data(), sizeof(glm::vec3) * vertices.size(), Buffer::Usage::StaticDraw, vertices.size());
+	m_sphereIBO->loadData(indices.data(), sizeof(unsigned int) * indices.size(), Buffer::Usage::StaticDraw, indices.size());
+	m_sphereVAO->storeVertexLayout(vertLayoutDesc);
+	m_sphereVAO->unbind();
+	m_sphereVBO->unbind();
+	m_sphereIBO->unbind();
+
+	// unit cone, apex at origin, base circle of radius 1 at z = 1
+	float baseRadius = 1.f / cosf(glm::pi<float>() / LIGHT_VOLUME_SEGMENTS);
+	vertices.clear();
+	indices.clear();
+	for (int s = 0; s < LIGHT_VOLUME_SEGMENTS; s++) {
+		float theta = glm::two_pi<float>() * s / LIGHT_VOLUME_SEGMENTS;
+		vertices.push_back(glm::vec3(cosf(theta) * baseRadius, sinf(theta) * baseRadius, 1.f));
+	}
+	unsigned int apex = vertices.size();
+	vertices.push_back(glm::vec3(0.f));
+	unsigned int center = vertices.size();
+	vertices.push_back(glm::vec3(0.f, 0.f, 1.f));
+
+	for (unsigned int s = 0; s < LIGHT_VOLUME_SEGMENTS; s++) {
+		unsigned int next = (s + 1) % LIGHT_VOLUME_SEGMENTS;
+		indices.insert(indices.end(), { apex, next, s, center, s, next });
+	}
 
-	Texture* dsTex = m_gBufferTarget.getAttachedTexture(RenderTarget::Slot::Depth_Stencil);
-	ASSERT(m_outputTarget.attachTexture2D(Texture::Format::RGBA16F, RenderTarget::Slot::Color));
-	ASSERT(m_outputTarget.attachProxyTexture(dsTex, RenderTarget::Slot::Depth_Stencil));
+	m_numConeIndices = indices.size();
+	m_coneVAO.reset(new VertexArray());
+	m_coneVBO.reset(new Buffer());
+	m_coneIBO.reset(new Buffer());
+
+	m_coneVAO->bind();
+	m_coneVBO->bind(Buffer::Target::VertexBuffer);
+	m_coneIBO->bind(Buffer::Target::IndexBuffer);
+	m_coneVBO->loadData(vertices.data(), sizeof(glm::vec3) * vertices.size(), Buffer::Usage::StaticDraw, vertices.size());
+	m_coneIBO->loadData(indices.data(), sizeof(unsigned int) * indices.size(), Buffer::Usage::StaticDraw, indices.size());
+	m_coneVAO->storeVertexLayout(vertLayoutDesc);
+	m_coneVAO->unbind();
+	m_coneVBO->unbind();
+	m_coneIBO->unbind();
 
 	return true;
 }
@@ -2,8 +2,10 @@
 #include"RenderTechnique.h"
 #include"RenderTaskExecutor.h"
 #include"RenderTarget.h"
+#include"RenderGraph.h"
 #include<memory>
 #include<unordered_map>
+#include<vector>
 
 
 class VertexArray;
@@ -13,7 +15,22 @@ class ShaderProgram;
 class IShadowMapping;
 
 
+// position, normal, albedo, specular, emissive/metallic/roughness, shading mode
+#define DEFERRED_NUM_GBUFFERS 6
+
+
 class DeferredRenderer : public RenderTechniqueBase {
+	// light layout of tiled lighting shader
+	struct TiledLight {
+		glm::vec4 position; // (xyz)position (w)range
+		glm::vec4 color; // (rgb)color (a)intensity
+		glm::vec3 toLight;
+		float _padding;
+		glm::vec3 angles; // spot angles
+		int type;
+		glm::vec4 bounds; // (xyz)world space bounding sphere center (w)radius
+	};
+
 	friend class DepthPassRenderTaskExecutor;
 	friend class GeometryPassRenderTaskExecutor;
 	friend class UlitPassRenderTaskExecutror;
@@ -22,6 +39,11 @@ class DeferredRenderer : public RenderTechniqueBase {
 	friend class SpotLightShadowMapping;
 
 public:
+	enum class LightingMode {
+		LightVolume, // point/spot lights draw bounding volumes, one draw per light
+		TiledCompute, // unshadowed lights are culled per screen tile and accumulated by one dispatch
+	};
+
 	DeferredRenderer(Renderer* renderer);
 	~DeferredRenderer();
 
@@ -36,10 +58,10 @@ public:
 	static const std::string s_identifier;
 
 	void render(const MeshRenderItem_t& task) override;
-	void render(const SkyBox_t& skyBox) override;
+	void render(const Scene_t& scene) override;
 	
 	inline Texture* getRenderedFrame() override {
-		return m_outputTarget.getAttachedTexture(RenderTarget::Slot::Color);
+		return m_renderedFrame;
 	}
 
 	void beginFrame() override;
@@ -57,14 +79,35 @@ public:
 		return s_identifier;
 	}
 
+	inline void setLightingMode(LightingMode mode) {
+		m_lightingMode = mode;
+	}
+
+	inline LightingMode getLightingMode() const {
+		return m_lightingMode;
+	}
+
+	// passes, schedule & timings of last frame
+	inline const RenderGraph& getRenderGraph() const {
+		return m_renderGraph;
+	}
+
 
 protected:
-	bool setupRenderTargets();
+	void setupRenderGraph(const Scene_t& scene);
+	bool setupLightVolumes();
 	void drawUnlitScene(const Scene_t& scene);
 	void drawSolidsLights(const Scene_t& scene);
+	void drawSolidsLight(const Scene_t& scene, const Light_t& light);
+	bool drawSolidsLightsTiled(const Scene_t& scene);
+	void bindGBuffer();
+	void unbindGBuffer();
+	void setGBufferUniforms(ShaderProgram* shader);
+	bool calcLightVolume(const Scene_t& scene, const Light_t& light, glm::mat4& mvp, VertexArray*& volume, size_t& numIndex) const;
 	void drawSolidsAmbient(const Scene_t& scene);
-	void drawCutOutsLights(const Scene_t& scene);
-	void drawCutOutsAmbient(const Scene_t& scene);
+	size_t drawCutOutsLights(const Scene_t& scene); // number of lights drawn
+	void drawCutOutsLight(const Scene_t& scene, const Light_t& light, bool isFirst);
+	void drawCutOutsAmbient(const Scene_t& scene, bool isFirst);
 	void drawLightShadow(const Scene_t& scene, const Light_t& light);
 
 private:
@@ -74,13 +117,17 @@ private:
 	GPUPipelineState m_geometryPassPipelineState;
 	GPUPipelineState m_shadowPassPipelineState;
 	GPUPipelineState m_lightPassPipelineState;
+	GPUPipelineState m_lightVolumePipelineState;
 	GPUPipelineState m_unlitPassPipelineState;
 	GPUPipelineState m_cutOutPipelineState1;
 	GPUPipelineState m_cutOutPipelineState2;
 
-	// geometry buffers
-	RenderTarget m_gBufferTarget;
-	RenderTarget m_outputTarget;
+	// geometry buffers, depth & lit scene are graph transients
+	RenderGraph m_renderGraph;
+	RenderGraphHandle m_gBuffers[DEFERRED_NUM_GBUFFERS];
+	RenderGraphHandle m_sceneDepth;
+	RenderGraphHandle m_sceneColor;
+	Texture* m_renderedFrame;
 
 	// light ubo
 	std::unique_ptr<Buffer> m_directionalLightUBO;
@@ -89,6 +136,22 @@ private:
 
 	// shadow mapping
 	std::unordered_map<LightType, std::unique_ptr<IShadowMapping>> m_shadowMappings;
+
+	// light volumes, unit sphere & unit cone (apex at origin, base at z = 1)
+	LightingMode m_lightingMode;
+	std::unique_ptr<VertexArray> m_sphereVAO;
+	std::unique_ptr<Buffer> m_sphereVBO;
+	std::unique_ptr<Buffer> m_sphereIBO;
+	std::unique_ptr<VertexArray> m_coneVAO;
+	std::unique_ptr<Buffer> m_coneVBO;
+	std::unique_ptr<Buffer> m_coneIBO;
+	size_t m_numSphereIndices;
+	size_t m_numConeIndices;
+
+	// tiled lighting
+	bool m_isTiledLighting; // this frame, shader is available
+	std::unique_ptr<Buffer> m_tiledLightsSSBO;
+	std::vector<TiledLight> m_tiledLights;
 };
 
 
@@ -9,7 +9,9 @@
 #include<glm/gtx/transform.hpp>
 #include<glm/gtc/type_ptr.hpp>
 #include<sstream>
+#include<limits>
 #include"Containers.h"
+#include"Profiler.h"
 
 const int DirectionalLightShadowMapping::s_maxNumCascades = 4;
 
@@ -19,8 +21,10 @@ DirectionalLightShadowMapping::DirectionalLightShadowMapping(IRenderTechnique* r
 , m_numCascade(numCascade)
 , m_shadowMapResolution(shadowMapResolution)
 , m_shadowViewport(0.f, 0.f, shadowMapResolution.x, shadowMapResolution.y)
-, m_shadowTarget()
-, m_shader() {
+, m_cache(Texture::Target::Texture_2D_Array, numCascade, [this]() { return createShadowTarget(); })
+, m_shader()
+, m_cascadeFrustums()
+, m_casterCuller() {
 
 }
 	
@@ -28,12 +32,12 @@ bool DirectionalLightShadowMapping::initialize() {
 	if (m_numCascade > s_maxNumCascades)
 		return false;
 
-	return setupShadowRenderTarget();
+	return true;
 }
 
 
 void DirectionalLightShadowMapping::cleanUp() {
-	m_shadowTarget.release();
+	m_cache.clear();
 }
 
 void DirectionalLightShadowMapping::renderShadow(const Scene_t& scene, const Light_t& light) {
@@ -41,46 +45,68 @@ void DirectionalLightShadowMapping::renderShadow(const Scene_t& scene, const Lig
 		return;
 
 	calcViewFrumstumCascades(light, *scene.mainCamera);
-	
-	m_shader =  ShaderProgramManager::getInstance()->addProgram("DirectionalLightShadowPass").lock();
 
+	std::vector<glm::mat4> lightsVP;
+	std::for_each(m_cascadeCameras.begin(), m_cascadeCameras.end(), [&](const Camera_t& c) {
+		lightsVP.push_back(c.projMatrix * c.viewMatrix);
+	});
+
+	// casters outside main camera may still throw shadow into it, test all of them against cascades
+	m_cascadeFrustums.clear();
+	for (const auto& vp : lightsVP) {
+		Frustum f = Frustum::FromMatrix(vp);
+		f.near.distance = -std::numeric_limits<float>::max(); // casters between light and near plane still occlude
+		m_cascadeFrustums.push_back(f);
+	}
+
+	// cascades follow main camera, map is left as it is while camera, light & casters stay put
 	Renderer* renderer = m_renderTech->getRenderer();
+	auto tracker = renderer->getShadowCasterTracker();
+	auto culler = [this](const MeshRenderItem_t* items, size_t count, uint8_t* masks) {
+		cullCasters(items, count, masks);
+	};
+
+	uint64_t lightKey = ShadowCasterTracker::lightKey(light);
+	uint64_t lightSignature = ShadowCasterTracker::hashBytes(lightsVP.data(), sizeof(glm::mat4) * lightsVP.size(), ShadowCasterTracker::lightSignature(light));
+	bool isDirty = m_cache.begin(scene, tracker, lightKey, lightSignature, culler);
+
+	auto profiler = Profiler::getInstance();
+	profiler->addCounter("Culling::shadowVisible", m_cache.numSelected());
+	profiler->addCounter("Culling::shadowCulled", m_cache.numCasters() - m_cache.numSelected());
+
+	if (!isDirty)
+		return;
+
+	m_shader =  ShaderProgramManager::getInstance()->addProgram("DirectionalLightShadowPass").lock();
+
 	renderer->pushShaderProgram(m_shader.get());
-	renderer->pushRenderTarget(m_shadowTarget.get());
 	renderer->pushViewport(&m_shadowViewport);
-	renderer->clearScreen(ClearFlags::Depth);
 
 	if (m_shader->hasUniform("u_numCascade"))
 		m_shader->setUniform1("u_numCascade", m_numCascade);
 
-	if (m_shader->hasUniform("u_lightVP[0]")) {
-		std::vector<glm::mat4> lightsVP;
-		std::for_each(m_cascadeCameras.begin(), m_cascadeCameras.end(), [&](const Camera_t& c) {
-			lightsVP.push_back(c.projMatrix * c.viewMatrix);
-		});
+	if (m_shader->hasUniform("u_lightVP[0]"))
 		m_shader->setUniformMat4v("u_lightVP[0]", glm::value_ptr(lightsVP[0]), lightsVP.size());
-	}
 
-	for (size_t i = 0; i < scene.numOpaqueItems; i++) {
-		m_renderTech->render(scene.opaqueItems[i]);
-	}
-
-	for (size_t i = 0; i < scene.numCutOutItems; i++) {
-		m_renderTech->render(scene.cutOutItems[i]);
-	}
-
-	for (size_t i = 0; i < scene.numTransparentItems; i++) {
-		m_renderTech->render(scene.transparentItems[i]);
-	}
+	m_cache.render(m_renderTech, tracker);
 
 	renderer->popViewport();
-	renderer->popRenderTarget();
 	renderer->popShadrProgram();
 	m_shader->unbindSubroutineUniforms();
 	m_shader = nullptr;
 }
 
 
+void DirectionalLightShadowMapping::cullCasters(const MeshRenderItem_t* items, size_t count, uint8_t* masks) {
+	m_casterCuller.clear();
+	for (size_t i = 0; i < count; i++)
+		m_casterCuller.add(items[i].bounds);
+
+	for (size_t c = 0; c < m_cascadeFrustums.size(); c++)
+		m_casterCuller.cull(m_cascadeFrustums[c], masks, uint8_t(1 << c));
+}
+
+
 void DirectionalLightShadowMapping::beginRenderLight(const Light_t& light, ShaderProgram* shader) {
 	if (shader->hasSubroutineUniform(Shader::Type::FragmentShader, "u_shadowAtten")) {
 		static std::map<ShadowType, std::string> shadowSubrotines { {ShadowType::HardShadow, "hardShadow"},
@@ -90,7 +116,7 @@ void DirectionalLightShadowMapping::beginRenderLight(const Light_t& light, Shade
 	}
 
 	if (shader->hasUniform("u_shadowMapArray") && light.isCastShadow()) {
-		Texture* shadowMap = m_shadowTarget->getAttachedTexture(RenderTarget::Slot::Depth);
+		Texture* shadowMap = m_cache.getShadowMap(ShadowCasterTracker::lightKey(light));
 		if (shadowMap) {
 			shadowMap->bindToTextureUnit(Texture::Unit::ShadowMap, Texture::Target::Texture_2D_Array);
 			shader->setUniform1("u_shadowMapArray", int(Texture::Unit::ShadowMap));
@@ -121,7 +147,7 @@ void DirectionalLightShadowMapping::beginRenderLight(const Light_t& light, Shade
 
 void DirectionalLightShadowMapping::endRenderLight(const Light_t& light, ShaderProgram* shader) {
 	if (light.isCastShadow()) {
-		Texture* shadowMap = m_shadowTarget->getAttachedTexture(RenderTarget::Slot::Depth);
+		Texture* shadowMap = m_cache.getShadowMap(ShadowCasterTracker::lightKey(light));
 		if (shadowMap) shadowMap->unbindFromTextureUnit();
 	}
 }
@@ -129,7 +155,7 @@ void DirectionalLightShadowMapping::endRenderLight(const Light_t& light, ShaderP
 void DirectionalLightShadowMapping::onShadowMapResolutionChange(float w, float h) {
 	m_shadowMapResolution = { w, h };
 	m_shadowViewport = Viewport_t(0.f, 0.f, w, h);
-	ASSERT(setupShadowRenderTarget());
+	m_cache.clear(); // maps are re-created at new resolution when lights render next
 }
 
 void DirectionalLightShadowMapping::calcViewFrumstumCascades(const Light_t& light, const Camera_t& camera) {
@@ -186,21 +212,21 @@ void DirectionalLightShadowMapping::calcViewFrumstumSplitPercents(const Camera_t
 }
 
 
-bool DirectionalLightShadowMapping::setupShadowRenderTarget() {
-	m_shadowTarget.reset(new RenderTarget(m_shadowMapResolution));
-	m_shadowTarget->bind();
+std::unique_ptr<RenderTarget> DirectionalLightShadowMapping::createShadowTarget() {
+	std::unique_ptr<RenderTarget> shadowTarget(new RenderTarget(m_shadowMapResolution));
+	shadowTarget->bind();
 
-	if (!m_shadowTarget->attchTexture2DArray(Texture::Format::Depth24, m_numCascade, RenderTarget::Slot::Depth)) {
-		m_shadowTarget->unBind();
-		return false;
+	if (!shadowTarget->attchTexture2DArray(Texture::Format::Depth24, m_numCascade, RenderTarget::Slot::Depth)) {
+		shadowTarget->unBind();
+		return nullptr;
 	}
 
-	if (!m_shadowTarget->isValid()) {
-		m_shadowTarget->unBind();
-		return false;
+	if (!shadowTarget->isValid()) {
+		shadowTarget->unBind();
+		return nullptr;
 	}
 
-	m_shadowTarget->unBind();
+	shadowTarget->unBind();
 
-	return true;
+	return shadowTarget;
 }
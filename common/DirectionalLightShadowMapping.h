@@ -1,6 +1,9 @@
 #pragma once
 #include"ShadowMapping.h"
 #include"RenderTarget.h"
+#include"FrustumCuller.h"
+#include"Geometry3D.h"
+#include"ShadowMapCache.h"
 #include<memory>
 
 //
@@ -29,10 +32,11 @@ private:
 	void calcViewFrumstumCascades(const Light_t& light, const Camera_t& camera);
 	void calcViewFrumstumSplitPercents(const Camera_t& camera, float t);
 
-	bool setupShadowRenderTarget();
+	std::unique_ptr<RenderTarget> createShadowTarget();
+	void cullCasters(const MeshRenderItem_t* items, size_t count, uint8_t* masks); // bit per cascade caster is inside
 
 private:
-	std::unique_ptr<RenderTarget> m_shadowTarget;
+	ShadowMapCache m_cache;
 	std::shared_ptr<ShaderProgram> m_shader;
 
 	glm::vec2 m_shadowMapResolution;
@@ -42,4 +46,7 @@ private:
 	std::vector<float> m_splitPercents;
 	std::vector<float> m_cascadeFarProjZ;
 	std::vector<Camera_t> m_cascadeCameras;
+	std::vector<Frustum> m_cascadeFrustums;
+
+	FrustumCuller m_casterCuller;
 };
\ No newline at end of file
@@ -1,4 +1,15 @@
 #include"FileSystem.h"
+#include<system_error>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include<Windows.h>
+#else
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#endif // _WIN32
 
 namespace fs = std::filesystem;
 
@@ -21,6 +32,17 @@ bool FileSystem::pathExist(const fs::path& path) {
 }
 
 
+bool FileSystem::fileStamp(const fs::path& path, uint64_t& size, int64_t& time) {
+	std::error_code error;
+	size = uint64_t(fs::file_size(path, error));
+	if (error)
+		return false;
+
+	time = int64_t(fs::last_write_time(path, error).time_since_epoch().count());
+	return !error;
+}
+
+
 FileSystem::FileType FileSystem::fileType(const fs::path& path) {
 	if (fs::is_directory(path))
 		return FileType::Directory;
@@ -33,3 +55,90 @@ FileSystem::FileType FileSystem::fileType(const fs::path& path) {
 
 	return FileType::Other;
 }
+
+
+
+MappedFile::MappedFile() :m_data(nullptr)
+, m_size(0)
+, m_file(nullptr)
+, m_mapping(nullptr) {
+
+}
+
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+
+bool MappedFile::open(const fs::path& path) {
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		CloseHandle(file);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file = file;
+	m_mapping = mapping;
+	m_size = size_t(size.QuadPart);
+#else
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(file, &st) != 0 || st.st_size == 0) {
+		::close(file);
+		return false;
+	}
+
+	void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (data == MAP_FAILED)
+		return false;
+
+	m_size = size_t(st.st_size);
+#endif // _WIN32
+
+	m_data = static_cast<const uint8_t*>(data);
+	return true;
+}
+
+
+void MappedFile::close() {
+	if (!m_data)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+#else
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif // _WIN32
+
+	m_data = nullptr;
+	m_size = 0;
+	m_file = nullptr;
+	m_mapping = nullptr;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include<filesystem>
+#include<cstdint>
 
 namespace fs = std::filesystem;
 
@@ -20,6 +21,7 @@ public:
 
 	bool pathExist(const fs::path& path);
 	FileType fileType(const fs::path& path);
+	bool fileStamp(const fs::path& path, uint64_t& size, int64_t& time); // cached files compare it to tell their source changed
 
 	inline void setHomeDirectory(const fs::path& home) {
 		m_home = home;
@@ -31,4 +33,39 @@ public:
 
 protected:
 	fs::path m_home;
-};
\ No newline at end of file
+};
+
+
+//
+// read only view of a whole file mapped into memory, pages are read in on first touch.
+// data stays valid until the object is destroyed
+//
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile& other) = delete;
+	MappedFile& operator = (const MappedFile& other) = delete;
+
+	bool open(const fs::path& path);
+	void close();
+
+	inline const uint8_t* data() const {
+		return m_data;
+	}
+
+	inline size_t size() const {
+		return m_size;
+	}
+
+	inline bool isOpen() const {
+		return m_data != nullptr;
+	}
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+	void* m_file; // platform handles
+	void* m_mapping;
+};
@@ -5,6 +5,7 @@
 #include"DirectionalLightShadowMapping.h"
 #include"PointLightShadowMapping.h"
 #include"SpotLightShadowMapping.h"
+#include"Profiler.h"
 #include<sstream>
 
 
@@ -12,15 +13,27 @@ const std::string ForwardPlusRenderer::s_identifier = "ForwarPlusRenderer";
 
 
 ForwardPlusRenderer::ForwardPlusRenderer(Renderer* renderer) : RenderTechniqueBase(renderer)
-, m_outputTarget()
+, m_renderGraph(renderer)
+, m_sceneColor(RENDER_GRAPH_NULL_HANDLE)
+, m_sceneDepth(RENDER_GRAPH_NULL_HANDLE)
+, m_fragListHeader(RENDER_GRAPH_NULL_HANDLE)
+, m_frameOutput(RENDER_GRAPH_NULL_HANDLE)
+, m_renderedFrame(nullptr)
 , m_taskExecutors()
 , m_shadowMappings()
 , m_lightsSSBO()
 , m_lights()
+, m_numGlobalLights(0)
+, m_lightClusters()
+, m_clusterBoundsSSBO()
+, m_lightSpheresSSBO()
+, m_lightExtentsSSBO()
+, m_lightGridSSBO()
+, m_lightIndicesSSBO()
+, m_isGPULightClustering(true)
 , m_isOITSetup(false)
 , m_fragIdxACBO()
 , m_fragListSSBO()
-, m_fragListHeader()
 , m_fragListHeaderResetBuffer(){
 	setupPipelineStates();
 	RENDER_TASK_EXECUTOR_INIT();
@@ -34,14 +47,37 @@ ForwardPlusRenderer::~ForwardPlusRenderer() {
 
 
 bool ForwardPlusRenderer::intialize() {
-	if (!setupOutputTarget())
-		return false;
-
 	m_lightsSSBO.reset(new Buffer());
 	m_lightsSSBO->bind(Buffer::Target::ShaderStorageBuffer);
 	ASSERT(m_lightsSSBO->loadData(nullptr, sizeof(Light) * MAX_NUM_TOTAL_LIGHTS, Buffer::Usage::DynamicDraw));
 	m_lightsSSBO->unbind();
 
+	size_t numClusters = m_lightClusters.numClusters();
+	m_clusterBoundsSSBO.reset(new Buffer());
+	m_clusterBoundsSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+	ASSERT(m_clusterBoundsSSBO->loadData(nullptr, sizeof(glm::vec4) * 2 * numClusters, Buffer::Usage::DynamicDraw));
+	m_clusterBoundsSSBO->unbind();
+
+	m_lightSpheresSSBO.reset(new Buffer());
+	m_lightSpheresSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+	ASSERT(m_lightSpheresSSBO->loadData(nullptr, sizeof(glm::vec4) * MAX_NUM_LIGHTS, Buffer::Usage::DynamicDraw));
+	m_lightSpheresSSBO->unbind();
+
+	m_lightExtentsSSBO.reset(new Buffer());
+	m_lightExtentsSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+	ASSERT(m_lightExtentsSSBO->loadData(nullptr, sizeof(glm::ivec4) * 2 * MAX_NUM_LIGHTS, Buffer::Usage::DynamicDraw));
+	m_lightExtentsSSBO->unbind();
+
+	m_lightGridSSBO.reset(new Buffer());
+	m_lightGridSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+	ASSERT(m_lightGridSSBO->loadData(nullptr, sizeof(glm::uvec2) * numClusters, Buffer::Usage::DynamicCopy));
+	m_lightGridSSBO->unbind();
+
+	m_lightIndicesSSBO.reset(new Buffer());
+	m_lightIndicesSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+	ASSERT(m_lightIndicesSSBO->loadData(nullptr, sizeof(uint32_t) * MAX_LIGHTS_PER_CLUSTER * numClusters, Buffer::Usage::DynamicCopy));
+	m_lightIndicesSSBO->unbind();
+
 	m_taskExecutors[RenderPass::DepthPass] = std::unique_ptr<RenderTaskExecutor>(new DepthPassRenderTaskExecutor(this));
 	m_taskExecutors[RenderPass::ShadowPass] = std::unique_ptr<RenderTaskExecutor>(new ShadowPassRenderTaskExecutor(this));
 	m_taskExecutors[RenderPass::LightPass] = std::unique_ptr<RenderTaskExecutor>(new LightPassRenderTaskExecuter(this));
@@ -63,33 +99,129 @@ void ForwardPlusRenderer::cleanUp() {
 	m_taskExecutors.clear();
 	m_shadowMappings.clear();
 	m_lightsSSBO.release();
-	m_outputTarget.release();
+	m_clusterBoundsSSBO.reset(nullptr);
+	m_lightSpheresSSBO.reset(nullptr);
+	m_lightExtentsSSBO.reset(nullptr);
+	m_lightGridSSBO.reset(nullptr);
+	m_lightIndicesSSBO.reset(nullptr);
+	m_renderGraph.releaseResources();
+	m_renderedFrame = nullptr;
 }
 
 
 void ForwardPlusRenderer::beginFrame() {
-	m_renderer->pushRenderTarget(m_outputTarget.get());
-	m_renderer->clearScreen(ClearFlags::Color | ClearFlags::Depth | ClearFlags::Stencil);
+	m_renderGraph.reset();
 }
 
 
 void ForwardPlusRenderer::endFrame() {
-	m_renderer->popRenderTarget();
+	m_renderedFrame = m_renderGraph.getTexture(m_frameOutput);
 }
 
 
 Texture* ForwardPlusRenderer::getRenderedFrame() {
-	if (m_oitBlendTarget)
-		return m_oitBlendTarget->getAttachedTexture(RenderTarget::Slot::Color);
-	
-	if (m_outputTarget)
-		return m_outputTarget->getAttachedTexture(RenderTarget::Slot::Color);
-
 #ifdef _DEBUG
-	ASSERT(false);
+	ASSERT(m_renderedFrame);
 #endif // _DEBUG
 
-	return nullptr;
+	return m_renderedFrame;
+}
+
+
+void ForwardPlusRenderer::render(const Scene_t& scene) {
+	beginFrame();
+	setupRenderGraph(scene);
+
+	if (m_renderGraph.compile())
+		m_renderGraph.execute();
+
+	endFrame();
+}
+
+
+void ForwardPlusRenderer::setupRenderGraph(const Scene_t& scene) {
+	auto renderSz = m_renderer->getRenderSize();
+	size_t width = size_t(renderSz.x), height = size_t(renderSz.y);
+	auto& graph = m_renderGraph;
+
+	m_sceneColor = graph.createTexture("SceneColor", Texture::Format::RGBA16F, width, height);
+	m_sceneDepth = graph.createTexture("SceneDepth", Texture::Format::Depth24_Stencil8, width, height);
+	auto lights = graph.importBuffer("Lights", m_lightsSSBO.get());
+	auto lightGrid = graph.importBuffer("LightGrid", m_lightGridSSBO.get());
+	auto lightIndices = graph.importBuffer("LightIndices", m_lightIndicesSSBO.get());
+
+	auto readLights = [&](size_t pass) {
+		graph.read(pass, lights, RenderGraphAccess::Storage);
+		graph.read(pass, lightGrid, RenderGraphAccess::Storage);
+		graph.read(pass, lightIndices, RenderGraphAccess::Storage);
+	};
+
+	// color is cleared along with depth so every opaque pass runs on one target
+	size_t pass = graph.addPass("DepthPrepass", false, [this, &scene]() { drawDepthPass(scene); });
+	graph.writeAttachment(pass, m_sceneColor, RenderTarget::Slot::Color);
+	graph.writeAttachment(pass, m_sceneDepth, RenderTarget::Slot::Depth_Stencil);
+	graph.setClearFlags(pass, ClearFlags::Color | ClearFlags::Depth | ClearFlags::Stencil);
+
+	pass = graph.addPass("LightClustering", true, [this, &scene]() { PrepareLights(scene); });
+	graph.write(pass, lights, RenderGraphAccess::Storage);
+	graph.write(pass, lightGrid, RenderGraphAccess::Storage);
+	graph.write(pass, lightIndices, RenderGraphAccess::Storage);
+
+	pass = graph.addPass("Opaques", false, [this, &scene]() { drawOpaquePass(scene); });
+	readLights(pass);
+	graph.writeAttachment(pass, m_sceneColor, RenderTarget::Slot::Color);
+	graph.writeAttachment(pass, m_sceneDepth, RenderTarget::Slot::Depth_Stencil);
+
+	// main lights of one type share a shadow map, next one is rendered after the light before it is shaded
+	if ((scene.numOpaqueItems + scene.numCutOutItems) > 0) {
+		std::unordered_map<LightType, RenderGraphHandle> shadowMaps;
+		for (size_t i = 0; i < scene.numMainLights; i++) {
+			auto& light = scene.mainLights[i];
+			auto shadowMap = shadowMaps.find(light.type);
+			if (shadowMap == shadowMaps.end())
+				shadowMap = shadowMaps.insert(std::make_pair(light.type, graph.importBuffer("ShadowMap" + std::to_string(int(light.type)), nullptr))).first;
+
+			pass = graph.addPass("ShadowMap" + std::to_string(i), false, [this, &scene, &light]() { genShadowMap(scene, light); });
+			graph.write(pass, shadowMap->second, RenderGraphAccess::Attachment);
+
+			pass = graph.addPass("MainLight" + std::to_string(i), false, [this, &scene, &light]() { RenderMainLight(scene, light); });
+			graph.read(pass, shadowMap->second, RenderGraphAccess::Sampled);
+			graph.writeAttachment(pass, m_sceneColor, RenderTarget::Slot::Color);
+			graph.readAttachment(pass, m_sceneDepth, RenderTarget::Slot::Depth_Stencil);
+		}
+	}
+
+	if (scene.skyBox) {
+		pass = graph.addPass("SkyBox", false, [this, &scene]() { drawSkyBox(*scene.skyBox, *scene.mainCamera); });
+		graph.writeAttachment(pass, m_sceneColor, RenderTarget::Slot::Color);
+		graph.readAttachment(pass, m_sceneDepth, RenderTarget::Slot::Depth_Stencil);
+	}
+
+	m_frameOutput = m_sceneColor;
+	if (scene.numTransparentItems > 0 && (m_isOITSetup || setupOIT())) {
+		m_fragListHeader = graph.createTexture("OITFragHeader", Texture::Format::R32UI, width, height);
+		auto fragList = graph.importBuffer("OITFragList", m_fragListSSBO.get());
+		auto oitColor = graph.createTexture("OITColor", Texture::Format::RGBA16F, width, height);
+
+		// fragments are depth tested on the opaque target with color writes masked
+		pass = graph.addPass("OITFragments", false, [this, &scene]() { drawTransparentPass(scene); });
+		readLights(pass);
+		graph.readAttachment(pass, m_sceneColor, RenderTarget::Slot::Color);
+		graph.readAttachment(pass, m_sceneDepth, RenderTarget::Slot::Depth_Stencil);
+		graph.write(pass, m_fragListHeader, RenderGraphAccess::Image);
+		graph.write(pass, fragList, RenderGraphAccess::Storage);
+
+		pass = graph.addPass("OITBlend", false, [this]() { blendOITFragList(); });
+		graph.read(pass, m_fragListHeader, RenderGraphAccess::Image);
+		graph.read(pass, fragList, RenderGraphAccess::Storage);
+		graph.read(pass, m_sceneColor, RenderGraphAccess::Image);
+		graph.writeAttachment(pass, oitColor, RenderTarget::Slot::Color);
+		graph.setClearFlags(pass, ClearFlags::Color);
+
+		m_frameOutput = oitColor;
+	}
+
+	graph.setOutput(m_frameOutput);
 }
 
 void ForwardPlusRenderer::drawDepthPass(const Scene_t& scene) {
@@ -109,8 +241,7 @@ void ForwardPlusRenderer::drawDepthPass(const Scene_t& scene) {
 		m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
 	}
 
-	for (size_t i = 0; i < scene.numOpaqueItems; i++)
-		render(scene.opaqueItems[i]);
+	renderBatch(scene.opaqueItems, scene.numOpaqueItems);
 
 	m_passShader->unbindSubroutineUniforms();
 	m_renderer->popGPUPipelineState();
@@ -122,10 +253,8 @@ void ForwardPlusRenderer::drawDepthPass(const Scene_t& scene) {
 
 
 void ForwardPlusRenderer::drawOpaquePass(const Scene_t& scene) {
-	PrepareLights(scene);
 	DrawOpaques(scene, false);
 	DrawOpaques(scene, true);
-	RenderMainLights(scene);
 }
 
 
@@ -133,15 +262,8 @@ void ForwardPlusRenderer::drawTransparentPass(const Scene_t& scene) {
 	if (scene.numTransparentItems <= 0)
 		return;
 
-	if (!m_isOITSetup)
-		ASSERT(setupOIT());
-
+	// blending waits on the graph barrier after fragment lists are written
 	genOITFragList(scene);
-
-	m_renderer->flushDrawCommands();
-	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-	
-	blendOITFragList();
 }
 
 
@@ -169,22 +291,17 @@ void ForwardPlusRenderer::DrawOpaques(const Scene_t& scene, bool useCutout) {
 		m_passShader->setUniform3v("u_CameraPosW", &scene.mainCamera->position[0]);
 	}
 
-	m_lightsSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 1);
-	m_passShader->bindShaderStorageBlock("Lights", 1);
-	m_passShader->setUniform1("u_NumLights", int(scene.numLights));
+	BindLights(scene, false);
 	
 	if (useCutout) {
-		for (size_t i = 0; i < scene.numCutOutItems; i++)
-			render(scene.cutOutItems[i]);
+		renderBatch(scene.cutOutItems, scene.numCutOutItems);
 	}
 	else {
-		for (size_t i = 0; i < scene.numOpaqueItems; i++)
-			render(scene.opaqueItems[i]);
+		renderBatch(scene.opaqueItems, scene.numOpaqueItems);
 	}
 
 	m_passShader->unbindSubroutineUniforms();
-	m_passShader->unbindShaderStorageBlock("Lights");
-	m_lightsSSBO->unbind();
+	UnbindLights();
 	m_renderer->popGPUPipelineState();
 	m_renderer->popShadrProgram();
 	m_passShader = nullptr;
@@ -193,28 +310,144 @@ void ForwardPlusRenderer::DrawOpaques(const Scene_t& scene, bool useCutout) {
 
 
 void ForwardPlusRenderer::PrepareLights(const Scene_t& scene) {
-	for (size_t i = 0; i < scene.numLights; i++)
-	{	
-		Light_t& light = scene.lights[i];
-		m_lights[i].position = glm::vec4(light.position, light.range);
-		m_lights[i].direction = glm::normalize(-light.direction);
-		m_lights[i].color = glm::vec4(light.color, light.intensity);
-		m_lights[i].angles = light.type == LightType::Ambient ? light.colorEx : glm::vec3(light.innerCone, light.outterCone, 0.f);
-		m_lights[i].type = int(light.type);
+	auto packLight = [](const Light_t& light, Light& packed) {
+		packed.position = glm::vec4(light.position, light.range);
+		packed.direction = glm::normalize(-light.direction);
+		packed.color = glm::vec4(light.color, light.intensity);
+		packed.angles = light.type == LightType::Ambient ? light.colorEx : glm::vec3(light.innerCone, light.outterCone, 0.f);
+		packed.type = int(light.type);
+	};
+
+	// main lights are shaded by their own pass on opaques, transparents take them as global lights
+	size_t numLights = 0;
+	for (size_t j = 0; j < scene.numMainLights; j++)
+		packLight(scene.mainLights[j], m_lights[numLights++]);
+
+	for (size_t i = 0; i < scene.numLights; i++) {
+		if (scene.lights[i].type == LightType::DirectioanalLight || scene.lights[i].type == LightType::Ambient)
+			packLight(scene.lights[i], m_lights[numLights++]);
 	}
+	m_numGlobalLights = numLights - scene.numMainLights;
 
-	for (size_t j = 0; j < scene.numMainLights; j++) {
-		Light_t& light = scene.mainLights[j];
-		m_lights[j + scene.numLights].position = glm::vec4(light.position, light.range);
-		m_lights[j + scene.numLights].direction = glm::normalize(-light.direction);
-		m_lights[j + scene.numLights].color = glm::vec4(light.color, light.intensity);
-		m_lights[j + scene.numLights].angles = light.type == LightType::Ambient ? light.colorEx : glm::vec3(light.innerCone, light.outterCone, 0.f);
-		m_lights[j + scene.numLights].type = int(light.type);
+	auto& camera = *scene.mainCamera;
+	bool isBoundsChanged = m_lightClusters.beginFrame(camera.viewMatrix, camera.projMatrix, camera.near, camera.far, uint32_t(numLights));
+	for (size_t i = 0; i < scene.numLights; i++) {
+		if (m_lightClusters.addLight(scene.lights[i]))
+			packLight(scene.lights[i], m_lights[numLights++]);
 	}
 
 	m_lightsSSBO->bind(Buffer::Target::ShaderStorageBuffer);
-	m_lightsSSBO->loadSubData(m_lights.data(), 0, sizeof(Light) * (scene.numLights + scene.numMainLights));
+	m_lightsSSBO->loadSubData(m_lights.data(), 0, sizeof(Light) * numLights);
 	m_lightsSSBO->unbind();
+
+	if (isBoundsChanged) {
+		auto& bounds = m_lightClusters.getClusterBounds();
+		m_clusterBoundsSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+		m_clusterBoundsSSBO->loadSubData(bounds.data(), 0, sizeof(glm::vec4) * bounds.size());
+		m_clusterBoundsSSBO->unbind();
+	}
+
+	PROFILE_SCOPE("ForwardPlus::lightClustering");
+	if (!m_isGPULightClustering || !BuildLightClustersGPU())
+		BuildLightClustersCPU();
+
+	Profiler::getInstance()->addCounter("ForwardPlus::clusteredLights", double(m_lightClusters.numLights()));
+}
+
+
+bool ForwardPlusRenderer::BuildLightClustersGPU() {
+	auto shader = ShaderProgramManager::getInstance()->getProgram("LightClustering");
+	if (shader.expired())
+		shader = ShaderProgramManager::getInstance()->addProgram("LightClustering");
+	if (shader.expired())
+		return false;
+
+	auto clusterShader = shader.lock();
+	m_renderer->pushShaderProgram(clusterShader.get());
+
+	auto& spheres = m_lightClusters.getLightSpheres();
+	auto& extents = m_lightClusters.getLightExtents();
+	if (!spheres.empty()) {
+		m_lightSpheresSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+		m_lightSpheresSSBO->loadSubData(spheres.data(), 0, sizeof(glm::vec4) * spheres.size());
+		m_lightExtentsSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+		m_lightExtentsSSBO->loadSubData(extents.data(), 0, sizeof(glm::ivec4) * extents.size());
+	}
+
+	m_clusterBoundsSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 0);
+	m_lightSpheresSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 1);
+	m_lightGridSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 2);
+	m_lightIndicesSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 3);
+	m_lightExtentsSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 4);
+	clusterShader->bindShaderStorageBlock("ClusterBounds", 0);
+	clusterShader->bindShaderStorageBlock("LightSpheres", 1);
+	clusterShader->bindShaderStorageBlock("LightGrid", 2);
+	clusterShader->bindShaderStorageBlock("LightIndices", 3);
+	clusterShader->bindShaderStorageBlock("LightExtents", 4);
+
+	unsigned numClusters = unsigned(m_lightClusters.numClusters());
+	clusterShader->setUniform3("u_ClusterDims", int(CLUSTER_GRID_X), int(CLUSTER_GRID_Y), int(CLUSTER_GRID_Z));
+	clusterShader->setUniform1("u_NumClusters", numClusters);
+	clusterShader->setUniform1("u_NumLocalLights", unsigned(spheres.size()));
+	clusterShader->setUniform1("u_LightIndexBase", unsigned(m_lightClusters.getLightIndexBase()));
+	clusterShader->setUniform1("u_MaxLightsPerCluster", unsigned(MAX_LIGHTS_PER_CLUSTER));
+
+	// one invocation per cluster, 64 per group, graph puts barrier before passes reading light lists
+	m_renderer->dispatchCompute((numClusters + 63) / 64);
+
+	clusterShader->unbindShaderStorageBlock("ClusterBounds");
+	clusterShader->unbindShaderStorageBlock("LightSpheres");
+	clusterShader->unbindShaderStorageBlock("LightGrid");
+	clusterShader->unbindShaderStorageBlock("LightIndices");
+	clusterShader->unbindShaderStorageBlock("LightExtents");
+	m_lightExtentsSSBO->unbind();
+	m_renderer->popShadrProgram();
+
+	return true;
+}
+
+
+void ForwardPlusRenderer::BuildLightClustersCPU() {
+	m_lightClusters.build();
+
+	auto& ranges = m_lightClusters.getClusterLightRanges();
+	m_lightGridSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+	m_lightGridSSBO->loadSubData(ranges.data(), 0, sizeof(glm::uvec2) * ranges.size());
+
+	auto& indices = m_lightClusters.getClusterLightIndices();
+	if (!indices.empty()) {
+		m_lightIndicesSSBO->bind(Buffer::Target::ShaderStorageBuffer);
+		m_lightIndicesSSBO->loadSubData(indices.data(), 0, sizeof(uint32_t) * indices.size());
+	}
+	m_lightIndicesSSBO->unbind();
+}
+
+
+void ForwardPlusRenderer::BindLights(const Scene_t& scene, bool withMainLights) {
+	m_lightsSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 1);
+	m_lightGridSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 2);
+	m_lightIndicesSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 3);
+	m_passShader->bindShaderStorageBlock("Lights", 1);
+	m_passShader->bindShaderStorageBlock("LightGrid", 2);
+	m_passShader->bindShaderStorageBlock("LightIndices", 3);
+
+	int globalEnd = int(scene.numMainLights + m_numGlobalLights);
+	m_passShader->setUniform2("u_GlobalLights", withMainLights ? 0 : int(scene.numMainLights), globalEnd);
+	m_passShader->setUniformMat4v("u_ViewMat", &scene.mainCamera->viewMatrix[0][0]);
+	m_passShader->setUniform3("u_ClusterDims", int(CLUSTER_GRID_X), int(CLUSTER_GRID_Y), int(CLUSTER_GRID_Z));
+
+	glm::vec2 tileSize = m_renderer->getRenderSize() / glm::vec2(CLUSTER_GRID_X, CLUSTER_GRID_Y);
+	glm::vec2 depthParams = m_lightClusters.getDepthSliceParams();
+	m_passShader->setUniform2v("u_ClusterTileSize", &tileSize[0]);
+	m_passShader->setUniform2v("u_ClusterDepthParams", &depthParams[0]);
+}
+
+
+void ForwardPlusRenderer::UnbindLights() {
+	m_passShader->unbindShaderStorageBlock("Lights");
+	m_passShader->unbindShaderStorageBlock("LightGrid");
+	m_passShader->unbindShaderStorageBlock("LightIndices");
+	m_lightIndicesSSBO->unbind();
 }
 
 
@@ -251,114 +484,98 @@ void ForwardPlusRenderer::genShadowMap(const Scene_t& scene, const Light_t& ligh
 
 
 
-void ForwardPlusRenderer::RenderMainLights(const Scene_t& scene) {
-	if (scene.numMainLights <= 0)
-		return;
-
-	if ((scene.numOpaqueItems + scene.numCutOutItems) <= 0)
-		return;
-
+void ForwardPlusRenderer::RenderMainLight(const Scene_t& scene, const Light_t& light) {
 	m_renderer->pushGPUPipelineState(&m_lightPassPipelineState);
 
-	for (size_t lightIdx = 0; lightIdx < scene.numMainLights; lightIdx++) {
-		auto& light = scene.mainLights[lightIdx];
-		genShadowMap(scene, light);
-
-		m_pass = RenderPass::LightPass;
-		switch (light.type) {
-		case LightType::DirectioanalLight: {
-			auto directionalLightShader = ShaderProgramManager::getInstance()->getProgram("DirectionalLight");
-			if (directionalLightShader.expired())
-				directionalLightShader = ShaderProgramManager::getInstance()->addProgram("DirectionalLight.shader");
-			ASSERT(!directionalLightShader.expired());
-
-			m_passShader = directionalLightShader.lock();
-			m_renderer->pushShaderProgram(m_passShader.get());
-
-			// set directional light
-			glm::vec4 lightColor(light.color, light.intensity);
-			glm::vec3 lightDir(-light.direction);
-			m_passShader->setUniform4v("u_lightColor", &lightColor[0]);
-			m_passShader->setUniform3v("u_toLight", &lightDir[0]);
-
-		}break;
-
-		case LightType::PointLight: {
-			auto pointLightShader = ShaderProgramManager::getInstance()->getProgram("PointLight");
-			if (pointLightShader.expired())
-				pointLightShader = ShaderProgramManager::getInstance()->addProgram("PointLight.shader");
-			ASSERT(!pointLightShader.expired());
-
-			m_passShader = pointLightShader.lock();
-			m_renderer->pushShaderProgram(m_passShader.get());
-
-			// set point light
-			glm::vec4 lightPos(light.position, light.range);
-			glm::vec4 lightColor(light.color, light.intensity);
-			m_passShader->setUniform4v("u_lightPos", &lightPos[0]);
-			m_passShader->setUniform4v("u_lightColor", &lightColor[0]);
-
-		}break;
-
-		case LightType::SpotLight: {
-			auto spotLightShader = ShaderProgramManager::getInstance()->getProgram("SpotLight");
-			if (spotLightShader.expired())
-				spotLightShader = ShaderProgramManager::getInstance()->addProgram("SpotLight.shader");
-			ASSERT(!spotLightShader.expired());
-
-			m_passShader = spotLightShader.lock();
-			m_renderer->pushShaderProgram(m_passShader.get());
-
-			// set spot light			
-			glm::vec4 lightPos(light.position, light.range);
-			glm::vec4 lightColor(light.color, light.intensity);
-			glm::vec3 lightDir(-light.direction);
-			glm::vec2 lightAngles(light.innerCone, light.outterCone);
-			m_passShader->setUniform4v("u_lightPos", &lightPos[0]);
-			m_passShader->setUniform4v("u_lightColor", &lightColor[0]);
-			m_passShader->setUniform3v("u_toLight", &lightDir[0]);
-			m_passShader->setUniform2v("u_angles", &lightAngles[0]);
-
-		}break;
-
-		default:
+	m_pass = RenderPass::LightPass;
+	switch (light.type) {
+	case LightType::DirectioanalLight: {
+		auto directionalLightShader = ShaderProgramManager::getInstance()->getProgram("DirectionalLight");
+		if (directionalLightShader.expired())
+			directionalLightShader = ShaderProgramManager::getInstance()->addProgram("DirectionalLight.shader");
+		ASSERT(!directionalLightShader.expired());
+
+		m_passShader = directionalLightShader.lock();
+		m_renderer->pushShaderProgram(m_passShader.get());
+
+		// set directional light
+		glm::vec4 lightColor(light.color, light.intensity);
+		glm::vec3 lightDir(-light.direction);
+		m_passShader->setUniform4v("u_lightColor", &lightColor[0]);
+		m_passShader->setUniform3v("u_toLight", &lightDir[0]);
+
+	}break;
+
+	case LightType::PointLight: {
+		auto pointLightShader = ShaderProgramManager::getInstance()->getProgram("PointLight");
+		if (pointLightShader.expired())
+			pointLightShader = ShaderProgramManager::getInstance()->addProgram("PointLight.shader");
+		ASSERT(!pointLightShader.expired());
+
+		m_passShader = pointLightShader.lock();
+		m_renderer->pushShaderProgram(m_passShader.get());
+
+		// set point light
+		glm::vec4 lightPos(light.position, light.range);
+		glm::vec4 lightColor(light.color, light.intensity);
+		m_passShader->setUniform4v("u_lightPos", &lightPos[0]);
+		m_passShader->setUniform4v("u_lightColor", &lightColor[0]);
+
+	}break;
+
+	case LightType::SpotLight: {
+		auto spotLightShader = ShaderProgramManager::getInstance()->getProgram("SpotLight");
+		if (spotLightShader.expired())
+			spotLightShader = ShaderProgramManager::getInstance()->addProgram("SpotLight.shader");
+		ASSERT(!spotLightShader.expired());
+
+		m_passShader = spotLightShader.lock();
+		m_renderer->pushShaderProgram(m_passShader.get());
+
+		// set spot light			
+		glm::vec4 lightPos(light.position, light.range);
+		glm::vec4 lightColor(light.color, light.intensity);
+		glm::vec3 lightDir(-light.direction);
+		glm::vec2 lightAngles(light.innerCone, light.outterCone);
+		m_passShader->setUniform4v("u_lightPos", &lightPos[0]);
+		m_passShader->setUniform4v("u_lightColor", &lightColor[0]);
+		m_passShader->setUniform3v("u_toLight", &lightDir[0]);
+		m_passShader->setUniform2v("u_angles", &lightAngles[0]);
+
+	}break;
+
+	default:
 #ifdef _DEBUG
-			ASSERT(false);
+		ASSERT(false);
 #endif // _DEBUG
-			break;
-		}
+		break;
+	}
 
-		// set view project matrix
-		if (m_passShader->hasUniform("u_VPMat")) {
-			glm::mat4 vp = scene.mainCamera->projMatrix * scene.mainCamera->viewMatrix;
-			m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
-		}
+	// set view project matrix
+	if (m_passShader->hasUniform("u_VPMat")) {
+		glm::mat4 vp = scene.mainCamera->projMatrix * scene.mainCamera->viewMatrix;
+		m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
+	}
 
-		// set camera position
-		if (m_passShader->hasUniform("u_cameraPosW")) {
-			m_passShader->setUniform3v("u_cameraPosW", &scene.mainCamera->position[0]);
-		}
+	// set camera position
+	if (m_passShader->hasUniform("u_cameraPosW")) {
+		m_passShader->setUniform3v("u_cameraPosW", &scene.mainCamera->position[0]);
+	}
 
-		m_shadowMappings[light.type]->beginRenderLight(light, m_passShader.get());
+	m_shadowMappings[light.type]->beginRenderLight(light, m_passShader.get());
 
-		for (size_t i = 0; i < scene.numOpaqueItems; i++) {
-			render(scene.opaqueItems[i]);
-		}
+	renderBatch(scene.opaqueItems, scene.numOpaqueItems);
 
-		for (size_t i = 0; i < scene.numCutOutItems; i++) {
-			render(scene.cutOutItems[i]);
-		}
+	renderBatch(scene.cutOutItems, scene.numCutOutItems);
 
-		m_shadowMappings[light.type]->endRenderLight(light, m_passShader.get());
+	m_shadowMappings[light.type]->endRenderLight(light, m_passShader.get());
 
-		m_passShader->unbindSubroutineUniforms();
-		m_renderer->popShadrProgram();
-		m_passShader = nullptr;
-		m_pass = RenderPass::None;
-	}
+	m_passShader->unbindSubroutineUniforms();
+	m_renderer->popShadrProgram();
+	m_passShader = nullptr;
+	m_pass = RenderPass::None;
 
 	m_renderer->popGPUPipelineState();
-
 }
 
 
@@ -385,8 +602,7 @@ void ForwardPlusRenderer::render(const MeshRenderItem_t& task) {
 
 
 void ForwardPlusRenderer::onWindowResize(float w, float h) {
-	ASSERT(setupOutputTarget());
-	cleanOIT();
+	cleanOIT(); // graph textures follow render size on their own
 }
 
 void ForwardPlusRenderer::onShadowMapResolutionChange(float w, float h) {
@@ -396,26 +612,6 @@ void ForwardPlusRenderer::onShadowMapResolutionChange(float w, float h) {
 }
 
 
-bool ForwardPlusRenderer::setupOutputTarget() {
-	m_outputTarget.reset(new RenderTarget(m_renderer->getRenderSize()));
-
-	m_outputTarget->bind();
-
-	if (!m_outputTarget->attachTexture2D(Texture::Format::RGBA16F, RenderTarget::Slot::Color))
-		return false;
-
-	if (!m_outputTarget->attachTexture2D(Texture::Format::Depth24_Stencil8, RenderTarget::Slot::Depth_Stencil))
-		return false;
-
-	if (!m_outputTarget->isValid())
-		return false;
-
-	m_outputTarget->unBind();
-
-	return true;
-}
-
-
 void ForwardPlusRenderer::setupPipelineStates() {
 	m_depthPassPipelineState.depthMode = DepthMode::Enable;
 	m_depthPassPipelineState.depthFunc = DepthFunc::Less;
@@ -472,22 +668,12 @@ bool ForwardPlusRenderer::setupOIT() {
 	m_fragListSSBO->unbind();
 	if (!ok) return false;
 
-	m_fragListHeader.reset(new Texture());
-	m_fragListHeader->allocStorage2D(Texture::Format::R32UI, renderSz.x, renderSz.y);
-
 	std::vector<unsigned int> clearData(renderSz.x * renderSz.y, 0xffffffff);
 	m_fragListHeaderResetBuffer.reset(new Buffer());
 	m_fragListHeaderResetBuffer->bind(Buffer::Target::PixelUnpackBuffer);
 	ok = m_fragListHeaderResetBuffer->loadData(clearData.data(), sizeof(unsigned int) * clearData.size(), Buffer::Usage::StaticCopy);
 	m_fragListHeaderResetBuffer->unbind();
-	if (!ok) return false;
-
-	m_oitBlendTarget.reset(new RenderTarget(m_renderer->getRenderSize()));
-	m_oitBlendTarget->bind();
-	ok = m_oitBlendTarget->attachTexture2D(Texture::Format::RGBA16F, RenderTarget::Slot::Color);
-	m_isOITSetup = ok && m_oitBlendTarget->isValid();
-	m_oitBlendTarget->unBind();
-
+	m_isOITSetup = ok;
 
 	return m_isOITSetup;
 }
@@ -497,8 +683,6 @@ void ForwardPlusRenderer::cleanOIT() {
 	m_fragIdxACBO.release();
 	m_fragListSSBO.release();
 	m_fragListHeaderResetBuffer.release();
-	m_fragListHeader.release();
-	m_oitBlendTarget.release();
 	m_isOITSetup = false;
 }
 
@@ -519,25 +703,23 @@ void ForwardPlusRenderer::genOITFragList(const Scene_t& scene) {
 	m_fragIdxACBO->loadSubData(&resetIdx, 0, sizeof(unsigned int));
 
 	auto renderSz = m_renderer->getRenderSize();
+	Texture* fragListHeader = m_renderGraph.getTexture(m_fragListHeader);
 	//m_fragListHeader->subDataImage2DFromBuffer(m_fragListHeaderResetBuffer.get(), Texture::Format::R, Texture::FormatDataType::Int, 0, 0, renderSz.x, renderSz.y);
 	m_fragListHeaderResetBuffer->bind(Buffer::Target::PixelUnpackBuffer);
-	m_fragListHeader->bindToTextureUnit();
+	fragListHeader->bindToTextureUnit();
 	//GLCALL(glTextureSubImage2D(m_fragListHeader->getHandler(), 0, 0, 0, renderSz.x, renderSz.y, GL_RED_INTEGER, GL_UNSIGNED_INT, 0));
 	GLCALL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, renderSz.x, renderSz.y, GL_RED_INTEGER, GL_UNSIGNED_INT, 0));
-	m_fragListHeader->unbindFromTextureUnit();
+	fragListHeader->unbindFromTextureUnit();
 	m_fragListHeaderResetBuffer->unbind();
 
-	m_fragListHeader->bindToImageUnit(0, Texture::Format::R32UI, Texture::Access::ReadWrite);
+	fragListHeader->bindToImageUnit(0, Texture::Format::R32UI, Texture::Access::ReadWrite);
 	m_passShader->setUniform1("u_FragHeader", 0);
 
 	unsigned int maxNumFrags = renderSz.x * renderSz.y * MAX_FRAG_PER_PIXEL;
 	m_passShader->setUniform1("u_MaxNumFrag", maxNumFrags);
 
 	//Lights
-	int totalLights = scene.numLights + scene.numMainLights;
-	m_lightsSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 1);
-	m_passShader->bindShaderStorageBlock("Lights", 1);
-	m_passShader->setUniform1("u_NumLights", totalLights);
+	BindLights(scene, true);
 
 	// set view project matrix
 	if (m_passShader->hasUniform("u_VPMat")) {
@@ -551,16 +733,13 @@ void ForwardPlusRenderer::genOITFragList(const Scene_t& scene) {
 	}
 
 	// draw per pixel fragments link list
-	for (size_t i = 0; i < scene.numTransparentItems; i++) {
-		render(scene.transparentItems[i]);
-	}
+	renderBatch(scene.transparentItems, scene.numTransparentItems);
 
-	m_lightsSSBO->unbind();
+	UnbindLights();
 	m_fragListSSBO->unbind();
 	m_fragIdxACBO->unbind();
-	m_fragListHeader->unbindFromImageUnit();
+	fragListHeader->unbindFromImageUnit();
 	m_passShader->unbindShaderStorageBlock("FragmentBuffer");
-	m_passShader->unbindShaderStorageBlock("Lights");
 	m_passShader->unbindSubroutineUniforms();
 	m_renderer->popGPUPipelineState();
 	m_renderer->popShadrProgram();
@@ -571,29 +750,28 @@ void ForwardPlusRenderer::genOITFragList(const Scene_t& scene) {
 
 
 void ForwardPlusRenderer::blendOITFragList() {
+	// graph binds & clears blend target
 	m_passShader = ShaderProgramManager::getInstance()->addProgram("OITFragBlending").lock();
 	m_renderer->pushShaderProgram(m_passShader.get());
 	m_renderer->pushGPUPipelineState(&m_oitBlendPipelineState);
-	m_renderer->pushRenderTarget(m_oitBlendTarget.get());
 
 	m_fragListSSBO->bindBase(Buffer::Target::ShaderStorageBuffer, 0);
 	m_passShader->bindShaderStorageBlock("FragmentBuffer", 0);
 
-	m_fragListHeader->bindToImageUnit(0, Texture::Format::R32UI, Texture::Access::Read);
+	Texture* fragListHeader = m_renderGraph.getTexture(m_fragListHeader);
+	fragListHeader->bindToImageUnit(0, Texture::Format::R32UI, Texture::Access::Read);
 	m_passShader->setUniform1("u_FragHeader", 0);
 
-	auto bgTex = m_outputTarget->getAttachedTexture(RenderTarget::Slot::Color);
+	Texture* bgTex = m_renderGraph.getTexture(m_sceneColor);
 	bgTex->bindToImageUnit(1, Texture::Format::RGBA16F, Texture::Access::Read);
 	m_passShader->setUniform1("u_BackroundImage", 1);
 
-	m_renderer->clearScreen(ClearFlags::Color);
 	m_renderer->drawFullScreenQuad();
 
 	bgTex->unbindFromImageUnit();
-	m_fragListHeader->unbindFromImageUnit();
+	fragListHeader->unbindFromImageUnit();
 	m_fragListSSBO->unbind();
 	m_passShader->unbindShaderStorageBlock("FragmentBuffer");
-	m_renderer->popRenderTarget();
 	m_renderer->popGPUPipelineState();
 	m_renderer->popShadrProgram();
 }
\ No newline at end of file
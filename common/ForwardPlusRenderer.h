@@ -3,6 +3,8 @@
 #include"RenderTaskExecutor.h"
 #include"RenderTarget.h"
 #include"Renderer.h"
+#include"LightClusterBuilder.h"
+#include"RenderGraph.h"
 
 class Buffer;
 class Texture;
@@ -53,7 +55,7 @@ public:
 		return s_identifier;
 	}
 
-	inline Texture* getRenderedFrame() override;
+	Texture* getRenderedFrame() override;
 
 	bool intialize() override;
 	void cleanUp() override;
@@ -62,6 +64,7 @@ public:
 	void endFrame() override;
 
 	void render(const MeshRenderItem_t& task) override;
+	void render(const Scene_t& scene) override;
 
 	void drawDepthPass(const Scene_t& scene) override;
 	void drawGeometryPass(const Scene_t& scene) override {};
@@ -71,13 +74,31 @@ public:
 	void onWindowResize(float w, float h) override;
 	void onShadowMapResolutionChange(float w, float h) override;
 
+	// assign lights to clusters with compute shader, cpu builder is used when disabled or shader unavailable
+	inline void setGPULightClusteringEnabled(bool enable) {
+		m_isGPULightClustering = enable;
+	}
+
+	inline bool isGPULightClusteringEnabled() const {
+		return m_isGPULightClustering;
+	}
+
+	// passes, schedule & timings of last frame
+	inline const RenderGraph& getRenderGraph() const {
+		return m_renderGraph;
+	}
+
 protected:
 	void setupPipelineStates();
-	bool setupOutputTarget();
+	void setupRenderGraph(const Scene_t& scene);
 
 	void DrawOpaques(const Scene_t& scene, bool useCutout);
-	void RenderMainLights(const Scene_t& scene);
+	void RenderMainLight(const Scene_t& scene, const Light_t& light);
 	void PrepareLights(const Scene_t& scene);
+	bool BuildLightClustersGPU();
+	void BuildLightClustersCPU();
+	void BindLights(const Scene_t& scene, bool withMainLights);
+	void UnbindLights();
 	void genShadowMap(const Scene_t& scene, const Light_t& light);
 
 
@@ -95,23 +116,36 @@ protected:
 	GPUPipelineState m_oitDrawPipelineState;
 	GPUPipelineState m_oitBlendPipelineState;
 
-	// default frame rener target (input frame for post processing)
-	std::unique_ptr<RenderTarget> m_outputTarget;
+	// scene color & depth, oit header & blended frame are graph transients
+	RenderGraph m_renderGraph;
+	RenderGraphHandle m_sceneColor;
+	RenderGraphHandle m_sceneDepth;
+	RenderGraphHandle m_fragListHeader;
+	RenderGraphHandle m_frameOutput;
+	Texture* m_renderedFrame; // input frame for post processing
 
 	std::unordered_map<RenderPass, std::unique_ptr<RenderTaskExecutor>> m_taskExecutors;
 
 	// shadow mapping
 	std::unordered_map<LightType, std::unique_ptr<IShadowMapping>> m_shadowMappings;
 
-	// lights SSBO
+	// lights SSBO, ordered as main lights, global lights (directional, ambient), local lights (point, spot)
 	std::unique_ptr<Buffer> m_lightsSSBO;
 	std::array<Light, MAX_NUM_TOTAL_LIGHTS> m_lights;
+	size_t m_numGlobalLights;
+
+	// clustered light lists
+	LightClusterBuilder m_lightClusters;
+	std::unique_ptr<Buffer> m_clusterBoundsSSBO;
+	std::unique_ptr<Buffer> m_lightSpheresSSBO;
+	std::unique_ptr<Buffer> m_lightExtentsSSBO;
+	std::unique_ptr<Buffer> m_lightGridSSBO;
+	std::unique_ptr<Buffer> m_lightIndicesSSBO;
+	bool m_isGPULightClustering;
 
 	// order indepamdent transparency
 	std::unique_ptr<Buffer> m_fragIdxACBO;
 	std::unique_ptr<Buffer> m_fragListSSBO;
 	std::unique_ptr<Buffer> m_fragListHeaderResetBuffer;
-	std::unique_ptr<Texture> m_fragListHeader;
-	std::unique_ptr<RenderTarget> m_oitBlendTarget;
 	bool m_isOITSetup;
 };
\ No newline at end of file
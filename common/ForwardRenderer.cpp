@@ -160,9 +160,7 @@ void ForwardRenderer::drawDepthPass(const Scene_t& scene) {
 		m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
 	}
 
-	for (size_t i = 0; i < scene.numOpaqueItems; i++) {
-		render(scene.opaqueItems[i]);
-	}
+	renderBatch(scene.opaqueItems, scene.numOpaqueItems);
 
 	m_renderer->popGPUPipelineState();
 	m_renderer->popShadrProgram();
@@ -207,9 +205,7 @@ void ForwardRenderer::drawUnlitScene(const Scene_t& scene) {
 		m_passShader->setUniformMat4v("u_VPMat", &vp[0][0]);
 	}
 
-	for (size_t i = 0; i < scene.numOpaqueItems; i++) {
-		render(scene.opaqueItems[i]);
-	}  
+	renderBatch(scene.opaqueItems, scene.numOpaqueItems);  
 
 	m_renderer->popGPUPipelineState();
 	m_renderer->popShadrProgram();
@@ -254,10 +250,7 @@ void ForwardRenderer::drawLightScene(const Scene_t& scene, bool useCutOut) {
 				static DirectionalLightBlock dlb;
 				dlb.color = glm::vec4(glm::vec3(light.color), light.intensity);
 				dlb.inverseDiretion = -light.direction;
-				m_directionalLightUBO->bind(Buffer::Target::UniformBuffer);
-				m_directionalLightUBO->loadSubData(&dlb, 0, sizeof(dlb));
-
-				m_directionalLightUBO->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::LightBlock));
+				bindLightBlock(m_directionalLightUBO.get(), &dlb, sizeof(dlb));
 				m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
 
 				lightUBO = m_directionalLightUBO.get();
@@ -279,9 +272,7 @@ void ForwardRenderer::drawLightScene(const Scene_t& scene, bool useCutOut) {
 				plb.position = glm::vec4(light.position, light.range);
 				plb.color = glm::vec4(light.color, light.intensity);
 
-				m_pointLightUBO->bind(Buffer::Target::UniformBuffer);
-				m_pointLightUBO->loadSubData(&plb, 0, sizeof(plb));
-				m_pointLightUBO->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::LightBlock));
+				bindLightBlock(m_pointLightUBO.get(), &plb, sizeof(plb));
 				m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
 
 				lightUBO = m_pointLightUBO.get();
@@ -306,9 +297,7 @@ void ForwardRenderer::drawLightScene(const Scene_t& scene, bool useCutOut) {
 				slb.inverseDirection = -light.direction;
 				slb.angles = glm::vec2(light.innerCone, light.outterCone);
 
-				m_spotLightUBO->bind(Buffer::Target::UniformBuffer);
-				m_spotLightUBO->loadSubData(&slb, 0, sizeof(slb));
-				m_spotLightUBO->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::LightBlock));
+				bindLightBlock(m_spotLightUBO.get(), &slb, sizeof(slb));
 				m_passShader->bindUniformBlock("LightBlock", ShaderProgram::UniformBlockBindingPoint::LightBlock);
 
 				lightUBO = m_spotLightUBO.get();
@@ -337,15 +326,11 @@ void ForwardRenderer::drawLightScene(const Scene_t& scene, bool useCutOut) {
 		m_shadowMappings[light.type]->beginRenderLight(light, m_passShader.get());
 
 		if (!useCutOut) { // render opaques
-			for (size_t i = 0; i < scene.numOpaqueItems; i++) {
-				render(scene.opaqueItems[i]);
-			}
+			renderBatch(scene.opaqueItems, scene.numOpaqueItems);
 		}  else { // render cutouts
 			if (lightIdx == 0) m_renderer->pushGPUPipelineState(&m_cutOutPipelineState);
 
-			for (size_t i = 0; i < scene.numCutOutItems; i++) {
-				render(scene.cutOutItems[i]);
-			}
+			renderBatch(scene.cutOutItems, scene.numCutOutItems);
 
 			if (lightIdx == 0) m_renderer->popGPUPipelineState();
 		}
@@ -389,14 +374,10 @@ void ForwardRenderer::drawAmbientScene(const Scene_t& scene) {
 	m_passShader->setUniform3v("u_AmbientSky", (float*)&scene.ambinetSky[0]);
 	m_passShader->setUniform3v("u_AmbientGround", (float*)&scene.ambinetGround[0]);
 	
-	for (size_t i = 0; i < scene.numOpaqueItems; i++) {
-		render(scene.opaqueItems[i]);
-	}
+	renderBatch(scene.opaqueItems, scene.numOpaqueItems);
 
 	if (scene.numLights <= 0) m_renderer->pushGPUPipelineState(&m_cutOutPipelineState);
-	for (size_t i = 0; i < scene.numCutOutItems; i++) {
-		render(scene.cutOutItems[i]);
-	}
+	renderBatch(scene.cutOutItems, scene.numCutOutItems);
 	if (scene.numLights <= 0) m_renderer->pushGPUPipelineState(&m_cutOutPipelineState);
 
 	m_renderer->popGPUPipelineState();
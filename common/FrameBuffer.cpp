@@ -1,5 +1,6 @@
 #include"FrameBuffer.h"
 #include"Util.h"
+#include"GLStateCache.h"
 
 
 FrameBuffer::FrameBuffer() :m_handler(0)
@@ -21,19 +22,19 @@ size_t FrameBuffer::maximumColorAttachment() {
 
 
 void FrameBuffer::bindDefault(Target target) {
-	GLCALL(glBindFramebuffer(int(target), 0));
+	GLStateCache::getInstance()->bindFramebuffer(GLenum(target), 0);
 }
 
 
 void FrameBuffer::bind(Target target) const {
-	GLCALL(glBindFramebuffer(int(target), m_handler));
+	GLStateCache::getInstance()->bindFramebuffer(GLenum(target), m_handler);
 	m_bindTarget = target;
 }
 
 
 void FrameBuffer::unbind() const {
 	if (m_bindTarget != Target::Unknown) {
-		glBindFramebuffer(int(m_bindTarget), 0);
+		GLStateCache::getInstance()->bindFramebuffer(GLenum(m_bindTarget), 0);
 		m_bindTarget = Target::Unknown;
 	}
 }
@@ -120,6 +121,7 @@ void FrameBuffer::release() {
 			unbind();
 
 		glDeleteFramebuffers(1, &m_handler);
+		GLStateCache::getInstance()->onDeleteFramebuffer(m_handler);
 		m_handler = 0;
 		m_bindTarget = Target::Unknown;
 	}
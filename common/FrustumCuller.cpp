@@ -0,0 +1,147 @@
+#include"FrustumCuller.h"
+#include"Geometry3D.h"
+#include"JobSystem.h"
+#include<atomic>
+#include<algorithm>
+#include<cmath>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include<emmintrin.h>
+#define FRUSTUM_CULLER_SSE
+#endif
+
+
+// extent given to invalid boxes so they pass every plane
+#define UNBOUNDED_EXTENT 1e30f
+
+// batches of 4 boxes per job, smaller sets are culled inline
+#define CULL_BATCHES_PER_JOB 256
+
+
+FrustumCuller::FrustumCuller() :m_centerX()
+, m_centerY()
+, m_centerZ()
+, m_extentX()
+, m_extentY()
+, m_extentZ()
+, m_numBoxes(0) {
+
+}
+
+
+void FrustumCuller::clear() {
+	m_centerX.clear();
+	m_centerY.clear();
+	m_centerZ.clear();
+	m_extentX.clear();
+	m_extentY.clear();
+	m_extentZ.clear();
+	m_numBoxes = 0;
+}
+
+
+void FrustumCuller::add(const AABB_t& aabb) {
+	// keep arrays padded to multiple of 4, so batches never read past the end
+	if (m_numBoxes % 4 == 0) {
+		size_t padded = m_numBoxes + 4;
+		m_centerX.resize(padded, 0.f);
+		m_centerY.resize(padded, 0.f);
+		m_centerZ.resize(padded, 0.f);
+		m_extentX.resize(padded, 0.f);
+		m_extentY.resize(padded, 0.f);
+		m_extentZ.resize(padded, 0.f);
+	}
+
+	glm::vec3 center(0.f);
+	glm::vec3 extent(UNBOUNDED_EXTENT);
+	if (aabb.isValid()) {
+		center = (aabb.minimum + aabb.maximum) * 0.5f;
+		extent = (aabb.maximum - aabb.minimum) * 0.5f;
+	}
+
+	m_centerX[m_numBoxes] = center.x;
+	m_centerY[m_numBoxes] = center.y;
+	m_centerZ[m_numBoxes] = center.z;
+	m_extentX[m_numBoxes] = extent.x;
+	m_extentY[m_numBoxes] = extent.y;
+	m_extentZ[m_numBoxes] = extent.z;
+	m_numBoxes++;
+}
+
+
+size_t FrustumCuller::cull(const glm::mat4& viewProj, uint8_t* masks, uint8_t bit) const {
+	return cull(Frustum::FromMatrix(viewProj), masks, bit);
+}
+
+
+size_t FrustumCuller::cull(const Frustum& frustum, uint8_t* masks, uint8_t bit) const {
+	// job ranges are whole batches, no two jobs share a batch
+	std::atomic<size_t> numVisible(0);
+	size_t numBatches = (m_numBoxes + 3) / 4;
+	JobSystem::getInstance()->parallelFor(numBatches, CULL_BATCHES_PER_JOB, [&](size_t begin, size_t end) {
+		numVisible += cullRange(frustum, begin * 4, std::min(end * 4, m_numBoxes), masks, bit);
+	});
+
+	return numVisible;
+}
+
+
+size_t FrustumCuller::cullRange(const Frustum& frustum, size_t begin, size_t end, uint8_t* masks, uint8_t bit) const {
+	// a box is outside when dot(n, c) + dot(|n|, e) < d for any plane
+	size_t numVisible = 0;
+
+#ifdef FRUSTUM_CULLER_SSE
+	__m128 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], d[6];
+	for (size_t p = 0; p < 6; p++) {
+		const Plane& plane = frustum.planes[p];
+		nx[p] = _mm_set1_ps(plane.normal.x);
+		ny[p] = _mm_set1_ps(plane.normal.y);
+		nz[p] = _mm_set1_ps(plane.normal.z);
+		ax[p] = _mm_set1_ps(fabsf(plane.normal.x));
+		ay[p] = _mm_set1_ps(fabsf(plane.normal.y));
+		az[p] = _mm_set1_ps(fabsf(plane.normal.z));
+		d[p] = _mm_set1_ps(plane.distance);
+	}
+
+	for (size_t i = begin; i < end; i += 4) {
+		__m128 cx = _mm_loadu_ps(&m_centerX[i]);
+		__m128 cy = _mm_loadu_ps(&m_centerY[i]);
+		__m128 cz = _mm_loadu_ps(&m_centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&m_extentX[i]);
+		__m128 ey = _mm_loadu_ps(&m_extentY[i]);
+		__m128 ez = _mm_loadu_ps(&m_extentZ[i]);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (size_t p = 0; p < 6; p++) {
+			__m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy)), _mm_mul_ps(nz[p], cz));
+			__m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(dist, radius), d[p]));
+		}
+
+		int result = _mm_movemask_ps(inside);
+		size_t count = end - i < 4 ? end - i : 4;
+		for (size_t j = 0; j < count; j++) {
+			if (result & (1 << j)) {
+				masks[i + j] |= bit;
+				numVisible++;
+			}
+		}
+	}
+#else
+	for (size_t i = begin; i < end; i++) {
+		bool inside = true;
+		for (size_t p = 0; p < 6 && inside; p++) {
+			const Plane& plane = frustum.planes[p];
+			float dist = plane.normal.x * m_centerX[i] + plane.normal.y * m_centerY[i] + plane.normal.z * m_centerZ[i];
+			float radius = fabsf(plane.normal.x) * m_extentX[i] + fabsf(plane.normal.y) * m_extentY[i] + fabsf(plane.normal.z) * m_extentZ[i];
+			inside = dist + radius >= plane.distance;
+		}
+
+		if (inside) {
+			masks[i] |= bit;
+			numVisible++;
+		}
+	}
+#endif // FRUSTUM_CULLER_SSE
+
+	return numVisible;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include"RendererCore.h"
+#include<glm/glm.hpp>
+#include<vector>
+#include<cstdint>
+
+struct Frustum;
+
+
+//
+// batch aabb vs frustum test.
+// boxes are packed as structure of arrays (center, half extents) and tested 4 at a time with sse,
+// result is written as a bit per box into a caller provided mask array, large sets are split across job threads.
+//
+class FrustumCuller {
+public:
+	FrustumCuller();
+
+	void clear();
+	void add(const AABB_t& aabb); // invalid boxes always pass
+
+	// set 'bit' in masks[i] for box i inside or intersecting frustum of view projection matrix,
+	// return number of such boxes
+	size_t cull(const glm::mat4& viewProj, uint8_t* masks, uint8_t bit) const;
+	size_t cull(const Frustum& frustum, uint8_t* masks, uint8_t bit) const;
+
+	inline size_t size() const {
+		return m_numBoxes;
+	}
+
+protected:
+	size_t cullRange(const Frustum& frustum, size_t begin, size_t end, uint8_t* masks, uint8_t bit) const;
+
+private:
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+	size_t m_numBoxes;
+};
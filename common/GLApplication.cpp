@@ -5,6 +5,12 @@
 #include<iamgui/imgui_impl_opengl3.h>
 #include"DebugDrawer.h"
 #include"FileSystem.h"
+#include"Profiler.h"
+#include"Benchmark.h"
+#include"GLStateCache.h"
+#include"JobSystem.h"
+#include<fstream>
+#include<cstring>
 
 GLApplication::GLApplication(const std::string& wndTitle, size_t wndWidth, size_t wndHeight, size_t major, size_t minor):m_wndName(wndTitle)
 , m_wndWidth(wndWidth)
@@ -12,7 +18,10 @@ GLApplication::GLApplication(const std::string& wndTitle, size_t wndWidth, size_
 , m_initailized(false)
 , m_glfwWnd(nullptr)
 , m_glMajorVersion(major)
-, m_glMinorVersion(minor){
+, m_glMinorVersion(minor)
+, m_headless()
+, m_numJobWorkers(-1)
+, m_numFailedBenchmarks(0) {
 
 }
 
@@ -31,6 +40,13 @@ bool GLApplication::initailize() {
 	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, 1);
 #endif // _DEBUG
 
+	if (m_headless.enable) {
+		// a regular glfw window that is never shown, its context is created through egl/osmesa so software drivers (llvmpipe) work.
+		// not surfaceless: glfw still needs its window system (x11/wayland/win32), frames render into the hidden window's framebuffer
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, m_headless.contextAPI);
+	}
+
 	// create window and associate opengl context
 	m_glfwWnd = glfwCreateWindow(m_wndWidth, m_wndHeight, m_wndName.c_str(), nullptr, nullptr);
 	if (m_glfwWnd == nullptr) {
@@ -47,7 +63,7 @@ bool GLApplication::initailize() {
 		throw AppException(AppException::Error::GLAD_LOAD_GL_FAILED, "GLAD load gl failed!");
 	}
 
-	glfwSwapInterval(1);
+	glfwSwapInterval(m_headless.enable ? 0 : 1);
 
 	glfwSetFramebufferSizeCallback(m_glfwWnd, [](GLFWwindow* wnd, int width, int height) {
 		ASSERT(glfwGetWindowUserPointer(wnd));
@@ -73,19 +89,22 @@ bool GLApplication::initailize() {
 	
 	InputManager::getInstance()->setWindow(m_glfwWnd);
 
-	// Setup Dear ImGui context
-	IMGUI_CHECKVERSION();
-	ImGui::CreateContext();
-	ImGuiIO& io = ImGui::GetIO(); //(void)io;
-	io.Fonts->AddFontDefault();
-
-	// Setup Dear ImGui style
-	ImGui::StyleColorsDark();
-
-	// Setup Platform/Renderer bindings
-	const char* glsl_version = "#version 130";
-	ImGui_ImplGlfw_InitForOpenGL(m_glfwWnd, true);
-	ImGui_ImplOpenGL3_Init(glsl_version);
+	// no gui in headless runs, nothing would draw it
+	if (!m_headless.enable) {
+		// Setup Dear ImGui context
+		IMGUI_CHECKVERSION();
+		ImGui::CreateContext();
+		ImGuiIO& io = ImGui::GetIO(); //(void)io;
+		io.Fonts->AddFontDefault();
+
+		// Setup Dear ImGui style
+		ImGui::StyleColorsDark();
+
+		// Setup Platform/Renderer bindings
+		const char* glsl_version = "#version 130";
+		ImGui_ImplGlfw_InitForOpenGL(m_glfwWnd, true);
+		ImGui_ImplOpenGL3_Init(glsl_version);
+	}
 
 #ifdef _DEBUG
 	DebugDrawer::setup();
@@ -95,6 +114,11 @@ bool GLApplication::initailize() {
 	FileSystem::Default.setCurrentWorkingDirectory(lanchPath.parent_path());
 	FileSystem::Default.setHomeDirectory(FileSystem::Default.currentWorkingDirectory());
 
+	// main thread is a worker too
+	size_t numCores = std::thread::hardware_concurrency();
+	size_t numWorkers = numCores > 1 ? numCores - 1 : 0;
+	JobSystem::getInstance()->initialize(m_numJobWorkers >= 0 ? size_t(m_numJobWorkers) : numWorkers);
+
 	m_initailized = true;
 
 	return m_initailized;
@@ -105,6 +129,11 @@ void GLApplication::run() {
 		_ASSERT_EXPR(initailize(), "App init failed!");
 	}
 
+	if (m_headless.enable) {
+		runHeadless();
+		return;
+	}
+
 	double now = glfwGetTime();
 	double last = now;
 	while (!glfwWindowShouldClose(m_glfwWnd)) {
@@ -112,6 +141,9 @@ void GLApplication::run() {
 
 		InputManager::getInstance()->update();
 		update(now - last);
+		JobSystem::getInstance()->flushMainThreadJobs();
+		MeshManager::getInstance()->updateLoading();
+		TextureManager::getInstance()->updateLoading();
 		
 		// Start the Dear ImGui frame
 		ImGui_ImplOpenGL3_NewFrame();
@@ -127,6 +159,8 @@ void GLApplication::run() {
 
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		// imgui backend talks to gl directly
+		GLStateCache::getInstance()->invalidate();
 
 		glfwSwapBuffers(m_glfwWnd);
 
@@ -138,6 +172,104 @@ void GLApplication::run() {
 }
 
 
+void GLApplication::runHeadless() {
+	auto profiler = Profiler::getInstance();
+	profiler->clear();
+	profiler->setEnable(true);
+
+	for (auto& bench : m_headless.benchmarks) {
+		if (!BenchmarkRegistry::getInstance()->run(bench))
+			m_numFailedBenchmarks++;
+	}
+
+	if (m_headless.frameCount == 0 && m_headless.duration <= 0.)
+		m_headless.frameCount = 300;
+
+	size_t frame = 0;
+	double start = glfwGetTime();
+	while (!glfwWindowShouldClose(m_glfwWnd)) {
+		if (m_headless.frameCount > 0 && frame >= m_headless.frameCount)
+			break;
+		if (m_headless.duration > 0. && glfwGetTime() - start >= m_headless.duration)
+			break;
+
+		{
+			PROFILE_SCOPE("Frame");
+			glfwPollEvents();
+
+			InputManager::getInstance()->update();
+			update(m_headless.fixedDeltaTime);
+			JobSystem::getInstance()->flushMainThreadJobs();
+			MeshManager::getInstance()->updateLoading();
+			TextureManager::getInstance()->updateLoading();
+			render();
+			// same as windowed loop, anything talking to gl outside the cache can't leave it stale next frame
+			GLStateCache::getInstance()->invalidate();
+
+			// wait gpu, so the frame time includes the work queued by this frame
+			GLCALL(glFinish());
+		}
+
+		frame++;
+	}
+
+	profiler->setEnable(false);
+	writeProfileReport();
+
+	shutdown();
+}
+
+
+void GLApplication::writeProfileReport() {
+	if (m_headless.reportFile.empty()) {
+		Profiler::getInstance()->dumpJson(std::cout);
+		return;
+	}
+
+	std::ofstream file(m_headless.reportFile, std::ios::out | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cerr << "[Headless] Failed to open report file: " << m_headless.reportFile << ", fall back to stdout." << std::endl;
+		Profiler::getInstance()->dumpJson(std::cout);
+		return;
+	}
+
+	Profiler::getInstance()->dumpJson(file);
+}
+
+
+bool GLApplication::parseCommandLine(int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (strcmp(arg, "--headless") == 0) {
+			m_headless.enable = true;
+		} else if (strcmp(arg, "--egl") == 0) {
+			m_headless.contextAPI = GLFW_EGL_CONTEXT_API;
+		} else if (strcmp(arg, "--osmesa") == 0) {
+			m_headless.contextAPI = GLFW_OSMESA_CONTEXT_API;
+		} else if (strcmp(arg, "--frames") == 0 && hasValue) {
+			m_headless.frameCount = strtoul(argv[++i], nullptr, 10);
+		} else if (strcmp(arg, "--duration") == 0 && hasValue) {
+			m_headless.duration = atof(argv[++i]);
+		} else if (strcmp(arg, "--dt") == 0 && hasValue) {
+			m_headless.fixedDeltaTime = atof(argv[++i]);
+		} else if (strcmp(arg, "--report") == 0 && hasValue) {
+			m_headless.reportFile = argv[++i];
+		} else if (strcmp(arg, "--bench") == 0 && hasValue) {
+			m_headless.benchmarks.push_back(argv[++i]);
+		} else if (strcmp(arg, "--workers") == 0 && hasValue) {
+			m_numJobWorkers = atoi(argv[++i]);
+		} else {
+			std::cerr << "Unknown argument: " << arg << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
 void GLApplication::onWindowResized(int width, int height) {
 	//GLCALL(glViewport(0, 0, width, height));
 	m_wndWidth = width;
@@ -145,9 +277,13 @@ void GLApplication::onWindowResized(int width, int height) {
 }
 
 void GLApplication::shutdown() {
-	ImGui_ImplOpenGL3_Shutdown();
-	ImGui_ImplGlfw_Shutdown();
-	ImGui::DestroyContext();
+	JobSystem::getInstance()->shutdown();
+
+	if (ImGui::GetCurrentContext()) {
+		ImGui_ImplOpenGL3_Shutdown();
+		ImGui_ImplGlfw_Shutdown();
+		ImGui::DestroyContext();
+	}
 
 #ifdef _DEBUG
 	DebugDrawer::clenup();
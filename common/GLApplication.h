@@ -1,15 +1,51 @@
 #pragma once
 #include"pch.h"
 #include<string>
+#include<vector>
 
 
 class GLApplication {
 public:
+	// run in a hidden window without gui, used for benchmarking
+	struct HeadlessSettings {
+		bool enable = false;
+		int contextAPI = GLFW_EGL_CONTEXT_API; // GLFW_EGL_CONTEXT_API or GLFW_OSMESA_CONTEXT_API
+		size_t frameCount = 0; // stop after n frames, 0 means no limit
+		double duration = 0.; // stop after n seconds of wall time, 0 means no limit
+		double fixedDeltaTime = 1. / 60.; // deterministic dt feed to update()
+		std::string reportFile; // json report destination, empty for stdout
+		std::vector<std::string> benchmarks; // registered benchmarks to run before frames
+	};
+
 	GLApplication(const std::string& wndTitle, size_t wndWidth = 1920, size_t wndHeight = 1080, size_t major = 4, size_t minor = 5);
 	virtual ~GLApplication() {}
 
 	virtual void run();
 
+	// [--workers n] --headless [--egl|--osmesa] [--frames n] [--duration sec] [--dt sec] [--report file] [--bench name]...
+	bool parseCommandLine(int argc, char* argv[]);
+
+	inline void setHeadless(const HeadlessSettings& settings) {
+		m_headless = settings;
+	}
+
+	inline const HeadlessSettings& getHeadless() const {
+		return m_headless;
+	}
+
+	inline bool isHeadless() const {
+		return m_headless.enable;
+	}
+
+	// unknown or failed --bench runs of headless mode, main exits with failure if any
+	inline size_t numFailedBenchmarks() const {
+		return m_numFailedBenchmarks;
+	}
+
+	inline void setJobWorkerCount(int numWorkers) {
+		m_numJobWorkers = numWorkers;
+	}
+
 	virtual void onWindowResized(int width, int height);
 	virtual void onOpenglDebugError(GLenum source, GLenum type, unsigned int id, GLenum severity, GLsizei length, const char* msg);
 
@@ -23,6 +59,9 @@ protected:
 
 	virtual void shutdown();
 
+	void runHeadless();
+	void writeProfileReport();
+
 protected:
 	std::string m_wndName;
 	size_t m_wndWidth;
@@ -31,4 +70,7 @@ protected:
 	GLFWwindow* m_glfwWnd;
 	size_t m_glMajorVersion;
 	rsize_t m_glMinorVersion;
+	HeadlessSettings m_headless;
+	int m_numJobWorkers; // job threads besides main thread, negative to use all cores
+	size_t m_numFailedBenchmarks;
 };
\ No newline at end of file
@@ -0,0 +1,412 @@
+#include"GLStateCache.h"
+#include"Util.h"
+
+
+GLStateCacheStats::GLStateCacheStats() {
+	reset();
+}
+
+void GLStateCacheStats::reset() {
+	numIssued = 0;
+	numElided = 0;
+}
+
+
+
+GLStateCache::GLStateCache() : m_stats() {
+	invalidate();
+}
+
+
+void GLStateCache::invalidate() {
+	m_program.valid = false;
+	m_vao.valid = false;
+	m_drawFramebuffer.valid = false;
+	m_readFramebuffer.valid = false;
+	m_activeTexUnit.valid = false;
+	for (auto& unit : m_textures) {
+		for (auto& tex : unit)
+			tex.valid = false;
+	}
+	for (auto& buf : m_buffers)
+		buf.valid = false;
+	for (size_t i = 0; i < MAX_CACHED_INDEXED_BUFFERS; i++) {
+		m_uniformBuffers[i].valid = false;
+		m_storageBuffers[i].valid = false;
+	}
+
+	m_cullFaceEnable.valid = false;
+	m_depthTestEnable.valid = false;
+	m_stencilTestEnable.valid = false;
+	m_blendEnable.valid = false;
+	m_cullFace.valid = false;
+	m_frontFace.valid = false;
+	m_shadeModel.valid = false;
+	m_polygonMode.valid = false;
+	m_depthFunc.valid = false;
+	m_depthMask.valid = false;
+	m_stencilFunc.valid = false;
+	m_stencilOp.valid = false;
+	m_stencilMask.valid = false;
+	m_colorMask.valid = false;
+	m_blendFunc.valid = false;
+	m_blendEquation.valid = false;
+	m_blendColor.valid = false;
+}
+
+
+void GLStateCache::resetStats() {
+	m_stats.reset();
+}
+
+
+int GLStateCache::textureTargetSlot(GLenum target) {
+	switch (target) {
+	case GL_TEXTURE_1D: return 0;
+	case GL_TEXTURE_1D_ARRAY: return 1;
+	case GL_TEXTURE_2D: return 2;
+	case GL_TEXTURE_2D_ARRAY: return 3;
+	case GL_TEXTURE_2D_MULTISAMPLE: return 4;
+	case GL_TEXTURE_2D_MULTISAMPLE_ARRAY: return 5;
+	case GL_TEXTURE_3D: return 6;
+	case GL_TEXTURE_CUBE_MAP: return 7;
+	case GL_TEXTURE_CUBE_MAP_ARRAY: return 8;
+	case GL_TEXTURE_RECTANGLE: return 9;
+	case GL_TEXTURE_BUFFER: return 10;
+	default: return -1;
+	}
+}
+
+
+int GLStateCache::bufferTargetSlot(GLenum target) {
+	switch (target) {
+	case GL_ARRAY_BUFFER: return 0;
+	case GL_ELEMENT_ARRAY_BUFFER: return 1;
+	case GL_UNIFORM_BUFFER: return 2;
+	case GL_TRANSFORM_FEEDBACK_BUFFER: return 3;
+	case GL_COPY_READ_BUFFER: return 4;
+	case GL_COPY_WRITE_BUFFER: return 5;
+	case GL_SHADER_STORAGE_BUFFER: return 6;
+	case GL_TEXTURE_BUFFER: return 7;
+	case GL_PIXEL_PACK_BUFFER: return 8;
+	case GL_PIXEL_UNPACK_BUFFER: return 9;
+	case GL_ATOMIC_COUNTER_BUFFER: return 10;
+	case GL_DRAW_INDIRECT_BUFFER: return 11;
+	default: return -1;
+	}
+}
+
+
+GLStateCache::Cached<GLStateCache::IndexedBuffer>* GLStateCache::indexedBufferSlot(GLenum target, GLuint index) {
+	if (index >= MAX_CACHED_INDEXED_BUFFERS)
+		return nullptr;
+
+	if (target == GL_UNIFORM_BUFFER)
+		return &m_uniformBuffers[index];
+	if (target == GL_SHADER_STORAGE_BUFFER)
+		return &m_storageBuffers[index];
+
+	return nullptr;
+}
+
+
+//
+// object bindings
+//
+void GLStateCache::useProgram(GLuint program) {
+	if (update(m_program, program)) {
+		GLCALL(glUseProgram(program));
+	}
+}
+
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+	if (update(m_vao, vao)) {
+		GLCALL(glBindVertexArray(vao));
+		// element array binding is part of vertex array state
+		m_buffers[bufferTargetSlot(GL_ELEMENT_ARRAY_BUFFER)].valid = false;
+	}
+}
+
+
+void GLStateCache::bindFramebuffer(GLenum target, GLuint fbo) {
+	bool issue = false;
+	if (target == GL_FRAMEBUFFER) {
+		// one call set both, only counted once
+		issue = !m_drawFramebuffer.valid || !m_readFramebuffer.valid
+			|| m_drawFramebuffer.value != fbo || m_readFramebuffer.value != fbo;
+		m_drawFramebuffer = { fbo, true };
+		m_readFramebuffer = { fbo, true };
+		issue ? m_stats.numIssued++ : m_stats.numElided++;
+	} else if (target == GL_DRAW_FRAMEBUFFER) {
+		issue = update(m_drawFramebuffer, fbo);
+	} else if (target == GL_READ_FRAMEBUFFER) {
+		issue = update(m_readFramebuffer, fbo);
+	}
+
+	if (issue) {
+		GLCALL(glBindFramebuffer(target, fbo));
+	}
+}
+
+
+void GLStateCache::activeTexture(GLuint unit) {
+	if (update(m_activeTexUnit, unit)) {
+		GLCALL(glActiveTexture(GL_TEXTURE0 + unit));
+	}
+}
+
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture) {
+	// texture parameter calls after bind rely on the active unit, always keep it in sync
+	activeTexture(unit);
+
+	int slot = textureTargetSlot(target);
+	if (unit >= MAX_CACHED_TEXTURE_UNITS || slot < 0) {
+		issued();
+		GLCALL(glBindTexture(target, texture));
+		return;
+	}
+
+	if (update(m_textures[unit][slot], texture)) {
+		GLCALL(glBindTexture(target, texture));
+	}
+}
+
+
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer) {
+	int slot = bufferTargetSlot(target);
+	if (slot < 0) {
+		issued();
+		GLCALL(glBindBuffer(target, buffer));
+		return;
+	}
+
+	if (update(m_buffers[slot], buffer)) {
+		GLCALL(glBindBuffer(target, buffer));
+	}
+}
+
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	// whole buffer binding, size 0 stands for the entire store
+	auto indexed = indexedBufferSlot(target, index);
+	if (!indexed || update(*indexed, { buffer, 0, 0 })) {
+		if (!indexed)
+			issued();
+		GLCALL(glBindBufferBase(target, index, buffer));
+
+		// also bind to the generic binding point
+		int slot = bufferTargetSlot(target);
+		if (slot >= 0)
+			m_buffers[slot] = { buffer, true };
+	}
+	else {
+		// elided indexed bind leaves generic binding point alone, callers still expect buffer there (eg. loadSubData after bindBase)
+		bindBuffer(target, buffer);
+	}
+}
+
+
+void GLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	auto indexed = indexedBufferSlot(target, index);
+	if (!indexed || update(*indexed, { buffer, offset, size })) {
+		if (!indexed)
+			issued();
+		GLCALL(glBindBufferRange(target, index, buffer, offset, size));
+
+		int slot = bufferTargetSlot(target);
+		if (slot >= 0)
+			m_buffers[slot] = { buffer, true };
+	}
+	else {
+		bindBuffer(target, buffer);
+	}
+}
+
+
+//
+// object deletion, affected slots are forgotten instead of guessing what gl reverted them to
+//
+void GLStateCache::onDeleteProgram(GLuint program) {
+	// program stay in use until another one is made current, forget it so the next use is issued
+	if (m_program.value == program)
+		m_program.valid = false;
+}
+
+
+void GLStateCache::onDeleteVertexArray(GLuint vao) {
+	if (m_vao.valid && m_vao.value == vao) {
+		m_vao.valid = false;
+		m_buffers[bufferTargetSlot(GL_ELEMENT_ARRAY_BUFFER)].valid = false;
+	}
+}
+
+
+void GLStateCache::onDeleteFramebuffer(GLuint fbo) {
+	if (m_drawFramebuffer.valid && m_drawFramebuffer.value == fbo)
+		m_drawFramebuffer.valid = false;
+	if (m_readFramebuffer.valid && m_readFramebuffer.value == fbo)
+		m_readFramebuffer.valid = false;
+}
+
+
+void GLStateCache::onDeleteTexture(GLuint texture) {
+	for (auto& unit : m_textures) {
+		for (auto& tex : unit) {
+			if (tex.valid && tex.value == texture)
+				tex.valid = false;
+		}
+	}
+}
+
+
+void GLStateCache::onDeleteBuffer(GLuint buffer) {
+	for (auto& buf : m_buffers) {
+		if (buf.valid && buf.value == buffer)
+			buf.valid = false;
+	}
+	for (size_t i = 0; i < MAX_CACHED_INDEXED_BUFFERS; i++) {
+		if (m_uniformBuffers[i].valid && m_uniformBuffers[i].value.handle == buffer)
+			m_uniformBuffers[i].valid = false;
+		if (m_storageBuffers[i].valid && m_storageBuffers[i].value.handle == buffer)
+			m_storageBuffers[i].valid = false;
+	}
+}
+
+
+//
+// raster state
+//
+void GLStateCache::setCapability(GLenum cap, bool enable) {
+	Cached<bool>* cached = nullptr;
+	switch (cap) {
+	case GL_CULL_FACE: cached = &m_cullFaceEnable; break;
+	case GL_DEPTH_TEST: cached = &m_depthTestEnable; break;
+	case GL_STENCIL_TEST: cached = &m_stencilTestEnable; break;
+	case GL_BLEND: cached = &m_blendEnable; break;
+	default: issued(); break;
+	}
+
+	if (cached && !update(*cached, enable))
+		return;
+
+	if (enable) {
+		GLCALL(glEnable(cap));
+	} else {
+		GLCALL(glDisable(cap));
+	}
+}
+
+
+void GLStateCache::cullFace(GLenum mode) {
+	if (update(m_cullFace, mode)) {
+		GLCALL(glCullFace(mode));
+	}
+}
+
+
+void GLStateCache::frontFace(GLenum order) {
+	if (update(m_frontFace, order)) {
+		GLCALL(glFrontFace(order));
+	}
+}
+
+
+void GLStateCache::shadeModel(GLenum mode) {
+	if (update(m_shadeModel, mode)) {
+		GLCALL(glShadeModel(mode));
+	}
+}
+
+
+void GLStateCache::polygonMode(GLenum mode) {
+	if (update(m_polygonMode, mode)) {
+		GLCALL(glPolygonMode(GL_FRONT_AND_BACK, mode));
+	}
+}
+
+
+void GLStateCache::depthFunc(GLenum func) {
+	if (update(m_depthFunc, func)) {
+		GLCALL(glDepthFunc(func));
+	}
+}
+
+
+void GLStateCache::depthMask(bool writable) {
+	if (update(m_depthMask, writable)) {
+		GLCALL(glDepthMask(writable));
+	}
+}
+
+
+void GLStateCache::stencilFunc(GLenum func, GLint ref, GLuint mask) {
+	if (update(m_stencilFunc, glm::uvec3(func, GLuint(ref), mask))) {
+		GLCALL(glStencilFunc(func, ref, mask));
+	}
+}
+
+
+void GLStateCache::stencilOp(GLenum sFail, GLenum dFail, GLenum pass) {
+	if (update(m_stencilOp, glm::uvec3(sFail, dFail, pass))) {
+		GLCALL(glStencilOp(sFail, dFail, pass));
+	}
+}
+
+
+void GLStateCache::stencilMask(GLuint mask) {
+	if (update(m_stencilMask, mask)) {
+		GLCALL(glStencilMask(mask));
+	}
+}
+
+
+void GLStateCache::colorMask(bool r, bool g, bool b, bool a) {
+	if (update(m_colorMask, glm::bvec4(r, g, b, a))) {
+		GLCALL(glColorMask(r, g, b, a));
+	}
+}
+
+
+void GLStateCache::colorMaski(GLuint buffer, bool r, bool g, bool b, bool a) {
+	// per draw buffer state is not tracked, global mask is no longer uniform
+	issued();
+	m_colorMask.valid = false;
+	GLCALL(glColorMaski(buffer, r, g, b, a));
+}
+
+
+void GLStateCache::blendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcA, GLenum dstA) {
+	if (update(m_blendFunc, glm::uvec4(srcRGB, dstRGB, srcA, dstA))) {
+		GLCALL(glBlendFuncSeparate(srcRGB, dstRGB, srcA, dstA));
+	}
+}
+
+
+void GLStateCache::blendFuncSeparatei(GLuint buffer, GLenum srcRGB, GLenum dstRGB, GLenum srcA, GLenum dstA) {
+	issued();
+	m_blendFunc.valid = false;
+	GLCALL(glBlendFuncSeparatei(buffer, srcRGB, dstRGB, srcA, dstA));
+}
+
+
+void GLStateCache::blendEquation(GLenum func) {
+	if (update(m_blendEquation, func)) {
+		GLCALL(glBlendEquation(func));
+	}
+}
+
+
+void GLStateCache::blendEquationi(GLuint buffer, GLenum func) {
+	issued();
+	m_blendEquation.valid = false;
+	GLCALL(glBlendEquationi(buffer, func));
+}
+
+
+void GLStateCache::blendColor(const glm::vec4& color) {
+	if (update(m_blendColor, color)) {
+		GLCALL(glBlendColor(color.r, color.g, color.b, color.a));
+	}
+}
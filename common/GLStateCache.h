@@ -0,0 +1,141 @@
+#pragma once
+#include"Singleton.h"
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<array>
+
+
+#define MAX_CACHED_TEXTURE_UNITS 32
+#define MAX_CACHED_TEXTURE_TARGETS 11
+#define MAX_CACHED_BUFFER_TARGETS 12
+#define MAX_CACHED_INDEXED_BUFFERS 16
+
+
+struct GLStateCacheStats {
+	size_t numIssued;
+	size_t numElided;
+
+	GLStateCacheStats();
+	void reset();
+};
+
+
+//
+// shadow copy of the gl context state, redundant binds & raster state changes are dropped.
+// every gl call that modify a cached state must go through here, or call invalidate() afterwards.
+//
+class GLStateCache : public Singleton<GLStateCache> {
+	template<typename T>
+	struct Cached {
+		T value;
+		bool valid = false;
+	};
+
+	struct IndexedBuffer {
+		GLuint handle;
+		GLintptr offset;
+		GLsizeiptr size;
+
+		bool operator == (const IndexedBuffer& other) const {
+			return handle == other.handle && offset == other.offset && size == other.size;
+		}
+	};
+
+public:
+	GLStateCache();
+
+	void invalidate(); // forget everything, the next call of each state hits the driver
+	void resetStats();
+
+	// object bindings
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vao);
+	void bindFramebuffer(GLenum target, GLuint fbo);
+	void activeTexture(GLuint unit);
+	void bindTexture(GLuint unit, GLenum target, GLuint texture);
+	void bindBuffer(GLenum target, GLuint buffer);
+	void bindBufferBase(GLenum target, GLuint index, GLuint buffer);
+	void bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+	// deleted object names are unbound by gl implicitly and may be reused
+	void onDeleteProgram(GLuint program);
+	void onDeleteVertexArray(GLuint vao);
+	void onDeleteFramebuffer(GLuint fbo);
+	void onDeleteTexture(GLuint texture);
+	void onDeleteBuffer(GLuint buffer);
+
+	// raster state
+	void setCapability(GLenum cap, bool enable);
+	void cullFace(GLenum mode);
+	void frontFace(GLenum order);
+	void shadeModel(GLenum mode);
+	void polygonMode(GLenum mode);
+	void depthFunc(GLenum func);
+	void depthMask(bool writable);
+	void stencilFunc(GLenum func, GLint ref, GLuint mask);
+	void stencilOp(GLenum sFail, GLenum dFail, GLenum pass);
+	void stencilMask(GLuint mask);
+	void colorMask(bool r, bool g, bool b, bool a);
+	void colorMaski(GLuint buffer, bool r, bool g, bool b, bool a);
+	void blendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcA, GLenum dstA);
+	void blendFuncSeparatei(GLuint buffer, GLenum srcRGB, GLenum dstRGB, GLenum srcA, GLenum dstA);
+	void blendEquation(GLenum func);
+	void blendEquationi(GLuint buffer, GLenum func);
+	void blendColor(const glm::vec4& color);
+
+	inline const GLStateCacheStats& getStats() const {
+		return m_stats;
+	}
+
+protected:
+	template<typename T>
+	bool update(Cached<T>& cached, const T& value) {
+		if (cached.valid && cached.value == value) {
+			m_stats.numElided++;
+			return false;
+		}
+		cached.value = value;
+		cached.valid = true;
+		m_stats.numIssued++;
+		return true;
+	}
+
+	void issued() {
+		m_stats.numIssued++;
+	}
+
+	static int textureTargetSlot(GLenum target);
+	static int bufferTargetSlot(GLenum target);
+	Cached<IndexedBuffer>* indexedBufferSlot(GLenum target, GLuint index);
+
+private:
+	Cached<GLuint> m_program;
+	Cached<GLuint> m_vao;
+	Cached<GLuint> m_drawFramebuffer;
+	Cached<GLuint> m_readFramebuffer;
+	Cached<GLuint> m_activeTexUnit;
+	std::array<std::array<Cached<GLuint>, MAX_CACHED_TEXTURE_TARGETS>, MAX_CACHED_TEXTURE_UNITS> m_textures;
+	std::array<Cached<GLuint>, MAX_CACHED_BUFFER_TARGETS> m_buffers;
+	std::array<Cached<IndexedBuffer>, MAX_CACHED_INDEXED_BUFFERS> m_uniformBuffers;
+	std::array<Cached<IndexedBuffer>, MAX_CACHED_INDEXED_BUFFERS> m_storageBuffers;
+
+	Cached<bool> m_cullFaceEnable;
+	Cached<bool> m_depthTestEnable;
+	Cached<bool> m_stencilTestEnable;
+	Cached<bool> m_blendEnable;
+	Cached<GLenum> m_cullFace;
+	Cached<GLenum> m_frontFace;
+	Cached<GLenum> m_shadeModel;
+	Cached<GLenum> m_polygonMode;
+	Cached<GLenum> m_depthFunc;
+	Cached<bool> m_depthMask;
+	Cached<glm::uvec3> m_stencilFunc;
+	Cached<glm::uvec3> m_stencilOp;
+	Cached<GLuint> m_stencilMask;
+	Cached<glm::bvec4> m_colorMask;
+	Cached<glm::uvec4> m_blendFunc;
+	Cached<GLenum> m_blendEquation;
+	Cached<glm::vec4> m_blendColor;
+
+	GLStateCacheStats m_stats;
+};
@@ -2,12 +2,12 @@
 #include"Renderer.h"
 #include"PostProcessingManager.h"
 #include"ShaderProgamMgr.h"
-#include<glm/gtc/constants.hpp>
 
 
 static const char* sGaussianFilterName = "GuassianBlur";
 static const char* sSigmaParamName = "Sigma";
 static const char* sKernelSizeParamName = "Kernel";
+static const char* sPyramidParamName = "Pyramid";
 
 
 RTTI_IMPLEMENTATION(GaussianBlurFilterComponent)
@@ -15,11 +15,12 @@ RTTI_IMPLEMENTATION(GaussianBlurFilterComponent)
 const double GaussianBlurFilterComponent::sMinSigma = 0.1;
 const double GaussianBlurFilterComponent::sMaxSigma = 25;
 const int GaussianBlurFilterComponent::sMinKernel = 3;
-const int GaussianBlurFilterComponent::sMaxKernel = 37;
+const int GaussianBlurFilterComponent::sMaxKernel = 151;
 
 GaussianBlurFilterComponent::GaussianBlurFilterComponent(): FilterComponent(sGaussianFilterName)
 , m_sigma(1)
-, m_kernelSize(5) {
+, m_kernelSize(5)
+, m_isPyramid(true) {
 
 }
 
@@ -27,6 +28,7 @@ GaussianBlurFilterComponent::GaussianBlurFilterComponent(): FilterComponent(sGau
 bool GaussianBlurFilterComponent::initialize() {
 	m_params.addParam<float>(sSigmaParamName, m_sigma);
 	m_params.addParam<int>(sKernelSizeParamName, m_kernelSize);
+	m_params.addParam<bool>(sPyramidParamName, m_isPyramid);
 	
 	return true;
 }
@@ -35,6 +37,7 @@ bool GaussianBlurFilterComponent::initialize() {
 void GaussianBlurFilterComponent::render(RenderContext* context) {
 	m_params.getParam<float>(sSigmaParamName)->m_value = m_sigma;
 	m_params.getParam<int>(sKernelSizeParamName)->m_value = m_kernelSize;
+	m_params.getParam<bool>(sPyramidParamName)->m_value = m_isPyramid;
 	context->getRenderer()->submitPostProcessingFilter(this);
 }
 
@@ -43,97 +46,139 @@ void GaussianBlurFilterComponent::render(RenderContext* context) {
 const std::string GaussianBlurFilter::sName = sGaussianFilterName;
 
 GaussianBlurFilter::GaussianBlurFilter(PostProcessingManager* mgr) : IFilter(sGaussianFilterName, mgr)
-, m_sigma(0)
-, m_kernel(0)
-, m_weights()
-, m_halfBlurTarget(mgr->getRenderer()->getRenderSize())
-, m_outputTarget(mgr->getRenderer()->getRenderSize()) {
-	m_weights.reserve(GaussianBlurFilterComponent::sMaxKernel / 2 + 1);
+, m_kernels()
+, m_levels() {
+
 }
 
+
 void GaussianBlurFilter::apply(Texture* inputFrame, Texture* outputFrame, const FilterParamGroup* params) {
-	calcWeights(params->getParam<float>(sSigmaParamName)->m_value, params->getParam<int>(sKernelSizeParamName)->m_value);
-	// set up shader
-	auto shader_weak = ShaderProgramManager::getInstance()->getProgram("GaussianBlur");
-	if (shader_weak.expired())
-		shader_weak = ShaderProgramManager::getInstance()->addProgram("GaussianBlur");
+	if (!inputFrame || !outputFrame || !params)
+		return;
 
-	ASSERT(!shader_weak.expired());
-	auto shader = shader_weak.lock();
-	
-	m_manager->getRenderer()->pushShaderProgram(shader.get());
-	shader->setUniform1("u_NumWeights", int(m_weights.size()));
-	shader->setUniform1v("u_Weights[0]", m_weights.data(), m_weights.size());
-	
-	// horizontal blur pass
-	auto halfBlurTex = m_manager->dequeReuseableTexture(Texture::Format::RGBA);
-	if (!halfBlurTex) {
-		auto renderSz = m_manager->getRenderer()->getRenderSize();
-		halfBlurTex = std::make_unique<Texture>();
-		halfBlurTex->bindToTextureUnit();
-		halfBlurTex->loadImage2DFromMemory(Texture::Format::RGBA, Texture::Format::RGBA, Texture::FormatDataType::UByte, renderSz.x, renderSz.y, nullptr);
-		halfBlurTex->unbindFromTextureUnit();
+	const GaussianBlurKernel_t& kernel = m_kernels.getKernel(params->getParam<float>(sSigmaParamName)->m_value,
+		params->getParam<int>(sKernelSizeParamName)->m_value,
+		params->getParam<bool>(sPyramidParamName)->m_value);
+
+	if (kernel.levels == 0) {
+		Texture* temp = levelTexture(0, true);
+		dispatchBlur(inputFrame, temp, kernel, 0);
+		dispatchBlur(temp, outputFrame, kernel, 1);
+		return;
 	}
 
-	ASSERT(halfBlurTex);
+	// downsample chain
+	Texture* level = inputFrame;
+	for (size_t i = 1; i <= kernel.levels; i++) {
+		Texture* down = levelTexture(i, false);
+		dispatchResample(level, down);
+		level = down;
+	}
 
-	m_manager->getRenderer()->pushRenderTarget(&m_halfBlurTarget);
-	m_halfBlurTarget.detachAllTexture();
-	m_halfBlurTarget.attachProxyTexture(halfBlurTex.get(), RenderTarget::Slot::Color);
-	m_manager->getRenderer()->clearScreen(ClearFlags::Color);
+	// blur smallest level in place
+	Texture* temp = levelTexture(kernel.levels, true);
+	dispatchBlur(level, temp, kernel, 0);
+	dispatchBlur(temp, level, kernel, 1);
 
-	inputFrame->bindToTextureUnit(Texture::Unit::Defualt, Texture::Target::Texture_2D);
-	shader->setUniform1("u_Texture", int(Texture::Unit::Defualt));
-	shader->setUniform1("u_Pass", 0);
+	// upsample chain through free temp of each level, last one lands in output
+	for (size_t i = kernel.levels; i > 0; i--) {
+		Texture* up = i > 1 ? levelTexture(i - 1, true) : outputFrame;
+		dispatchResample(level, up);
+		level = up;
+	}
+}
 
-	m_manager->getRenderer()->drawFullScreenQuad();
-	
-	m_manager->getRenderer()->popRenderTarget();
 
-	// vertical blur pass
-	m_manager->getRenderer()->pushRenderTarget(&m_outputTarget);
-	m_outputTarget.detachAllTexture();
-	m_outputTarget.attachProxyTexture(outputFrame, RenderTarget::Slot::Color);
-	m_manager->getRenderer()->clearScreen(ClearFlags::Color);
-	
-	halfBlurTex->bindToTextureUnit(Texture::Unit::Defualt, Texture::Target::Texture_2D);
-	shader->setUniform1("u_Pass", 1);
-	
-	m_manager->getRenderer()->drawFullScreenQuad();
+void GaussianBlurFilter::cleanUp() {
+	m_levels.clear();
+}
 
-	halfBlurTex->unbindFromTextureUnit();
-	inputFrame->unbindFromTextureUnit();
-	m_manager->getRenderer()->popRenderTarget();
-	m_manager->getRenderer()->popShadrProgram();
-	m_manager->enqueReuseableTexture(std::move(halfBlurTex));
+
+void GaussianBlurFilter::onRenderSizeChange(float w, float h) {
+	m_levels.clear();
 }
 
 
-void GaussianBlurFilter::calcWeights(float sigma, int kernel) {
-	if (sigma == m_sigma && kernel == m_kernel)
-		return;
-		
-	float sum = 0;
-	m_weights.clear();
-	m_weights.resize(kernel / 2 + 1, 0);
-	m_weights[0] = gaussian(sigma, 0);
-	sum += m_weights[0];
-	for (size_t i = 1; i < m_weights.size(); i++) {
-		m_weights[i] = gaussian(sigma, i);
-		sum += m_weights[i] * 2;
-	}
+Texture* GaussianBlurFilter::levelTexture(size_t level, bool isTemp) {
+	if (m_levels.size() <= level)
+		m_levels.resize(level + 1);
 
-	for (size_t i = 0; i < m_weights.size(); i++) {  // normalize weights, sum of all weights is 1
-		m_weights[i] /= sum;
+	auto& texture = isTemp ? m_levels[level].temp : m_levels[level].color;
+	if (!texture) {
+		auto renderSz = m_manager->getRenderer()->getRenderSize();
+		texture.reset(new Texture());
+		texture->allocStorage2D(Texture::Format::RGBA16F,
+			GaussianBlurKernelCache::levelSize(size_t(renderSz.x), level),
+			GaussianBlurKernelCache::levelSize(size_t(renderSz.y), level));
+
+		// pyramid resample relies on linear filtering
+		texture->bindToTextureUnit();
+		texture->setFilterMode(Texture::FilterType::Magnification, Texture::FilterMode::Liner);
+		texture->setFilterMode(Texture::FilterType::Minification, Texture::FilterMode::Liner);
+		texture->setWrapMode(Texture::WrapType::S, Texture::WrapMode::Clamp_To_Edge);
+		texture->setWrapMode(Texture::WrapType::T, Texture::WrapMode::Clamp_To_Edge);
+		texture->unbindFromTextureUnit();
 	}
 
-	m_sigma = sigma;
-	m_kernel = kernel;
+	return texture.get();
+}
+
+
+// unsized post processing frames are rgba8 to image load store
+static GLenum imageFormat(const Texture* texture) {
+	return texture->getFormat() == Texture::Format::RGBA ? GL_RGBA8 : GLenum(texture->getFormat());
+}
+
+
+void GaussianBlurFilter::dispatchBlur(Texture* input, Texture* output, const GaussianBlurKernel_t& kernel, int pass) {
+	auto shader_weak = ShaderProgramManager::getInstance()->getProgram("GaussianBlurTile");
+	if (shader_weak.expired())
+		shader_weak = ShaderProgramManager::getInstance()->addProgram("GaussianBlurTile");
+
+	ASSERT(!shader_weak.expired());
+	auto shader = shader_weak.lock();
+	auto renderer = m_manager->getRenderer();
+	renderer->pushShaderProgram(shader.get());
+
+	input->bindToTextureUnit(Texture::Unit::Defualt, Texture::Target::Texture_2D);
+	GLCALL(glBindImageTexture(0, output->getHandler(), 0, GL_FALSE, 0, GL_WRITE_ONLY, imageFormat(output)));
+
+	shader->setUniform1("u_Input", int(Texture::Unit::Defualt));
+	shader->setUniform1("u_Pass", pass);
+	shader->setUniform1("u_Radius", kernel.radius);
+	shader->setUniform1("u_NumTaps", int(kernel.tapOffsets.size()));
+	shader->setUniform1v("u_TapOffsets[0]", kernel.tapOffsets.data(), kernel.tapOffsets.size());
+	shader->setUniform1v("u_TapWeights[0]", kernel.tapWeights.data(), kernel.tapWeights.size());
+
+	size_t size = pass == 0 ? output->getWidth() : output->getHeight();
+	size_t lines = pass == 0 ? output->getHeight() : output->getWidth();
+	renderer->dispatchCompute((size + GAUSSIAN_BLUR_TILE_SIZE - 1) / GAUSSIAN_BLUR_TILE_SIZE, lines);
+	GLCALL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT));
+
+	GLCALL(glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8));
+	input->unbindFromTextureUnit();
+	renderer->popShadrProgram();
 }
 
 
-float GaussianBlurFilter::gaussian(float sigma, int x) { // 1D gaussian equaltion
-	float cof = 1.0 / (glm::root_two_pi<double>() * sigma);
-	float p = -0.5 * (x * x) / (sigma * sigma);
-	return cof * glm::exp(p);
-}
\ No newline at end of file
+void GaussianBlurFilter::dispatchResample(Texture* input, Texture* output) {
+	auto shader_weak = ShaderProgramManager::getInstance()->getProgram("GaussianBlurResample");
+	if (shader_weak.expired())
+		shader_weak = ShaderProgramManager::getInstance()->addProgram("GaussianBlurResample");
+
+	ASSERT(!shader_weak.expired());
+	auto shader = shader_weak.lock();
+	auto renderer = m_manager->getRenderer();
+	renderer->pushShaderProgram(shader.get());
+
+	input->bindToTextureUnit(Texture::Unit::Defualt, Texture::Target::Texture_2D);
+	GLCALL(glBindImageTexture(0, output->getHandler(), 0, GL_FALSE, 0, GL_WRITE_ONLY, imageFormat(output)));
+	shader->setUniform1("u_Input", int(Texture::Unit::Defualt));
+
+	renderer->dispatchCompute((output->getWidth() + 15) / 16, (output->getHeight() + 15) / 16);
+	GLCALL(glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT));
+
+	GLCALL(glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8));
+	input->unbindFromTextureUnit();
+	renderer->popShadrProgram();
+}
@@ -1,6 +1,9 @@
 #pragma once
 #include"IFilter.h"
-#include"RenderTarget.h"
+#include"Texture.h"
+#include"GaussianBlurKernel.h"
+#include<memory>
+#include<vector>
 
 
 class GaussianBlurFilterComponent : public FilterComponent {
@@ -36,14 +39,28 @@ public:
 		return m_kernelSize;
 	}
 
+	inline void setPyramid(bool pyramid) {
+		m_isPyramid = pyramid;
+	}
+
+	inline bool isPyramid() const {
+		return m_isPyramid;
+	}
+
 protected:
 	float m_sigma;
 	int m_kernelSize;
+	bool m_isPyramid; // blur wide sigma on a downsampled level
 };
 
 
 
 
+//
+// separable gaussian blur in compute. each group loads a tile of a row/column plus its apron into shared memory once,
+// then blurs it with paired taps. wide sigma is blurred on a downsampled level of a pyramid and upsampled back,
+// so cost stays about the same as sigma grows. intermediates are half float and kept across frames.
+//
 class GaussianBlurFilter : public IFilter {
 public:
 	GaussianBlurFilter(PostProcessingManager* mgr);
@@ -52,14 +69,21 @@ public:
 
 	void apply(Texture* inputFrame, Texture* outputFrame, const FilterParamGroup* params) override;
 
+	void cleanUp() override;
+
+	void onRenderSizeChange(float w, float h) override;
+
 protected:
-	float gaussian(float sigma, int x);
-	void calcWeights(float sigma, int kernel);
+	struct BlurLevel_t {
+		std::unique_ptr<Texture> color;
+		std::unique_ptr<Texture> temp;
+	};
+
+	Texture* levelTexture(size_t level, bool isTemp);
+	void dispatchBlur(Texture* input, Texture* output, const GaussianBlurKernel_t& kernel, int pass);
+	void dispatchResample(Texture* input, Texture* output);
 
 protected:
-	int m_kernel;
-	float m_sigma;
-	std::vector<float> m_weights;
-	RenderTarget m_outputTarget;
-	RenderTarget m_halfBlurTarget;
+	GaussianBlurKernelCache m_kernels;
+	std::vector<BlurLevel_t> m_levels;
 };
\ No newline at end of file
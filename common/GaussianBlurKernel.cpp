@@ -0,0 +1,207 @@
+#include"GaussianBlurKernel.h"
+#include"Util.h"
+#include<glm/gtc/constants.hpp>
+#include<cmath>
+
+
+GaussianBlurKernelCache::GaussianBlurKernelCache() : m_kernels() {
+
+}
+
+
+const GaussianBlurKernel_t& GaussianBlurKernelCache::getKernel(float sigma, int kernelSize, bool isPyramid) {
+	Key key(sigma, kernelSize, isPyramid);
+	auto pos = m_kernels.find(key);
+	if (pos != m_kernels.end())
+		return pos->second;
+
+	// sigma is dragged around in gui, don't let every value pile up
+	if (m_kernels.size() >= GAUSSIAN_BLUR_MAX_CACHED_KERNELS)
+		m_kernels.clear();
+
+	GaussianBlurKernel_t& kernel = m_kernels[key];
+	buildKernel(sigma, kernelSize, isPyramid, kernel);
+
+	return kernel;
+}
+
+
+void GaussianBlurKernelCache::buildKernel(float sigma, int kernelSize, bool isPyramid, GaussianBlurKernel_t& kernel) {
+	sigma = glm::max(sigma, 0.1f);
+
+	// weights beyond 3 sigma are below 0.5% of center, not worth a fetch
+	int radius = glm::max(glm::min(kernelSize / 2, int(std::ceil(3.f * sigma))), 1);
+
+	// a radius one tile pass can't reach goes down the pyramid even with pyramid mode off, instead of being cut short
+	size_t levels = 0;
+	while (levels < GAUSSIAN_BLUR_MAX_PYRAMID_LEVELS) {
+		float scale = float(1 << levels);
+		bool isWide = isPyramid && sigma / scale > GAUSSIAN_BLUR_PYRAMID_SIGMA;
+		bool isOutOfReach = int(std::ceil(radius / scale)) > GAUSSIAN_BLUR_MAX_RADIUS;
+		if (!isWide && !isOutOfReach)
+			break;
+		levels++;
+	}
+
+	// 2x box downsample chain & bilinear upsample chain blur too, about (scale^2 - 1) / 4 variance in full resolution pixels,
+	// leave it out of what the level blurs
+	float scale = float(1 << levels);
+	float variance = sigma * sigma - (scale * scale - 1.f) / 4.f;
+	kernel.sigma = std::sqrt(glm::max(variance, 0.25f * scale * scale)) / scale;
+	kernel.radius = glm::clamp(int(std::ceil(radius / scale)), 1, GAUSSIAN_BLUR_MAX_RADIUS);
+	kernel.levels = levels;
+
+	float sum = 0;
+	kernel.weights.resize(kernel.radius + 1);
+	for (int i = 0; i <= kernel.radius; i++) {
+		kernel.weights[i] = gaussian(kernel.sigma, i);
+		sum += i == 0 ? kernel.weights[i] : kernel.weights[i] * 2;
+	}
+
+	for (auto& w : kernel.weights) { // normalize weights, sum of all weights is 1
+		w /= sum;
+	}
+
+	// pair taps (1, 2), (3, 4) ... into one fetch at their weighted center
+	kernel.tapOffsets.clear();
+	kernel.tapWeights.clear();
+	kernel.tapOffsets.push_back(0);
+	kernel.tapWeights.push_back(kernel.weights[0]);
+	for (int i = 1; i <= kernel.radius; i += 2) {
+		if (i + 1 <= kernel.radius) {
+			float w = kernel.weights[i] + kernel.weights[i + 1];
+			kernel.tapOffsets.push_back((i * kernel.weights[i] + (i + 1) * kernel.weights[i + 1]) / w);
+			kernel.tapWeights.push_back(w);
+		}
+		else {
+			kernel.tapOffsets.push_back(float(i));
+			kernel.tapWeights.push_back(kernel.weights[i]);
+		}
+	}
+}
+
+
+float GaussianBlurKernelCache::gaussian(float sigma, int x) { // 1D gaussian equaltion
+	float cof = 1.0 / (glm::root_two_pi<double>() * sigma);
+	float p = -0.5 * (x * x) / (sigma * sigma);
+	return cof * glm::exp(p);
+}
+
+
+void GaussianBlurKernelCache::blurReference(const glm::vec4* src, glm::vec4* dst, size_t width, size_t height, const GaussianBlurKernel_t& kernel) {
+	if (kernel.levels == 0) {
+		std::vector<glm::vec4> temp(width * height);
+		blurPass(src, temp.data(), width, height, kernel, 0);
+		blurPass(temp.data(), dst, width, height, kernel, 1);
+		return;
+	}
+
+	std::vector<std::vector<glm::vec4>> pyramid(kernel.levels + 1);
+	const glm::vec4* level = src;
+	for (size_t i = 1; i <= kernel.levels; i++) {
+		pyramid[i].resize(levelSize(width, i) * levelSize(height, i));
+		resample(level, levelSize(width, i - 1), levelSize(height, i - 1), pyramid[i].data(), levelSize(width, i), levelSize(height, i));
+		level = pyramid[i].data();
+	}
+
+	size_t levelWidth = levelSize(width, kernel.levels);
+	size_t levelHeight = levelSize(height, kernel.levels);
+	std::vector<glm::vec4> temp(levelWidth * levelHeight);
+	blurPass(pyramid[kernel.levels].data(), temp.data(), levelWidth, levelHeight, kernel, 0);
+	blurPass(temp.data(), pyramid[kernel.levels].data(), levelWidth, levelHeight, kernel, 1);
+
+	for (size_t i = kernel.levels; i > 0; i--) {
+		glm::vec4* up = dst;
+		if (i > 1) {
+			pyramid[i - 1].resize(levelSize(width, i - 1) * levelSize(height, i - 1));
+			up = pyramid[i - 1].data();
+		}
+		resample(pyramid[i].data(), levelSize(width, i), levelSize(height, i), up, levelSize(width, i - 1), levelSize(height, i - 1));
+	}
+}
+
+
+void GaussianBlurKernelCache::blurExact(const glm::vec4* src, glm::vec4* dst, size_t width, size_t height, float sigma, int kernelSize) {
+	int radius = glm::max(kernelSize / 2, 1);
+	std::vector<float> weights(radius + 1);
+	float sum = 0;
+	for (int i = 0; i <= radius; i++) {
+		weights[i] = gaussian(sigma, i);
+		sum += i == 0 ? weights[i] : weights[i] * 2;
+	}
+
+	std::vector<glm::vec4> temp(width * height);
+	int w = int(width), h = int(height);
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			glm::vec4 color(0.f);
+			for (int i = -radius; i <= radius; i++)
+				color += src[y * w + glm::clamp(x + i, 0, w - 1)] * weights[glm::abs(i)];
+			temp[y * w + x] = color / sum;
+		}
+	}
+
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			glm::vec4 color(0.f);
+			for (int i = -radius; i <= radius; i++)
+				color += temp[glm::clamp(y + i, 0, h - 1) * w + x] * weights[glm::abs(i)];
+			dst[y * w + x] = color / sum;
+		}
+	}
+}
+
+
+void GaussianBlurKernelCache::resample(const glm::vec4* src, size_t srcWidth, size_t srcHeight, glm::vec4* dst, size_t dstWidth, size_t dstHeight) {
+	float scaleX = float(srcWidth) / float(dstWidth);
+	float scaleY = float(srcHeight) / float(dstHeight);
+	int maxX = int(srcWidth) - 1, maxY = int(srcHeight) - 1;
+
+	for (size_t y = 0; y < dstHeight; y++) {
+		float v = (y + 0.5f) * scaleY - 0.5f;
+		int y0 = int(std::floor(v));
+		float fy = v - y0;
+		const glm::vec4* row0 = src + glm::clamp(y0, 0, maxY) * srcWidth;
+		const glm::vec4* row1 = src + glm::clamp(y0 + 1, 0, maxY) * srcWidth;
+
+		for (size_t x = 0; x < dstWidth; x++) {
+			float u = (x + 0.5f) * scaleX - 0.5f;
+			int x0 = int(std::floor(u));
+			float fx = u - x0;
+			int c0 = glm::clamp(x0, 0, maxX), c1 = glm::clamp(x0 + 1, 0, maxX);
+			dst[y * dstWidth + x] = glm::mix(glm::mix(row0[c0], row0[c1], fx), glm::mix(row1[c0], row1[c1], fx), fy);
+		}
+	}
+}
+
+
+void GaussianBlurKernelCache::blurPass(const glm::vec4* src, glm::vec4* dst, size_t width, size_t height, const GaussianBlurKernel_t& kernel, int pass) {
+	int w = int(width), h = int(height);
+	int size = pass == 0 ? w : h;
+	auto fetch = [&](int x, int y, int i) -> const glm::vec4& {
+		i = glm::clamp(i, 0, size - 1);
+		return pass == 0 ? src[y * w + i] : src[i * w + x];
+	};
+
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			int center = pass == 0 ? x : y;
+			glm::vec4 color = fetch(x, y, center) * kernel.tapWeights[0];
+			for (size_t t = 1; t < kernel.tapOffsets.size(); t++) {
+				int i = int(kernel.tapOffsets[t]);
+				float f = kernel.tapOffsets[t] - i;
+#ifdef _DEBUG
+				ASSERT(i + (f > 0.f ? 1 : 0) <= kernel.radius); // shader's tile apron is radius wide
+#endif // _DEBUG
+				glm::vec4 right = fetch(x, y, center + i);
+				glm::vec4 left = fetch(x, y, center - i);
+				if (f > 0.f) { // same as shader, unpaired tap fetches one texel
+					right = glm::mix(right, fetch(x, y, center + i + 1), f);
+					left = glm::mix(left, fetch(x, y, center - i - 1), f);
+				}
+				color += (right + left) * kernel.tapWeights[t];
+			}
+			dst[y * w + x] = color;
+		}
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include<glm/glm.hpp>
+#include<vector>
+#include<map>
+#include<tuple>
+
+
+// taps per side one tile pass takes, matches MAX_RADIUS in GaussianBlurTile.shader.
+// wider kernels are blurred on a downsampled level whether pyramid mode is on or not
+#define GAUSSIAN_BLUR_MAX_RADIUS 18
+#define GAUSSIAN_BLUR_MAX_TAPS (GAUSSIAN_BLUR_MAX_RADIUS / 2 + 1)
+
+// pixels one work group blurs along pass axis, matches TILE_SIZE in GaussianBlurTile.shader
+#define GAUSSIAN_BLUR_TILE_SIZE 128
+
+// wider sigma is blurred on a downsampled level, at most this many halvings
+#define GAUSSIAN_BLUR_PYRAMID_SIGMA 4.f
+#define GAUSSIAN_BLUR_MAX_PYRAMID_LEVELS 4
+
+#define GAUSSIAN_BLUR_MAX_CACHED_KERNELS 32
+
+
+//
+// separable gaussian blur taps of one (sigma, kernel size) on the level it runs at.
+// adjacent taps are paired into one tap between them, so a linear fetch (or lerp of two shared memory texels)
+// gives their weighted sum, roughly halving taps per pass.
+//
+struct GaussianBlurKernel_t {
+	float sigma; // on blur level
+	int radius;
+	size_t levels; // halvings before blurring, 0 blurs at full resolution
+	std::vector<float> weights; // [0] center, [i] at +-i
+	std::vector<float> tapOffsets; // [0] center
+	std::vector<float> tapWeights;
+
+	GaussianBlurKernel_t() : sigma(0), radius(0), levels(0), weights(), tapOffsets(), tapWeights() {}
+};
+
+
+//
+// kernel cache for the blur filter, and cpu reference of what the gpu passes compute.
+// reference images are rgba float rows, edges clamp like the texture fetches.
+//
+class GaussianBlurKernelCache {
+public:
+	GaussianBlurKernelCache();
+
+	const GaussianBlurKernel_t& getKernel(float sigma, int kernelSize, bool isPyramid);
+
+	inline size_t numCached() const {
+		return m_kernels.size();
+	}
+
+	static void buildKernel(float sigma, int kernelSize, bool isPyramid, GaussianBlurKernel_t& kernel);
+	static float gaussian(float sigma, int x);
+
+	// full gpu path: downsample chain, two paired tap passes, upsample chain
+	static void blurReference(const glm::vec4* src, glm::vec4* dst, size_t width, size_t height, const GaussianBlurKernel_t& kernel);
+
+	// ground truth, every discrete tap of the unpaired kernel at full resolution
+	static void blurExact(const glm::vec4* src, glm::vec4* dst, size_t width, size_t height, float sigma, int kernelSize);
+
+	// bilinear fetch at destination texel centers, halving size averages 2x2 blocks
+	static void resample(const glm::vec4* src, size_t srcWidth, size_t srcHeight, glm::vec4* dst, size_t dstWidth, size_t dstHeight);
+
+	// one paired tap pass along x (pass 0) or y (pass 1)
+	static void blurPass(const glm::vec4* src, glm::vec4* dst, size_t width, size_t height, const GaussianBlurKernel_t& kernel, int pass);
+
+	static inline size_t levelSize(size_t size, size_t level) {
+		return glm::max<size_t>(size >> level, 1);
+	}
+
+private:
+	typedef std::tuple<float, int, bool> Key;
+	std::map<Key, GaussianBlurKernel_t> m_kernels;
+};
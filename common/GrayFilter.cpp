@@ -1,6 +1,6 @@
 #include"GrayFilter.h"
 #include"Renderer.h"
-#include"ShaderProgamMgr.h"
+#include"PostProcessingManager.h"
 
 const static char* sGrayFilterName = "Gray";
 
@@ -19,8 +19,7 @@ void GrayFilterComponent::render(RenderContext* context) {
 
 const std::string GrayFilter::sName = sGrayFilterName;
 
-GrayFilter::GrayFilter(PostProcessingManager* mgr) : IFilter(sGrayFilterName, mgr)
-, m_outputTarget(mgr->getRenderer()->getRenderSize()) {
+GrayFilter::GrayFilter(PostProcessingManager* mgr) : IFilter(sGrayFilterName, mgr) {
 
 }
 
@@ -29,25 +28,5 @@ void GrayFilter::apply(Texture* inputFrame, Texture* outputFrame, const FilterPa
 	if (!inputFrame || !outputFrame)
 		return;
 
-	auto shader_weak = ShaderProgramManager::getInstance()->getProgram("Gray");
-	if (shader_weak.expired())
-		shader_weak = ShaderProgramManager::getInstance()->addProgram("Gray");
-
-	ASSERT(!shader_weak.expired());
-	
-	auto shader = shader_weak.lock();
-	m_manager->getRenderer()->pushShaderProgram(shader.get());
-
-	m_outputTarget.detachAllTexture();
-	m_outputTarget.attachProxyTexture(outputFrame, RenderTarget::Slot::Color);
-	m_manager->getRenderer()->pushRenderTarget(&m_outputTarget);
-
-	inputFrame->bindToTextureUnit(Texture::Unit::Defualt, Texture::Target::Texture_2D);
-	shader->setUniform1("u_Texture", int(Texture::Unit::Defualt));
-
-	m_manager->getRenderer()->drawFullScreenQuad();
-	
-	inputFrame->unbindFromTextureUnit();
-	m_manager->getRenderer()->popRenderTarget();
-	m_manager->getRenderer()->popShadrProgram();
-}
\ No newline at end of file
+	m_manager->applyPointwise(this, inputFrame, outputFrame, params);
+}
@@ -1,6 +1,5 @@
 #pragma once
 #include"IFilter.h"
-#include"RenderTarget.h"
 
 
 class GrayFilterComponent : public FilterComponent {
@@ -25,6 +24,5 @@ public:
 
 	void apply(Texture* inputFrame, Texture* outputFrame, const FilterParamGroup* params) override;
 
-protected:
-	RenderTarget m_outputTarget;
+	const char* getPointwiseSource() const override { return "GrayPointwise.glsl"; }
 };
\ No newline at end of file
@@ -2,18 +2,23 @@
 #include"RendererCore.h"
 #include"Renderer.h"
 #include"ShaderProgamMgr.h"
+#include"Profiler.h"
 
 
 static const char* sHDRFilterName = "HDR";
 static const char* sExposureParamName = "Exposure";
 static const char* sWhiteParamName = "White";
+static const char* sAdaptationRateParamName = "AdaptationRate";
+static const char* sTelemetryParamName = "Telemetry";
 
 RTTI_IMPLEMENTATION(HDRFilterComponent)
 
 
 HDRFilterComponent::HDRFilterComponent() : FilterComponent(sHDRFilterName)
 , m_exposure(0.35f)
-, m_white(0.92f){
+, m_white(0.92f)
+, m_adaptationRate(1.5f)
+, m_isTelemetry(false) {
 
 }
 
@@ -21,6 +26,8 @@ HDRFilterComponent::HDRFilterComponent() : FilterComponent(sHDRFilterName)
 bool HDRFilterComponent::initialize() {
 	m_params.addParam<float>(sExposureParamName, m_exposure);
 	m_params.addParam<float>(sWhiteParamName, m_white);
+	m_params.addParam<float>(sAdaptationRateParamName, m_adaptationRate);
+	m_params.addParam<bool>(sTelemetryParamName, m_isTelemetry);
 
 	return true;
 }
@@ -34,6 +41,8 @@ Component* HDRFilterComponent::copy() const {
 void HDRFilterComponent::render(RenderContext* context) {
 	m_params.getParam<float>(sExposureParamName)->m_value = m_exposure;
 	m_params.getParam<float>(sWhiteParamName)->m_value = m_white;
+	m_params.getParam<float>(sAdaptationRateParamName)->m_value = m_adaptationRate;
+	m_params.getParam<bool>(sTelemetryParamName)->m_value = m_isTelemetry;
 	context->getRenderer()->submitPostProcessingFilter(this);
 }
 
@@ -43,23 +52,29 @@ void HDRFilterComponent::render(RenderContext* context) {
 const std::string HDRFilter::sName = sHDRFilterName;
 
 HDRFilter::HDRFilter(PostProcessingManager* mgr) :IFilter(sHDRFilterName, mgr)
-, m_outputTarget(mgr->getRenderer()->getRenderSize())
 , m_histBuffer()
-, m_aveLumTex()
-, m_atomicCounter() {
+, m_exposureBuffer()
+, m_readbacks()
+, m_readbackFences()
+, m_readbackFrame(0)
+, m_telemetry()
+, m_hasTelemetry(false)
+, m_lastApplyTime()
+, m_isFirstApply(true) {
 
 }
 
 
 HDRFilter::~HDRFilter() {
+	releaseReadbacks();
 	m_histBuffer.release();
-	m_aveLumTex.release();
+	m_exposureBuffer.release();
 }
 
 
 bool HDRFilter::initialize() {
 	m_histBuffer.bind(Buffer::Target::ShaderStorageBuffer);
-	if (!m_histBuffer.loadData(nullptr, sizeof(unsigned int) * 256, Buffer::Usage::DynamicDraw)) {
+	if (!m_histBuffer.loadData(nullptr, sizeof(unsigned int) * HDR_HISTOGRAM_BINS, Buffer::Usage::DynamicCopy)) {
 #ifdef _DEBUG
 		ASSERT(false);
 #endif // _DEBUG
@@ -67,13 +82,22 @@ bool HDRFilter::initialize() {
 	}
 	m_histBuffer.unbind();
 
-	m_atomicCounter.bind(Buffer::Target::AtomicCounterBuffer);
-	m_atomicCounter.loadData(nullptr, sizeof(unsigned int), Buffer::Usage::DynamicDraw);
-	m_atomicCounter.unbind();
+	// zero adapted luminance, first frame snaps to its own average
+	m_exposureBuffer.bind(Buffer::Target::ShaderStorageBuffer);
+	if (!m_exposureBuffer.loadData(nullptr, sizeof(HDRExposure_t), Buffer::Usage::DynamicCopy)) {
+#ifdef _DEBUG
+		ASSERT(false);
+#endif // _DEBUG
+		return false;
+	}
+	m_exposureBuffer.clearData();
+	m_exposureBuffer.unbind();
 
-	m_aveLumTex.bindToTextureUnit(Texture::Unit::Defualt, Texture::Target::Texture_2D);
-	m_aveLumTex.allocStorage2D(Texture::Format::R16F, 1, 1);
-	m_aveLumTex.unbindFromTextureUnit();
+	for (auto& readback : m_readbacks) {
+		readback.bind(Buffer::Target::CopyWriteBuffer);
+		readback.loadData(nullptr, sizeof(HDRExposure_t), Buffer::Usage::StreamRead);
+		readback.unbind();
+	}
 
 	return true;
 }
@@ -83,85 +107,137 @@ void HDRFilter::apply(Texture* inputFrame, Texture* outputFrame, const FilterPar
 	if (!inputFrame || !outputFrame || !params)
 		return;
 
-	// calculate  histogram
+	m_manager->applyPointwise(this, inputFrame, outputFrame, params);
+}
+
+
+void HDRFilter::prepare(Texture* inputFrame, const FilterParamGroup* params) {
+	if (!inputFrame || !params)
+		return;
+
+	auto renderer = m_manager->getRenderer();
+	float deltaTime = frameDeltaTime();
+	glm::vec2 logLumRange(HDR_MIN_LOG_LUMINANCE, 1.f / (HDR_MAX_LOG_LUMINANCE - HDR_MIN_LOG_LUMINANCE));
+
+	// calculate histogram of downsampled input
 	auto shader = ShaderProgramManager::getInstance()->getProgram("HDRHistogram");
 	if (shader.expired()) {
 		shader = ShaderProgramManager::getInstance()->addProgram("HDRHistogram");
 		ASSERT(!shader.expired())
 	}
 	auto histShader = shader.lock();
-	m_manager->getRenderer()->pushShaderProgram(histShader.get());
+	renderer->pushShaderProgram(histShader.get());
 
+	m_histBuffer.bind(Buffer::Target::ShaderStorageBuffer);
+	m_histBuffer.clearData();
 	m_histBuffer.bindBase(Buffer::Target::ShaderStorageBuffer, 0);
-	m_atomicCounter.bindBase(Buffer::Target::AtomicCounterBuffer, 0);
 
-	auto bufferData = (unsigned int*)m_histBuffer.map(Buffer::MapAccess::Write);
-	memset(bufferData, 0, sizeof(unsigned int) * 256);
-	m_histBuffer.unmap();
-
-	bufferData = (unsigned int*)m_atomicCounter.map(Buffer::MapAccess::Write);
-	*bufferData = 0;
-	m_atomicCounter.unmap();
-
-	inputFrame->bindToImageUnit(0, Texture::Format::RGBA16F, Texture::Access::Read);
-
-	histShader->setUniform1("u_InputImage", 0);
+	inputFrame->bindToTextureUnit(Texture::Unit::Defualt);
+	histShader->setUniform1("u_InputTexture", int(Texture::Unit::Defualt));
+	histShader->setUniform2("u_LogLumRange", logLumRange.x, logLumRange.y);
 	histShader->bindShaderStorageBlock("Hist", 0);
 
-	auto renderSz = m_manager->getRenderer()->getRenderSize();
-	m_manager->getRenderer()->dispatchCompute(glm::ceil(renderSz.x / 16), glm::ceil(renderSz.y / 16));
+	glm::ivec2 histSize = (glm::ivec2(renderer->getRenderSize()) + HDR_HISTOGRAM_DOWNSAMPLE - 1) / HDR_HISTOGRAM_DOWNSAMPLE;
+	renderer->dispatchCompute((histSize.x + 15) / 16, (histSize.y + 15) / 16);
+	GLCALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
 
-	unsigned numPix = (*(unsigned int*)m_atomicCounter.map(Buffer::MapAccess::Read));
-	m_atomicCounter.unmap();
-	m_atomicCounter.unbind();
-	inputFrame->unbindFromImageUnit();
-	m_manager->getRenderer()->popShadrProgram();
+	inputFrame->unbindFromTextureUnit();
+	renderer->popShadrProgram();
 
-	// calculate average log luminance
+	// reduce histogram to average log luminance & adapt toward it
 	shader = ShaderProgramManager::getInstance()->getProgram("HDRAveLogLuminance");
 	if (shader.expired()) {
 		shader = ShaderProgramManager::getInstance()->addProgram("HDRAveLogLuminance");
 		ASSERT(!shader.expired());
 	}
 	auto aveLumShader = shader.lock();
-	m_manager->getRenderer()->pushShaderProgram(aveLumShader.get());
-	
-	m_aveLumTex.bindToImageUnit(0, Texture::Format::R16F, Texture::Access::ReadWrite);
+	renderer->pushShaderProgram(aveLumShader.get());
 
-	aveLumShader->setUniform1("u_OutAveLum", 0);
+	m_exposureBuffer.bindBase(Buffer::Target::ShaderStorageBuffer, 1);
 	aveLumShader->bindShaderStorageBlock("Hist", 0);
-	aveLumShader->setUniform1("u_NumPixel", numPix);
+	aveLumShader->bindShaderStorageBlock("Exposure", 1);
+	aveLumShader->setUniform2("u_LogLumRange", logLumRange.x, logLumRange.y);
+	aveLumShader->setUniform1("u_DeltaTime", deltaTime);
+	aveLumShader->setUniform1("u_AdaptationRate", params->getParam<float>(sAdaptationRateParamName)->m_value);
 
-	m_manager->getRenderer()->dispatchCompute(256);
+	renderer->dispatchCompute(1);
+	GLCALL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT));
 
 	m_histBuffer.unbind();
-	m_aveLumTex.unbindFromImageUnit();
-	m_manager->getRenderer()->popShadrProgram();
-	
-	m_outputTarget.detachAllTexture();
-	m_outputTarget.attachProxyTexture(outputFrame, RenderTarget::Slot::Color);
-	m_manager->getRenderer()->pushRenderTarget(&m_outputTarget);
-	m_manager->getRenderer()->clearScreen(ClearFlags::Color);
-
-	shader = ShaderProgramManager::getInstance()->getProgram("HDR");
-	if (shader.expired()) {
-		shader = ShaderProgramManager::getInstance()->addProgram("HDR");
-		ASSERT(!shader.expired());
+	m_exposureBuffer.unbind();
+	renderer->popShadrProgram();
+
+	if (params->getParam<bool>(sTelemetryParamName)->m_value)
+		readTelemetry();
+}
+
+
+void HDRFilter::setPointwiseUniforms(ShaderProgram* shader, const std::string& stage, const FilterParamGroup* params) {
+	m_exposureBuffer.bindBase(Buffer::Target::ShaderStorageBuffer, 1);
+	shader->bindShaderStorageBlock(stage + "Exposure", 1);
+	shader->setUniform1(stage + "exposureScale", params->getParam<float>(sExposureParamName)->m_value);
+	shader->setUniform1(stage + "white", params->getParam<float>(sWhiteParamName)->m_value);
+}
+
+
+float HDRFilter::frameDeltaTime() {
+	auto now = std::chrono::steady_clock::now();
+	float deltaTime = m_isFirstApply ? 0.f : std::chrono::duration<float>(now - m_lastApplyTime).count();
+	m_lastApplyTime = now;
+	m_isFirstApply = false;
+
+	// long hitch would jump straight to new exposure
+	return MIN(deltaTime, 0.1f);
+}
+
+
+void HDRFilter::readTelemetry() {
+	// slot written HDR_TELEMETRY_LATENCY frames ago, read it only if gpu is done, never wait
+	GLsync& fence = m_readbackFences[m_readbackFrame];
+	Buffer& readback = m_readbacks[m_readbackFrame];
+	if (fence) {
+		GLCALL(GLenum result = glClientWaitSync(fence, 0, 0));
+		if (result == GL_TIMEOUT_EXPIRED)
+			return;
+
+		GLCALL(glDeleteSync(fence));
+		fence = nullptr;
+
+		if (result != GL_WAIT_FAILED) {
+			readback.bind(Buffer::Target::CopyReadBuffer);
+			auto exposure = (const HDRExposure_t*)readback.mapRange(Buffer::MapBitFiled::Read_Bit, 0, sizeof(HDRExposure_t));
+			if (exposure) {
+				m_telemetry = *exposure;
+				m_hasTelemetry = true;
+			}
+			readback.unmap();
+			readback.unbind();
+
+			auto profiler = Profiler::getInstance();
+			profiler->addCounter("HDR::averageLuminance", m_telemetry.averageLuminance);
+			profiler->addCounter("HDR::adaptedLuminance", m_telemetry.adaptedLuminance);
+		}
 	}
 
-	auto hdrShader = shader.lock();
-	m_manager->getRenderer()->pushShaderProgram(hdrShader.get());
+	m_exposureBuffer.bind(Buffer::Target::CopyReadBuffer);
+	readback.bind(Buffer::Target::CopyWriteBuffer);
+	GLCALL(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(HDRExposure_t)));
+	readback.unbind();
+	m_exposureBuffer.unbind();
+	GLCALL(fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
 
-	m_aveLumTex.bindToTextureUnit(Texture::Unit::Defualt);
-	inputFrame->bindToTextureUnit(Texture::Unit::DiffuseMap);
-	hdrShader->setUniform1("u_aveLumTexture", int(Texture::Unit::Defualt));
-	hdrShader->setUniform1("u_hdrTexture", int(Texture::Unit::DiffuseMap));
-	hdrShader->setUniform1("u_exposure", params->getParam<float>(sExposureParamName)->m_value);
-	hdrShader->setUniform1("u_white", params->getParam<float>(sWhiteParamName)->m_value);
+	m_readbackFrame = (m_readbackFrame + 1) % HDR_TELEMETRY_LATENCY;
+}
 
-	m_manager->getRenderer()->drawFullScreenQuad();
 
-	inputFrame->unbindFromTextureUnit();
-	m_manager->getRenderer()->popShadrProgram();
-	m_manager->getRenderer()->popRenderTarget();
+void HDRFilter::releaseReadbacks() {
+	for (auto& fence : m_readbackFences) {
+		if (fence) {
+			GLCALL(glDeleteSync(fence));
+			fence = nullptr;
+		}
+	}
+
+	for (auto& readback : m_readbacks)
+		readback.release();
 }
@@ -1,8 +1,22 @@
 #pragma once
 #include"IFilter.h"
-#include"RenderTarget.h"
 #include"Buffer.h"
 #include"Texture.h"
+#include<chrono>
+
+
+#define HDR_HISTOGRAM_BINS 256
+
+// histogram takes one sample per 4x4 block of input, matches DOWNSAMPLE in HDRHistogram.shader
+#define HDR_HISTOGRAM_DOWNSAMPLE 4
+
+// log2 luminance range mapped onto bins, darker goes to bin 0 which is left out of average
+#define HDR_MIN_LOG_LUMINANCE -10.f
+#define HDR_MAX_LOG_LUMINANCE 2.f
+
+// frames exposure telemetry trails behind gpu
+#define HDR_TELEMETRY_LATENCY 3
+
 
 class HDRFilterComponent: public FilterComponent {
 	RTTI_DECLARATION(HDRFilterComponent)
@@ -20,26 +34,70 @@ public:
 public:
 	float m_exposure;
 	float m_white;
+	float m_adaptationRate; // per second, higher adapts faster
+	bool m_isTelemetry; // read exposure back to profiler counters, few frames late
 };
 
 
 
+// layout of exposure block in shaders (std430)
+struct HDRExposure_t {
+	float averageLuminance; // this frame
+	float adaptedLuminance; // what tone mapping uses
+	uint32_t numPixels; // histogram samples above black
+	uint32_t reserved;
+};
+
+
+
+//
+// auto exposure stays on gpu: histogram of downsampled input, reduction to average log luminance
+// and temporal adaptation all run in compute, result lives in a storage buffer tone mapping reads.
+// cpu never maps a buffer the gpu is still writing, telemetry goes through fenced copies read a few frames later.
+//
 class HDRFilter : public IFilter {
 	typedef glm::vec3 Piexl;
 
 public:
 	HDRFilter(PostProcessingManager* mgr);
 	~HDRFilter();
-	
+
 	static const std::string sName;
 
 	bool initialize() override;
 
 	void apply(Texture* inputFrame, Texture* outputFrame, const FilterParamGroup* params) override;
 
+	// exposure runs on the input, tone mapping is a pointwise stage
+	const char* getPointwiseSource() const override { return "HDRPointwise.glsl"; }
+
+	void setPointwiseUniforms(ShaderProgram* shader, const std::string& stage, const FilterParamGroup* params) override;
+
+	bool needsPrepare() const override { return true; }
+
+	void prepare(Texture* inputFrame, const FilterParamGroup* params) override;
+
+	// last exposure read back, false before the first readback completed
+	inline bool getTelemetry(HDRExposure_t& exposure) const {
+		exposure = m_telemetry;
+		return m_hasTelemetry;
+	}
+
+protected:
+	float frameDeltaTime();
+	void readTelemetry();
+	void releaseReadbacks();
+
 protected:
-	RenderTarget m_outputTarget;
 	Buffer m_histBuffer;
-	Buffer m_atomicCounter;
-	Texture m_aveLumTex;
-};
\ No newline at end of file
+	Buffer m_exposureBuffer;
+
+	Buffer m_readbacks[HDR_TELEMETRY_LATENCY];
+	GLsync m_readbackFences[HDR_TELEMETRY_LATENCY];
+	size_t m_readbackFrame;
+	HDRExposure_t m_telemetry;
+	bool m_hasTelemetry;
+
+	std::chrono::steady_clock::time_point m_lastApplyTime;
+	bool m_isFirstApply;
+};
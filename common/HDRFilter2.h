@@ -1,6 +1,5 @@
 #pragma once
 #include"IFilter.h"
-#include"RenderTarget.h"
 
 
 class HDRFilterComponent2 : public FilterComponent {
@@ -40,8 +39,9 @@ public:
 
 	void apply(Texture* inputFrame, Texture* outputFrame, const FilterParamGroup* params) override;
 
-protected:
-	RenderTarget m_outputTarget;
+	const char* getPointwiseSource() const override { return "HDR2Pointwise.glsl"; }
+
+	void setPointwiseUniforms(ShaderProgram* shader, const std::string& stage, const FilterParamGroup* params) override;
 };
 
 
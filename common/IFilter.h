@@ -29,6 +29,7 @@ protected:
 
 class Texture;
 class Renderer;
+class ShaderProgram;
 class PostProcessingManager;
 
 // base filter class for rendering
@@ -45,6 +46,28 @@ public:
 
 	virtual void onRenderSizeChange(float w, float h) {};
 
+	//
+	// pointwise filters map every pixel on its own, adjacent ones are fused into one generated pass.
+	// stage source is a glsl file in shader directory defining "vec4 STAGE_apply(vec4 color)",
+	// every uniform & block name starts with STAGE_, which is replaced by a prefix unique in the fused pass
+	//
+	virtual const char* getPointwiseSource() const { return nullptr; }
+
+	virtual void setPointwiseUniforms(ShaderProgram* shader, const std::string& stage, const FilterParamGroup* params) {}
+
+	// work on the input frame before a pointwise stage (e.g. reductions), stage is then first of its fused pass
+	virtual bool needsPrepare() const { return false; }
+
+	virtual void prepare(Texture* inputFrame, const FilterParamGroup* params) {}
+
+	inline bool isPointwise() const {
+		return getPointwiseSource() != nullptr;
+	}
+
+	inline const std::string& getName() const {
+		return m_name;
+	}
+
 protected:
 	PostProcessingManager* m_manager;
 	const std::string m_name;
@@ -4,12 +4,20 @@
 
 IMesh::IMesh() :m_name()
 , m_indices()
+, m_mappedFile()
+, m_mappedIndices(nullptr)
+, m_numMappedIndex(0)
 , m_primitiveType(PrimitiveType::Unknown)
 , m_transform(1.f)
+, m_bounds()
 , m_vao()
 , m_vbo()
-, m_ibo() {
+, m_ibo()
+, m_sharedVAO(nullptr)
+, m_vertexRange()
+, m_indexRange() {
 	m_id = reinterpret_cast<ID>(this);
+	m_bounds.reset();
 }
 
 
@@ -21,11 +29,18 @@ IMesh::~IMesh() {
 void IMesh::release() {
 	m_name.clear();
 	m_indices.clear();
+	m_mappedFile.reset();
+	m_mappedIndices = nullptr;
+	m_numMappedIndex = 0;
 	m_primitiveType = PrimitiveType::Unknown;
 	m_transform = glm::mat4(1.f);
+	m_bounds.reset();
 	m_vbo.release();
 	m_ibo.release();
 	m_vao.release();
+	m_sharedVAO = nullptr;
+	m_vertexRange = MeshBufferRange_t();
+	m_indexRange = MeshBufferRange_t();
 }
 
 
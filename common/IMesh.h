@@ -1,10 +1,12 @@
 #pragma once
 #include"Util.h"
 #include"RendererCore.h"
+#include"MeshBufferPool.h"
 #include<memory>
 
 class Buffer;
 class VertexArray;
+class MappedFile;
 
 class IMesh {
 public:
@@ -13,21 +15,39 @@ public:
 
 	virtual size_t verticesCount() const = 0;
 	virtual void release();
+	virtual void upload() {} // create gpu resources of a mesh filled without them, main thread only
 
 	inline ID id() const {
 		return m_id;
 	}
 
 	inline size_t indicesCount() const {
-		return m_indices.size();
+		return m_indices.empty() ? m_numMappedIndex : m_indices.size();
 	}
 
 	inline const std::vector<Index_t>& getIndices() const {
 		return m_indices;
 	}
 
+	inline bool isUploaded() const {
+		return vertexArray() != nullptr;
+	}
+
 	inline VertexArray* vertexArray() const {
-		return m_vao.get();
+		return m_vao ? m_vao.get() : m_sharedVAO;
+	}
+
+	// mesh lives in mesh manager's shared buffers, draws start at these offsets of the shared vao
+	inline bool isShared() const {
+		return m_sharedVAO != nullptr;
+	}
+
+	inline size_t getVertexOffset() const {
+		return m_vertexRange.offset;
+	}
+
+	inline size_t getIndexOffset() const {
+		return m_indexRange.offset;
 	}
 
 	inline void setName(const std::string& name) {
@@ -54,6 +74,10 @@ public:
 		return m_transform;
 	}
 
+	inline const AABB_t& getBounds() const {
+		return m_bounds;
+	}
+
 
 protected:
 	ID m_id;
@@ -61,12 +85,22 @@ protected:
 
 	PrimitiveType m_primitiveType;
 	glm::mat4 m_transform; // transform mesh from reletive to parent to reletive to model space
+	AABB_t m_bounds; // local space, computed on fill
 
 	std::vector<Index_t> m_indices; // cpu data
 
+	// cpu data of a mesh read from a cooked file stays in the mapping until upload, counts are kept after
+	std::shared_ptr<const MappedFile> m_mappedFile;
+	const Index_t* m_mappedIndices;
+	size_t m_numMappedIndex;
+
 	std::unique_ptr<Buffer> m_vbo; // gpu data
 	std::unique_ptr<Buffer> m_ibo;
 	std::unique_ptr<VertexArray> m_vao;
+
+	VertexArray* m_sharedVAO; // gpu data in shared buffers
+	MeshBufferRange_t m_vertexRange;
+	MeshBufferRange_t m_indexRange;
 };
 
 
@@ -0,0 +1,262 @@
+#include"JobSystem.h"
+#include<algorithm>
+
+
+// upper bound of chunks per worker in parallelFor, more chunks balance better but cost more pushes
+#define MAX_CHUNKS_PER_WORKER 4
+
+
+// index of the queue owned by current thread, threads not spawned by the job system share queue 0
+static thread_local size_t s_workerIndex = 0;
+
+
+JobSystem::JobSystem() :m_queues()
+, m_threads()
+, m_mainThreadId(std::this_thread::get_id())
+, m_numPendingJobs(0)
+, m_isQuit(false)
+, m_sleepMutex()
+, m_wakeCondition()
+, m_mainThreadMutex()
+, m_mainThreadJobs() {
+
+}
+
+
+JobSystem::~JobSystem() {
+	shutdown();
+}
+
+
+void JobSystem::initialize(size_t numWorkers) {
+	shutdown();
+
+	m_mainThreadId = std::this_thread::get_id();
+	s_workerIndex = 0;
+	m_isQuit = false;
+
+	for (size_t i = 0; i < numWorkers + 1; i++)
+		m_queues.push_back(std::make_unique<WorkerQueue>());
+
+	for (size_t i = 1; i < numWorkers + 1; i++)
+		m_threads.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+
+void JobSystem::shutdown() {
+	if (m_threads.empty()) {
+		m_queues.clear();
+		return;
+	}
+
+	// finish what is left, nobody will wait on it otherwise
+	while (tryRunOne());
+
+	m_isQuit = true;
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_wakeCondition.notify_all();
+
+	for (auto& t : m_threads)
+		t.join();
+
+	m_threads.clear();
+	m_queues.clear();
+	m_numPendingJobs = 0;
+}
+
+
+void JobSystem::run(std::function<void()> func, JobCounter* counter) {
+	if (counter)
+		counter->m_count.fetch_add(1, std::memory_order_relaxed);
+
+	Job job(std::move(func), counter);
+	if (m_threads.empty()) {
+		execute(job);
+		return;
+	}
+
+	push(std::move(job));
+}
+
+
+void JobSystem::runAfter(JobCounter* dependency, std::function<void()> func, JobCounter* counter) {
+	if (counter)
+		counter->m_count.fetch_add(1, std::memory_order_relaxed);
+
+	Job job(std::move(func), counter);
+	{
+		std::lock_guard<std::mutex> lock(dependency->m_mutex);
+		if (!dependency->isDone()) {
+			dependency->m_continuations.push_back(std::move(job));
+			return;
+		}
+	}
+
+	if (m_threads.empty()) {
+		execute(job);
+	} else {
+		push(std::move(job));
+	}
+}
+
+
+void JobSystem::wait(JobCounter* counter) {
+	while (!counter->isDone()) {
+		if (!tryRunOne())
+			std::this_thread::yield();
+	}
+
+	// last finish() may still hold the mutex, counter must not die before it lets go
+	std::lock_guard<std::mutex> lock(counter->m_mutex);
+}
+
+
+void JobSystem::parallelFor(size_t count, size_t grain, const RangeFunc& func) {
+	if (count <= 0)
+		return;
+
+	grain = std::max<size_t>(grain, 1);
+	size_t numChunks = std::min((count + grain - 1) / grain, workerCount() * MAX_CHUNKS_PER_WORKER);
+	if (m_threads.empty() || numChunks <= 1) {
+		func(0, count);
+		return;
+	}
+
+	size_t chunkSize = (count + numChunks - 1) / numChunks;
+	JobCounter counter;
+	for (size_t begin = chunkSize; begin < count; begin += chunkSize) {
+		size_t end = std::min(begin + chunkSize, count);
+		run([&func, begin, end]() { func(begin, end); }, &counter);
+	}
+
+	func(0, std::min(chunkSize, count));
+	wait(&counter);
+}
+
+
+void JobSystem::runOnMainThread(std::function<void()> func) {
+	if (isMainThread()) {
+		func();
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+	m_mainThreadJobs.push_back(std::move(func));
+}
+
+
+void JobSystem::flushMainThreadJobs() {
+	if (!isMainThread())
+		return;
+
+	std::vector<std::function<void()>> jobs;
+	{
+		std::lock_guard<std::mutex> lock(m_mainThreadMutex);
+		jobs.swap(m_mainThreadJobs);
+	}
+
+	for (auto& job : jobs)
+		job();
+}
+
+
+void JobSystem::workerLoop(size_t workerIndex) {
+	s_workerIndex = workerIndex;
+	while (!m_isQuit) {
+		if (tryRunOne())
+			continue;
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wakeCondition.wait(lock, [this]() { return m_isQuit || m_numPendingJobs > 0; });
+	}
+}
+
+
+void JobSystem::push(Job&& job) {
+	WorkerQueue& queue = *m_queues[s_workerIndex];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	m_numPendingJobs++;
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+	}
+	m_wakeCondition.notify_one();
+}
+
+
+bool JobSystem::pop(Job& job) {
+	if (m_numPendingJobs <= 0)
+		return false;
+
+	// own queue lifo, keeps recently pushed data in cache
+	{
+		WorkerQueue& queue = *m_queues[s_workerIndex];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			m_numPendingJobs--;
+			return true;
+		}
+	}
+
+	// steal oldest job of others, it tends to be the biggest one
+	for (size_t i = 1; i < m_queues.size(); i++) {
+		WorkerQueue& victim = *m_queues[(s_workerIndex + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty()) {
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			m_numPendingJobs--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+bool JobSystem::tryRunOne() {
+	if (m_queues.empty())
+		return false;
+
+	Job job;
+	if (!pop(job))
+		return false;
+
+	execute(job);
+	return true;
+}
+
+
+void JobSystem::execute(Job& job) {
+	if (job.func)
+		job.func();
+	finish(job.counter);
+}
+
+
+void JobSystem::finish(JobCounter* counter) {
+	if (!counter)
+		return;
+
+	std::vector<Job> released;
+	{
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		if (counter->m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			released.swap(counter->m_continuations);
+	}
+
+	for (auto& job : released) {
+		if (m_threads.empty()) {
+			execute(job);
+		} else {
+			push(std::move(job));
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include"Singleton.h"
+#include<atomic>
+#include<condition_variable>
+#include<deque>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+
+class JobCounter;
+
+struct Job {
+	std::function<void()> func;
+	JobCounter* counter; // decreased when func returns, may be null
+
+	Job() : func(), counter(nullptr) {}
+	Job(std::function<void()> f, JobCounter* c) : func(std::move(f)), counter(c) {}
+};
+
+
+//
+// number of unfinished jobs attached to it.
+// jobs scheduled with runAfter() are held by the counter and released when it drops to zero.
+// a counter can be reused once waited, it must outlive the jobs attached to it.
+//
+class JobCounter {
+	friend class JobSystem;
+
+public:
+	JobCounter() : m_count(0), m_mutex(), m_continuations() {}
+
+	JobCounter(const JobCounter& other) = delete;
+	JobCounter& operator = (const JobCounter& other) = delete;
+
+	inline bool isDone() const {
+		return m_count.load(std::memory_order_acquire) == 0;
+	}
+
+private:
+	std::atomic<int> m_count;
+	std::mutex m_mutex;
+	std::vector<Job> m_continuations;
+};
+
+
+//
+// work stealing job scheduler.
+// each worker owns a deque, it pushes & pops jobs at the back and steals from the front of others.
+// the thread calling initialize() is worker 0, it runs jobs while it waits on a counter.
+// without worker threads every job runs inline on the calling thread.
+// gl calls are only legal on main thread, jobs hand them over with runOnMainThread().
+//
+class JobSystem : public Singleton<JobSystem> {
+public:
+	typedef std::function<void(size_t begin, size_t end)> RangeFunc;
+
+public:
+	JobSystem();
+	~JobSystem();
+
+	void initialize(size_t numWorkers); // number of threads besides the main thread
+	void shutdown();
+
+	void run(std::function<void()> func, JobCounter* counter = nullptr);
+	void runAfter(JobCounter* dependency, std::function<void()> func, JobCounter* counter = nullptr);
+	void wait(JobCounter* counter); // run other jobs until counter drops to zero
+
+	// split [0, count) into chunks of at least 'grain' items and wait all of them
+	void parallelFor(size_t count, size_t grain, const RangeFunc& func);
+
+	// queue work for main thread, executed by flushMainThreadJobs()
+	void runOnMainThread(std::function<void()> func);
+	void flushMainThreadJobs();
+
+	inline size_t workerCount() const {
+		return m_threads.size() + 1; // main thread included
+	}
+
+	inline bool isMainThread() const {
+		return std::this_thread::get_id() == m_mainThreadId;
+	}
+
+protected:
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	void workerLoop(size_t workerIndex);
+	void push(Job&& job);
+	bool pop(Job& job);
+	bool tryRunOne();
+	void execute(Job& job);
+	void finish(JobCounter* counter);
+
+private:
+	std::vector<std::unique_ptr<WorkerQueue>> m_queues; // index 0 belongs to main thread
+	std::vector<std::thread> m_threads;
+	std::thread::id m_mainThreadId;
+
+	std::atomic<int> m_numPendingJobs;
+	std::atomic<bool> m_isQuit;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wakeCondition;
+
+	std::mutex m_mainThreadMutex;
+	std::vector<std::function<void()>> m_mainThreadJobs;
+};
@@ -75,7 +75,7 @@ bool KeyFrameTrack<T>::isValid() const {
 }
 
 template<typename T>
-T KeyFrameTrack<T>::sample(float t, LoopType loop) const	{
+T KeyFrameTrack<T>::sample(float t, LoopType loop, int* cursor) const	{
 	if (!isValid())
 		return T();
 
@@ -88,7 +88,7 @@ T KeyFrameTrack<T>::sample(float t, LoopType loop) const	{
 	int frameIdx = -1;
 	float weight = 0.f;
 	auto timeAndSign = ajustTimeToFitTrack(t, loop);
-	bool found = findMixFramesFromAjustedTime(timeAndSign.first * timeAndSign.second, frameIdx, weight);
+	bool found = findMixFramesFromAjustedTime(timeAndSign.first * timeAndSign.second, frameIdx, weight, cursor);
 
 	if (!found) {
 #ifdef _DEBUG
@@ -190,7 +190,7 @@ std::pair<float, int> KeyFrameTrack<T>::ajustTimeToFitTrack(float t, LoopType lo
 
 
 template<typename T>
-bool KeyFrameTrack<T>::findMixFramesFromAjustedTime(float time, int& frameIdx, float& mixWeight) const {
+bool KeyFrameTrack<T>::findMixFramesFromAjustedTime(float time, int& frameIdx, float& mixWeight, int* cursor) const {
 	bool backWard = time < 0;
 	time = fabs(time);
 
@@ -198,35 +198,29 @@ bool KeyFrameTrack<T>::findMixFramesFromAjustedTime(float time, int& frameIdx, f
 	mixWeight = 0.f;
 	
 	if (m_interpolationType == InterpolationType::Constant) {
-		for (int i = m_keyFrames.size() - 1; i >= 0; i--) {
-			if (m_keyFrames[i].m_time <= time) {
-				frameIdx = backWard ? i + 1 : i;
-				frameIdx = MIN(frameIdx, m_keyFrames.size() - 1);
-				mixWeight = 1.f;
-				return true;
-			}
+		int i = searchKeyFrame(int(m_keyFrames.size()), [&](int k) { return m_keyFrames[k].m_time <= time; }, cursor);
+		if (i >= 0) {
+			frameIdx = backWard ? i + 1 : i;
+			frameIdx = MIN(frameIdx, m_keyFrames.size() - 1);
+			mixWeight = 1.f;
+			return true;
 		}
 		
 		return false;
 	}
 
-	for (int i = m_keyFrames.size() - 1; i >= 0; i--) {
-		if (epslion_equal(m_keyFrames[i].m_time, time)) {
-			frameIdx = i;
-			mixWeight = 1.f;
-			break;
-
-		} else if (m_keyFrames[i].m_time < time) {
-			frameIdx = i;
-			break;
-		}
-	}
+	// last key before time, a key within epsilon of time is a hit
+	frameIdx = searchKeyFrame(int(m_keyFrames.size()), [&](int k) {
+		return m_keyFrames[k].m_time < time || epslion_equal(m_keyFrames[k].m_time, time);
+	}, cursor);
 
 	if (frameIdx < 0)
 		return false;
 	
-	if (mixWeight >= 1.f) // not need to mix
+	if (epslion_equal(m_keyFrames[frameIdx].m_time, time)) { // not need to mix
+		mixWeight = 1.f;
 		return true;
+	}
 
 	if (frameIdx >= m_keyFrames.size() - 1)
 		return false;
@@ -4,6 +4,50 @@
 #include<vector>
 
 
+// steps a cursor may walk forward before key search falls back to binary search
+#define MAX_KEY_CURSOR_STEPS 4
+
+
+// index of the last key for which 'isBefore' holds, -1 if none.
+// keys are sorted by time, so the predicate holds for a prefix of them.
+// cursor holds the result of previous search: when time moved forward a little
+// it is walked a few keys ahead, otherwise (jump back, loop wrap) binary search is used.
+template<typename Predicate>
+int searchKeyFrame(int numKeys, const Predicate& isBefore, int* cursor) {
+	int begin = 0;
+	int end = numKeys;
+	if (cursor && *cursor >= 0 && *cursor < numKeys) {
+		int hint = *cursor;
+		if (isBefore(hint)) {
+			for (int step = 0; step < MAX_KEY_CURSOR_STEPS && hint + 1 < numKeys && isBefore(hint + 1); step++)
+				hint++;
+
+			if (hint + 1 >= numKeys || !isBefore(hint + 1)) {
+				*cursor = hint;
+				return hint;
+			}
+			begin = hint + 2;
+		} else {
+			end = hint;
+		}
+	}
+
+	while (begin < end) {
+		int mid = (begin + end) / 2;
+		if (isBefore(mid)) {
+			begin = mid + 1;
+		} else {
+			end = mid;
+		}
+	}
+
+	if (cursor)
+		*cursor = begin - 1;
+
+	return begin - 1;
+}
+
+
 // track contain collection of key frames
 // and how to intepolate between them
 template<typename T>
@@ -26,7 +70,7 @@ public:
 	KeyFrameTrack& operator = (KeyFrameTrack&& rv);
 
 
-	T sample(float t, LoopType loop) const;
+	T sample(float t, LoopType loop, int* cursor = nullptr) const; // cursor keeps key search state between samples of one playback
 	
 	float getStartTime() const;
 	float getEndTime() const;
@@ -64,7 +108,7 @@ protected:
 	T sampleCubic(int frameIdx, float weight) const;
 
 	std::pair<float, int> ajustTimeToFitTrack(float t, LoopType loop) const;
-	bool findMixFramesFromAjustedTime(float time, int& frameIdx, float& mixWeight) const;
+	bool findMixFramesFromAjustedTime(float time, int& frameIdx, float& mixWeight, int* cursor) const;
 
 protected:
 	std::vector<KeyFrame<T>> m_keyFrames;
@@ -0,0 +1,231 @@
+#include"LightClusterBuilder.h"
+#include"JobSystem.h"
+#include"Util.h"
+#include<glm/gtc/constants.hpp>
+#include<cmath>
+
+
+// clip space w below this is treated as behind camera
+#define MIN_CLIP_W 1e-4f
+
+
+LightClusterBuilder::LightClusterBuilder() :m_viewMatrix(1.f)
+, m_projMatrix(0.f)
+, m_near(0.f)
+, m_far(0.f)
+, m_depthSliceParams(0.f)
+, m_lightIndexBase(0)
+, m_clusterBounds()
+, m_lightSpheres()
+, m_lightExtents()
+, m_clusterSlots()
+, m_clusterCounts()
+, m_lightRanges()
+, m_lightIndices() {
+
+}
+
+
+bool LightClusterBuilder::beginFrame(const glm::mat4& viewMatrix, const glm::mat4& projMatrix, float near, float far, uint32_t lightIndexBase) {
+	m_viewMatrix = viewMatrix;
+	m_lightIndexBase = lightIndexBase;
+	m_lightSpheres.clear();
+	m_lightExtents.clear();
+
+	if (!m_clusterBounds.empty() && projMatrix == m_projMatrix && near == m_near && far == m_far)
+		return false;
+
+	setupClusterBounds(projMatrix, near, far);
+	return true;
+}
+
+
+bool LightClusterBuilder::addLight(const Light_t& light) {
+	if (light.type != LightType::PointLight && light.type != LightType::SpotLight)
+		return false;
+
+	glm::vec4 bounds = lightBoundingSphere(light);
+	glm::vec4 sphere(glm::vec3(m_viewMatrix * glm::vec4(glm::vec3(bounds), 1.f)), bounds.w);
+	glm::ivec4 extentMin, extentMax;
+	calcLightExtent(sphere, extentMin, extentMax);
+	m_lightSpheres.push_back(sphere);
+	m_lightExtents.push_back(extentMin);
+	m_lightExtents.push_back(extentMax);
+
+	return true;
+}
+
+
+void LightClusterBuilder::build() {
+	size_t numCluster = numClusters();
+	m_clusterCounts.assign(numCluster, 0);
+	m_clusterSlots.resize(numCluster * MAX_LIGHTS_PER_CLUSTER);
+
+	// a slice is owned by one job, lights are visited in order so every list comes out sorted
+	JobSystem::getInstance()->parallelFor(CLUSTER_GRID_Z, 1, [this](size_t begin, size_t end) {
+		binSlices(begin, end);
+	});
+
+	m_lightRanges.resize(numCluster);
+	m_lightIndices.clear();
+	for (size_t i = 0; i < numCluster; i++) {
+		const uint32_t* slots = &m_clusterSlots[i * MAX_LIGHTS_PER_CLUSTER];
+		m_lightRanges[i] = glm::uvec2(m_lightIndices.size(), m_clusterCounts[i]);
+		m_lightIndices.insert(m_lightIndices.end(), slots, slots + m_clusterCounts[i]);
+	}
+}
+
+
+uint32_t LightClusterBuilder::clusterIndex(const glm::vec2& screenPos, float viewDepth) const {
+	int x = glm::clamp(int(screenPos.x * CLUSTER_GRID_X), 0, CLUSTER_GRID_X - 1);
+	int y = glm::clamp(int(screenPos.y * CLUSTER_GRID_Y), 0, CLUSTER_GRID_Y - 1);
+	int z = depthSlice(viewDepth);
+
+	return uint32_t((z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x);
+}
+
+
+glm::vec4 LightClusterBuilder::lightBoundingSphere(const Light_t& light) {
+	glm::vec3 center = light.position;
+	float radius = light.range;
+
+	if (light.type == LightType::SpotLight) {
+		// bounding sphere of the lit cone, range is distance from apex
+		float halfAngle = light.outterCone * 0.5f;
+		glm::vec3 axis = glm::normalize(light.direction);
+		if (halfAngle < glm::quarter_pi<float>()) {
+			radius = light.range / (2.f * cosf(halfAngle));
+			center = light.position + axis * radius;
+		} else if (halfAngle < glm::half_pi<float>()) {
+			center = light.position + axis * (cosf(halfAngle) * light.range);
+			radius = sinf(halfAngle) * light.range;
+		}
+	}
+
+	return glm::vec4(center, radius);
+}
+
+
+bool LightClusterBuilder::sphereIntersectAABB(const glm::vec4& sphere, const glm::vec4& aabbMin, const glm::vec4& aabbMax) {
+	glm::vec3 center(sphere);
+	glm::vec3 d = center - glm::clamp(center, glm::vec3(aabbMin), glm::vec3(aabbMax));
+	return glm::dot(d, d) <= sphere.w * sphere.w;
+}
+
+
+void LightClusterBuilder::setupClusterBounds(const glm::mat4& projMatrix, float near, float far) {
+	m_projMatrix = projMatrix;
+	m_near = near;
+	m_far = far;
+
+	float logRatio = logf(far / near);
+	m_depthSliceParams.x = CLUSTER_GRID_Z / logRatio;
+	m_depthSliceParams.y = -CLUSTER_GRID_Z * logf(near) / logRatio;
+
+	// view ray through every tile corner, as a point on near & far clip plane
+	glm::mat4 invProj = glm::inverse(projMatrix);
+	std::vector<glm::vec3> rayStarts((CLUSTER_GRID_X + 1) * (CLUSTER_GRID_Y + 1));
+	std::vector<glm::vec3> rayEnds(rayStarts.size());
+	for (int y = 0; y <= CLUSTER_GRID_Y; y++) {
+		for (int x = 0; x <= CLUSTER_GRID_X; x++) {
+			glm::vec2 ndc(float(x) / CLUSTER_GRID_X * 2.f - 1.f, float(y) / CLUSTER_GRID_Y * 2.f - 1.f);
+			glm::vec4 p0 = invProj * glm::vec4(ndc, -1.f, 1.f);
+			glm::vec4 p1 = invProj * glm::vec4(ndc, 1.f, 1.f);
+			rayStarts[y * (CLUSTER_GRID_X + 1) + x] = glm::vec3(p0) / p0.w;
+			rayEnds[y * (CLUSTER_GRID_X + 1) + x] = glm::vec3(p1) / p1.w;
+		}
+	}
+
+	// aabb of tile corners on slice's near & far depth
+	m_clusterBounds.resize(numClusters() * 2);
+	for (int z = 0; z < CLUSTER_GRID_Z; z++) {
+		float depths[2] = { near * powf(far / near, float(z) / CLUSTER_GRID_Z), near * powf(far / near, float(z + 1) / CLUSTER_GRID_Z) };
+		for (int y = 0; y < CLUSTER_GRID_Y; y++) {
+			for (int x = 0; x < CLUSTER_GRID_X; x++) {
+				AABB_t aabb;
+				aabb.reset();
+				for (int c = 0; c < 4; c++) {
+					size_t ray = (y + c / 2) * (CLUSTER_GRID_X + 1) + x + c % 2;
+					glm::vec3 start = rayStarts[ray];
+					glm::vec3 dir = rayEnds[ray] - start;
+					for (float depth : depths)
+						aabb.expand(start + dir * ((-depth - start.z) / dir.z));
+				}
+
+				size_t idx = (z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x;
+				m_clusterBounds[idx * 2] = glm::vec4(aabb.minimum, 0.f);
+				m_clusterBounds[idx * 2 + 1] = glm::vec4(aabb.maximum, 0.f);
+			}
+		}
+	}
+}
+
+
+int LightClusterBuilder::depthSlice(float viewDepth) const {
+	if (viewDepth <= m_near)
+		return 0;
+
+	int slice = int(floorf(logf(viewDepth) * m_depthSliceParams.x + m_depthSliceParams.y));
+	return glm::clamp(slice, 0, CLUSTER_GRID_Z - 1);
+}
+
+
+void LightClusterBuilder::calcLightExtent(const glm::vec4& sphere, glm::ivec4& extentMin, glm::ivec4& extentMax) const {
+	extentMin = glm::ivec4(0);
+	extentMax = glm::ivec4(CLUSTER_GRID_X - 1, CLUSTER_GRID_Y - 1, CLUSTER_GRID_Z - 1, 0);
+	float depth = -sphere.z;
+	float radius = sphere.w;
+
+	// completely in front of near or behind far plane, touches nothing
+	if (depth + radius < m_near || depth - radius > m_far) {
+		extentMin.z = CLUSTER_GRID_Z;
+		extentMax.z = -1;
+		return;
+	}
+
+	extentMin.z = depthSlice(depth - radius);
+	extentMax.z = depthSlice(depth + radius);
+
+	// screen rect of the sphere's view aabb, whole screen if any corner is behind camera
+	glm::vec2 ndcMin(1.f);
+	glm::vec2 ndcMax(-1.f);
+	for (int c = 0; c < 8; c++) {
+		glm::vec3 corner(sphere.x + (c & 1 ? radius : -radius), sphere.y + (c & 2 ? radius : -radius), sphere.z + (c & 4 ? radius : -radius));
+		glm::vec4 clip = m_projMatrix * glm::vec4(corner, 1.f);
+		if (clip.w < MIN_CLIP_W)
+			return;
+
+		glm::vec2 ndc = glm::vec2(clip) / clip.w;
+		ndcMin = glm::min(ndcMin, ndc);
+		ndcMax = glm::max(ndcMax, ndc);
+	}
+
+	extentMin.x = glm::clamp(int(floorf((ndcMin.x * 0.5f + 0.5f) * CLUSTER_GRID_X)), 0, CLUSTER_GRID_X - 1);
+	extentMax.x = glm::clamp(int(floorf((ndcMax.x * 0.5f + 0.5f) * CLUSTER_GRID_X)), 0, CLUSTER_GRID_X - 1);
+	extentMin.y = glm::clamp(int(floorf((ndcMin.y * 0.5f + 0.5f) * CLUSTER_GRID_Y)), 0, CLUSTER_GRID_Y - 1);
+	extentMax.y = glm::clamp(int(floorf((ndcMax.y * 0.5f + 0.5f) * CLUSTER_GRID_Y)), 0, CLUSTER_GRID_Y - 1);
+}
+
+
+void LightClusterBuilder::binSlices(size_t beginZ, size_t endZ) {
+	for (int z = int(beginZ); z < int(endZ); z++) {
+		for (size_t l = 0; l < m_lightSpheres.size(); l++) {
+			const glm::ivec4& extentMin = m_lightExtents[l * 2];
+			const glm::ivec4& extentMax = m_lightExtents[l * 2 + 1];
+			if (z < extentMin.z || z > extentMax.z)
+				continue;
+
+			for (int y = extentMin.y; y <= extentMax.y; y++) {
+				for (int x = extentMin.x; x <= extentMax.x; x++) {
+					size_t idx = (z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x;
+					uint32_t& count = m_clusterCounts[idx];
+					if (count >= MAX_LIGHTS_PER_CLUSTER)
+						continue;
+
+					if (sphereIntersectAABB(m_lightSpheres[l], m_clusterBounds[idx * 2], m_clusterBounds[idx * 2 + 1]))
+						m_clusterSlots[idx * MAX_LIGHTS_PER_CLUSTER + count++] = m_lightIndexBase + uint32_t(l);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include"RendererCore.h"
+#include<glm/glm.hpp>
+#include<vector>
+#include<cstdint>
+
+
+// view space froxel grid, x/y split screen evenly, z split view depth exponentially
+#define CLUSTER_GRID_X 16
+#define CLUSTER_GRID_Y 9
+#define CLUSTER_GRID_Z 24
+
+// lights beyond this in one cluster are dropped, keeps index storage bounded for the gpu builder
+#define MAX_LIGHTS_PER_CLUSTER 128
+
+
+//
+// assign local (point/spot) lights to view space clusters.
+// each light is bounded by a view space sphere, a cluster takes every light whose cluster extent
+// (depth range & screen rect of the sphere) covers it and whose sphere touches its aabb.
+// result is a (offset, count) pair per cluster into one light index list, indices are in light order.
+// cluster bounds, light spheres & extents are exposed so a compute shader can run the same test on gpu,
+// build() is the cpu reference/fallback.
+//
+class LightClusterBuilder {
+public:
+	LightClusterBuilder();
+
+	// rebuild cluster bounds when projection changed, forget lights of last frame, return true if bounds changed.
+	// lightIndexBase is the index of first local light in the shading light buffer
+	bool beginFrame(const glm::mat4& viewMatrix, const glm::mat4& projMatrix, float near, float far, uint32_t lightIndexBase);
+	bool addLight(const Light_t& light); // point & spot light only
+	void build();
+
+	// cluster of a view space point, (x, y) in [0, 1] screen space
+	uint32_t clusterIndex(const glm::vec2& screenPos, float viewDepth) const;
+
+	inline size_t numClusters() const {
+		return CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+	}
+
+	inline size_t numLights() const {
+		return m_lightSpheres.size();
+	}
+
+	inline uint32_t getLightIndexBase() const {
+		return m_lightIndexBase;
+	}
+
+	// (scale, bias) turning log(view depth) into slice index
+	inline glm::vec2 getDepthSliceParams() const {
+		return m_depthSliceParams;
+	}
+
+	inline const std::vector<glm::uvec2>& getClusterLightRanges() const {
+		return m_lightRanges;
+	}
+
+	inline const std::vector<uint32_t>& getClusterLightIndices() const {
+		return m_lightIndices;
+	}
+
+	// (min, max) view space corners per cluster, w unused
+	inline const std::vector<glm::vec4>& getClusterBounds() const {
+		return m_clusterBounds;
+	}
+
+	// (xyz) view space center (w) radius per local light
+	inline const std::vector<glm::vec4>& getLightSpheres() const {
+		return m_lightSpheres;
+	}
+
+	// (min, max) cluster coordinates per local light, inclusive, only clusters in it are tested against the sphere
+	inline const std::vector<glm::ivec4>& getLightExtents() const {
+		return m_lightExtents;
+	}
+
+	// (xyz) world space center (w) radius bounding lit volume of a point/spot light
+	static glm::vec4 lightBoundingSphere(const Light_t& light);
+	static bool sphereIntersectAABB(const glm::vec4& sphere, const glm::vec4& aabbMin, const glm::vec4& aabbMax);
+
+protected:
+	void setupClusterBounds(const glm::mat4& projMatrix, float near, float far);
+	int depthSlice(float viewDepth) const;
+	void calcLightExtent(const glm::vec4& sphere, glm::ivec4& extentMin, glm::ivec4& extentMax) const;
+	void binSlices(size_t beginZ, size_t endZ);
+
+private:
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projMatrix;
+	float m_near;
+	float m_far;
+	glm::vec2 m_depthSliceParams;
+	uint32_t m_lightIndexBase;
+
+	std::vector<glm::vec4> m_clusterBounds;
+	std::vector<glm::vec4> m_lightSpheres;
+	std::vector<glm::ivec4> m_lightExtents;
+
+	// fixed capacity slots filled per slice, compacted into index list afterwards
+	std::vector<uint32_t> m_clusterSlots;
+	std::vector<uint32_t> m_clusterCounts;
+
+	std::vector<glm::uvec2> m_lightRanges;
+	std::vector<uint32_t> m_lightIndices;
+};
@@ -1,6 +1,7 @@
 #include"Mesh.h"
 #include"VertexArray.h"
 #include"Buffer.h"
+#include"MeshMgr.h"
 
 
 template TMesh<Vertex_t>;
@@ -9,7 +10,9 @@ template TMesh<SkinVertex_t>;
 
 template<typename Vertex>
 TMesh<Vertex>::TMesh() :IMesh()
-, m_vertics() {
+, m_vertics()
+, m_mappedVertices(nullptr)
+, m_numMappedVertex(0) {
 }
 
 template<typename Vertex>
@@ -17,6 +20,11 @@ TMesh<Vertex>::TMesh(TMesh<Vertex>&& other)noexcept : IMesh() {
 	*this = std::move(other);
 }
 
+template<typename Vertex>
+TMesh<Vertex>::~TMesh() {
+	releaseShared();
+}
+
 template<typename Vertex>
 TMesh<Vertex>& TMesh<Vertex>::operator = (TMesh<Vertex>&& other) noexcept {
 	if (&other == this)
@@ -25,50 +33,142 @@ TMesh<Vertex>& TMesh<Vertex>::operator = (TMesh<Vertex>&& other) noexcept {
 	m_name = std::move(other.m_name);
 	m_vertics = std::move(other.m_vertics);
 	m_indices = std::move(other.m_indices);
+	m_mappedFile = std::move(other.m_mappedFile);
+	m_mappedVertices = other.m_mappedVertices;
+	m_numMappedVertex = other.m_numMappedVertex;
+	m_mappedIndices = other.m_mappedIndices;
+	m_numMappedIndex = other.m_numMappedIndex;
+	other.m_mappedVertices = nullptr;
+	other.m_numMappedVertex = 0;
+	other.m_mappedIndices = nullptr;
+	other.m_numMappedIndex = 0;
 	m_primitiveType = other.m_primitiveType;
 	m_transform = std::move(other.m_transform);
+	m_bounds = other.m_bounds;
 	m_vbo = std::move(other.m_vbo);
 	m_ibo = std::move(other.m_ibo);
 	m_vao = std::move(other.m_vao);
+
+	releaseShared();
+	m_sharedVAO = other.m_sharedVAO;
+	m_vertexRange = other.m_vertexRange;
+	m_indexRange = other.m_indexRange;
+	other.m_sharedVAO = nullptr;
+	other.m_vertexRange = MeshBufferRange_t();
+	other.m_indexRange = MeshBufferRange_t();
 	
 	return *this;
 }
 
 template<typename Vertex>
-void TMesh<Vertex>::fill(const std::vector<Vertex>& vertices, const std::vector<Index_t>& indices) {
+void TMesh<Vertex>::fill(const std::vector<Vertex>& vertices, const std::vector<Index_t>& indices, bool upload) {
+	releaseMapped();
 	m_vertics = vertices;
 	m_indices = indices;
-	genGpuResources();
+	calcBounds();
+	if (upload)
+		genGpuResources();
 }
 
 
 template<typename Vertex>
-void TMesh<Vertex>::fill(std::vector<Vertex>&& vertices, std::vector<Index_t>&& indices) {
+void TMesh<Vertex>::fill(std::vector<Vertex>&& vertices, std::vector<Index_t>&& indices, bool upload) {
+	releaseMapped();
 	m_vertics = std::move(vertices);
 	m_indices = std::move(indices);
+	calcBounds();
+	if (upload)
+		genGpuResources();
+}
+
+
+template<typename Vertex>
+void TMesh<Vertex>::fillMapped(std::shared_ptr<const MappedFile> file, const Vertex* vertices, size_t numVertex, const Index_t* indices, size_t numIndex, const AABB_t& bounds) {
+	m_vertics.clear();
+	m_indices.clear();
+	m_mappedFile = file;
+	m_mappedVertices = vertices;
+	m_numMappedVertex = numVertex;
+	m_mappedIndices = indices;
+	m_numMappedIndex = numIndex;
+	m_bounds = bounds;
+}
+
+
+template<typename Vertex>
+void TMesh<Vertex>::upload() {
+	if (isUploaded() || verticesCount() == 0)
+		return;
+
 	genGpuResources();
+
+	// gl has its own copy now, unmap once every mesh of the file let go
+	m_mappedFile.reset();
+	m_mappedVertices = nullptr;
+	m_mappedIndices = nullptr;
+}
+
+
+template<typename Vertex>
+void TMesh<Vertex>::releaseMapped() {
+	m_mappedFile.reset();
+	m_mappedVertices = nullptr;
+	m_numMappedVertex = 0;
+	m_mappedIndices = nullptr;
+	m_numMappedIndex = 0;
+}
+
+
+template<typename Vertex>
+void TMesh<Vertex>::calcBounds() {
+	m_bounds.reset();
+	for (auto& v : m_vertics)
+		m_bounds.expand(v.position);
 }
 
 
 template<typename Vertex>
 void TMesh<Vertex>::release() {
+	releaseShared();
 	m_vertics.clear();
+	m_mappedVertices = nullptr;
+	m_numMappedVertex = 0;
 	__super::release();
 }
 
 
-template<>
-void TMesh<Vertex_t>::genGpuResources() {
-#ifdef _DEBUG
-	ASSERT(m_vertics.size() > 0);
-#endif // _DEBUG
+template<typename Vertex>
+bool TMesh<Vertex>::allocateShared(const VertexLayoutDescription& layout) {
+	releaseShared();
 
-	m_vao = std::make_unique<VertexArray>();
-	m_vbo = std::make_unique<Buffer>(m_vertics.data(), sizeof(Vertex_t) * m_vertics.size(), Buffer::Target::VertexBuffer, Buffer::Usage::StaticDraw, m_vertics.size());
-	if (m_indices.size() > 0) {
-		m_ibo = std::make_unique<Buffer>(m_indices.data(), sizeof(Index_t) * m_indices.size(), Buffer::Target::IndexBuffer, Buffer::Usage::StaticDraw, m_indices.size());
-	}
+	// only indexed meshes are pooled, draws from shared buffers go by base vertex & first index
+	MeshBufferPool* pool = MeshManager::getInstance()->getBufferPool();
+	if (!pool->allocate(bufferFormat(), layout, vertexData(), verticesCount(), indexData(), indicesCount(), m_vertexRange, m_indexRange))
+		return false;
 
+	m_sharedVAO = pool->vertexArray(bufferFormat());
+	m_vao.reset(nullptr);
+	m_vbo.reset(nullptr);
+	m_ibo.reset(nullptr);
+
+	return true;
+}
+
+
+template<typename Vertex>
+void TMesh<Vertex>::releaseShared() {
+	if (!m_sharedVAO)
+		return;
+
+	MeshManager::getInstance()->getBufferPool()->free(bufferFormat(), m_vertexRange, m_indexRange);
+	m_sharedVAO = nullptr;
+	m_vertexRange = MeshBufferRange_t();
+	m_indexRange = MeshBufferRange_t();
+}
+
+
+template<>
+VertexLayoutDescription TMesh<Vertex_t>::vertexLayout() {
 	VertexLayoutDescription layoutDesc;
 	layoutDesc.setStride(sizeof(Vertex_t));
 	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 3, 0); // position
@@ -76,6 +176,53 @@ void TMesh<Vertex_t>::genGpuResources() {
 	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 3, 2); // tangent
 	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 2, 3); // uv
 
+	return layoutDesc;
+}
+
+
+template<>
+VertexLayoutDescription TMesh<SkinVertex_t>::vertexLayout() {
+	VertexLayoutDescription layoutDesc;
+	layoutDesc.setStride(sizeof(SkinVertex_t));
+	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::INT, 4, 4, sizeof(GLint)*4); // joints
+	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 4, 5, sizeof(GLfloat)*4); // weights
+	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 3, 0, sizeof(GLfloat)*3); // position
+	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 3, 1, sizeof(GLfloat)*3); // normal
+	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 3, 2, sizeof(GLfloat)*3); // tangent
+	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 2, 3); // uv
+
+	return layoutDesc;
+}
+
+
+template<>
+MeshBufferPool::VertexFormat TMesh<Vertex_t>::bufferFormat() {
+	return MeshBufferPool::VertexFormat::Static;
+}
+
+
+template<>
+MeshBufferPool::VertexFormat TMesh<SkinVertex_t>::bufferFormat() {
+	return MeshBufferPool::VertexFormat::Skinned;
+}
+
+
+template<>
+void TMesh<Vertex_t>::genGpuResources() {
+#ifdef _DEBUG
+	ASSERT(verticesCount() > 0);
+#endif // _DEBUG
+
+	VertexLayoutDescription layoutDesc = vertexLayout();
+	if (indicesCount() > 0 && allocateShared(layoutDesc))
+		return;
+
+	m_vao = std::make_unique<VertexArray>();
+	m_vbo = std::make_unique<Buffer>(vertexData(), sizeof(Vertex_t) * verticesCount(), Buffer::Target::VertexBuffer, Buffer::Usage::StaticDraw, verticesCount());
+	if (indicesCount() > 0) {
+		m_ibo = std::make_unique<Buffer>(indexData(), sizeof(Index_t) * indicesCount(), Buffer::Target::IndexBuffer, Buffer::Usage::StaticDraw, indicesCount());
+	}
+
 	m_vao->bind();
 	m_vbo->bind(Buffer::Target::VertexBuffer);
 	if (m_ibo)
@@ -91,25 +238,19 @@ void TMesh<Vertex_t>::genGpuResources() {
 template<>
 void TMesh<SkinVertex_t>::genGpuResources() {
 #ifdef _DEBUG
-	ASSERT(m_vertics.size() > 0);
+	ASSERT(verticesCount() > 0);
 #endif // _DEBUG
 
+	VertexLayoutDescription layoutDesc = vertexLayout();
+	if (indicesCount() > 0 && allocateShared(layoutDesc))
+		return;
+
 	m_vao = std::make_unique<VertexArray>();
-	m_vbo = std::make_unique<Buffer>(m_vertics.data(), sizeof(SkinVertex_t) * m_vertics.size(), Buffer::Target::VertexBuffer, Buffer::Usage::StaticDraw, m_vertics.size());
-	if (m_indices.size() > 0) {
-		m_ibo = std::make_unique<Buffer>(m_indices.data(), sizeof(Index_t) * m_indices.size(), Buffer::Target::IndexBuffer, Buffer::Usage::StaticDraw, m_indices.size());
+	m_vbo = std::make_unique<Buffer>(vertexData(), sizeof(SkinVertex_t) * verticesCount(), Buffer::Target::VertexBuffer, Buffer::Usage::StaticDraw, verticesCount());
+	if (indicesCount() > 0) {
+		m_ibo = std::make_unique<Buffer>(indexData(), sizeof(Index_t) * indicesCount(), Buffer::Target::IndexBuffer, Buffer::Usage::StaticDraw, indicesCount());
 	}
 
-	VertexLayoutDescription layoutDesc;
-	layoutDesc.setStride(sizeof(SkinVertex_t));
-	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::INT, 4, 4, sizeof(GLint)*4); // joints
-	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 4, 5, sizeof(GLfloat)*4); // weights
-	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 3, 0, sizeof(GLfloat)*3); // position
-	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 3, 1, sizeof(GLfloat)*3); // normal
-	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 3, 2, sizeof(GLfloat)*3); // tangent
-	layoutDesc.pushAttribute(VertexLayoutDescription::AttributeElementType::FLOAT, 2, 3); // uv
-
-
 	m_vao->bind();
 	m_vbo->bind(Buffer::Target::VertexBuffer);
 	if (m_ibo)
@@ -120,4 +261,3 @@ void TMesh<SkinVertex_t>::genGpuResources() {
 	if (m_ibo)
 		m_ibo->unbind();
 }
-
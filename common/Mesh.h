@@ -13,16 +13,21 @@ public:
 	TMesh();
 	TMesh(const TMesh& other) = delete;
 	TMesh(TMesh&& other) noexcept;
+	~TMesh();
 
 	TMesh& operator = (const TMesh& other) = delete;
 	TMesh& operator = (TMesh&& other) noexcept;
 
-	void fill(const std::vector<Vertex>& vertices, const std::vector<Index_t>& indices);
-	void fill(std::vector<Vertex>&& vertices, std::vector<Index_t>&& indices);
+	// upload = false keeps data on cpu, so a loader thread can fill it and main thread call upload() later
+	void fill(const std::vector<Vertex>& vertices, const std::vector<Index_t>& indices, bool upload = true);
+	void fill(std::vector<Vertex>&& vertices, std::vector<Index_t>&& indices, bool upload = true);
+	// data lives in a mapped cooked file, it is read from there by upload(), nothing is copied on cpu
+	void fillMapped(std::shared_ptr<const MappedFile> file, const Vertex* vertices, size_t numVertex, const Index_t* indices, size_t numIndex, const AABB_t& bounds);
+	void upload() override;
 	void release() override;
 
 	inline size_t verticesCount() const override {
-		return m_vertics.size();
+		return m_vertics.empty() ? m_numMappedVertex : m_vertics.size();
 	}
 	
 	inline const std::vector<Vertex>& getVertices() const {
@@ -31,9 +36,26 @@ public:
 
 protected:
 	void genGpuResources();
+	bool allocateShared(const VertexLayoutDescription& layout); // into mesh manager's buffer pool
+	void releaseShared();
+	void calcBounds();
+	void releaseMapped();
+
+	inline const Vertex* vertexData() const {
+		return m_vertics.empty() ? m_mappedVertices : m_vertics.data();
+	}
+
+	inline const Index_t* indexData() const {
+		return m_indices.empty() ? m_mappedIndices : m_indices.data();
+	}
+
+	static VertexLayoutDescription vertexLayout();
+	static MeshBufferPool::VertexFormat bufferFormat();
 
 protected:
 	std::vector<Vertex> m_vertics;
+	const Vertex* m_mappedVertices;
+	size_t m_numMappedVertex;
 };
 
 
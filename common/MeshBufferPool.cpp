@@ -0,0 +1,203 @@
+#include"MeshBufferPool.h"
+#include"Util.h"
+#include<vector>
+#include<iterator>
+
+
+RangeAllocator::RangeAllocator(size_t capacity) :m_freeRanges()
+, m_capacity(0)
+, m_used(0) {
+	reset(capacity);
+}
+
+
+void RangeAllocator::reset(size_t capacity) {
+	m_freeRanges.clear();
+	m_capacity = capacity;
+	m_used = 0;
+	if (capacity > 0)
+		m_freeRanges.insert({ 0, capacity });
+}
+
+
+bool RangeAllocator::allocate(size_t count, size_t& offset) {
+	if (count == 0)
+		return false;
+
+	for (auto range = m_freeRanges.begin(); range != m_freeRanges.end(); range++) {
+		if (range->second < count)
+			continue;
+
+		offset = range->first;
+		size_t remain = range->second - count;
+		m_freeRanges.erase(range);
+		if (remain > 0)
+			m_freeRanges.insert({ offset + count, remain });
+		m_used += count;
+
+		return true;
+	}
+
+	return false;
+}
+
+
+void RangeAllocator::free(size_t offset, size_t count) {
+	if (count == 0)
+		return;
+
+#ifdef _DEBUG
+	ASSERT(offset + count <= m_capacity && count <= m_used);
+#endif // _DEBUG
+
+	m_used -= count;
+	auto next = m_freeRanges.lower_bound(offset);
+
+	// merge with free range right after it
+	if (next != m_freeRanges.end() && offset + count == next->first) {
+		count += next->second;
+		next = m_freeRanges.erase(next);
+	}
+
+	// merge with free range right before it
+	if (next != m_freeRanges.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			prev->second += count;
+			return;
+		}
+	}
+
+	m_freeRanges.insert(next, { offset, count });
+}
+
+
+
+MeshBufferPool::MeshBufferPool() :m_formats()
+, m_ibo(nullptr)
+, m_instanceSlots(nullptr)
+, m_indexAllocator() {
+
+}
+
+
+MeshBufferPool::~MeshBufferPool() {
+	release();
+}
+
+
+bool MeshBufferPool::allocate(VertexFormat format, const VertexLayoutDescription& layout, const void* vertices, size_t numVertex,
+	const Index_t* indices, size_t numIndex, MeshBufferRange_t& vertexRange, MeshBufferRange_t& indexRange) {
+	if (numVertex == 0 || numIndex == 0)
+		return false;
+
+	if (!m_ibo && !setupShared())
+		return false;
+
+	FormatBuffer& buffer = m_formats[size_t(format)];
+	if (!buffer.vao && !setupFormat(format, layout))
+		return false;
+
+#ifdef _DEBUG
+	ASSERT(buffer.stride == layout.getStride());
+#endif // _DEBUG
+
+	if (!buffer.allocator.allocate(numVertex, vertexRange.offset))
+		return false;
+
+	if (!m_indexAllocator.allocate(numIndex, indexRange.offset)) {
+		buffer.allocator.free(vertexRange.offset, numVertex);
+		return false;
+	}
+
+	vertexRange.count = numVertex;
+	indexRange.count = numIndex;
+
+	// uploads go through copy write target, binding index buffer here would change whichever vao is bound
+	buffer.vbo->bind(Buffer::Target::CopyWriteBuffer);
+	buffer.vbo->loadSubData(vertices, vertexRange.offset * buffer.stride, numVertex * buffer.stride);
+	buffer.vbo->unbind();
+
+	m_ibo->bind(Buffer::Target::CopyWriteBuffer);
+	m_ibo->loadSubData(indices, indexRange.offset * sizeof(Index_t), numIndex * sizeof(Index_t));
+	m_ibo->unbind();
+
+	return true;
+}
+
+
+void MeshBufferPool::free(VertexFormat format, const MeshBufferRange_t& vertexRange, const MeshBufferRange_t& indexRange) {
+	if (!m_ibo)
+		return;
+
+	m_formats[size_t(format)].allocator.free(vertexRange.offset, vertexRange.count);
+	m_indexAllocator.free(indexRange.offset, indexRange.count);
+}
+
+
+void MeshBufferPool::release() {
+	for (auto& buffer : m_formats) {
+		buffer.vao.reset(nullptr);
+		buffer.vbo.reset(nullptr);
+		buffer.allocator.reset(0);
+		buffer.stride = 0;
+	}
+
+	m_ibo.reset(nullptr);
+	m_instanceSlots.reset(nullptr);
+	m_indexAllocator.reset(0);
+}
+
+
+bool MeshBufferPool::setupShared() {
+	m_ibo.reset(new Buffer());
+	m_ibo->bind(Buffer::Target::CopyWriteBuffer);
+	if (!m_ibo->loadData(nullptr, sizeof(Index_t) * MESH_POOL_INDICES, Buffer::Usage::StaticDraw, MESH_POOL_INDICES)) {
+		m_ibo.reset(nullptr);
+		return false;
+	}
+	m_ibo->unbind();
+	m_indexAllocator.reset(MESH_POOL_INDICES);
+
+	// identity stream, instance i of a command reads slot baseInstance + i
+	std::vector<GLuint> slots(MAX_NUM_INSTANCES);
+	for (size_t i = 0; i < slots.size(); i++)
+		slots[i] = GLuint(i);
+
+	m_instanceSlots.reset(new Buffer(slots.data(), sizeof(GLuint) * slots.size(), Buffer::Target::CopyWriteBuffer, Buffer::Usage::StaticDraw, slots.size()));
+	m_instanceSlots->unbind();
+
+	return true;
+}
+
+
+bool MeshBufferPool::setupFormat(VertexFormat format, const VertexLayoutDescription& layout) {
+	size_t capacity = format == VertexFormat::Skinned ? MESH_POOL_SKIN_VERTICES : MESH_POOL_STATIC_VERTICES;
+	FormatBuffer& buffer = m_formats[size_t(format)];
+	buffer.stride = layout.getStride();
+	buffer.vbo.reset(new Buffer());
+	buffer.vbo->bind(Buffer::Target::CopyWriteBuffer);
+	if (!buffer.vbo->loadData(nullptr, buffer.stride * capacity, Buffer::Usage::StaticDraw, capacity)) {
+		buffer.vbo.reset(nullptr);
+		return false;
+	}
+	buffer.vbo->unbind();
+	buffer.allocator.reset(capacity);
+
+	VertexLayoutDescription slotLayout;
+	slotLayout.pushAttribute(VertexLayoutDescription::AttributeElementType::UNSIGNED_INT, 1, MESH_POOL_INSTANCE_SLOT_LOCATION, 0, false, 1);
+
+	buffer.vao.reset(new VertexArray());
+	buffer.vao->bind();
+	buffer.vbo->bind(Buffer::Target::VertexBuffer);
+	buffer.vao->storeVertexLayout(layout);
+	m_instanceSlots->bind(Buffer::Target::VertexBuffer);
+	buffer.vao->storeVertexLayout(slotLayout);
+	m_ibo->bind(Buffer::Target::IndexBuffer);
+	buffer.vao->unbind();
+	buffer.vbo->unbind();
+	m_instanceSlots->unbind();
+	m_ibo->unbind();
+
+	return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include"RendererCore.h"
+#include"VertexLayoutDescription.h"
+#include"VertexArray.h"
+#include"Buffer.h"
+#include<memory>
+#include<map>
+#include<array>
+
+
+// shared buffer capacities in elements, meshes not fitting in keep their own buffers
+#define MESH_POOL_STATIC_VERTICES (1024 * 1024)
+#define MESH_POOL_SKIN_VERTICES (256 * 1024)
+#define MESH_POOL_INDICES (4 * 1024 * 1024)
+
+// per instance attribute of pooled vaos, holds instance slot of a multi draw command
+#define MESH_POOL_INSTANCE_SLOT_LOCATION 6
+
+
+//
+// first fit allocator of element ranges, freed ranges are merged with free neighbours
+//
+class RangeAllocator {
+public:
+	RangeAllocator(size_t capacity = 0);
+
+	void reset(size_t capacity);
+	bool allocate(size_t count, size_t& offset);
+	void free(size_t offset, size_t count);
+
+	inline size_t getCapacity() const {
+		return m_capacity;
+	}
+
+	inline size_t getUsed() const {
+		return m_used;
+	}
+
+	inline size_t getNumFreeRanges() const {
+		return m_freeRanges.size();
+	}
+
+private:
+	std::map<size_t, size_t> m_freeRanges; // offset -> count
+	size_t m_capacity;
+	size_t m_used;
+};
+
+
+struct MeshBufferRange_t {
+	size_t offset; // in elements
+	size_t count;
+
+	MeshBufferRange_t() : offset(0), count(0) {}
+	inline bool isValid() const { return count > 0; }
+};
+
+
+//
+// one large vbo per vertex format and one ibo shared by all formats, meshes are sub allocated ranges of them.
+// meshes of a format share one vao, so consecutive draws need no vao rebind
+// and a run of them can go in one multi draw indirect call.
+// pooled vaos carry an identity instance slot stream, indirect commands point it at their instance slots by baseInstance.
+//
+class MeshBufferPool {
+public:
+	enum class VertexFormat {
+		Static,
+		Skinned,
+		Count,
+	};
+
+public:
+	MeshBufferPool();
+	~MeshBufferPool();
+
+	MeshBufferPool(const MeshBufferPool& other) = delete;
+	MeshBufferPool& operator = (const MeshBufferPool& other) = delete;
+
+	// upload mesh into shared buffers, false if there is no room
+	bool allocate(VertexFormat format, const VertexLayoutDescription& layout, const void* vertices, size_t numVertex,
+		const Index_t* indices, size_t numIndex, MeshBufferRange_t& vertexRange, MeshBufferRange_t& indexRange);
+	void free(VertexFormat format, const MeshBufferRange_t& vertexRange, const MeshBufferRange_t& indexRange);
+	void release();
+
+	inline VertexArray* vertexArray(VertexFormat format) const {
+		return m_formats[size_t(format)].vao.get();
+	}
+
+	inline const RangeAllocator& getVertexAllocator(VertexFormat format) const {
+		return m_formats[size_t(format)].allocator;
+	}
+
+	inline const RangeAllocator& getIndexAllocator() const {
+		return m_indexAllocator;
+	}
+
+protected:
+	bool setupFormat(VertexFormat format, const VertexLayoutDescription& layout);
+	bool setupShared();
+
+private:
+	struct FormatBuffer {
+		std::unique_ptr<VertexArray> vao;
+		std::unique_ptr<Buffer> vbo;
+		RangeAllocator allocator;
+		size_t stride;
+
+		FormatBuffer() : vao(), vbo(), allocator(), stride(0) {}
+	};
+
+	std::array<FormatBuffer, size_t(VertexFormat::Count)> m_formats;
+	std::unique_ptr<Buffer> m_ibo;
+	std::unique_ptr<Buffer> m_instanceSlots;
+	RangeAllocator m_indexAllocator;
+};
@@ -6,6 +6,7 @@
 #include"MaterialMgr.h"
 #include"TextureMgr.h"
 #include"PhongMaterial.h"
+#include"ModelCache.h"
 #include<assimp/Importer.hpp>
 #include<glm/gtc/type_ptr.hpp>
 #include<queue>
@@ -13,10 +14,67 @@
 #include<unordered_set>
 
 
+MaterialDesc_t::MaterialDesc_t() :name()
+, diffuseColor(0.f)
+, specularColor(1.f)
+, emissive(0.f)
+, opacity(1.f)
+, shininess(0.f)
+, diffuseMap()
+, normalMap()
+, specularMap()
+, emissiveMap()
+, isValid(false) {
+
+}
+
+
+ModelImport_t::ModelImport_t() :model()
+, materials()
+, numUploaded(0) {
+
+}
+
+
+ModelImport_t::~ModelImport_t() {
+
+}
+
+
+bool ModelImport_t::isUploaded() const {
+	return !model || numUploaded >= model->meshCount();
+}
+
+
 Model* MeshLoader::load(const std::string& file, int options, Preset preset,std::string name) {
+	std::unique_ptr<ModelImport_t> imported(import(file, options, preset, name));
+	if (!imported)
+		return nullptr;
+
+	while (!uploadNext(*imported));
+
+#ifdef _DEBUG
+	std::cout << *imported->model << std::endl;
+#endif // _DEBUG
+
+	return imported->model.release();
+}
+
+
+ModelImport_t* MeshLoader::import(const std::string& file, int options, Preset preset, std::string name) {
 	if (name.empty())
 		name = ExtractFileNameFromPath(file);
 
+	fs::path cookedFile = ModelCache::cookedPath(file);
+	if (!(options & Option::IgnoreCache)) {
+		ModelImport_t* cooked = ModelCache::read(cookedFile, file, options, preset);
+		if (cooked) {
+			cooked->model->setName(name);
+			cooked->model->setFilePath(file);
+			return cooked;
+		}
+	}
+
 	Assimp::Importer importer;
 	auto aScene = importer.ReadFile(file, unsigned int (preset));
 	if (!aScene) {
@@ -33,7 +91,9 @@ Model* MeshLoader::load(const std::string& file, int options, Preset preset,std:
 		animations = loadAnimations(aScene, skeleton);
 	}
 
-	auto model = new Model();
+	ModelImport_t* imported = new ModelImport_t();
+	imported->model.reset(new Model());
+	Model* model = imported->model.get();
 	model->setName(name);
 	model->setFilePath(file);
 	model->setSkeleton(skeleton);
@@ -41,13 +101,38 @@ Model* MeshLoader::load(const std::string& file, int options, Preset preset,std:
 		model->addAnimation(anim);
 	}
 
-	loadMeshes(aScene, aScene->mRootNode, model, options, aiMatrix4x4());
+	loadMeshes(aScene, aScene->mRootNode, imported, options, aiMatrix4x4());
 
+	if (!(options & Option::IgnoreCache) && !ModelCache::write(cookedFile, file, options, preset, *imported)) {
 #ifdef _DEBUG
-	std::cout << *model << std::endl;
+		std::cerr << "[Mesh Load warning] Failed to write cooked model: \"" << cookedFile.string() << "\"" << std::endl;
 #endif // _DEBUG
+	}
+
+	return imported;
+}
+
+
+bool MeshLoader::uploadNext(ModelImport_t& imported) {
+	if (imported.isUploaded())
+		return true;
+
+	Model* model = imported.model.get();
+	IMesh* mesh = model->meshAt(imported.numUploaded);
+	const MaterialDesc_t& desc = imported.materials[imported.numUploaded];
+	imported.numUploaded++;
+
+	mesh->upload();
+	if (desc.isValid) {
+		IMaterial* mat = createMaterial(desc);
+		mat->setName(model->getName() + "_" + mat->getName());
+		if (MaterialManager::getInstance()->addMaterial(mat))
+			model->addEmbededMaterial(mesh, mat);
+		else
+			delete mat;
+	}
 
-	return model;
+	return imported.isUploaded();
 }
 
 
@@ -238,6 +323,8 @@ std::vector<AnimationClip*> MeshLoader::loadAnimations(const aiScene* aScene, co
 				}
 			}
 		}
+
+		animClip->buildSampler();
 	}
    	return animations;
 }
@@ -302,7 +389,8 @@ const aiNode* MeshLoader::findSkeletonRootNode(const aiNode* node, const std::un
 }
 
 
-void MeshLoader::loadMeshes(const aiScene* aScene, const aiNode* node, Model* model, int options, const aiMatrix4x4& parentTransform) {
+void MeshLoader::loadMeshes(const aiScene* aScene, const aiNode* node, ModelImport_t* imported, int options, const aiMatrix4x4& parentTransform) {
+	Model* model = imported->model.get();
 	aiMatrix4x4 transform = parentTransform * node->mTransformation;
 	for (size_t i = 0; i < node->mNumMeshes; i++) {
 		const aiMesh* aMesh = aScene->mMeshes[node->mMeshes[i]];
@@ -312,20 +400,11 @@ void MeshLoader::loadMeshes(const aiScene* aScene, const aiNode* node, Model* mo
 
 		mesh->setTransform(glm::transpose(glm::make_mat4(&transform[0][0])));
 		model->addMesh(mesh);
-		if (options & Option::LoadMaterials) {
-			IMaterial* mat = loadMaterial(aScene, aMesh);
-			if (mat) {
-				mat->setName(model->getName() + "_" + mat->getName());
-				if (MaterialManager::getInstance()->addMaterial(mat))
-					model->addEmbededMaterial(mesh, mat);
-				else
-					delete mat;
-			}
-		}
+		imported->materials.push_back(options & Option::LoadMaterials ? loadMaterial(aScene, aMesh) : MaterialDesc_t());
 	}
 
 	for (size_t j = 0; j < node->mNumChildren; j++) {
-		loadMeshes(aScene, node->mChildren[j], model, options, transform);
+		loadMeshes(aScene, node->mChildren[j], imported, options, transform);
 	}
 }
 
@@ -397,7 +476,7 @@ IMesh* MeshLoader::loadGeometrys(const aiMesh* aMesh, const Skeleton* skeleton)
 
 
 	TMesh<Vertex>* mesh = new TMesh<Vertex>();
-	mesh->fill(std::move(vertices), std::move(indices));
+	mesh->fill(std::move(vertices), std::move(indices), false);
 	mesh->setName(aMesh->mName.C_Str());
 	mesh->setPrimitiveType(pt);
 
@@ -425,12 +504,13 @@ void MeshLoader::loadBoneWeights<SkinVertex_t>(std::vector<SkinVertex_t>& vertic
 }
 
 
-IMaterial* MeshLoader::loadMaterial(const aiScene* aScene, const aiMesh* aMesh) {
+MaterialDesc_t MeshLoader::loadMaterial(const aiScene* aScene, const aiMesh* aMesh) {
+	MaterialDesc_t desc;
 	if (!aScene->HasMaterials())
-		return nullptr;
+		return desc;
 
 	if (aScene->mNumMaterials <= aMesh->mMaterialIndex)
-		return nullptr;
+		return desc;
 
 	aiColor3D aiDiffuseColor(0.f, 0.f, 0.f);
 	aiColor3D aiSpecularColor(1.f, 1.f, 1.f);
@@ -439,15 +519,6 @@ IMaterial* MeshLoader::loadMaterial(const aiScene* aScene, const aiMesh* aMesh)
 	float aiOpacity = 1.f;
 	float aiShininess = 0.f;
 
-	bool hasDiffuseMap = false;
-	bool hasNormalMap = false;
-	bool hasEmissiveMap = false;
-	bool hasSpecularMap = false;
-	std::string diffuseTextureName;
-	std::string normalTextureName;
-	std::string specularTextureName;
-	std::string emissiveTextureName;
-
 	const aiMaterial* aMat = aScene->mMaterials[aMesh->mMaterialIndex];
 	aMat->Get(AI_MATKEY_COLOR_DIFFUSE, aiDiffuseColor);
 	aMat->Get(AI_MATKEY_COLOR_SPECULAR, aiSpecularColor);
@@ -459,101 +530,85 @@ IMaterial* MeshLoader::loadMaterial(const aiScene* aScene, const aiMesh* aMesh)
 	if (aMat->GetTextureCount(aiTextureType_DIFFUSE) > 0) {
 		aiString path;
 		aMat->GetTexture(aiTextureType_DIFFUSE, 0, &path);
-		diffuseTextureName = ExtractFileNameFromPath(path.C_Str());
-		hasDiffuseMap = !diffuseTextureName.empty();
+		desc.diffuseMap = ExtractFileNameFromPath(path.C_Str());
 	}
 
 	if (aMat->GetTextureCount(aiTextureType_NORMALS) > 0) {
 		aiString path;
 		aMat->GetTexture(aiTextureType_NORMALS, 0, &path);
-		normalTextureName = ExtractFileNameFromPath(path.C_Str());
-		hasNormalMap = !normalTextureName.empty();
+		desc.normalMap = ExtractFileNameFromPath(path.C_Str());
 	}
 
 	if (aMat->GetTextureCount(aiTextureType_SPECULAR) > 0) {
 		aiString path;
 		aMat->GetTexture(aiTextureType_SPECULAR, 0, &path);
-		specularTextureName = ExtractFileNameFromPath(path.C_Str());
-		hasSpecularMap = !specularTextureName.empty();
+		desc.specularMap = ExtractFileNameFromPath(path.C_Str());
 	}
 
 	if (aMat->GetTextureCount(aiTextureType_EMISSIVE) > 0) {
 		aiString path;
 		aMat->GetTexture(aiTextureType_EMISSIVE, 0, &path);
-		emissiveTextureName = ExtractFileNameFromPath(path.C_Str());
-		hasEmissiveMap = !emissiveTextureName.empty();
+		desc.emissiveMap = ExtractFileNameFromPath(path.C_Str());
 	}
 
+	desc.diffuseColor = glm::vec3(aiDiffuseColor.r, aiDiffuseColor.g, aiDiffuseColor.b);
+	desc.specularColor = glm::vec3(aiSpecularColor.r, aiSpecularColor.g, aiSpecularColor.b);
+	desc.emissive = aiEmissiveColor.r * 0.2f + aiEmissiveColor.g * 0.7f + aiEmissiveColor.b * 0.1f;
+	desc.opacity = aiOpacity;
+	desc.shininess = aiShininess;
+	desc.name = std::string(aMesh->mName.C_Str()) + "_" + aiName.C_Str();
+	desc.isValid = true;
+
+	return desc;
+}
+
+
+IMaterial* MeshLoader::createMaterial(const MaterialDesc_t& desc) {
 	auto mat = new PhongMaterial("");
-	mat->m_mainColor = glm::vec3(aiDiffuseColor.r, aiDiffuseColor.g, aiDiffuseColor.b);
-	mat->m_specularColor = glm::vec3(aiSpecularColor.r, aiSpecularColor.g, aiSpecularColor.b);
-	mat->m_emissive = aiEmissiveColor.r * 0.2f + aiEmissiveColor.g * 0.7f + aiEmissiveColor.b * 0.1f;
-	mat->m_opacity = aiOpacity;
-	mat->m_shininess = aiShininess;
-	
-	std::string name(aMesh->mName.C_Str()); 
-	name = name + "_" + aiName.C_Str();
-	mat->setName(name);
-
-	if (hasDiffuseMap) {
-		mat->m_albedoMap = loadTexture(diffuseTextureName);
-		if (mat->m_albedoMap.expired()) {
-#ifdef _DEBUG	
+	mat->m_mainColor = desc.diffuseColor;
+	mat->m_specularColor = desc.specularColor;
+	mat->m_emissive = desc.emissive;
+	mat->m_opacity = desc.opacity;
+	mat->m_shininess = desc.shininess;
+	mat->setName(desc.name);
+
+	// missing files fail here, async decode failures show up once queue gets to them (PhongMaterial::hasMissingTexture)
+	auto checkLoaded = [mat](const std::weak_ptr<Texture>& texture, const std::string& file) {
+		if (texture.expired()) {
 			std::string msg;
 			msg += "[Material Load error] Failed to load texture: ";
-			msg += (mat->getName() + "_" + diffuseTextureName);
+			msg += (mat->getName() + "_" + file);
 			CONSOLELOG(msg);
-#endif // _DEBUG
-
 		}
-	}
-	if (hasNormalMap) {
-		mat->m_normalMap = loadTexture(normalTextureName);
-		if (mat->m_normalMap.expired()) {
-#ifdef _DEBUG
-			std::string msg;
-			msg += "[Material Load error] Failed to load texture: ";
-			msg += (mat->getName() + "_" + normalTextureName);
-			CONSOLELOG(msg);
-#endif // _DEBUG
+	};
 
-		}
+	if (!desc.diffuseMap.empty()) {
+		mat->m_albedoMap = loadTexture(desc.diffuseMap);
+		checkLoaded(mat->m_albedoMap, desc.diffuseMap);
 	}
-	if (hasSpecularMap) {
-		mat->m_specularMap = loadTexture(specularTextureName);
-		if (mat->m_specularMap.expired()) {
-#ifdef _DEBUG
-			std::string msg;
-			msg += "[Material Load error] Failed to load texture: ";
-			msg += (mat->getName() + "_" + specularTextureName);
-			CONSOLELOG(msg);
-#endif // _DEBUG
-
-		}
+	if (!desc.normalMap.empty()) {
+		mat->m_normalMap = loadTexture(desc.normalMap, TextureManager::Fallback::FlatNormal);
+		checkLoaded(mat->m_normalMap, desc.normalMap);
 	}
-	if (hasEmissiveMap) {
-		mat->m_albedoMap = loadTexture(emissiveTextureName);
-		if (mat->m_albedoMap.expired()) {
-#ifdef _DEBUG
-			std::string msg;
-			msg += "[Material Load error] Failed to load texture: ";
-			msg += (mat->getName() + "_" + emissiveTextureName);
-			CONSOLELOG(msg);
-#endif // _DEBUG
-
-		}
+	if (!desc.specularMap.empty()) {
+		mat->m_specularMap = loadTexture(desc.specularMap);
+		checkLoaded(mat->m_specularMap, desc.specularMap);
+	}
+	if (!desc.emissiveMap.empty()) {
+		mat->m_albedoMap = loadTexture(desc.emissiveMap);
+		checkLoaded(mat->m_albedoMap, desc.emissiveMap);
 	}
 
 	return mat;
 }
 
 
-std::weak_ptr<Texture> MeshLoader::loadTexture(const std::string& name) {
+std::weak_ptr<Texture> MeshLoader::loadTexture(const std::string& name, TextureManager::Fallback fallback) {
 	auto textureMgr = TextureManager::getInstance();
 	if (textureMgr->hasTexture(name))
 		return textureMgr->getTexture(name);
 
-	return textureMgr->addTexture(name);
+	return textureMgr->addTexture(name, "", fallback);
 }
 
 
@@ -1,11 +1,14 @@
 #pragma once
 #include"Singleton.h"
 #include"IMesh.h"
+#include"TextureMgr.h"
 #include<string>
 #include<assimp/postprocess.h>
 #include<assimp/scene.h>
 #include<unordered_map>
 #include<vector>
+#include<memory>
+#include<glm/glm.hpp>
 
 class Model;
 class AnimationClip;
@@ -14,12 +17,44 @@ class Material;
 class Texture;
 
 
+// material properties read from an imported scene, turned into a material on main thread
+struct MaterialDesc_t {
+	std::string name;
+	glm::vec3 diffuseColor;
+	glm::vec3 specularColor;
+	float emissive;
+	float opacity;
+	float shininess;
+	std::string diffuseMap;
+	std::string normalMap;
+	std::string specularMap;
+	std::string emissiveMap;
+	bool isValid;
+
+	MaterialDesc_t();
+};
+
+
+// result of cpu loading stage, meshes hold data only and get gpu resources on upload
+struct ModelImport_t {
+	std::unique_ptr<Model> model;
+	std::vector<MaterialDesc_t> materials; // one per mesh of model
+	size_t numUploaded;
+
+	ModelImport_t();
+	~ModelImport_t();
+
+	bool isUploaded() const;
+};
+
+
 class MeshLoader : public Singleton<MeshLoader> {
 public:
 	enum Option {
 		None = 0,
 		LoadMaterials = 1 << 0,
 		LoadAnimations = 1 << 1,
+		IgnoreCache = 1 << 2, // always import source, neither read nor write cooked file
 	};
 
 	enum class Preset {
@@ -30,14 +65,22 @@ public:
 
 	Model* load(const std::string& file, int options = Option::None, Preset preset = Preset::Quality, std::string name = "");
 
+	// cpu stage: import, vertex conversion, bone weights & animation tracks. no gl call, safe on any thread.
+	// an up to date cooked file is mapped instead of importing source, otherwise it is written after import
+	ModelImport_t* import(const std::string& file, int options = Option::None, Preset preset = Preset::Quality, std::string name = "");
+
+	// gpu stage: create material & buffers of next mesh, return true once every mesh is done. main thread only
+	bool uploadNext(ModelImport_t& imported);
+
 protected:
 	Skeleton* loadSkeletion(const aiScene* aScene);
 	std::vector<AnimationClip*> loadAnimations(const aiScene* aScene, const Skeleton* skeleton);
 	const aiNode* findSkeletonRootNode(const aiNode* node, const std::unordered_map<std::string, aiBone*>& bones);
 
-	void loadMeshes(const aiScene* aScene, const aiNode* node, Model* model, int options, const aiMatrix4x4& parentTransform);
-	IMaterial* loadMaterial(const aiScene* aScene, const aiMesh* mesh);
-	std::weak_ptr<Texture> loadTexture(const std::string& name);
+	void loadMeshes(const aiScene* aScene, const aiNode* node, ModelImport_t* imported, int options, const aiMatrix4x4& parentTransform);
+	MaterialDesc_t loadMaterial(const aiScene* aScene, const aiMesh* mesh);
+	IMaterial* createMaterial(const MaterialDesc_t& desc);
+	std::weak_ptr<Texture> loadTexture(const std::string& name, TextureManager::Fallback fallback = TextureManager::Fallback::White);
 	
 	template<typename Vertex>
 	IMesh* loadGeometrys(const aiMesh* mesh, const Skeleton* skeleton);
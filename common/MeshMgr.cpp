@@ -28,6 +28,52 @@ std::weak_ptr<Model> MeshManager::addMesh(const std::string& fileName, int loadi
 	return  std::weak_ptr<Model>(m_meshes[model->getName()]);
 }
 
+std::shared_ptr<ModelLoadHandle> MeshManager::addMeshAsync(const std::string& fileName, int loadingOptions, MeshLoader::Preset preset, std::string name) {
+	if (name.empty())
+		name = ExtractFileNameFromPath(fileName);
+
+	auto found = getMesh(name);
+	if (!found.expired()) {
+		auto pending = m_loadHandles.find(name);
+		if (pending != m_loadHandles.end())
+			return pending->second;
+
+		return std::make_shared<ModelLoadHandle>(found, ModelLoadHandle::State::Ready);
+	}
+
+	std::shared_ptr<Model> placeholder(new Model());
+	placeholder->setName(name);
+	placeholder->setFilePath(getResourcePath(fileName));
+	m_meshes.insert({ name, placeholder });
+
+	auto handle = m_loadQueue.load(placeholder, placeholder->getFilePath(), loadingOptions, preset, name);
+	m_loadHandles[name] = handle;
+
+	return handle;
+}
+
+
+void MeshManager::updateLoading(double budgetMs) {
+	if (m_loadHandles.empty())
+		return;
+
+	m_loadQueue.update(budgetMs);
+
+	for (auto handle = m_loadHandles.begin(); handle != m_loadHandles.end();) {
+		if (!handle->second->isDone()) {
+			handle++;
+			continue;
+		}
+
+		// name may have been taken over by another model meanwhile, only the placeholder itself goes
+		auto model = handle->second->getModel().lock();
+		if (model && model == getMesh(handle->first).lock() && handle->second->getState() == ModelLoadHandle::State::Failed)
+			removeMesh(handle->first);
+		handle = m_loadHandles.erase(handle);
+	}
+}
+
+
 bool MeshManager::addMesh(Model* mesh) {
 	auto founded = getMesh(mesh->getName());
 	if (!founded.expired())
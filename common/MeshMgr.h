@@ -2,6 +2,8 @@
 #include"Singleton.h"
 #include"Model.h"
 #include"MeshLoader.h"
+#include"MeshBufferPool.h"
+#include"ModelLoadQueue.h"
 #include<unordered_map>
 #include<string>
 #include<memory>
@@ -12,7 +14,7 @@ class MeshManager : public Singleton<MeshManager> {
 	typedef std::unordered_map<std::string, std::shared_ptr<Model>> MeshContainer;
 public:
 	MeshManager() = default;
-	~MeshManager() {};
+	~MeshManager() { m_loadQueue.shutdown(); removeAllMesh(); };
 
 	std::weak_ptr<Model> addMesh(const std::string& fileName,
 		int loadingOptions = MeshLoader::Option::LoadAnimations | MeshLoader::Option::LoadMaterials,
@@ -20,6 +22,16 @@ public:
 		std::string name = "");
 	bool addMesh(Model* mesh);
 
+	// returns at once, model behind handle is an empty placeholder until loading finishes.
+	// loads of an already known name share the model (and the handle while it is in flight)
+	std::shared_ptr<ModelLoadHandle> addMeshAsync(const std::string& fileName,
+		int loadingOptions = MeshLoader::Option::LoadAnimations | MeshLoader::Option::LoadMaterials,
+		MeshLoader::Preset preset = MeshLoader::Preset::Quality,
+		std::string name = "");
+
+	// main thread, once per frame: gpu upload stage of background loads
+	void updateLoading(double budgetMs = MODEL_UPLOAD_BUDGET_MS);
+
 	std::weak_ptr<Model> createGrid(float width, float depth, float spacing = 1);
 	std::weak_ptr<Model> createPlane(float width, float depth);
 	std::weak_ptr<Model> createCube();
@@ -32,10 +44,16 @@ public:
 	
 	void removeAllMesh();
 
+	inline MeshBufferPool* getBufferPool() {
+		return &m_bufferPool;
+	}
 
 protected:
 	inline std::string getResourcePath(const std::string& fileName) const;
 
 private:
+	MeshBufferPool m_bufferPool; // outlives meshes, they return their ranges on destruction
 	std::unordered_map<std::string, std::shared_ptr<Model>> m_meshes;
+	std::unordered_map<std::string, std::shared_ptr<ModelLoadHandle>> m_loadHandles; // in flight, placeholder of a failed one is removed
+	ModelLoadQueue m_loadQueue; // destroyed first, imports in flight may hold pooled meshes
 };
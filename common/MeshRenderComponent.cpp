@@ -97,9 +97,12 @@ void MeshRenderComponent::render(RenderContext* context) {
 		task.vao = mesh->vertexArray();
 		task.vertexCount = mesh->verticesCount();
 		task.indexCount = mesh->indicesCount();
+		task.indexOffset = mesh->getIndexOffset();
+		task.vertexOffset = mesh->getVertexOffset();
 		task.primitive = mesh->getPrimitiveType();
 		task.material = mat;
-		task.modelMatrix = context->getMatrix() * m_owner->m_transform.getMatrix() * mesh->getTransform();
+		task.modelMatrix = m_owner->m_transform.getMatrixWorld() * mesh->getTransform();
+		task.bounds = mesh->getBounds().transform(task.modelMatrix);
 		auto layer = getGameObject()->getLayer();
 		auto renderer = context->getRenderer();
 		if (layer == SceneLayer::Opaque) {
@@ -0,0 +1,405 @@
+#include"ModelCache.h"
+#include"Model.h"
+#include"Skeleton.h"
+#include"AnimationClip.h"
+#include"Util.h"
+#include<fstream>
+#include<cstring>
+#include<system_error>
+
+
+//
+// sequential writer, blobs are padded to COOKED_BLOB_ALIGNMENT from file start
+//
+class CookedWriter {
+public:
+	CookedWriter(std::ofstream& stream) : m_stream(stream), m_offset(0) {}
+
+	template<typename T>
+	void pod(const T& value) {
+		bytes(&value, sizeof(T));
+	}
+
+	void string(const std::string& s) {
+		pod(uint32_t(s.size()));
+		bytes(s.data(), s.size());
+	}
+
+	template<typename T>
+	void blob(const T* data, size_t count) {
+		static const char zeros[COOKED_BLOB_ALIGNMENT] = {};
+		pod(uint64_t(count));
+		size_t pad = (COOKED_BLOB_ALIGNMENT - m_offset % COOKED_BLOB_ALIGNMENT) % COOKED_BLOB_ALIGNMENT;
+		bytes(zeros, pad);
+		bytes(data, sizeof(T) * count);
+	}
+
+	void bytes(const void* data, size_t size) {
+		m_stream.write(static_cast<const char*>(data), size);
+		m_offset += size;
+	}
+
+private:
+	std::ofstream& m_stream;
+	size_t m_offset;
+};
+
+
+//
+// bounds checked cursor over a mapped file, any overrun turns it invalid and reads give zeros/nullptr
+//
+class CookedReader {
+public:
+	CookedReader(const uint8_t* data, size_t size) : m_data(data), m_size(size), m_offset(0), m_isValid(true) {}
+
+	template<typename T>
+	void pod(T& value) {
+		if (!reserve(sizeof(T))) {
+			value = T();
+			return;
+		}
+		memcpy(&value, m_data + m_offset, sizeof(T));
+		m_offset += sizeof(T);
+	}
+
+	void string(std::string& s) {
+		uint32_t length = 0;
+		pod(length);
+		if (!reserve(length)) {
+			s.clear();
+			return;
+		}
+		s.assign(reinterpret_cast<const char*>(m_data + m_offset), length);
+		m_offset += length;
+	}
+
+	template<typename T>
+	const T* blob(size_t& count) {
+		uint64_t n = 0;
+		pod(n);
+		size_t pad = (COOKED_BLOB_ALIGNMENT - m_offset % COOKED_BLOB_ALIGNMENT) % COOKED_BLOB_ALIGNMENT;
+		if (!reserve(pad) || n > (m_size - m_offset - pad) / sizeof(T)) {
+			m_isValid = false;
+			count = 0;
+			return nullptr;
+		}
+		m_offset += pad;
+		const T* data = reinterpret_cast<const T*>(m_data + m_offset);
+		m_offset += sizeof(T) * n;
+		count = size_t(n);
+
+		return data;
+	}
+
+	inline bool isValid() const {
+		return m_isValid;
+	}
+
+protected:
+	bool reserve(size_t size) {
+		if (!m_isValid || size > m_size - m_offset)
+			m_isValid = false;
+
+		return m_isValid;
+	}
+
+private:
+	const uint8_t* m_data;
+	size_t m_size;
+	size_t m_offset;
+	bool m_isValid;
+};
+
+
+template<typename T>
+static void writeTrack(CookedWriter& writer, KeyFrameTrack<T>& track) {
+	writer.pod(int32_t(track.getInterpolationType()));
+	writer.pod(int32_t(track.m_preBehavior));
+	writer.pod(int32_t(track.m_postBehavior));
+	writer.pod(track.m_defualtVal);
+	writer.blob(track.getKeyFrames().data(), track.size());
+}
+
+
+template<typename T>
+static void readTrack(CookedReader& reader, KeyFrameTrack<T>& track) {
+	int32_t interpolation = 0, preBehavior = 0, postBehavior = 0;
+	reader.pod(interpolation);
+	reader.pod(preBehavior);
+	reader.pod(postBehavior);
+	reader.pod(track.m_defualtVal);
+	track.setInterpolationType(InterpolationType(interpolation));
+	track.m_preBehavior = typename KeyFrameTrack<T>::Behavior(preBehavior);
+	track.m_postBehavior = typename KeyFrameTrack<T>::Behavior(postBehavior);
+
+	size_t numKeys = 0;
+	const KeyFrame<T>* keys = reader.blob<KeyFrame<T>>(numKeys);
+	track.getKeyFrames().assign(keys, keys + numKeys);
+}
+
+
+static void writePose(CookedWriter& writer, const Pose& pose) {
+	std::vector<Transform> joints(pose.size());
+	std::vector<int32_t> parents(pose.size());
+	for (size_t i = 0; i < pose.size(); i++) {
+		joints[i] = pose[i];
+		parents[i] = pose.getJointParent(i);
+	}
+	writer.blob(joints.data(), joints.size());
+	writer.blob(parents.data(), parents.size());
+}
+
+
+static void readPose(CookedReader& reader, Pose& pose, size_t numJoints) {
+	size_t numTransform = 0, numParent = 0;
+	const Transform* joints = reader.blob<Transform>(numTransform);
+	const int32_t* parents = reader.blob<int32_t>(numParent);
+	if (numTransform != numJoints || numParent != numJoints)
+		return;
+
+	pose.resize(numJoints);
+	for (size_t i = 0; i < numJoints; i++) {
+		pose[i] = joints[i];
+		pose.setJointParent(i, parents[i]);
+	}
+}
+
+
+template<typename Vertex>
+static void writeMesh(CookedWriter& writer, const IMesh* mesh) {
+	const TMesh<Vertex>* typed = static_cast<const TMesh<Vertex>*>(mesh);
+	writer.blob(typed->getVertices().data(), typed->getVertices().size());
+	writer.blob(typed->getIndices().data(), typed->getIndices().size());
+}
+
+
+template<typename Vertex>
+static IMesh* readMesh(CookedReader& reader, std::shared_ptr<const MappedFile> file, const AABB_t& bounds) {
+	size_t numVertex = 0, numIndex = 0;
+	const Vertex* vertices = reader.blob<Vertex>(numVertex);
+	const Index_t* indices = reader.blob<Index_t>(numIndex);
+	if (!reader.isValid() || numVertex == 0)
+		return nullptr;
+
+	TMesh<Vertex>* mesh = new TMesh<Vertex>();
+	mesh->fillMapped(file, vertices, numVertex, indices, numIndex, bounds);
+
+	return mesh;
+}
+
+
+
+fs::path ModelCache::cookedPath(const std::string& sourceFile) {
+	return fs::path(sourceFile + COOKED_MODEL_EXT);
+}
+
+
+ModelImport_t* ModelCache::read(const fs::path& cookedFile, const std::string& sourceFile, int options, MeshLoader::Preset preset) {
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	if (!FileSystem::Default.fileStamp(sourceFile, sourceSize, sourceTime))
+		return nullptr;
+
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (!file->open(cookedFile))
+		return nullptr;
+
+	CookedReader reader(file->data(), file->size());
+	CookedModelHeader_t header;
+	reader.pod(header);
+	if (!reader.isValid()
+		|| header.magic != COOKED_MODEL_MAGIC
+		|| header.version != COOKED_MODEL_VERSION
+		|| header.sourceSize != sourceSize
+		|| header.sourceTime != sourceTime
+		|| header.options != cookedOptions(options)
+		|| header.preset != int32_t(preset))
+		return nullptr;
+
+	std::unique_ptr<ModelImport_t> imported(new ModelImport_t());
+	imported->model.reset(new Model());
+	Model* model = imported->model.get();
+
+	if (header.numJoints > 0) {
+		Pose resPose, invBindPose;
+		readPose(reader, resPose, header.numJoints);
+		readPose(reader, invBindPose, header.numJoints);
+		std::vector<std::string> names(header.numJoints);
+		for (auto& name : names)
+			reader.string(name);
+		glm::mat4 invRootTransform;
+		reader.pod(invRootTransform);
+
+		if (!reader.isValid() || resPose.size() != header.numJoints || invBindPose.size() != header.numJoints)
+			return nullptr;
+
+		Skeleton* skeleton = new Skeleton();
+		skeleton->set(resPose, invBindPose, names, invRootTransform);
+		model->setSkeleton(skeleton);
+	}
+
+	for (uint32_t i = 0; i < header.numClips && reader.isValid(); i++) {
+		std::string name;
+		float duration = 0.f;
+		uint32_t numTracks = 0;
+		reader.string(name);
+		reader.pod(duration);
+		reader.pod(numTracks);
+
+		AnimationClip* clip = new AnimationClip(name, duration);
+		model->addAnimation(clip);
+		clip->resize(MIN(numTracks, header.numJoints));
+		for (size_t t = 0; t < clip->size(); t++) {
+			TransformTrack& track = clip->trackAt(t);
+			int32_t jointId = -1;
+			reader.pod(jointId);
+			track.setJointId(jointId);
+			readTrack(reader, track.getPositionTrack());
+			readTrack(reader, track.getScaleTrack());
+			readTrack(reader, track.getRotationTrack());
+		}
+		clip->buildSampler();
+	}
+
+	for (uint32_t i = 0; i < header.numMeshes && reader.isValid(); i++) {
+		std::string name;
+		int32_t primitive = 0;
+		glm::mat4 transform;
+		AABB_t bounds;
+		reader.string(name);
+		reader.pod(primitive);
+		reader.pod(transform);
+		reader.pod(bounds.minimum);
+		reader.pod(bounds.maximum);
+
+		IMesh* mesh = header.isSkinned ? readMesh<SkinVertex_t>(reader, file, bounds) : readMesh<Vertex_t>(reader, file, bounds);
+		if (!mesh)
+			return nullptr;
+
+		mesh->setName(name);
+		mesh->setPrimitiveType(PrimitiveType(primitive));
+		mesh->setTransform(transform);
+		model->addMesh(mesh);
+
+		MaterialDesc_t desc;
+		uint8_t hasMaterial = 0;
+		reader.pod(hasMaterial);
+		if (hasMaterial) {
+			reader.string(desc.name);
+			reader.pod(desc.diffuseColor);
+			reader.pod(desc.specularColor);
+			reader.pod(desc.emissive);
+			reader.pod(desc.opacity);
+			reader.pod(desc.shininess);
+			reader.string(desc.diffuseMap);
+			reader.string(desc.normalMap);
+			reader.string(desc.specularMap);
+			reader.string(desc.emissiveMap);
+			desc.isValid = true;
+		}
+		imported->materials.push_back(desc);
+	}
+
+	if (!reader.isValid())
+		return nullptr;
+
+	return imported.release();
+}
+
+
+bool ModelCache::write(const fs::path& cookedFile, const std::string& sourceFile, int options, MeshLoader::Preset preset, const ModelImport_t& imported) {
+	const Model* model = imported.model.get();
+	CookedModelHeader_t header;
+	memset(&header, 0, sizeof(header));
+	if (!model || !FileSystem::Default.fileStamp(sourceFile, header.sourceSize, header.sourceTime))
+		return false;
+
+	const Skeleton* skeleton = model->getSkeleton();
+	header.magic = COOKED_MODEL_MAGIC;
+	header.version = COOKED_MODEL_VERSION;
+	header.options = cookedOptions(options);
+	header.preset = int32_t(preset);
+	header.numMeshes = uint32_t(model->meshCount());
+	header.numJoints = skeleton ? uint32_t(skeleton->size()) : 0;
+	header.numClips = uint32_t(model->animationCount());
+	header.isSkinned = model->hasSkeleton() ? 1 : 0;
+
+	// written aside and renamed, a reader never maps a half written file
+	fs::path tempFile = cookedFile;
+	tempFile += ".tmp";
+	{
+		std::ofstream stream(tempFile, std::ios::binary | std::ios::trunc);
+		if (!stream)
+			return false;
+
+		CookedWriter writer(stream);
+		writer.pod(header);
+
+		if (skeleton) {
+			writePose(writer, skeleton->getResPose());
+			writePose(writer, skeleton->getInvBindPose());
+			for (const auto& name : skeleton->getJointNames())
+				writer.string(name);
+			writer.pod(skeleton->getInvRootTransform());
+		}
+
+		for (size_t i = 0; i < model->animationCount(); i++) {
+			AnimationClip* clip = model->animationAt(i);
+			writer.string(clip->getName());
+			writer.pod(clip->getDuration());
+			writer.pod(uint32_t(clip->size()));
+			for (size_t t = 0; t < clip->size(); t++) {
+				TransformTrack& track = clip->trackAt(t);
+				writer.pod(int32_t(track.getJointId()));
+				writeTrack(writer, track.getPositionTrack());
+				writeTrack(writer, track.getScaleTrack());
+				writeTrack(writer, track.getRotationTrack());
+			}
+		}
+
+		for (size_t i = 0; i < model->meshCount(); i++) {
+			const IMesh* mesh = model->meshAt(i);
+			writer.string(mesh->getName());
+			writer.pod(int32_t(mesh->getPrimitiveType()));
+			writer.pod(mesh->getTransform());
+			writer.pod(mesh->getBounds().minimum);
+			writer.pod(mesh->getBounds().maximum);
+			if (header.isSkinned)
+				writeMesh<SkinVertex_t>(writer, mesh);
+			else
+				writeMesh<Vertex_t>(writer, mesh);
+
+			const MaterialDesc_t& desc = imported.materials[i];
+			writer.pod(uint8_t(desc.isValid ? 1 : 0));
+			if (desc.isValid) {
+				writer.string(desc.name);
+				writer.pod(desc.diffuseColor);
+				writer.pod(desc.specularColor);
+				writer.pod(desc.emissive);
+				writer.pod(desc.opacity);
+				writer.pod(desc.shininess);
+				writer.string(desc.diffuseMap);
+				writer.string(desc.normalMap);
+				writer.string(desc.specularMap);
+				writer.string(desc.emissiveMap);
+			}
+		}
+
+		if (!stream)
+			return false;
+	}
+
+	std::error_code error;
+	fs::rename(tempFile, cookedFile, error);
+	if (error) {
+		fs::remove(tempFile, error);
+		return false;
+	}
+
+	return true;
+}
+
+
+int ModelCache::cookedOptions(int options) {
+	return options & (MeshLoader::Option::LoadMaterials | MeshLoader::Option::LoadAnimations);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include"MeshLoader.h"
+#include"FileSystem.h"
+#include<cstdint>
+
+
+// cooked file sits next to its source, "model.fbx" -> "model.fbx.cooked"
+#define COOKED_MODEL_EXT ".cooked"
+#define COOKED_MODEL_MAGIC 0x4c444d43u // "CMDL"
+#define COOKED_MODEL_VERSION 1u
+
+// blobs start at multiples of it, so mapped vertices/keys can be read in place
+#define COOKED_BLOB_ALIGNMENT 16
+
+
+struct CookedModelHeader_t {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceSize; // cooked file is stale when source size, time or load options differ
+	int64_t sourceTime;
+	int32_t options;
+	int32_t preset;
+	uint32_t numMeshes;
+	uint32_t numJoints; // 0 without skeleton
+	uint32_t numClips;
+	uint32_t isSkinned;
+};
+
+
+//
+// binary cache of an imported model: meshes with vertex/index blobs in Vertex_t/SkinVertex_t layout,
+// skeleton with rest & inverse bind pose, animation tracks and material descriptions.
+// reading maps the file, mesh data is not copied but uploaded to gl straight from the mapping.
+//
+class ModelCache {
+public:
+	static fs::path cookedPath(const std::string& sourceFile);
+
+	// nullptr if there is no up to date cooked file for source & options
+	static ModelImport_t* read(const fs::path& cookedFile, const std::string& sourceFile, int options, MeshLoader::Preset preset);
+	static bool write(const fs::path& cookedFile, const std::string& sourceFile, int options, MeshLoader::Preset preset, const ModelImport_t& imported);
+
+protected:
+	static int cookedOptions(int options);
+};
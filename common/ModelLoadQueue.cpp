@@ -0,0 +1,152 @@
+#include"ModelLoadQueue.h"
+#include"Model.h"
+#include"Profiler.h"
+
+
+ModelLoadHandle::ModelLoadHandle(std::weak_ptr<Model> model, State state) :m_state(state)
+, m_model(model) {
+
+}
+
+
+
+ModelLoadQueue::ModelLoadQueue() :m_threads()
+, m_mutex()
+, m_wakeCondition()
+, m_queued()
+, m_imported()
+, m_numInFlight(0)
+, m_isQuit(false) {
+
+}
+
+
+ModelLoadQueue::~ModelLoadQueue() {
+	shutdown();
+}
+
+
+std::shared_ptr<ModelLoadHandle> ModelLoadQueue::load(std::weak_ptr<Model> placeholder, const std::string& file, int options, MeshLoader::Preset preset, const std::string& name) {
+	std::unique_ptr<Request> request(new Request());
+	request->handle = std::make_shared<ModelLoadHandle>(placeholder);
+	request->file = file;
+	request->options = options;
+	request->preset = preset;
+	request->name = name;
+	std::shared_ptr<ModelLoadHandle> handle = request->handle;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isQuit = false;
+		m_queued.push_back(std::move(request));
+		m_numInFlight++;
+
+		// threads start with first request, apps never loading in background pay nothing
+		while (m_threads.size() < MODEL_LOADER_THREADS)
+			m_threads.emplace_back(&ModelLoadQueue::loaderLoop, this);
+	}
+	m_wakeCondition.notify_one();
+
+	return handle;
+}
+
+
+void ModelLoadQueue::update(double budgetMs) {
+	if (m_numInFlight == 0)
+		return;
+
+	PROFILE_SCOPE("ModelLoadQueue::update");
+	auto start = Profiler::Clock::now();
+	auto loader = MeshLoader::getInstance();
+
+	// at least one mesh per frame even if budget is already gone, so every load makes progress
+	while (true) {
+		std::unique_ptr<Request> request;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_imported.empty())
+				return;
+			request = std::move(m_imported.front());
+			m_imported.pop_front();
+		}
+
+		bool isUploaded = !request->imported || request->handle->m_model.expired();
+		while (!isUploaded) {
+			isUploaded = loader->uploadNext(*request->imported);
+			if (std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count() >= budgetMs)
+				break;
+		}
+
+		if (!isUploaded) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_imported.push_front(std::move(request));
+			return;
+		}
+
+		finish(*request);
+		if (std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count() >= budgetMs)
+			return;
+	}
+}
+
+
+void ModelLoadQueue::shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isQuit = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (auto& t : m_threads)
+		t.join();
+
+	m_threads.clear();
+	m_queued.clear();
+	m_imported.clear();
+	m_numInFlight = 0;
+}
+
+
+void ModelLoadQueue::loaderLoop() {
+	while (true) {
+		std::unique_ptr<Request> request;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCondition.wait(lock, [this]() { return m_isQuit || !m_queued.empty(); });
+			if (m_isQuit)
+				return;
+			request = std::move(m_queued.front());
+			m_queued.pop_front();
+		}
+
+		// placeholder removed while queued, nothing to load for
+		if (!request->handle->m_model.expired()) {
+			request->handle->m_state.store(ModelLoadHandle::State::Importing, std::memory_order_release);
+			request->imported.reset(MeshLoader::getInstance()->import(request->file, request->options, request->preset, request->name));
+			request->handle->m_state.store(ModelLoadHandle::State::Uploading, std::memory_order_release);
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_imported.push_back(std::move(request));
+	}
+}
+
+
+void ModelLoadQueue::finish(Request& request) {
+	auto placeholder = request.handle->m_model.lock();
+	if (!placeholder || !request.imported) {
+		request.handle->m_state.store(ModelLoadHandle::State::Failed, std::memory_order_release);
+		m_numInFlight--;
+		return;
+	}
+
+	// placeholder keeps its id, so handles & components holding it see the loaded model
+	*placeholder = std::move(*request.imported->model);
+
+#ifdef _DEBUG
+	std::cout << *placeholder << std::endl;
+#endif // _DEBUG
+
+	request.handle->m_state.store(ModelLoadHandle::State::Ready, std::memory_order_release);
+	m_numInFlight--;
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include"MeshLoader.h"
+#include<atomic>
+#include<condition_variable>
+#include<deque>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+
+// loads importing at the same time, every loader thread blocks in one import for its whole duration
+#define MODEL_LOADER_THREADS 2
+
+// main thread time per frame spent creating materials & gpu buffers of loaded models
+#define MODEL_UPLOAD_BUDGET_MS 2.0
+
+
+//
+// caller's view of a model loading in background.
+// model is a placeholder owned by mesh manager, it stays empty until state turns Ready and is filled in place,
+// so weak pointers taken early remain valid.
+//
+class ModelLoadHandle {
+	friend class ModelLoadQueue;
+
+public:
+	enum class State {
+		Queued,
+		Importing,
+		Uploading,
+		Ready,
+		Failed,
+	};
+
+public:
+	ModelLoadHandle(std::weak_ptr<Model> model, State state = State::Queued);
+
+	ModelLoadHandle(const ModelLoadHandle& other) = delete;
+	ModelLoadHandle& operator = (const ModelLoadHandle& other) = delete;
+
+	inline State getState() const {
+		return m_state.load(std::memory_order_acquire);
+	}
+
+	inline bool isReady() const {
+		return getState() == State::Ready;
+	}
+
+	inline bool isDone() const {
+		State state = getState();
+		return state == State::Ready || state == State::Failed;
+	}
+
+	inline std::weak_ptr<Model> getModel() const {
+		return m_model;
+	}
+
+private:
+	std::atomic<State> m_state;
+	std::weak_ptr<Model> m_model;
+};
+
+
+//
+// two stage model loading.
+// loader threads run cpu stage (MeshLoader::import) of queued requests.
+// main thread runs gpu stage (MeshLoader::uploadNext) of imported models in update(), mesh by mesh within a time budget,
+// then moves finished model into its placeholder.
+// loader threads are dedicated, a multi second import on job system would stall whoever steals it while waiting.
+//
+class ModelLoadQueue {
+public:
+	ModelLoadQueue();
+	~ModelLoadQueue();
+
+	ModelLoadQueue(const ModelLoadQueue& other) = delete;
+	ModelLoadQueue& operator = (const ModelLoadQueue& other) = delete;
+
+	std::shared_ptr<ModelLoadHandle> load(std::weak_ptr<Model> placeholder, const std::string& file, int options, MeshLoader::Preset preset, const std::string& name);
+	void update(double budgetMs = MODEL_UPLOAD_BUDGET_MS); // main thread
+	void shutdown(); // drop queued requests, wait imports in flight
+
+	inline size_t numInFlight() const {
+		return m_numInFlight.load(std::memory_order_acquire);
+	}
+
+protected:
+	struct Request {
+		std::shared_ptr<ModelLoadHandle> handle;
+		std::string file;
+		int options;
+		MeshLoader::Preset preset;
+		std::string name;
+		std::unique_ptr<ModelImport_t> imported;
+	};
+
+	void loaderLoop();
+	void finish(Request& request);
+
+private:
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::deque<std::unique_ptr<Request>> m_queued; // waiting for a loader thread
+	std::deque<std::unique_ptr<Request>> m_imported; // waiting for main thread upload
+	std::atomic<size_t> m_numInFlight;
+	bool m_isQuit;
+};
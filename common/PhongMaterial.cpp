@@ -16,3 +16,15 @@ PhongMaterial::PhongMaterial(const std::string& name) :IMaterial(name, MaterialT
 , m_aoMap() {
 	
 }
+
+
+bool PhongMaterial::hasMissingTexture() const {
+	const std::weak_ptr<Texture>* maps[] = { &m_albedoMap, &m_specularMap, &m_normalMap, &m_aoMap };
+	for (auto map : maps) {
+		auto texture = map->lock();
+		if (texture && texture->isLoadFailed())
+			return true;
+	}
+
+	return false;
+}
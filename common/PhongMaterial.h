@@ -36,6 +36,9 @@ public:
 		return !m_aoMap.expired();
 	}
 
+	// some map's file failed to load asynchronously, material renders with fallback texels in its place
+	bool hasMissingTexture() const;
+
 public:
 	std::weak_ptr<Texture> m_albedoMap;
 	std::weak_ptr<Texture> m_specularMap;
@@ -11,7 +11,7 @@ PointLightShadowMapping::PointLightShadowMapping(IRenderTechnique* rt, const glm
 : IShadowMapping(rt)
 , m_shadowMapResolution(shadowMapResolution)
 , m_shadowViewport(0.f, 0.f, shadowMapResolution.x, shadowMapResolution.y)
-, m_shadowTarget()
+, m_cache(Texture::Target::Texture_CubeMap, 6, [this]() { return createShadowTarget(); })
 , m_shader(nullptr) {
 	
 }
@@ -24,13 +24,21 @@ void PointLightShadowMapping::renderShadow(const Scene_t& scene, const Light_t&
 	if (!light.isCastShadow())
 		return;
 
+	auto renderer = m_renderTech->getRenderer();
+	auto tracker = renderer->getShadowCasterTracker();
+	auto culler = [&light](const MeshRenderItem_t* items, size_t count, uint8_t* masks) {
+		cullCasters(light, items, count, masks);
+	};
+
+	// map is left as it is while light & casters it sees stay put
+	uint64_t lightKey = ShadowCasterTracker::lightKey(light);
+	if (!m_cache.begin(scene, tracker, lightKey, ShadowCasterTracker::lightSignature(light), culler))
+		return;
+
 	m_shader = ShaderProgramManager::getInstance()->addProgram("PointLightShadowPass").lock();
 
-	auto renderer = m_renderTech->getRenderer();
 	renderer->pushShaderProgram(m_shader.get());
-	renderer->pushRenderTarget(m_shadowTarget.get());
 	renderer->pushViewport(&m_shadowViewport);
-	renderer->clearScreen(ClearFlags::Depth);
 
 	if (m_shader->hasUniform("u_lightVP[0]")) {
 		auto transforms = calclightLightCameraMatrixs(light);
@@ -43,20 +51,9 @@ void PointLightShadowMapping::renderShadow(const Scene_t& scene, const Light_t&
 	if (m_shader->hasUniform("u_far"))
 		m_shader->setUniform1("u_far", light.range);
 
-	for (size_t i = 0; i < scene.numOpaqueItems; i++) {
-		m_renderTech->render(scene.opaqueItems[i]);
-	}
-
-	for (size_t i = 0; i < scene.numCutOutItems; i++) {
-		m_renderTech->render(scene.cutOutItems[i]);
-	}
-
-	for (size_t i = 0; i < scene.numTransparentItems; i++) {
-		m_renderTech->render(scene.transparentItems[i]);
-	}
+	m_cache.render(m_renderTech, tracker);
 
 	renderer->popViewport();
-	renderer->popRenderTarget();
 	renderer->popShadrProgram();
 	m_shader->unbindSubroutineUniforms();
 	m_shader = nullptr;
@@ -72,7 +69,7 @@ void PointLightShadowMapping::beginRenderLight(const Light_t& light, ShaderProgr
 	}
 
 	if (shader->hasUniform("u_shadowMap") && light.isCastShadow()) {
-		Texture* shadowMap = m_shadowTarget->getAttachedTexture(RenderTarget::Slot::Depth);
+		Texture* shadowMap = m_cache.getShadowMap(ShadowCasterTracker::lightKey(light));
 		if (shadowMap) {
 			shadowMap->bindToTextureUnit(Texture::Unit::ShadowMap, Texture::Target::Texture_CubeMap);
 			shader->setUniform1("u_shadowMap", int(Texture::Unit::ShadowMap));
@@ -88,7 +85,7 @@ void PointLightShadowMapping::beginRenderLight(const Light_t& light, ShaderProgr
 
 void PointLightShadowMapping::endRenderLight(const Light_t& light, ShaderProgram* shader) {
 	if (light.isCastShadow()) {
-		if (auto shadowMap = m_shadowTarget->getAttachedTexture(RenderTarget::Slot::Depth))
+		if (auto shadowMap = m_cache.getShadowMap(ShadowCasterTracker::lightKey(light)))
 			shadowMap->unbindFromTextureUnit();
 	}
 }
@@ -96,7 +93,22 @@ void PointLightShadowMapping::endRenderLight(const Light_t& light, ShaderProgram
 void PointLightShadowMapping::onShadowMapResolutionChange(float w, float h) {
 	m_shadowMapResolution = { w, h };
 	m_shadowViewport = Viewport_t(0.f, 0.f, w, h);
-	ASSERT(setupShadowRenderTarget());
+	m_cache.clear(); // maps are re-created at new resolution when lights render next
+}
+
+
+void PointLightShadowMapping::cullCasters(const Light_t& light, const MeshRenderItem_t* items, size_t count, uint8_t* masks) {
+	float rangeSq = light.range * light.range;
+	for (size_t i = 0; i < count; i++) {
+		const AABB_t& bounds = items[i].bounds;
+		if (!bounds.isValid()) { // never culled
+			masks[i] = 1;
+			continue;
+		}
+
+		glm::vec3 d = light.position - glm::clamp(light.position, bounds.minimum, bounds.maximum);
+		masks[i] = glm::dot(d, d) <= rangeSq ? 1 : 0;
+	}
 }
 
 
@@ -115,21 +127,21 @@ std::vector<glm::mat4> PointLightShadowMapping::calclightLightCameraMatrixs(cons
 
 
 
-bool PointLightShadowMapping::setupShadowRenderTarget() {
-	m_shadowTarget.reset(new RenderTarget(m_shadowMapResolution));
-	m_shadowTarget->bind();
+std::unique_ptr<RenderTarget> PointLightShadowMapping::createShadowTarget() {
+	std::unique_ptr<RenderTarget> shadowTarget(new RenderTarget(m_shadowMapResolution));
+	shadowTarget->bind();
 
-	if (!m_shadowTarget->attachTextureCube(Texture::Format::Depth24, RenderTarget::Slot::Depth)) {
-		m_shadowTarget->unBind();
-		return false;
+	if (!shadowTarget->attachTextureCube(Texture::Format::Depth24, RenderTarget::Slot::Depth)) {
+		shadowTarget->unBind();
+		return nullptr;
 	}
 
-	if (!m_shadowTarget->isValid()) {
-		m_shadowTarget->unBind();
-		return false;
+	if (!shadowTarget->isValid()) {
+		shadowTarget->unBind();
+		return nullptr;
 	}
 
-	m_shadowTarget->unBind();
+	shadowTarget->unBind();
 
-	return true;
+	return shadowTarget;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include"SpotLightShadowMapping.h"
 #include"RenderTarget.h"
+#include"ShadowMapCache.h"
 #include<memory>
 
 class Renderer;
@@ -12,11 +13,11 @@ public:
 	~PointLightShadowMapping();
 
 	inline bool initialize() override {
-		return setupShadowRenderTarget();
+		return true;
 	}
 
 	inline  void cleanUp() override {
-		m_shadowTarget.release();
+		m_cache.clear();
 	}
 
 	void renderShadow(const Scene_t& scene, const Light_t& light) override;
@@ -24,14 +25,17 @@ public:
 	void endRenderLight(const Light_t& light, ShaderProgram* shader) override;
 	void onShadowMapResolutionChange(float w, float h) override;
 
+	// casters whose bounds touch light range sphere
+	static void cullCasters(const Light_t& light, const MeshRenderItem_t* items, size_t count, uint8_t* masks);
+
 private:
-	bool setupShadowRenderTarget();
+	std::unique_ptr<RenderTarget> createShadowTarget();
 	std::vector<glm::mat4> calclightLightCameraMatrixs(const Light_t& l);
 
 private:
 	glm::vec2 m_shadowMapResolution;
 	Viewport_t m_shadowViewport;
 
-	std::unique_ptr<RenderTarget> m_shadowTarget;
+	ShadowMapCache m_cache;
 	std::shared_ptr<ShaderProgram> m_shader;
 };
\ No newline at end of file
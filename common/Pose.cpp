@@ -1,4 +1,5 @@
 #include"Pose.h"
+#include<algorithm>
 
 Pose::Pose(const Pose& other) {
 	*this = other;
@@ -73,7 +74,27 @@ void Pose::getSkinMatrix(std::vector<glm::mat4>& skinMat) const {
 		skinMat[i] = m;
 	}
 
+	// out of order joints, climb to the nearest computed ancestor and compose back down, every joint is computed once
+	if (i >= size())
+		return;
+
+	std::vector<bool> isComputed(size(), false);
+	std::fill(isComputed.begin(), isComputed.begin() + i, true);
+	std::vector<int> chain;
 	for (; i < size(); i++) {
-		skinMat[i] = transform2Mat(getJointTransformGlobal(i));
+		int joint = i;
+		for (; joint >= 0 && !isComputed[joint]; joint = m_parents[joint]) {
+			isComputed[joint] = true;
+			chain.push_back(joint);
+		}
+
+		for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+			glm::mat4 m = transform2Mat(m_joints[*it]);
+			if (m_parents[*it] >= 0)
+				m = skinMat[m_parents[*it]] * m;
+
+			skinMat[*it] = m;
+		}
+		chain.clear();
 	}
 }
@@ -1,6 +1,13 @@
 #include"PostProcessingManager.h"
 #include"Renderer.h"
+#include"ShaderProgamMgr.h"
+#include"FileSystem.h"
+#include"Profiler.h"
 #include<algorithm>
+#include<fstream>
+#include<sstream>
+#include<iostream>
+#include<cstdint>
 #include"HDRFilter.h"
 #include"HDRFilter2.h"
 #include"GrayFilter.h"
@@ -8,7 +15,16 @@
 
 
 PostProcessingManager::PostProcessingManager(Renderer* renderer) : m_renderer(renderer)
-, m_swapBuffers()
+, m_outputTarget(renderer->getRenderSize())
+, m_isFusion(true)
+, m_signature()
+, m_processors()
+, m_params()
+, m_passes()
+, m_transientSlots()
+, m_transientTextures()
+, m_stageSources()
+, m_stats()
 , m_textureCache()
 , m_filterFactory()
 , m_filterProcessers() {
@@ -23,63 +39,246 @@ PostProcessingManager::~PostProcessingManager() {
 
 
 bool PostProcessingManager::initialize() {
-	auto frontBuffer = std::unique_ptr<Texture>(new Texture());
-	auto backBuffer = std::unique_ptr<Texture>(new Texture());
-	auto renderSz = m_renderer->getRenderSize();
+	// transient textures are created by first chain needing them
+	return true;
+}
 
-	frontBuffer->bindToTextureUnit();
-	if (!frontBuffer->loadImage2DFromMemory(Texture::Format::RGBA, Texture::Format::RGBA, Texture::FormatDataType::UByte, renderSz.x, renderSz.y, nullptr)) {
-		cleanUp();
-#ifdef _DEBUG
-		ASSERT(false);
-#endif // _DEBUG
-		return false;
+
+void PostProcessingManager::cleanUp() {
+	m_signature.clear();
+	m_transientTextures.clear();
+	m_textureCache.clear();
+}
+
+
+Texture* PostProcessingManager::applyFilters(Texture* inputFrame, const FilterComponent** filters, size_t numFilters) {
+	if (numFilters <= 0)
+		return inputFrame;
+
+	if (!compile(filters, numFilters))
+		return inputFrame;
+
+	m_renderer->pushGPUPipelineState(&GPUPipelineState::s_defaultState);
+
+	Texture* frame = inputFrame;
+	for (auto& pass : m_passes) {
+		Texture* output = getTransientTexture(m_transientSlots[pass.output]);
+		if (pass.isPointwise) {
+			runPointwise(&m_processors[pass.firstFilter], &m_params[pass.firstFilter], pass.numFilters, pass.program, frame, output);
+		}
+		else {
+			m_processors[pass.firstFilter]->apply(frame, output, m_params[pass.firstFilter]);
+		}
+		frame = output;
 	}
-	frontBuffer->unbindFromTextureUnit();
 
-	backBuffer->bindToTextureUnit();
-	if (!backBuffer->loadImage2DFromMemory(Texture::Format::RGBA, Texture::Format::RGBA, Texture::FormatDataType::UByte, renderSz.x, renderSz.y, nullptr)) {
-		cleanUp();
+	m_renderer->popGPUPipelineState();
+
+	auto profiler = Profiler::getInstance();
+	profiler->addCounter("PostProcessing::passes", double(m_stats.numPasses));
+	profiler->addCounter("PostProcessing::bandwidthSavedBytes", double(m_stats.bandwidthSaved));
+
+	return frame;
+}
+
+
+void PostProcessingManager::applyPointwise(IFilter* filter, Texture* inputFrame, Texture* outputFrame, const FilterParamGroup* params) {
+	runPointwise(&filter, &params, 1, "PostProcessing_" + filter->getName(), inputFrame, outputFrame);
+}
+
+
+bool PostProcessingManager::compile(const FilterComponent** filters, size_t numFilters) {
+	// filter processors don't change for a name, chain is the same when names & fusion are
+	std::string signature = m_isFusion ? "fused" : "unfused";
+	for (size_t i = 0; i < numFilters; i++)
+		signature += "|" + filters[i]->getName();
+
+	m_params.resize(numFilters);
+	for (size_t i = 0; i < numFilters; i++)
+		m_params[i] = filters[i]->getParams();
+
+	if (signature == m_signature)
+		return true;
+
+	m_signature.clear();
+	m_passes.clear();
+	m_processors.resize(numFilters);
+	for (size_t i = 0; i < numFilters; i++) {
+		m_processors[i] = getFilterProcessor(filters[i]->getName());
+		if (!m_processors[i]) {
 #ifdef _DEBUG
-		ASSERT(false);
+			ASSERT(false);
 #endif // _DEBUG
-		return false;
+			return false;
+		}
+	}
+
+	// runs of pointwise filters make one pass, a stage preparing on its own input starts a new run
+	for (size_t i = 0; i < numFilters; ) {
+		PostProcessingPass_t pass;
+		pass.firstFilter = i;
+		pass.numFilters = 1;
+		pass.isPointwise = m_processors[i]->isPointwise();
+		pass.output = m_passes.size();
+		if (pass.isPointwise) {
+			while (m_isFusion && i + pass.numFilters < numFilters && m_processors[i + pass.numFilters]->isPointwise()
+				&& !m_processors[i + pass.numFilters]->needsPrepare())
+				pass.numFilters++;
+
+			pass.program = "PostProcessing";
+			for (size_t s = 0; s < pass.numFilters; s++)
+				pass.program += "_" + m_processors[i + s]->getName();
+		}
+
+		i += pass.numFilters;
+		m_passes.push_back(pass);
+	}
+
+	// transient of pass k lives until pass k + 1 read it, last one until frame is presented.
+	// first texture whose transients all ended before this one starts is reused
+	std::vector<size_t> textureEnds;
+	m_transientSlots.resize(m_passes.size());
+	for (size_t k = 0; k < m_passes.size(); k++) {
+		size_t end = k + 1 < m_passes.size() ? k + 1 : SIZE_MAX;
+		size_t slot = 0;
+		while (slot < textureEnds.size() && textureEnds[slot] >= k)
+			slot++;
+
+		if (slot == textureEnds.size())
+			textureEnds.push_back(end);
+		else
+			textureEnds[slot] = end;
+		m_transientSlots[k] = slot;
 	}
-	backBuffer->unbindFromTextureUnit();
 
-	m_swapBuffers[0] = std::move(frontBuffer);
-	m_swapBuffers[1] = std::move(backBuffer);
+	auto renderSz = m_renderer->getRenderSize();
+	size_t frameBytes = size_t(renderSz.x) * size_t(renderSz.y) * 4;
+	m_stats.numFilters = numFilters;
+	m_stats.numPasses = m_passes.size();
+	m_stats.numTransients = m_passes.size();
+	m_stats.numTextures = textureEnds.size();
+	m_stats.bandwidthSaved = (numFilters - m_passes.size()) * frameBytes * 2;
+	m_stats.memorySaved = (m_stats.numTransients - m_stats.numTextures) * frameBytes;
+	m_signature = signature;
+
+#ifdef _DEBUG
+	std::cout << "[PostProcessing] " << numFilters << " filters -> " << m_stats.numPasses << " passes, " << m_stats.numTextures << " textures for "
+		<< m_stats.numTransients << " transients, " << (m_stats.bandwidthSaved / 1024) << "KB bandwidth saved per frame" << std::endl;
+#endif // _DEBUG
 
 	return true;
 }
 
 
-void PostProcessingManager::cleanUp() {
-	m_swapBuffers[0] = nullptr;
-	m_swapBuffers[1] = nullptr;
-	m_textureCache.clear();
+void PostProcessingManager::runPointwise(IFilter* const* stages, const FilterParamGroup* const* params, size_t numStages, const std::string& program,
+	Texture* inputFrame, Texture* outputFrame) {
+	if (!inputFrame || !outputFrame || numStages == 0)
+		return;
+
+	if (stages[0]->needsPrepare())
+		stages[0]->prepare(inputFrame, params[0]);
+
+	auto shader_weak = ShaderProgramManager::getInstance()->getProgram(program);
+	if (shader_weak.expired())
+		shader_weak = ShaderProgramManager::getInstance()->addProgramSource(program, generatePointwiseSource(stages, numStages));
+
+	ASSERT(!shader_weak.expired());
+	auto shader = shader_weak.lock();
+
+	m_outputTarget.detachAllTexture();
+	m_outputTarget.attachProxyTexture(outputFrame, RenderTarget::Slot::Color);
+	m_renderer->pushRenderTarget(&m_outputTarget);
+	m_renderer->pushShaderProgram(shader.get());
+
+	inputFrame->bindToTextureUnit(Texture::Unit::Defualt, Texture::Target::Texture_2D);
+	shader->setUniform1("u_Texture", int(Texture::Unit::Defualt));
+	for (size_t i = 0; i < numStages; i++)
+		stages[i]->setPointwiseUniforms(shader.get(), "stage" + std::to_string(i) + "_", params[i]);
+
+	m_renderer->drawFullScreenQuad();
+
+	inputFrame->unbindFromTextureUnit();
+	m_renderer->popShadrProgram();
+	m_renderer->popRenderTarget();
 }
 
 
-Texture* PostProcessingManager::applyFilters(Texture* inputFrame, const FilterComponent** filters, size_t numFilters) {
-	if (numFilters <= 0)
-		return inputFrame;
+std::string PostProcessingManager::generatePointwiseSource(IFilter* const* stages, size_t numStages) {
+	std::stringstream src;
+	src << "#shader vertex\n"
+		<< "#version 450 core\n\n"
+		<< "layout(location = 0) in vec3 a_pos;\n"
+		<< "layout(location = 1) in vec2 a_uv;\n\n"
+		<< "out vec2 frag_uv;\n\n"
+		<< "void main() {\n"
+		<< "\tgl_Position = vec4(a_pos, 1.f);\n"
+		<< "\tfrag_uv = a_uv;\n"
+		<< "}\n\n\n"
+		<< "#shader fragment\n"
+		<< "#version 450 core\n\n"
+		<< "in vec2 frag_uv;\n"
+		<< "out vec4 frag_color;\n\n"
+		<< "uniform sampler2D u_Texture;\n\n";
+
+	for (size_t i = 0; i < numStages; i++) {
+		std::string prefix = "stage" + std::to_string(i) + "_";
+		std::string stage = getStageSource(stages[i]->getPointwiseSource());
+		for (size_t pos = stage.find("STAGE_"); pos != std::string::npos; pos = stage.find("STAGE_", pos + prefix.size()))
+			stage.replace(pos, 6, prefix);
+
+		src << "// " << stages[i]->getName() << "\n" << stage << "\n\n";
+	}
 
-	m_renderer->pushGPUPipelineState(&GPUPipelineState::s_defaultState);
+	src << "void main() {\n"
+		<< "\tvec4 color = texture(u_Texture, frag_uv);\n";
+	for (size_t i = 0; i < numStages; i++)
+		src << "\tcolor = stage" << i << "_apply(color);\n";
+	src << "\tfrag_color = vec4(color.rgb, 1.f);\n"
+		<< "}\n";
 
-	Texture* inFrame = nullptr;
-	Texture* outFrame = nullptr;
-	for (size_t i = 0; i < numFilters; i++) {
-		inFrame = outFrame ? outFrame : inputFrame;
-		outFrame = m_swapBuffers[i % 2].get();
-		IFilter* processor = getFilterProcessor(filters[i]->getName());
-		ASSERT(processor);
-		processor->apply(inFrame, outFrame, filters[i]->getParams());
+	return src.str();
+}
+
+
+const std::string& PostProcessingManager::getStageSource(const std::string& file) {
+	auto pos = m_stageSources.find(file);
+	if (pos != m_stageSources.end())
+		return pos->second;
+
+	std::ifstream ifs((FileSystem::Default.getHomeDirectory() / "res" / "shader" / file).string());
+	std::stringstream src;
+	if (ifs.is_open()) {
+		src << ifs.rdbuf();
+	}
+	else {
+		std::cerr << "Walling: pointwise stage \"" << file << "\" not exist!" << std::endl;
+#ifdef _DEBUG
+		ASSERT(false);
+#endif // _DEBUG
 	}
 
-	m_renderer->popGPUPipelineState();
+	return m_stageSources[file] = src.str();
+}
+
+
+Texture* PostProcessingManager::getTransientTexture(size_t slot) {
+	if (m_transientTextures.size() <= slot)
+		m_transientTextures.resize(slot + 1);
+
+	auto& texture = m_transientTextures[slot];
+	if (!texture) {
+		auto renderSz = m_renderer->getRenderSize();
+		texture.reset(new Texture());
+		texture->bindToTextureUnit();
+		bool ok = texture->loadImage2DFromMemory(Texture::Format::RGBA, Texture::Format::RGBA, Texture::FormatDataType::UByte, renderSz.x, renderSz.y, nullptr);
+		texture->unbindFromTextureUnit();
+
+#ifdef _DEBUG
+		ASSERT(ok);
+#endif // _DEBUG
+	}
 
-	return outFrame;
+	return texture.get();
 }
 
 
@@ -1,14 +1,42 @@
 #pragma once
 #include"Texture.h"
 #include"IFilter.h"
+#include"RenderTarget.h"
 #include<glm/glm.hpp>
 #include<functional>
 
 class Renderer;
 
 
+// one pass of a compiled filter chain
+struct PostProcessingPass_t {
+	size_t firstFilter;
+	size_t numFilters; // more than one only for fused pointwise filters
+	bool isPointwise;
+	std::string program; // generated program of a pointwise pass
+	size_t output; // transient written by this pass, next pass reads it
+
+	PostProcessingPass_t() : firstFilter(0), numFilters(0), isPointwise(false), program(), output(0) {}
+};
+
+
+struct PostProcessingStats_t {
+	size_t numFilters;
+	size_t numPasses;
+	size_t numTransients;
+	size_t numTextures; // textures transients alias into
+	size_t bandwidthSaved; // bytes per frame, a fused pass boundary saves writing & reading back one frame
+	size_t memorySaved; // bytes, transients sharing textures
+
+	PostProcessingStats_t() : numFilters(0), numPasses(0), numTransients(0), numTextures(0), bandwidthSaved(0), memorySaved(0) {}
+};
+
+
 // post processing manager manage filter chain textures 
-// and render filter chain
+// and render filter chain.
+// chain is compiled into passes whenever it changes: runs of pointwise filters become one generated shader,
+// neighborhood filters (blur, histogram) keep their own passes. every pass writes a transient frame,
+// transients whose lifetimes don't overlap alias the same texture.
 class PostProcessingManager {
 	typedef std::unordered_map<Texture::Format, std::vector<std::unique_ptr<Texture>>> TextureCacheContainer;
 	typedef std::function<IFilter* (void)> FilterCreator;
@@ -24,6 +52,25 @@ public:
 	void cleanUp();
 	Texture* applyFilters(Texture* inputFrame, const FilterComponent** filters, size_t numFilters);
 
+	// single pointwise filter outside a compiled chain, for IFilter::apply() of pointwise filters
+	void applyPointwise(IFilter* filter, Texture* inputFrame, Texture* outputFrame, const FilterParamGroup* params);
+
+	inline void setFusion(bool fusion) {
+		m_isFusion = fusion;
+	}
+
+	inline bool isFusion() const {
+		return m_isFusion;
+	}
+
+	inline const std::vector<PostProcessingPass_t>& getPasses() const {
+		return m_passes;
+	}
+
+	inline const PostProcessingStats_t& getStats() const {
+		return m_stats;
+	}
+
 	//
 	// texture cache 
 	//
@@ -64,9 +111,27 @@ public:
 protected:
 	IFilter* getFilterProcessor(const std::string& name);
 
+	// rebuild passes & transient aliasing if chain differs from last compiled one
+	bool compile(const FilterComponent** filters, size_t numFilters);
+	void runPointwise(IFilter* const* stages, const FilterParamGroup* const* params, size_t numStages, const std::string& program,
+		Texture* inputFrame, Texture* outputFrame);
+	std::string generatePointwiseSource(IFilter* const* stages, size_t numStages);
+	const std::string& getStageSource(const std::string& file);
+	Texture* getTransientTexture(size_t slot);
+
 protected:
 	Renderer* m_renderer;
-	std::array<std::unique_ptr<Texture>, 2> m_swapBuffers;
+	RenderTarget m_outputTarget;
+	bool m_isFusion;
+
+	std::string m_signature;
+	std::vector<IFilter*> m_processors;
+	std::vector<const FilterParamGroup*> m_params;
+	std::vector<PostProcessingPass_t> m_passes;
+	std::vector<size_t> m_transientSlots; // transient -> texture
+	std::vector<std::unique_ptr<Texture>> m_transientTextures;
+	std::unordered_map<std::string, std::string> m_stageSources;
+	PostProcessingStats_t m_stats;
 	
 	TextureCacheContainer m_textureCache;
 
@@ -0,0 +1,106 @@
+#include"Profiler.h"
+#include<algorithm>
+#include<numeric>
+#include<iomanip>
+
+
+void Profiler::addSample(const std::string& name, double ms) {
+	if (m_isEnable)
+		record(m_samples, name, ms);
+}
+
+
+void Profiler::addCounter(const std::string& name, double value) {
+	if (m_isEnable)
+		record(m_counters, name, value);
+}
+
+
+void Profiler::clear() {
+	m_samples.clear();
+	m_counters.clear();
+}
+
+
+void Profiler::record(SampleContainer& container, const std::string& name, double value) {
+	auto& samples = container[name];
+	if (samples.capacity() == samples.size())
+		samples.reserve(std::max<size_t>(samples.size() * 2, 1024));
+	samples.push_back(value);
+}
+
+
+double Profiler::percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty())
+		return 0.;
+
+	// linear interpolation between closest ranks
+	double rank = p * (sorted.size() - 1);
+	size_t lo = size_t(rank);
+	size_t hi = std::min(lo + 1, sorted.size() - 1);
+	double t = rank - lo;
+
+	return sorted[lo] * (1. - t) + sorted[hi] * t;
+}
+
+
+void Profiler::dumpJson(std::ostream& o) const {
+	auto flags = o.flags();
+	auto precision = o.precision();
+	o << std::fixed << std::setprecision(4);
+
+	o << "{\n";
+	o << "  \"unit\": \"ms\",\n";
+	o << "  \"samples\": {";
+	dumpSection(o, m_samples);
+	o << "  },\n";
+	o << "  \"counters\": {";
+	dumpSection(o, m_counters);
+	o << "  }\n";
+	o << "}" << std::endl;
+
+	o.flags(flags);
+	o.precision(precision);
+}
+
+
+void Profiler::dumpSection(std::ostream& o, const SampleContainer& container) {
+	bool first = true;
+	for (auto& entry : container) {
+		std::vector<double> sorted = entry.second;
+		std::sort(sorted.begin(), sorted.end());
+		double mean = sorted.empty() ? 0. : std::accumulate(sorted.begin(), sorted.end(), 0.) / sorted.size();
+
+		o << (first ? "\n" : ",\n");
+		o << "    \"" << entry.first << "\": {";
+		o << "\"count\": " << sorted.size();
+		o << ", \"min\": " << (sorted.empty() ? 0. : sorted.front());
+		o << ", \"max\": " << (sorted.empty() ? 0. : sorted.back());
+		o << ", \"mean\": " << mean;
+		o << ", \"p50\": " << percentile(sorted, 0.5);
+		o << ", \"p90\": " << percentile(sorted, 0.9);
+		o << ", \"p95\": " << percentile(sorted, 0.95);
+		o << ", \"p99\": " << percentile(sorted, 0.99);
+		o << "}";
+		first = false;
+	}
+	o << "\n";
+}
+
+
+
+ProfileScope::ProfileScope(const char* name) :m_name(name)
+, m_isRecording(Profiler::getInstance()->isEnable())
+, m_start() {
+	if (m_isRecording)
+		m_start = Profiler::Clock::now();
+}
+
+
+ProfileScope::~ProfileScope() {
+	if (!m_isRecording)
+		return;
+
+	std::chrono::duration<double, std::milli> elapsed = Profiler::Clock::now() - m_start;
+	Profiler::getInstance()->addSample(m_name, elapsed.count());
+}
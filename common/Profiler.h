@@ -0,0 +1,69 @@
+#pragma once
+#include"Singleton.h"
+#include<chrono>
+#include<map>
+#include<ostream>
+#include<string>
+#include<vector>
+
+
+// cpu timing samples & per frame counters collector, used by headless benchmark runs
+class Profiler : public Singleton<Profiler> {
+public:
+	typedef std::chrono::high_resolution_clock Clock;
+	typedef std::map<std::string, std::vector<double>> SampleContainer;
+
+	void addSample(const std::string& name, double ms);
+	void addCounter(const std::string& name, double value);
+	void clear();
+
+	// print per-sample & per-counter min/max/mean and percentiles as json
+	void dumpJson(std::ostream& o) const;
+
+	inline void setEnable(bool enable) {
+		m_isEnable = enable;
+	}
+
+	inline bool isEnable() const {
+		return m_isEnable;
+	}
+
+	inline const SampleContainer& getSamples() const {
+		return m_samples;
+	}
+
+	inline const SampleContainer& getCounters() const {
+		return m_counters;
+	}
+
+protected:
+	static double percentile(const std::vector<double>& sorted, double p);
+	static void record(SampleContainer& container, const std::string& name, double value);
+	static void dumpSection(std::ostream& o, const SampleContainer& container);
+
+private:
+	SampleContainer m_samples;
+	SampleContainer m_counters;
+	bool m_isEnable = false;
+};
+
+
+// record elapsed time of current scope to the profiler
+class ProfileScope {
+public:
+	ProfileScope(const char* name);
+	~ProfileScope();
+
+	ProfileScope(const ProfileScope& other) = delete;
+	ProfileScope& operator = (const ProfileScope& other) = delete;
+
+private:
+	const char* m_name;
+	bool m_isRecording;
+	Profiler::Clock::time_point m_start;
+};
+
+
+#define _PROFILE_SCOPE_NAME(line) _profileScope##line
+#define _PROFILE_SCOPE_DECL(name, line) ProfileScope _PROFILE_SCOPE_NAME(line)(name)
+#define PROFILE_SCOPE(name) _PROFILE_SCOPE_DECL(name, __LINE__)
@@ -0,0 +1,810 @@
+#include"RenderGraph.h"
+#include"Renderer.h"
+#include"Profiler.h"
+#include"Util.h"
+#include<algorithm>
+#include<sstream>
+
+
+RenderGraph::RenderGraph(Renderer* renderer) : m_renderer(renderer)
+, m_resources()
+, m_passes()
+, m_signature()
+, m_schedule()
+, m_compiledPasses()
+, m_compiledResources()
+, m_compiledSchedule()
+, m_finalBarriers(0)
+, m_textures()
+, m_renderTargets()
+, m_stats()
+, m_isTiming(true)
+, m_frame(0)
+, m_timers()
+, m_timings() {
+
+}
+
+
+RenderGraph::~RenderGraph() {
+	releaseResources();
+}
+
+
+void RenderGraph::reset() {
+	m_resources.clear();
+	m_passes.clear();
+	m_schedule.clear();
+}
+
+
+RenderGraphHandle RenderGraph::createTexture(const std::string& name, Texture::Format fmt, size_t width, size_t height) {
+	RenderGraphResource_t resource;
+	resource.name = name;
+	resource.isTexture = true;
+	resource.format = fmt;
+	resource.width = width;
+	resource.height = height;
+	m_resources.push_back(resource);
+
+	return m_resources.size() - 1;
+}
+
+
+RenderGraphHandle RenderGraph::importTexture(const std::string& name, Texture* texture) {
+	RenderGraphResource_t resource;
+	resource.name = name;
+	resource.isTexture = true;
+	resource.isImported = true;
+	resource.texture = texture;
+	if (texture) {
+		resource.format = texture->getFormat();
+		resource.width = texture->getWidth();
+		resource.height = texture->getHeight();
+	}
+	m_resources.push_back(resource);
+
+	return m_resources.size() - 1;
+}
+
+
+RenderGraphHandle RenderGraph::importBuffer(const std::string& name, Buffer* buffer) {
+	RenderGraphResource_t resource;
+	resource.name = name;
+	resource.isImported = true;
+	resource.buffer = buffer;
+	m_resources.push_back(resource);
+
+	return m_resources.size() - 1;
+}
+
+
+size_t RenderGraph::addPass(const std::string& name, bool isCompute, PassExecutor executor) {
+	RenderGraphPass_t pass;
+	pass.name = name;
+	pass.isCompute = isCompute;
+	pass.executor = executor;
+	m_passes.push_back(pass);
+
+	return m_passes.size() - 1;
+}
+
+
+void RenderGraph::read(size_t pass, RenderGraphHandle resource, RenderGraphAccess access) {
+#ifdef _DEBUG
+	ASSERT(pass < m_passes.size() && resource < m_resources.size());
+#endif // _DEBUG
+	m_passes[pass].reads.push_back(RenderGraphAccess_t(resource, access));
+}
+
+
+void RenderGraph::write(size_t pass, RenderGraphHandle resource, RenderGraphAccess access) {
+#ifdef _DEBUG
+	ASSERT(pass < m_passes.size() && resource < m_resources.size());
+#endif // _DEBUG
+	m_passes[pass].writes.push_back(RenderGraphAccess_t(resource, access));
+}
+
+
+void RenderGraph::readAttachment(size_t pass, RenderGraphHandle resource, Slot slot, size_t index) {
+#ifdef _DEBUG
+	ASSERT(pass < m_passes.size() && resource < m_resources.size());
+#endif // _DEBUG
+	RenderGraphAccess_t attachment(resource, RenderGraphAccess::Attachment, slot, index);
+	m_passes[pass].reads.push_back(attachment);
+	m_passes[pass].attachments.push_back(attachment);
+}
+
+
+void RenderGraph::writeAttachment(size_t pass, RenderGraphHandle resource, Slot slot, size_t index) {
+#ifdef _DEBUG
+	ASSERT(pass < m_passes.size() && resource < m_resources.size());
+#endif // _DEBUG
+	RenderGraphAccess_t attachment(resource, RenderGraphAccess::Attachment, slot, index);
+	m_passes[pass].writes.push_back(attachment);
+	m_passes[pass].attachments.push_back(attachment);
+}
+
+
+void RenderGraph::setClearFlags(size_t pass, int flags) {
+	m_passes[pass].clearFlags = flags;
+}
+
+
+void RenderGraph::setSideEffect(size_t pass) {
+	m_passes[pass].hasSideEffect = true;
+}
+
+
+void RenderGraph::setOutput(RenderGraphHandle resource) {
+	m_resources[resource].isOutput = true;
+}
+
+
+bool RenderGraph::compile() {
+	std::string sig = signature();
+	if (sig == m_signature && m_compiledPasses.size() == m_passes.size() && m_compiledResources.size() == m_resources.size()) {
+		for (size_t i = 0; i < m_passes.size(); i++) {
+			m_passes[i].isCulled = m_compiledPasses[i].isCulled;
+			m_passes[i].barriers = m_compiledPasses[i].barriers;
+			m_passes[i].targetKey = m_compiledPasses[i].targetKey;
+			m_passes[i].dependencies = m_compiledPasses[i].dependencies;
+		}
+
+		for (size_t i = 0; i < m_resources.size(); i++) {
+			m_resources[i].firstUse = m_compiledResources[i].firstUse;
+			m_resources[i].lastUse = m_compiledResources[i].lastUse;
+			m_resources[i].slot = m_compiledResources[i].slot;
+		}
+
+		m_schedule = m_compiledSchedule;
+		return true;
+	}
+
+	m_signature.clear();
+	cullPasses();
+	buildDependencies();
+	schedulePasses();
+	if (m_schedule.size() + m_stats.numCulled != m_passes.size()) {
+#ifdef _DEBUG
+		ASSERT(false);
+#endif // _DEBUG
+		return false;
+	}
+
+	aliasTransients();
+	placeBarriers();
+
+	std::vector<size_t> declared;
+	for (size_t i = 0; i < m_passes.size(); i++) {
+		if (!m_passes[i].isCulled)
+			declared.push_back(i);
+	}
+	m_stats.numPasses = m_passes.size();
+	m_stats.numTargetSwitches = countTargetSwitches(m_schedule);
+	m_stats.numTargetSwitchesDeclared = countTargetSwitches(declared);
+
+	m_compiledPasses = m_passes;
+	for (auto& pass : m_compiledPasses)
+		pass.executor = nullptr;
+	m_compiledResources = m_resources;
+	m_compiledSchedule = m_schedule;
+	m_signature = sig;
+
+	return true;
+}
+
+
+void RenderGraph::execute() {
+#ifdef _DEBUG
+	ASSERT(m_renderer);
+#endif // _DEBUG
+
+	if (!allocateTextures())
+		return;
+
+	// passes of one render target run back to back, target is pushed once for all of them.
+	// passes binding their own targets (shadow maps) push on top of it
+	RenderTarget* target = nullptr;
+	for (auto p : m_schedule) {
+		auto& pass = m_passes[p];
+		if (pass.barriers) {
+			GLCALL(glMemoryBarrier(pass.barriers));
+		}
+
+		if (!pass.attachments.empty()) {
+			RenderTarget* passTarget = getRenderTarget(pass);
+			if (passTarget != target) {
+				if (target) m_renderer->popRenderTarget();
+				m_renderer->pushRenderTarget(passTarget);
+				target = passTarget;
+			}
+
+			if (pass.clearFlags)
+				m_renderer->clearScreen(pass.clearFlags);
+		}
+
+		bool isTimed = m_isTiming && beginTimer(pass.name);
+		auto start = Profiler::Clock::now();
+
+		if (pass.executor)
+			pass.executor();
+
+		double ms = std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count();
+		if (isTimed) endTimer();
+
+		m_timings[pass.name].cpuMs = ms;
+		Profiler::getInstance()->addSample("RenderGraph::" + pass.name, ms);
+	}
+
+	if (target)
+		m_renderer->popRenderTarget();
+
+	if (m_finalBarriers) {
+		GLCALL(glMemoryBarrier(m_finalBarriers));
+	}
+
+	m_frame++;
+}
+
+
+Texture* RenderGraph::getTexture(RenderGraphHandle resource) const {
+	if (resource >= m_resources.size())
+		return nullptr;
+
+	return m_resources[resource].texture;
+}
+
+
+void RenderGraph::releaseResources() {
+	for (auto& resource : m_resources) {
+		if (!resource.isImported)
+			resource.texture = nullptr;
+	}
+
+	for (auto& timer : m_timers) {
+		GLCALL(glDeleteQueries(RENDER_GRAPH_TIMER_LATENCY, timer.second.queries));
+	}
+
+	m_renderTargets.clear();
+	m_textures.clear();
+	m_timers.clear();
+}
+
+
+void RenderGraph::dump(std::ostream& o) const {
+	auto accessName = [](RenderGraphAccess access) {
+		switch (access) {
+		case RenderGraphAccess::Attachment: return "attachment";
+		case RenderGraphAccess::Sampled: return "sampled";
+		case RenderGraphAccess::Image: return "image";
+		case RenderGraphAccess::Storage: return "storage";
+		default: return "";
+		}
+	};
+
+	o << "[RenderGraph] " << m_stats.numPasses << " passes, " << m_stats.numCulled << " culled, " << m_stats.numTransients << " transients in "
+		<< m_stats.numTextures << " textures (" << (m_stats.memorySaved / 1024) << "KB saved), " << m_stats.numBarriers << " barriers, "
+		<< m_stats.numTargetSwitches << " target switches (" << m_stats.numTargetSwitchesDeclared << " in declaration order)\n";
+
+	for (size_t i = 0; i < m_schedule.size(); i++) {
+		auto& pass = m_passes[m_schedule[i]];
+		o << "  " << i << " " << pass.name << (pass.isCompute ? " compute" : pass.attachments.empty() ? " own target" : " raster");
+		if (pass.barriers) o << ", barrier 0x" << std::hex << pass.barriers << std::dec;
+		if (pass.clearFlags) o << ", clear 0x" << std::hex << pass.clearFlags << std::dec;
+		o << "\n";
+
+		for (auto& r : pass.reads)
+			o << "    < " << m_resources[r.resource].name << " (" << accessName(r.access) << ")\n";
+		for (auto& w : pass.writes)
+			o << "    > " << m_resources[w.resource].name << " (" << accessName(w.access) << ")\n";
+
+		auto timing = m_timings.find(pass.name);
+		if (timing != m_timings.end())
+			o << "    cpu " << timing->second.cpuMs << "ms, gpu " << timing->second.gpuMs << "ms\n";
+	}
+
+	for (auto& pass : m_passes) {
+		if (pass.isCulled)
+			o << "  culled " << pass.name << "\n";
+	}
+
+	for (auto& resource : m_resources) {
+		if (resource.isImported || !resource.isTexture || resource.slot == SIZE_MAX)
+			continue;
+
+		o << "  " << resource.name << " " << resource.width << "x" << resource.height << " format 0x" << std::hex << int(resource.format) << std::dec
+			<< " passes [" << resource.firstUse << ", ";
+		if (resource.lastUse == SIZE_MAX) o << "output";
+		else o << resource.lastUse;
+		o << "] -> texture " << resource.slot << "\n";
+	}
+
+	o << std::flush;
+}
+
+
+size_t RenderGraph::texelBytes(Texture::Format fmt) {
+	switch (fmt) {
+	case Texture::Format::R8:
+	case Texture::Format::R8UI:
+		return 1;
+	case Texture::Format::RG8:
+	case Texture::Format::R16F:
+	case Texture::Format::Depth16:
+		return 2;
+	case Texture::Format::RGB16F:
+		return 6;
+	case Texture::Format::RG32F:
+	case Texture::Format::RGBA16F:
+	case Texture::Format::Depth32F_Stencil8:
+		return 8;
+	case Texture::Format::RGB32F:
+		return 12;
+	case Texture::Format::RGBA32F:
+		return 16;
+	default: // 8 bits rgba, 32 bits single channel & packed depth/stencil
+		return 4;
+	}
+}
+
+
+GLbitfield RenderGraph::barrierBit(RenderGraphAccess access) {
+	switch (access) {
+	case RenderGraphAccess::Attachment: return GL_FRAMEBUFFER_BARRIER_BIT;
+	case RenderGraphAccess::Sampled: return GL_TEXTURE_FETCH_BARRIER_BIT;
+	case RenderGraphAccess::Image: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+	case RenderGraphAccess::Storage: return GL_SHADER_STORAGE_BARRIER_BIT;
+	default: return 0;
+	}
+}
+
+
+std::string RenderGraph::signature() const {
+	std::stringstream sig;
+	for (auto& resource : m_resources) {
+		sig << resource.name << "," << resource.isTexture << resource.isImported << resource.isOutput << "," << int(resource.format) << ","
+			<< resource.width << "x" << resource.height << ";";
+	}
+
+	auto accesses = [&sig](const std::vector<RenderGraphAccess_t>& list) {
+		for (auto& a : list)
+			sig << a.resource << ":" << int(a.access) << ":" << int(a.slot) << ":" << a.index << ",";
+	};
+
+	for (auto& pass : m_passes) {
+		sig << "|" << pass.name << "," << pass.isCompute << pass.hasSideEffect << "," << pass.clearFlags << ",r";
+		accesses(pass.reads);
+		sig << "w";
+		accesses(pass.writes);
+	}
+
+	return sig.str();
+}
+
+
+bool RenderGraph::isLoadingAttachment(const RenderGraphPass_t& pass, const RenderGraphAccess_t& attachment) {
+	int cleared = 0;
+	if (attachment.slot == Slot::Color) {
+		cleared = ClearFlags::Color;
+	}
+	else if (attachment.slot == Slot::Depth) {
+		cleared = ClearFlags::Depth;
+	}
+	else if (attachment.slot == Slot::Stencil) {
+		cleared = ClearFlags::Stencil;
+	}
+	else {
+		cleared = ClearFlags::Depth | ClearFlags::Stencil;
+	}
+
+	return (pass.clearFlags & cleared) != cleared;
+}
+
+
+void RenderGraph::cullPasses() {
+	// walk back from outputs, a pass lives if it has side effects or writes something a later live pass needs.
+	// an attachment it clears is entirely overwritten, passes before it don't need to produce that resource
+	std::vector<bool> isNeeded(m_resources.size(), false);
+	for (size_t i = 0; i < m_resources.size(); i++)
+		isNeeded[i] = m_resources[i].isOutput;
+
+	m_stats.numCulled = 0;
+	for (size_t i = m_passes.size(); i > 0; i--) {
+		auto& pass = m_passes[i - 1];
+		bool isLive = pass.hasSideEffect;
+		for (auto& w : pass.writes)
+			isLive = isLive || isNeeded[w.resource];
+
+		pass.isCulled = !isLive;
+		if (!isLive) {
+			m_stats.numCulled++;
+			continue;
+		}
+
+		for (auto& a : pass.attachments) {
+			bool isWritten = std::find_if(pass.writes.begin(), pass.writes.end(), [&a](const RenderGraphAccess_t& w) {
+				return w.resource == a.resource;
+			}) != pass.writes.end();
+
+			if (isWritten && !isLoadingAttachment(pass, a))
+				isNeeded[a.resource] = false;
+		}
+
+		for (auto& r : pass.reads)
+			isNeeded[r.resource] = true;
+
+		for (auto& a : pass.attachments) {
+			if (isLoadingAttachment(pass, a))
+				isNeeded[a.resource] = true;
+		}
+	}
+}
+
+
+void RenderGraph::buildDependencies() {
+	// declaration order is program order: reads wait for last writer, writes wait for last writer & readers since
+	std::vector<size_t> lastWriter(m_resources.size(), SIZE_MAX);
+	std::vector<std::vector<size_t>> readers(m_resources.size());
+
+	auto depend = [](RenderGraphPass_t& pass, size_t on) {
+		if (std::find(pass.dependencies.begin(), pass.dependencies.end(), on) == pass.dependencies.end())
+			pass.dependencies.push_back(on);
+	};
+
+	for (size_t i = 0; i < m_passes.size(); i++) {
+		auto& pass = m_passes[i];
+		pass.dependencies.clear();
+		if (pass.isCulled)
+			continue;
+
+		for (auto& r : pass.reads) {
+			if (lastWriter[r.resource] != SIZE_MAX)
+				depend(pass, lastWriter[r.resource]);
+			readers[r.resource].push_back(i);
+		}
+
+		for (auto& a : pass.attachments) {
+			if (isLoadingAttachment(pass, a) && lastWriter[a.resource] != SIZE_MAX)
+				depend(pass, lastWriter[a.resource]);
+		}
+
+		for (auto& w : pass.writes) {
+			if (lastWriter[w.resource] != SIZE_MAX)
+				depend(pass, lastWriter[w.resource]);
+			for (auto reader : readers[w.resource]) {
+				if (reader != i)
+					depend(pass, reader);
+			}
+			lastWriter[w.resource] = i;
+			readers[w.resource].clear();
+		}
+
+		// stable key of attachment set, passes sharing it share a render target
+		std::vector<std::string> keys;
+		for (auto& a : pass.attachments)
+			keys.push_back(std::to_string(a.resource) + "@" + std::to_string(int(a.slot)) + ":" + std::to_string(a.index));
+		std::sort(keys.begin(), keys.end());
+		keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+		pass.targetKey.clear();
+		for (auto& key : keys)
+			pass.targetKey += key + ";";
+	}
+}
+
+
+void RenderGraph::schedulePasses() {
+	// ready pass on the current render target first, then passes not on a graph target (compute, shadow maps) so
+	// they run before a target run rather than splitting it, then declaration order
+	std::vector<size_t> numWaiting(m_passes.size(), 0);
+	std::vector<std::vector<size_t>> dependents(m_passes.size());
+	std::vector<size_t> ready;
+	for (size_t i = 0; i < m_passes.size(); i++) {
+		if (m_passes[i].isCulled)
+			continue;
+
+		numWaiting[i] = m_passes[i].dependencies.size();
+		for (auto on : m_passes[i].dependencies)
+			dependents[on].push_back(i);
+
+		if (numWaiting[i] == 0)
+			ready.push_back(i);
+	}
+
+	m_schedule.clear();
+	std::string currentKey;
+	while (!ready.empty()) {
+		size_t pick = SIZE_MAX;
+		int pickRank = 3;
+		for (size_t r = 0; r < ready.size(); r++) {
+			auto& pass = m_passes[ready[r]];
+			int rank = 2;
+			if (!pass.targetKey.empty() && pass.targetKey == currentKey) {
+				rank = 0;
+			}
+			else if (pass.targetKey.empty()) {
+				rank = 1;
+			}
+
+			if (rank < pickRank || (rank == pickRank && ready[r] < ready[pick])) {
+				pick = r;
+				pickRank = rank;
+			}
+		}
+
+		size_t p = ready[pick];
+		ready.erase(ready.begin() + pick);
+		m_schedule.push_back(p);
+
+		auto& pass = m_passes[p];
+		if (!pass.targetKey.empty()) {
+			currentKey = pass.targetKey;
+		}
+		else if (!pass.isCompute) {
+			currentKey.clear(); // bound its own target
+		}
+
+		for (auto d : dependents[p]) {
+			if (--numWaiting[d] == 0)
+				ready.push_back(d);
+		}
+	}
+}
+
+
+void RenderGraph::aliasTransients() {
+	for (auto& resource : m_resources) {
+		resource.firstUse = SIZE_MAX;
+		resource.lastUse = 0;
+		resource.slot = SIZE_MAX;
+	}
+
+	auto use = [this](RenderGraphHandle handle, size_t position) {
+		auto& resource = m_resources[handle];
+		resource.firstUse = MIN(resource.firstUse, position);
+		resource.lastUse = MAX(resource.lastUse, position);
+	};
+
+	for (size_t i = 0; i < m_schedule.size(); i++) {
+		auto& pass = m_passes[m_schedule[i]];
+		for (auto& r : pass.reads) use(r.resource, i);
+		for (auto& w : pass.writes) use(w.resource, i);
+		for (auto& a : pass.attachments) use(a.resource, i);
+	}
+
+	std::vector<size_t> transients;
+	for (size_t i = 0; i < m_resources.size(); i++) {
+		auto& resource = m_resources[i];
+		if (resource.isImported || !resource.isTexture || resource.firstUse == SIZE_MAX)
+			continue;
+
+		if (resource.isOutput)
+			resource.lastUse = SIZE_MAX;
+		transients.push_back(i);
+	}
+
+	std::sort(transients.begin(), transients.end(), [this](size_t a, size_t b) {
+		return m_resources[a].firstUse < m_resources[b].firstUse;
+	});
+
+	// first texture of same format & size whose transients all ended before this one starts is reused
+	std::vector<size_t> textureEnds;
+	std::vector<size_t> textureOwners; // first transient of texture, gives its format & size
+	size_t transientBytes = 0, textureBytes = 0;
+	for (auto t : transients) {
+		auto& resource = m_resources[t];
+		size_t slot = 0;
+		for (; slot < textureEnds.size(); slot++) {
+			auto& owner = m_resources[textureOwners[slot]];
+			if (owner.format == resource.format && owner.width == resource.width && owner.height == resource.height && textureEnds[slot] < resource.firstUse)
+				break;
+		}
+
+		size_t bytes = texelBytes(resource.format) * resource.width * resource.height;
+		if (slot == textureEnds.size()) {
+			textureEnds.push_back(resource.lastUse);
+			textureOwners.push_back(t);
+			textureBytes += bytes;
+		}
+		else {
+			textureEnds[slot] = resource.lastUse;
+		}
+		resource.slot = slot;
+		transientBytes += bytes;
+	}
+
+	m_stats.numTransients = transients.size();
+	m_stats.numTextures = textureEnds.size();
+	m_stats.memorySaved = transientBytes - textureBytes;
+}
+
+
+void RenderGraph::placeBarriers() {
+	// image & storage writes aren't visible to later commands until a barrier for the way they are read.
+	// a barrier covers all writes before it, bits already issued since a write aren't issued again
+	std::vector<bool> isIncoherent(m_resources.size(), false);
+	std::vector<GLbitfield> visible(m_resources.size(), 0);
+
+	m_stats.numBarriers = 0;
+	for (auto p : m_schedule) {
+		auto& pass = m_passes[p];
+		GLbitfield bits = 0;
+		auto access = [&](const RenderGraphAccess_t& a) {
+			if (isIncoherent[a.resource])
+				bits |= barrierBit(a.access) & ~visible[a.resource];
+		};
+
+		for (auto& r : pass.reads) access(r);
+		for (auto& w : pass.writes) access(w);
+
+		pass.barriers = bits;
+		if (bits) {
+			m_stats.numBarriers++;
+			for (size_t i = 0; i < m_resources.size(); i++) {
+				if (isIncoherent[i])
+					visible[i] |= bits;
+			}
+		}
+
+		for (auto& w : pass.writes) {
+			isIncoherent[w.resource] = w.access == RenderGraphAccess::Image || w.access == RenderGraphAccess::Storage;
+			visible[w.resource] = 0;
+		}
+	}
+
+	// outputs are fetched as textures after frame
+	m_finalBarriers = 0;
+	for (size_t i = 0; i < m_resources.size(); i++) {
+		if (m_resources[i].isOutput && isIncoherent[i])
+			m_finalBarriers |= GL_TEXTURE_FETCH_BARRIER_BIT & ~visible[i];
+	}
+
+	if (m_finalBarriers)
+		m_stats.numBarriers++;
+}
+
+
+size_t RenderGraph::countTargetSwitches(const std::vector<size_t>& order) const {
+	size_t switches = 0;
+	std::string currentKey;
+	for (auto p : order) {
+		auto& pass = m_passes[p];
+		if (!pass.targetKey.empty() && pass.targetKey != currentKey) {
+			switches++;
+			currentKey = pass.targetKey;
+		}
+		else if (pass.targetKey.empty() && !pass.isCompute) {
+			switches++;
+			currentKey.clear();
+		}
+	}
+
+	return switches;
+}
+
+
+bool RenderGraph::allocateTextures() {
+	bool isChanged = false;
+	for (auto& resource : m_resources) {
+		if (resource.isImported || resource.slot == SIZE_MAX)
+			continue;
+
+		if (m_textures.size() <= resource.slot)
+			m_textures.resize(resource.slot + 1);
+
+		auto& texture = m_textures[resource.slot];
+		if (!texture.texture || texture.format != resource.format || texture.width != resource.width || texture.height != resource.height) {
+			texture.texture.reset(new Texture());
+			texture.texture->allocStorage2D(resource.format, resource.width, resource.height);
+			texture.format = resource.format;
+			texture.width = resource.width;
+			texture.height = resource.height;
+
+			texture.texture->bindToTextureUnit();
+			texture.texture->setWrapMode(Texture::WrapType::S, Texture::WrapMode::Clamp_To_Edge);
+			texture.texture->setWrapMode(Texture::WrapType::T, Texture::WrapMode::Clamp_To_Edge);
+			texture.texture->unbindFromTextureUnit();
+			texture.isLinear = !resource.isOutput; // forces filter below
+			isChanged = true;
+		}
+
+		// passes fetch graph textures at texel centers, outputs are sampled by post processing (bilinear downsamples)
+		if (texture.isLinear != resource.isOutput) {
+			auto mode = resource.isOutput ? Texture::FilterMode::Liner : Texture::FilterMode::Nearest;
+			texture.texture->bindToTextureUnit();
+			texture.texture->setFilterMode(Texture::FilterType::Minification, mode);
+			texture.texture->setFilterMode(Texture::FilterType::Magnification, mode);
+			texture.texture->unbindFromTextureUnit();
+			texture.isLinear = resource.isOutput;
+		}
+
+		resource.texture = texture.texture.get();
+	}
+
+	// targets may still reference deleted textures
+	if (isChanged)
+		m_renderTargets.clear();
+
+	return true;
+}
+
+
+RenderTarget* RenderGraph::getRenderTarget(const RenderGraphPass_t& pass) {
+	std::string key;
+	for (auto& a : pass.attachments) {
+		Texture* texture = m_resources[a.resource].texture;
+		if (!texture)
+			return nullptr;
+		key += std::to_string(texture->getHandler()) + "@" + std::to_string(int(a.slot)) + ":" + std::to_string(a.index) + ";";
+	}
+
+	auto pos = m_renderTargets.find(key);
+	if (pos != m_renderTargets.end())
+		return pos->second.get();
+
+	Texture* first = m_resources[pass.attachments.front().resource].texture;
+	std::unique_ptr<RenderTarget> target(new RenderTarget(glm::vec2(first->getWidth(), first->getHeight())));
+	std::vector<int> drawLocations;
+	target->bind();
+	for (auto& a : pass.attachments) {
+		if (target->getAttachedTexture(a.slot, a.index))
+			continue;
+
+		target->attachProxyTexture(m_resources[a.resource].texture, a.slot, a.index);
+		if (a.slot == Slot::Color)
+			drawLocations.push_back(int(a.index));
+	}
+	std::sort(drawLocations.begin(), drawLocations.end());
+	target->setDrawLocations(drawLocations);
+
+#ifdef _DEBUG
+	ASSERT(target->isValid());
+#endif // _DEBUG
+
+	target->unBind();
+
+	RenderTarget* result = target.get();
+	m_renderTargets[key] = std::move(target);
+
+	return result;
+}
+
+
+bool RenderGraph::beginTimer(const std::string& name) {
+	auto pos = m_timers.find(name);
+	if (pos == m_timers.end()) {
+		Timer timer;
+		GLCALL(glGenQueries(RENDER_GRAPH_TIMER_LATENCY, timer.queries));
+		for (size_t i = 0; i < RENDER_GRAPH_TIMER_LATENCY; i++)
+			timer.isPending[i] = false;
+		pos = m_timers.insert(std::make_pair(name, timer)).first;
+	}
+
+	// query of this slot was issued latency frames ago, skip timing rather than wait if gpu is still behind
+	auto& timer = pos->second;
+	size_t slot = m_frame % RENDER_GRAPH_TIMER_LATENCY;
+	if (timer.isPending[slot]) {
+		GLint isAvailable = 0;
+		GLCALL(glGetQueryObjectiv(timer.queries[slot], GL_QUERY_RESULT_AVAILABLE, &isAvailable));
+		if (!isAvailable)
+			return false;
+
+		GLuint64 ns = 0;
+		GLCALL(glGetQueryObjectui64v(timer.queries[slot], GL_QUERY_RESULT, &ns));
+		double ms = double(ns) / 1000000.0;
+		m_timings[name].gpuMs = ms;
+		Profiler::getInstance()->addSample("RenderGraph::" + name + "::gpu", ms);
+		timer.isPending[slot] = false;
+	}
+
+	GLCALL(glBeginQuery(GL_TIME_ELAPSED, timer.queries[slot]));
+	timer.isPending[slot] = true;
+
+	return true;
+}
+
+
+void RenderGraph::endTimer() {
+	GLCALL(glEndQuery(GL_TIME_ELAPSED));
+}
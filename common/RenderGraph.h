@@ -0,0 +1,240 @@
+#pragma once
+#include"Texture.h"
+#include"RenderTarget.h"
+#include<functional>
+#include<map>
+#include<memory>
+#include<ostream>
+#include<string>
+#include<unordered_map>
+#include<vector>
+
+
+// frames gpu pass timings trail behind
+#define RENDER_GRAPH_TIMER_LATENCY 3
+
+#define RENDER_GRAPH_NULL_HANDLE SIZE_MAX
+
+
+class Renderer;
+class Buffer;
+
+typedef size_t RenderGraphHandle;
+
+
+enum class RenderGraphAccess {
+	Attachment, // bound to render target of pass
+	Sampled, // texture fetch
+	Image, // image load/store, incoherent writes
+	Storage, // shader storage buffer, incoherent writes
+};
+
+
+struct RenderGraphResource_t {
+	std::string name;
+	bool isTexture;
+	bool isImported;
+	bool isOutput; // read after frame, not culled, never aliased
+	Texture::Format format; // transient texture
+	size_t width;
+	size_t height;
+	Texture* texture; // imported, or aliased one while executing
+	Buffer* buffer; // imported, nullptr only orders passes
+
+	// compiled
+	size_t firstUse; // position in schedule
+	size_t lastUse;
+	size_t slot; // graph texture transient aliases
+
+	RenderGraphResource_t() : name(), isTexture(false), isImported(false), isOutput(false), format(Texture::Format::Unknown), width(0), height(0)
+		, texture(nullptr), buffer(nullptr), firstUse(SIZE_MAX), lastUse(0), slot(SIZE_MAX) {}
+};
+
+
+struct RenderGraphAccess_t {
+	RenderGraphHandle resource;
+	RenderGraphAccess access;
+	RenderTarget::Slot slot; // of an attachment
+	size_t index;
+
+	RenderGraphAccess_t(RenderGraphHandle res, RenderGraphAccess acc, RenderTarget::Slot s = RenderTarget::Slot::Color, size_t i = 0) : resource(res)
+		, access(acc), slot(s), index(i) {}
+};
+
+
+struct RenderGraphPass_t {
+	std::string name;
+	bool isCompute;
+	bool hasSideEffect; // never culled
+	int clearFlags; // render target cleared before pass, cleared attachments don't load previous content
+	std::function<void()> executor;
+	std::vector<RenderGraphAccess_t> reads;
+	std::vector<RenderGraphAccess_t> writes;
+	std::vector<RenderGraphAccess_t> attachments; // read or written, make up render target of pass
+
+	// compiled
+	bool isCulled;
+	GLbitfield barriers; // issued before pass
+	std::string targetKey; // passes with same key share render target, empty if pass binds its own
+	std::vector<size_t> dependencies;
+
+	RenderGraphPass_t() : name(), isCompute(false), hasSideEffect(false), clearFlags(0), executor(), reads(), writes(), attachments()
+		, isCulled(false), barriers(0), targetKey(), dependencies() {}
+};
+
+
+struct RenderGraphStats_t {
+	size_t numPasses;
+	size_t numCulled;
+	size_t numTransients;
+	size_t numTextures; // textures transients alias into
+	size_t memorySaved; // bytes, transients sharing textures
+	size_t numBarriers;
+	size_t numTargetSwitches;
+	size_t numTargetSwitchesDeclared; // same passes run in declaration order
+
+	RenderGraphStats_t() : numPasses(0), numCulled(0), numTransients(0), numTextures(0), memorySaved(0), numBarriers(0), numTargetSwitches(0)
+		, numTargetSwitchesDeclared(0) {}
+};
+
+
+struct RenderGraphTiming_t {
+	double cpuMs;
+	double gpuMs; // few frames late, 0 until first query read back
+
+	RenderGraphTiming_t() : cpuMs(0), gpuMs(0) {}
+};
+
+
+//
+// frame graph a render technique declares each frame: passes with the resources they read & write, and what frame outputs.
+// compile culls passes nothing needs, orders the rest by their dependencies while keeping passes of one render target together,
+// gives every transient texture a lifetime & lets transients with disjoint lifetimes share a texture,
+// and places memory barriers after image/storage writes before whatever reads them.
+// schedule is cached while declarations stay the same, executors are taken every frame.
+//
+class RenderGraph {
+public:
+	typedef std::function<void()> PassExecutor;
+	typedef RenderTarget::Slot Slot;
+
+public:
+	RenderGraph(Renderer* renderer = nullptr);
+	~RenderGraph();
+
+	RenderGraph(const RenderGraph& other) = delete;
+	RenderGraph& operator = (const RenderGraph& other) = delete;
+
+	//
+	// declarations, start over every frame
+	//
+	void reset();
+
+	RenderGraphHandle createTexture(const std::string& name, Texture::Format fmt, size_t width, size_t height);
+	RenderGraphHandle importTexture(const std::string& name, Texture* texture);
+	RenderGraphHandle importBuffer(const std::string& name, Buffer* buffer); // null buffer is only for ordering, eg. shadow maps a pass renders itself
+
+	size_t addPass(const std::string& name, bool isCompute, PassExecutor executor);
+
+	void read(size_t pass, RenderGraphHandle resource, RenderGraphAccess access);
+	void write(size_t pass, RenderGraphHandle resource, RenderGraphAccess access);
+	void readAttachment(size_t pass, RenderGraphHandle resource, Slot slot, size_t index = 0); // eg. depth test without depth writes
+	void writeAttachment(size_t pass, RenderGraphHandle resource, Slot slot, size_t index = 0);
+
+	void setClearFlags(size_t pass, int flags);
+	void setSideEffect(size_t pass);
+	void setOutput(RenderGraphHandle resource);
+
+	//
+	// compile & run
+	//
+	bool compile();
+	void execute();
+
+	Texture* getTexture(RenderGraphHandle resource) const;
+
+	// release textures, render targets & timer queries
+	void releaseResources();
+
+	// schedule, lifetimes & barriers of last compile, techniques expose their graph through getRenderGraph()
+	void dump(std::ostream& o) const;
+
+	inline void setRenderer(Renderer* renderer) {
+		m_renderer = renderer;
+	}
+
+	inline const std::vector<RenderGraphPass_t>& getPasses() const {
+		return m_passes;
+	}
+
+	inline const std::vector<size_t>& getSchedule() const {
+		return m_schedule;
+	}
+
+	inline const RenderGraphStats_t& getStats() const {
+		return m_stats;
+	}
+
+	inline const std::map<std::string, RenderGraphTiming_t>& getTimings() const {
+		return m_timings;
+	}
+
+	inline void setTiming(bool timing) {
+		m_isTiming = timing;
+	}
+
+	inline bool isTiming() const {
+		return m_isTiming;
+	}
+
+	static size_t texelBytes(Texture::Format fmt);
+	static GLbitfield barrierBit(RenderGraphAccess access);
+
+protected:
+	struct Timer {
+		GLuint queries[RENDER_GRAPH_TIMER_LATENCY];
+		bool isPending[RENDER_GRAPH_TIMER_LATENCY];
+	};
+
+	struct GraphTexture {
+		std::unique_ptr<Texture> texture;
+		Texture::Format format;
+		size_t width;
+		size_t height;
+		bool isLinear;
+	};
+
+	std::string signature() const;
+	void cullPasses();
+	void buildDependencies();
+	void schedulePasses();
+	void aliasTransients();
+	void placeBarriers();
+	size_t countTargetSwitches(const std::vector<size_t>& order) const;
+	static bool isLoadingAttachment(const RenderGraphPass_t& pass, const RenderGraphAccess_t& attachment);
+
+	bool allocateTextures();
+	RenderTarget* getRenderTarget(const RenderGraphPass_t& pass);
+	bool beginTimer(const std::string& name);
+	void endTimer();
+
+protected:
+	Renderer* m_renderer;
+	std::vector<RenderGraphResource_t> m_resources;
+	std::vector<RenderGraphPass_t> m_passes;
+
+	std::string m_signature;
+	std::vector<size_t> m_schedule;
+	std::vector<RenderGraphPass_t> m_compiledPasses; // culling, barriers & target keys of last compile, without executors
+	std::vector<RenderGraphResource_t> m_compiledResources; // lifetimes & aliasing of last compile
+	std::vector<size_t> m_compiledSchedule;
+	GLbitfield m_finalBarriers; // outputs written incoherently are fetched after frame
+	std::vector<GraphTexture> m_textures;
+	std::unordered_map<std::string, std::unique_ptr<RenderTarget>> m_renderTargets;
+	RenderGraphStats_t m_stats;
+
+	bool m_isTiming;
+	size_t m_frame;
+	std::unordered_map<std::string, Timer> m_timers;
+	std::map<std::string, RenderGraphTiming_t> m_timings;
+};
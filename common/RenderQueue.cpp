@@ -0,0 +1,236 @@
+#include"RenderQueue.h"
+#include"FrameAllocator.h"
+#include"IMaterial.h"
+#include"FrustumCuller.h"
+#include<cstring>
+#include<algorithm>
+
+
+#define INITIAL_QUEUE_CAPACITY 256
+
+
+RenderQueueStats::RenderQueueStats() {
+	reset();
+}
+
+void RenderQueueStats::reset() {
+	numItems = 0;
+	numDropped = 0;
+	numCulled = 0;
+	numShaderChanges = 0;
+	numMaterialChanges = 0;
+	numVAOChanges = 0;
+}
+
+RenderQueueStats& RenderQueueStats::operator += (const RenderQueueStats& other) {
+	numItems += other.numItems;
+	numDropped += other.numDropped;
+	numCulled += other.numCulled;
+	numShaderChanges += other.numShaderChanges;
+	numMaterialChanges += other.numMaterialChanges;
+	numVAOChanges += other.numVAOChanges;
+	return *this;
+}
+
+
+
+RenderQueue::RenderQueue(FrameAllocator* allocator, unsigned pass, SortOrder order, size_t maxItems) :m_allocator(allocator)
+, m_items(nullptr)
+, m_numItems(0)
+, m_numVisible(0)
+, m_capacity(0)
+, m_maxItems(maxItems)
+, m_pass(pass & 0x3)
+, m_order(order)
+, m_stats() {
+
+}
+
+
+bool RenderQueue::push(const MeshRenderItem_t& item) {
+	if (!item.vao || !item.material || m_numItems >= m_maxItems) {
+		m_stats.numDropped++;
+		return false;
+	}
+
+	if (m_numItems >= m_capacity)
+		grow();
+
+	m_items[m_numItems++] = item;
+	m_numVisible = m_numItems;
+	m_stats.numItems = m_numItems;
+
+	return true;
+}
+
+
+void RenderQueue::reset() {
+	// memory is owned by frame allocator, will be reclaimed by it's clear
+	m_items = nullptr;
+	m_numItems = 0;
+	m_numVisible = 0;
+	m_capacity = 0;
+	m_stats.reset();
+}
+
+
+void RenderQueue::grow() {
+	size_t newCapacity = std::min(std::max<size_t>(m_capacity * 2, INITIAL_QUEUE_CAPACITY), m_maxItems);
+	auto newItems = reinterpret_cast<MeshRenderItem_t*>(m_allocator->allocAligned(UINT32(newCapacity * sizeof(MeshRenderItem_t)), 16));
+	if (m_numItems > 0)
+		memcpy(newItems, m_items, m_numItems * sizeof(MeshRenderItem_t));
+
+	m_allocator->free(reinterpret_cast<UINT8*>(m_items));
+	m_items = newItems;
+	m_capacity = newCapacity;
+}
+
+
+size_t RenderQueue::cull(const Frustum& frustum, FrustumCuller& culler) {
+	if (m_numItems <= 0)
+		return 0;
+
+	culler.clear();
+	for (size_t i = 0; i < m_numItems; i++)
+		culler.add(m_items[i].bounds);
+
+	auto masks = m_allocator->allocAligned(UINT32(m_numItems), 16);
+	memset(masks, 0, m_numItems);
+	m_numVisible = culler.cull(frustum, masks, 1);
+
+	// stable partition, culled items are still needed as shadow casters
+	if (m_numVisible < m_numItems) {
+		auto partitioned = reinterpret_cast<MeshRenderItem_t*>(m_allocator->allocAligned(UINT32(m_numItems * sizeof(MeshRenderItem_t)), 16));
+		size_t front = 0;
+		size_t back = m_numVisible;
+		for (size_t i = 0; i < m_numItems; i++)
+			partitioned[masks[i] ? front++ : back++] = m_items[i];
+
+		m_allocator->free(reinterpret_cast<UINT8*>(m_items));
+		m_items = partitioned;
+		m_capacity = m_numItems;
+	}
+
+	m_allocator->free(masks);
+	m_stats.numCulled = m_numItems - m_numVisible;
+
+	return m_numVisible;
+}
+
+
+unsigned RenderQueue::shaderBits(const MeshRenderItem_t& item) {
+	// material type select shading subroutine, bones select transform subroutine
+	unsigned matType = item.material ? unsigned(item.material->getType()) : 0;
+	return ((matType & 0x1f) << 1) | (item.boneCount > 0 ? 1 : 0);
+}
+
+
+unsigned RenderQueue::pointerBits(const void* p) {
+	// fibonacci hashing, equal pointers always map to equal bits
+	return unsigned((uint64_t(reinterpret_cast<uintptr_t>(p)) * 0x9E3779B97F4A7C15ull) >> 48);
+}
+
+
+unsigned RenderQueue::geometryBits(const MeshRenderItem_t& item) {
+	// meshes in shared buffers have one vao, index range tells them apart so instances of a mesh still cluster
+	uint64_t geometry = uint64_t(reinterpret_cast<uintptr_t>(item.vao)) + uint64_t(item.indexOffset) * 0x10001ull;
+	return unsigned((geometry * 0x9E3779B97F4A7C15ull) >> 48);
+}
+
+
+uint64_t RenderQueue::makeSortKey(const MeshRenderItem_t& item, float depth) const {
+	uint64_t pass = m_pass;
+	uint64_t shader = shaderBits(item) & 0x3f;
+	uint64_t material = pointerBits(item.material);
+	uint64_t vao = geometryBits(item);
+	uint64_t d = uint64_t(glm::clamp(depth, 0.f, 1.f) * float(0xffffff)) & 0xffffff;
+
+	if (m_order == SortOrder::FrontToBack)
+		return (pass << 62) | (shader << 56) | (material << 40) | (vao << 24) | d;
+
+	return (pass << 62) | ((0xffffff - d) << 38) | (shader << 32) | (material << 16) | vao;
+}
+
+
+void RenderQueue::sort(const Camera_t* camera) {
+	if (m_numVisible <= 1) {
+		countStateChanges();
+		return;
+	}
+
+	struct KeyIndex {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	glm::vec3 viewPos = camera ? camera->position : glm::vec3(0.f);
+	glm::vec3 viewDir = camera ? glm::normalize(camera->lookDirection) : glm::vec3(0.f, 0.f, -1.f);
+	float invFar = camera && camera->far > 0.f ? 1.f / camera->far : 1e-3f;
+
+	auto keys = reinterpret_cast<KeyIndex*>(m_allocator->allocAligned(UINT32(m_numVisible * sizeof(KeyIndex)), 16));
+	auto temp = reinterpret_cast<KeyIndex*>(m_allocator->allocAligned(UINT32(m_numVisible * sizeof(KeyIndex)), 16));
+
+	for (size_t i = 0; i < m_numVisible; i++) {
+		glm::vec3 pos = glm::vec3(m_items[i].modelMatrix[3]);
+		float depth = glm::dot(pos - viewPos, viewDir) * invFar;
+		keys[i].key = makeSortKey(m_items[i], depth);
+		keys[i].index = uint32_t(i);
+	}
+
+	// lsd radix sort, 8 bits per pass, passes where all keys share the digit are skipped
+	size_t histogram[256];
+	for (unsigned shift = 0; shift < 64; shift += 8) {
+		memset(histogram, 0, sizeof(histogram));
+		for (size_t i = 0; i < m_numVisible; i++)
+			histogram[(keys[i].key >> shift) & 0xff]++;
+
+		if (histogram[(keys[0].key >> shift) & 0xff] == m_numVisible)
+			continue;
+
+		size_t offset = 0;
+		for (size_t b = 0; b < 256; b++) {
+			size_t count = histogram[b];
+			histogram[b] = offset;
+			offset += count;
+		}
+
+		for (size_t i = 0; i < m_numVisible; i++)
+			temp[histogram[(keys[i].key >> shift) & 0xff]++] = keys[i];
+
+		std::swap(keys, temp);
+	}
+
+	auto sorted = reinterpret_cast<MeshRenderItem_t*>(m_allocator->allocAligned(UINT32(m_numItems * sizeof(MeshRenderItem_t)), 16));
+	for (size_t i = 0; i < m_numVisible; i++)
+		sorted[i] = m_items[keys[i].index];
+	if (m_numItems > m_numVisible)
+		memcpy(sorted + m_numVisible, m_items + m_numVisible, (m_numItems - m_numVisible) * sizeof(MeshRenderItem_t));
+
+	m_allocator->free(reinterpret_cast<UINT8*>(m_items));
+	m_allocator->free(reinterpret_cast<UINT8*>(keys));
+	m_allocator->free(reinterpret_cast<UINT8*>(temp));
+	m_items = sorted;
+	m_capacity = m_numItems;
+
+	countStateChanges();
+}
+
+
+void RenderQueue::countStateChanges() {
+	m_stats.numItems = m_numItems;
+	m_stats.numShaderChanges = 0;
+	m_stats.numMaterialChanges = 0;
+	m_stats.numVAOChanges = 0;
+
+	for (size_t i = 0; i < m_numVisible; i++) {
+		const MeshRenderItem_t& cur = m_items[i];
+		const MeshRenderItem_t* prev = i > 0 ? &m_items[i - 1] : nullptr;
+
+		if (!prev || shaderBits(*prev) != shaderBits(cur))
+			m_stats.numShaderChanges++;
+		if (!prev || prev->material != cur.material)
+			m_stats.numMaterialChanges++;
+		if (!prev || prev->vao != cur.vao)
+			m_stats.numVAOChanges++;
+	}
+}
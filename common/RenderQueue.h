@@ -0,0 +1,97 @@
+#pragma once
+#include"RendererCore.h"
+#include<cstdint>
+
+class FrameAllocator;
+class FrustumCuller;
+struct Frustum;
+
+
+// hard limit per queue, items beyond it are dropped and counted
+#define MAX_NUM_QUEUE_ITEMS (1 << 20)
+
+
+struct RenderQueueStats {
+	size_t numItems;
+	size_t numDropped;
+	size_t numCulled;
+	size_t numShaderChanges;
+	size_t numMaterialChanges;
+	size_t numVAOChanges;
+
+	RenderQueueStats();
+	void reset();
+	RenderQueueStats& operator += (const RenderQueueStats& other);
+
+	inline size_t numStateChanges() const {
+		return numShaderChanges + numMaterialChanges + numVAOChanges;
+	}
+};
+
+
+//
+// per frame growable list of mesh render items, memory comes from a frame allocator.
+// items are radix sorted by a 64 bit key before execution:
+// front to back: | pass:2 | shader:6 | material:16 | vao:16 | depth:24 |
+// back to front: | pass:2 | ~depth:24 | shader:6 | material:16 | vao:16 |
+// culling moves items outside view frustum behind the visible ones, only the visible range is sorted.
+//
+class RenderQueue {
+public:
+	enum class SortOrder {
+		FrontToBack,
+		BackToFront,
+	};
+
+public:
+	RenderQueue(FrameAllocator* allocator, unsigned pass, SortOrder order, size_t maxItems = MAX_NUM_QUEUE_ITEMS);
+	~RenderQueue() = default;
+
+	RenderQueue(const RenderQueue& other) = delete;
+	RenderQueue& operator = (const RenderQueue& other) = delete;
+
+	bool push(const MeshRenderItem_t& item);
+	size_t cull(const Frustum& frustum, FrustumCuller& culler); // return number of visible items
+	void sort(const Camera_t* camera);
+	void reset(); // forget items, must be called before the frame allocator is cleared
+
+	inline MeshRenderItem_t* items() const {
+		return m_items;
+	}
+
+	inline size_t size() const {
+		return m_numItems;
+	}
+
+	inline size_t visibleSize() const {
+		return m_numVisible;
+	}
+
+	inline bool empty() const {
+		return m_numItems == 0;
+	}
+
+	inline const RenderQueueStats& getStats() const {
+		return m_stats;
+	}
+
+protected:
+	void grow();
+	uint64_t makeSortKey(const MeshRenderItem_t& item, float depth) const;
+	void countStateChanges();
+
+	static unsigned shaderBits(const MeshRenderItem_t& item);
+	static unsigned pointerBits(const void* p);
+	static unsigned geometryBits(const MeshRenderItem_t& item);
+
+private:
+	FrameAllocator* m_allocator;
+	MeshRenderItem_t* m_items;
+	size_t m_numItems;
+	size_t m_numVisible;
+	size_t m_capacity;
+	size_t m_maxItems;
+	unsigned m_pass;
+	SortOrder m_order;
+	RenderQueueStats m_stats;
+};
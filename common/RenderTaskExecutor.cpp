@@ -15,16 +15,77 @@ static std::unique_ptr<Buffer> s_SkinPoseBlockBuf;
 static std::unique_ptr<Buffer> s_MaterialBlockBuf;
 static MaterialBlock s_MaterialBlock;
 
+// uniforms resolved once per program
+static const UniformHandle s_ModelMatUniform("u_ModelMat");
+static const UniformHandle s_AlbedoMapUniform("u_AlbedoMap");
+static const UniformHandle s_NormalMapUniform("u_NormalMap");
+static const UniformHandle s_SpecularMapUniform("u_SpecularMap");
+static const UniformHandle s_MetallicMapUniform("u_MetallicMap");
+static const UniformHandle s_RoughnessMapUniform("u_RoughnessMap");
+static const UniformHandle s_HasANRMMapUniform("u_HasANRMMap");
+static const UniformHandle s_HasANMapUniform("u_HasANMap");
+static const UniformHandle s_InstanceBaseUniform("u_InstanceBase");
+
+// copy block into frame's ring region and bind its range, shared block buffer takes it when ring is full
+// blockSz is the size block is declared with, a bound range smaller than that is undefined behaviour
+static void streamBlock(Renderer* renderer, Buffer* fallback, ShaderProgram::UniformBlockBindingPoint bindingPoint, const void* data, size_t dataSz, size_t blockSz = 0) {
+	if (renderer->getBlockRing()->bindData(Buffer::Target::UniformBuffer, int(bindingPoint), data, dataSz, blockSz))
+		return;
+
+	fallback->bindBase(Buffer::Target::UniformBuffer, int(bindingPoint));
+	fallback->loadSubData(data, 0, dataSz);
+}
+
+
+static void unbindBlock(ShaderProgram::UniformBlockBindingPoint bindingPoint) {
+	GLStateCache::getInstance()->bindBufferBase(GL_UNIFORM_BUFFER, int(bindingPoint), 0);
+}
+
+
+// model matrix, or instance slots of an instanced/multi draw batch, or skin pose of a skinned mesh
+static void bindTransform(Renderer* renderer, const MeshRenderItem_t& task, ShaderProgram* shader) {
+	if (shader->hasUniform(s_ModelMatUniform)) {
+		shader->setUniformMat4v(s_ModelMatUniform, &task.modelMatrix[0][0]);
+	}
+
+	if (!shader->hasSubroutineUniform(Shader::Type::VertexShader, "u_Transform"))
+		return;
+
+	if (task.drawCount > 0) {
+		shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "multiDrawMesh");
+		shader->bindShaderStorageBlock("Instances", INSTANCE_BUFFER_BINDING);
+	}
+	else if (task.instanceCount > 1) {
+		shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "instancedMesh");
+		shader->setUniform1(s_InstanceBaseUniform, int(task.instanceIndex));
+		shader->bindShaderStorageBlock("Instances", INSTANCE_BUFFER_BINDING);
+	}
+	else if (task.boneCount <= 0) {
+		shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "staticMesh");
+	}
+	else {
+#ifdef _DEBUG
+		ASSERT(task.boneCount <= MAX_NUM_BONES);
+#endif // _DEBUG
+		int  numBone = MIN(task.boneCount, MAX_NUM_BONES);
+		shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "skinMesh");
+		streamBlock(renderer, s_SkinPoseBlockBuf.get(), ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock, task.bonesTransform,
+			sizeof(glm::mat4) * numBone, sizeof(glm::mat4) * MAX_NUM_BONES);
+		shader->bindUniformBlock("SkinPoseBlock", ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
+	}
+}
+
+
 bool RENDER_TASK_EXECUTOR_INIT() {
 	s_SkinPoseBlockBuf.reset(new Buffer());
 	s_SkinPoseBlockBuf->bind(Buffer::Target::UniformBuffer);
 	s_SkinPoseBlockBuf->loadData(nullptr, sizeof(glm::mat4) * MAX_NUM_BONES, Buffer::Usage::DynamicDraw);
-	s_SkinPoseBlockBuf->unbind();
+	unbindBlock(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
 
 	s_MaterialBlockBuf.reset(new Buffer());
 	s_MaterialBlockBuf->bind(Buffer::Target::UniformBuffer);
 	s_MaterialBlockBuf->loadData(nullptr, sizeof(MaterialBlock), Buffer::Usage::DynamicDraw);
-	s_MaterialBlockBuf->unbind();
+	unbindBlock(ShaderProgram::UniformBlockBindingPoint::MaterialBlock);
 
 	return true;
 }
@@ -52,32 +113,13 @@ DepthPassRenderTaskExecutor::DepthPassRenderTaskExecutor(IRenderTechnique* rt) :
 }
 
 void DepthPassRenderTaskExecutor::executeMeshTask(const MeshRenderItem_t& renderTask, ShaderProgram* shader) {	
-	if (shader->hasUniform("u_ModelMat")) {
-		glm::mat4 m = renderTask.modelMatrix;
-		shader->setUniformMat4v("u_ModelMat", &m[0][0]);
-	}
-
-	if (shader->hasSubroutineUniform(Shader::Type::VertexShader, "u_Transform")) {
-		if (renderTask.boneCount <= 0) {
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "staticMesh");
-		}
-		else {
-#ifdef _DEBUG
-			ASSERT(renderTask.boneCount <= MAX_NUM_BONES);
-#endif // _DEBUG
-			int  numBone = MIN(renderTask.boneCount, MAX_NUM_BONES);
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "skinMesh");
-			s_SkinPoseBlockBuf->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock));
-			s_SkinPoseBlockBuf->loadSubData(renderTask.bonesTransform, 0, sizeof(glm::mat4) * numBone);
-			shader->bindUniformBlock("SkinPoseBlock", ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
-		}
-	}
+	bindTransform(m_renderer->getRenderer(), renderTask, shader);
 
 	shader->bindSubroutineUniforms();
 	
-	m_renderer->getRenderer()->executeDrawCommand(renderTask.vao, renderTask.primitive, renderTask.vertexCount, renderTask.indexCount);
+	m_renderer->getRenderer()->executeDrawCommand(renderTask);
 
-	if (renderTask.boneCount > 0) s_SkinPoseBlockBuf->unbind();
+	if (renderTask.boneCount > 0) unbindBlock(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
 }
 
 
@@ -176,25 +218,7 @@ void LightPassRenderTaskExecuter::executeMeshTask(const MeshRenderItem_t& render
 	std::shared_ptr<Texture> strongMetallicMap;
 	std::shared_ptr<Texture> strongroughnessMap;
 
-	if (shader->hasUniform("u_ModelMat")) {
-		shader->setUniformMat4v("u_ModelMat", &renderTask.modelMatrix[0][0]);
-	}
-
-	if (shader->hasSubroutineUniform(Shader::Type::VertexShader, "u_Transform")) {
-		if (renderTask.boneCount <= 0) {
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "staticMesh");
-		}
-		else {
-#ifdef _DEBUG
-			ASSERT(renderTask.boneCount <= MAX_NUM_BONES);
-#endif // _DEBUG
-			int  numBone = MIN(renderTask.boneCount, MAX_NUM_BONES);
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "skinMesh");
-			s_SkinPoseBlockBuf->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock));
-			s_SkinPoseBlockBuf->loadSubData(renderTask.bonesTransform, 0, sizeof(glm::mat4) * numBone);
-			shader->bindUniformBlock("SkinPoseBlock", ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
-		}
-	}
+	bindTransform(m_renderer->getRenderer(), renderTask, shader);
 	
 	if (auto mtl = renderTask.material->asType<PhongMaterial>()) {
 		shader->setSubroutineUniform(Shader::Type::FragmentShader, "u_ShadingMode", "PhongShading");
@@ -210,24 +234,24 @@ void LightPassRenderTaskExecuter::executeMeshTask(const MeshRenderItem_t& render
 		if (hasAlbedoMap) {
 			strongDiffuseMap = mtl->m_albedoMap.lock();
 			strongDiffuseMap->bindToTextureUnit(Texture::Unit::DiffuseMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_AlbedoMap", int(Texture::Unit::DiffuseMap));
+			shader->setUniform1(s_AlbedoMapUniform, int(Texture::Unit::DiffuseMap));
 		}
 	
 		int hasNormalMap = mtl->hasNormalMap();
 		if (hasNormalMap) {
 			strongNormalMap = mtl->m_normalMap.lock();
 			strongNormalMap->bindToTextureUnit(Texture::Unit::NormalMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_NormalMap", int(Texture::Unit::NormalMap));
+			shader->setUniform1(s_NormalMapUniform, int(Texture::Unit::NormalMap));
 		}	
 
 		int hasSpecMap = mtl->hasSpecularMap();
 		if (hasSpecMap) {
 			strongSpecularMap = mtl->m_specularMap.lock();
 			strongSpecularMap->bindToTextureUnit(Texture::Unit::SpecularMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_SpecularMap", int(Texture::Unit::SpecularMap));
+			shader->setUniform1(s_SpecularMapUniform, int(Texture::Unit::SpecularMap));
 		}
 
-		shader->setUniform4("u_HasANRMMap", hasAlbedoMap, hasNormalMap, hasSpecMap, 0);
+		shader->setUniform4(s_HasANRMMapUniform, hasAlbedoMap, hasNormalMap, hasSpecMap, 0);
 	}
 
 	if (auto mtl = renderTask.material->asType<PBRMaterial>()) {
@@ -244,48 +268,47 @@ void LightPassRenderTaskExecuter::executeMeshTask(const MeshRenderItem_t& render
 		if (hasAlbedoMap) {
 			strongDiffuseMap = mtl->m_albedoMap.lock();
 			strongDiffuseMap->bindToTextureUnit(Texture::Unit::DiffuseMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_AlbedoMap", int(Texture::Unit::DiffuseMap));
+			shader->setUniform1(s_AlbedoMapUniform, int(Texture::Unit::DiffuseMap));
 		}
 
 		int hasNormalMap = mtl->hasNormalMap();
 		if (hasNormalMap) {
 			strongNormalMap = mtl->m_normalMap.lock();
 			strongNormalMap->bindToTextureUnit(Texture::Unit::NormalMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_NormalMap", int(Texture::Unit::NormalMap));
+			shader->setUniform1(s_NormalMapUniform, int(Texture::Unit::NormalMap));
 		}
 
 		int hasMetallicMap = mtl->hasMetallicMap();
 		if (hasMetallicMap) {
 			strongMetallicMap = mtl->m_metallicMap.lock();
 			strongMetallicMap->bindToTextureUnit(Texture::Unit::MetallicMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_MetallicMap", int(Texture::Unit::MetallicMap));
+			shader->setUniform1(s_MetallicMapUniform, int(Texture::Unit::MetallicMap));
 		}
 
 		int hasRoughnessMap = mtl->hasRoughnessMap();
 		if (hasRoughnessMap) {
 			strongroughnessMap = mtl->m_roughnessMap.lock();
 			strongroughnessMap->bindToTextureUnit(Texture::Unit::RoughnessMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_RoughnessMap", int(Texture::Unit::RoughnessMap));
+			shader->setUniform1(s_RoughnessMapUniform, int(Texture::Unit::RoughnessMap));
 		}
 
-		shader->setUniform4("u_HasANRMMap", hasAlbedoMap, hasNormalMap, hasRoughnessMap, hasMetallicMap);
+		shader->setUniform4(s_HasANRMMapUniform, hasAlbedoMap, hasNormalMap, hasRoughnessMap, hasMetallicMap);
 	}
 
-	s_MaterialBlockBuf->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::MaterialBlock));
-	s_MaterialBlockBuf->loadSubData(&s_MaterialBlock, 0, sizeof(MaterialBlock));
+	streamBlock(m_renderer->getRenderer(), s_MaterialBlockBuf.get(), ShaderProgram::UniformBlockBindingPoint::MaterialBlock, &s_MaterialBlock, sizeof(MaterialBlock));
 	shader->bindUniformBlock("MaterialBlock", ShaderProgram::UniformBlockBindingPoint::MaterialBlock);
 	shader->bindSubroutineUniforms();
 
 	// draw
-	m_renderer->getRenderer()->executeDrawCommand(renderTask.vao, renderTask.primitive, renderTask.vertexCount, renderTask.indexCount);
+	m_renderer->getRenderer()->executeDrawCommand(renderTask);
 
-	s_MaterialBlockBuf->unbind();
+	unbindBlock(ShaderProgram::UniformBlockBindingPoint::MaterialBlock);
 	if (strongDiffuseMap) strongDiffuseMap->unbindFromTextureUnit();
 	if (strongNormalMap) strongNormalMap->unbindFromTextureUnit();
 	if (strongSpecularMap) strongSpecularMap->unbindFromTextureUnit();
 	if (strongMetallicMap) strongMetallicMap->unbindFromTextureUnit();
 	if (strongroughnessMap) strongroughnessMap->unbindFromTextureUnit();
-	if (renderTask.boneCount > 0) s_SkinPoseBlockBuf->unbind();
+	if (renderTask.boneCount > 0) unbindBlock(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
 }
 
 
@@ -307,26 +330,7 @@ void GeometryPassRenderTaskExecutor::executeMeshTask(const MeshRenderItem_t& ren
 	int hasMetallicMap = 0;
 	int hasRoughnessMap = 0;
 
-	// set matrixs
-	if (shader->hasUniform("u_ModelMat")) {
-		shader->setUniformMat4v("u_ModelMat", &renderTask.modelMatrix[0][0]);
-	}
-
-	if (shader->hasSubroutineUniform(Shader::Type::VertexShader, "u_Transform")) {
-		if (renderTask.boneCount <= 0) {
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "staticMesh");
-		}
-		else {
-#ifdef _DEBUG
-			ASSERT(renderTask.boneCount <= MAX_NUM_BONES);
-#endif // _DEBUG
-			int  numBone = MIN(renderTask.boneCount, MAX_NUM_BONES);
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "skinMesh");
-			s_SkinPoseBlockBuf->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock));
-			s_SkinPoseBlockBuf->loadSubData(renderTask.bonesTransform, 0, sizeof(glm::mat4) * numBone);
-			shader->bindUniformBlock("SkinPoseBlock", ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
-		}
-	}
+	bindTransform(m_renderer->getRenderer(), renderTask, shader);
 
 	if (auto mtl = renderTask.material->asType<PhongMaterial>()) {
 		shader->setSubroutineUniform(Shader::Type::FragmentShader, "u_ShadingMode", "PhongShading");
@@ -349,11 +353,11 @@ void GeometryPassRenderTaskExecutor::executeMeshTask(const MeshRenderItem_t& ren
 		if (mtl->hasSpecularMap()) {
 			strongSpecularMap = mtl->m_specularMap.lock();
 			strongSpecularMap->bindToTextureUnit(Texture::Unit::SpecularMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_SpecularMap", int(Texture::Unit::SpecularMap));
+			shader->setUniform1(s_SpecularMapUniform, int(Texture::Unit::SpecularMap));
 			hasSpecularMap = 1;
 		}
 
-		shader->setUniform4("u_HasANRMMap", hasAlbedoMap, hasNormalMap, hasSpecularMap, 0);
+		shader->setUniform4(s_HasANRMMapUniform, hasAlbedoMap, hasNormalMap, hasSpecularMap, 0);
 	}
 
 	if (auto mtl = renderTask.material->asType<PBRMaterial>()) {
@@ -377,45 +381,44 @@ void GeometryPassRenderTaskExecutor::executeMeshTask(const MeshRenderItem_t& ren
 		if (mtl->hasMetallicMap()) {
 			strongMatellicMap = mtl->m_metallicMap.lock();
 			strongMatellicMap->bindToTextureUnit(Texture::Unit::MetallicMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_MetallicMap", int(Texture::Unit::MetallicMap));
+			shader->setUniform1(s_MetallicMapUniform, int(Texture::Unit::MetallicMap));
 			hasMetallicMap = 1;
 		}
 
 		if (mtl->hasRoughnessMap()) {
 			strongRoughnessMap = mtl->m_roughnessMap.lock();
 			strongRoughnessMap->bindToTextureUnit(Texture::Unit::RoughnessMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_RoughnessMap", int(Texture::Unit::RoughnessMap));
+			shader->setUniform1(s_RoughnessMapUniform, int(Texture::Unit::RoughnessMap));
 			hasRoughnessMap = 1;
 		}
 
-		shader->setUniform4("u_HasANRMMap", hasAlbedoMap, hasNormalMap, hasRoughnessMap, hasMetallicMap);
+		shader->setUniform4(s_HasANRMMapUniform, hasAlbedoMap, hasNormalMap, hasRoughnessMap, hasMetallicMap);
 	}
 
 
 	if (hasAlbedoMap) {
 		strongDiffuseMap->bindToTextureUnit(Texture::Unit::DiffuseMap, Texture::Target::Texture_2D);
-		shader->setUniform1("u_AlbedoMap", int(Texture::Unit::DiffuseMap));
+		shader->setUniform1(s_AlbedoMapUniform, int(Texture::Unit::DiffuseMap));
 	}
 	if (hasNormalMap) {
 		strongNormalMap->bindToTextureUnit(Texture::Unit::NormalMap, Texture::Target::Texture_2D);
-		shader->setUniform1("u_NormalMap", int(Texture::Unit::NormalMap));
+		shader->setUniform1(s_NormalMapUniform, int(Texture::Unit::NormalMap));
 	}
 
-	s_MaterialBlockBuf->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::MaterialBlock));
-	s_MaterialBlockBuf->loadSubData(&s_MaterialBlock, 0, sizeof(MaterialBlock));
+	streamBlock(m_renderer->getRenderer(), s_MaterialBlockBuf.get(), ShaderProgram::UniformBlockBindingPoint::MaterialBlock, &s_MaterialBlock, sizeof(MaterialBlock));
 	shader->bindUniformBlock("MaterialBlock", ShaderProgram::UniformBlockBindingPoint::MaterialBlock);
 	shader->bindSubroutineUniforms();
 
 	// draw
-	m_renderer->getRenderer()->executeDrawCommand(renderTask.vao, renderTask.primitive, renderTask.vertexCount, renderTask.indexCount);
+	m_renderer->getRenderer()->executeDrawCommand(renderTask);
 
-	s_MaterialBlockBuf->unbind();
+	unbindBlock(ShaderProgram::UniformBlockBindingPoint::MaterialBlock);
 	if (hasAlbedoMap) strongDiffuseMap->unbindFromTextureUnit();
 	if (hasNormalMap) strongNormalMap->unbindFromTextureUnit();
 	if (hasSpecularMap) strongSpecularMap->unbindFromTextureUnit();
 	if (hasMetallicMap) strongMatellicMap->unbindFromTextureUnit();
 	if (hasRoughnessMap) strongRoughnessMap->unbindFromTextureUnit();
-	if (renderTask.boneCount > 0) s_SkinPoseBlockBuf->unbind();
+	if (renderTask.boneCount > 0) unbindBlock(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
 }
 
 
@@ -429,33 +432,13 @@ void ShadowPassRenderTaskExecutor::executeMeshTask(const MeshRenderItem_t& rende
 		renderTask.primitive != PrimitiveType::TriangleStrip)
 		return;
 	
-	// set model matrix
-	if (shader->hasUniform("u_ModelMat")) {
-		glm::mat4 m = renderTask.modelMatrix;
-		shader->setUniformMat4v("u_ModelMat", &m[0][0]);
-	}
-
-	if (shader->hasSubroutineUniform(Shader::Type::VertexShader, "u_Transform")) {
-		if (renderTask.boneCount <= 0) {
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "staticMesh");
-		}
-		else {
-#ifdef _DEBUG
-			ASSERT(renderTask.boneCount <= MAX_NUM_BONES);
-#endif // _DEBUG
-			int  numBone = MIN(renderTask.boneCount, MAX_NUM_BONES);
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "skinMesh");
-			s_SkinPoseBlockBuf->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock));
-			s_SkinPoseBlockBuf->loadSubData(renderTask.bonesTransform, 0, sizeof(glm::mat4) * numBone);
-			shader->bindUniformBlock("SkinPoseBlock", ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
-		}
-	}
+	bindTransform(m_renderer->getRenderer(), renderTask, shader);
 
 	shader->bindSubroutineUniforms();
 	
-	m_renderer->getRenderer()->executeDrawCommand(renderTask.vao, renderTask.primitive, renderTask.vertexCount, renderTask.indexCount);
+	m_renderer->getRenderer()->executeDrawCommand(renderTask);
 
-	if (renderTask.boneCount > 0) s_SkinPoseBlockBuf->unbind();
+	if (renderTask.boneCount > 0) unbindBlock(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
 }
 
 
@@ -469,26 +452,7 @@ void AmbientPassRenderTaskExecutor::executeMeshTask(const MeshRenderItem_t& task
 	std::shared_ptr<Texture> diffuseMap;
 	std::shared_ptr<Texture> normalMap;
 
-	// set model matrix
-	if (shader->hasUniform("u_ModelMat")) {
-		shader->setUniformMat4v("u_ModelMat", (float*)&task.modelMatrix[0][0]);
-	}
-
-	if (shader->hasSubroutineUniform(Shader::Type::VertexShader, "u_Transform")) {
-		if (task.boneCount <= 0) {
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "staticMesh");
-		}
-		else {
-#ifdef _DEBUG
-			ASSERT(task.boneCount <= MAX_NUM_BONES);
-#endif // _DEBUG
-			int  numBone = MIN(task.boneCount, MAX_NUM_BONES);
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "skinMesh");
-			s_SkinPoseBlockBuf->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock));
-			s_SkinPoseBlockBuf->loadSubData(task.bonesTransform, 0, sizeof(glm::mat4) * numBone);
-			shader->bindUniformBlock("SkinPoseBlock", ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
-		}
-	}
+	bindTransform(m_renderer->getRenderer(), task, shader);
 
 	int hasDiffuseMap = 0;
 	int hasNormalMap = 0;
@@ -511,22 +475,22 @@ void AmbientPassRenderTaskExecutor::executeMeshTask(const MeshRenderItem_t& task
 
 	if (hasDiffuseMap) {
 		diffuseMap->bindToTextureUnit(Texture::Unit::DiffuseMap);
-		shader->setUniform1("u_AlbedoMap", int(Texture::Unit::DiffuseMap));
+		shader->setUniform1(s_AlbedoMapUniform, int(Texture::Unit::DiffuseMap));
 	}
 
 	if (hasNormalMap) {
 		normalMap->bindToTextureUnit(Texture::Unit::NormalMap);
-		shader->setUniform1("u_NormalMap", int(Texture::Unit::NormalMap));
+		shader->setUniform1(s_NormalMapUniform, int(Texture::Unit::NormalMap));
 	}
 
-	shader->setUniform2("u_HasANMap", hasDiffuseMap, hasNormalMap);
+	shader->setUniform2(s_HasANMapUniform, hasDiffuseMap, hasNormalMap);
 	shader->bindSubroutineUniforms();
 
-	m_renderer->getRenderer()->executeDrawCommand(task.vao, task.primitive, task.vertexCount, task.indexCount);
+	m_renderer->getRenderer()->executeDrawCommand(task);
 	
 	if (diffuseMap) diffuseMap->unbindFromTextureUnit();
 	if (normalMap) normalMap->unbindFromTextureUnit();
-	if (task.boneCount > 0) s_SkinPoseBlockBuf->unbind();
+	if (task.boneCount > 0) unbindBlock(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
 }
 
 
@@ -544,25 +508,7 @@ void LightAccumulationPassRenderTaskExecutor::executeMeshTask(const MeshRenderIt
 	std::shared_ptr<Texture> strongMetallicMap;
 	std::shared_ptr<Texture> strongroughnessMap;
 
-	if (shader->hasUniform("u_ModelMat")) {
-		shader->setUniformMat4v("u_ModelMat", &task.modelMatrix[0][0]);
-	}
-
-	if (shader->hasSubroutineUniform(Shader::Type::VertexShader, "u_Transform")) {
-		if (task.boneCount <= 0) {
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "staticMesh");
-		}
-		else {
-#ifdef _DEBUG
-			ASSERT(task.boneCount <= MAX_NUM_BONES);
-#endif // _DEBUG
-			int  numBone = MIN(task.boneCount, MAX_NUM_BONES);
-			shader->setSubroutineUniform(Shader::Type::VertexShader, "u_Transform", "skinMesh");
-			s_SkinPoseBlockBuf->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock));
-			s_SkinPoseBlockBuf->loadSubData(task.bonesTransform, 0, sizeof(glm::mat4) * numBone);
-			shader->bindUniformBlock("SkinPoseBlock", ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
-		}
-	}
+	bindTransform(m_renderer->getRenderer(), task, shader);
 
 	if (auto mtl = task.material->asType<PhongMaterial>()) {
 		shader->setSubroutineUniform(Shader::Type::FragmentShader, "u_ShadingMode", "PhongShading");
@@ -578,24 +524,24 @@ void LightAccumulationPassRenderTaskExecutor::executeMeshTask(const MeshRenderIt
 		if (hasAlbedoMap) {
 			strongDiffuseMap = mtl->m_albedoMap.lock();
 			strongDiffuseMap->bindToTextureUnit(Texture::Unit::DiffuseMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_AlbedoMap", int(Texture::Unit::DiffuseMap));
+			shader->setUniform1(s_AlbedoMapUniform, int(Texture::Unit::DiffuseMap));
 		}
 
 		int hasNormalMap = mtl->hasNormalMap();
 		if (hasNormalMap) {
 			strongNormalMap = mtl->m_normalMap.lock();
 			strongNormalMap->bindToTextureUnit(Texture::Unit::NormalMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_NormalMap", int(Texture::Unit::NormalMap));
+			shader->setUniform1(s_NormalMapUniform, int(Texture::Unit::NormalMap));
 		}
 
 		int hasSpecMap = mtl->hasSpecularMap();
 		if (hasSpecMap) {
 			strongSpecularMap = mtl->m_specularMap.lock();
 			strongSpecularMap->bindToTextureUnit(Texture::Unit::SpecularMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_SpecularMap", int(Texture::Unit::SpecularMap));
+			shader->setUniform1(s_SpecularMapUniform, int(Texture::Unit::SpecularMap));
 		}
 
-		shader->setUniform4("u_HasANRMMap", hasAlbedoMap, hasNormalMap, hasSpecMap, 0);
+		shader->setUniform4(s_HasANRMMapUniform, hasAlbedoMap, hasNormalMap, hasSpecMap, 0);
 	}
 
 	if (auto mtl = task.material->asType<PBRMaterial>()) {
@@ -612,46 +558,45 @@ void LightAccumulationPassRenderTaskExecutor::executeMeshTask(const MeshRenderIt
 		if (hasAlbedoMap) {
 			strongDiffuseMap = mtl->m_albedoMap.lock();
 			strongDiffuseMap->bindToTextureUnit(Texture::Unit::DiffuseMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_AlbedoMap", int(Texture::Unit::DiffuseMap));
+			shader->setUniform1(s_AlbedoMapUniform, int(Texture::Unit::DiffuseMap));
 		}
 
 		int hasNormalMap = mtl->hasNormalMap();
 		if (hasNormalMap) {
 			strongNormalMap = mtl->m_normalMap.lock();
 			strongNormalMap->bindToTextureUnit(Texture::Unit::NormalMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_NormalMap", int(Texture::Unit::NormalMap));
+			shader->setUniform1(s_NormalMapUniform, int(Texture::Unit::NormalMap));
 		}
 
 		int hasMetallicMap = mtl->hasMetallicMap();
 		if (hasMetallicMap) {
 			strongMetallicMap = mtl->m_metallicMap.lock();
 			strongMetallicMap->bindToTextureUnit(Texture::Unit::MetallicMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_MetallicMap", int(Texture::Unit::MetallicMap));
+			shader->setUniform1(s_MetallicMapUniform, int(Texture::Unit::MetallicMap));
 		}
 
 		int hasRoughnessMap = mtl->hasRoughnessMap();
 		if (hasRoughnessMap) {
 			strongroughnessMap = mtl->m_roughnessMap.lock();
 			strongroughnessMap->bindToTextureUnit(Texture::Unit::RoughnessMap, Texture::Target::Texture_2D);
-			shader->setUniform1("u_RoughnessMap", int(Texture::Unit::RoughnessMap));
+			shader->setUniform1(s_RoughnessMapUniform, int(Texture::Unit::RoughnessMap));
 		}
 
-		shader->setUniform4("u_HasANRMMap", hasAlbedoMap, hasNormalMap, hasRoughnessMap, hasMetallicMap);
+		shader->setUniform4(s_HasANRMMapUniform, hasAlbedoMap, hasNormalMap, hasRoughnessMap, hasMetallicMap);
 	}
 
-	s_MaterialBlockBuf->bindBase(Buffer::Target::UniformBuffer, int(ShaderProgram::UniformBlockBindingPoint::MaterialBlock));
-	s_MaterialBlockBuf->loadSubData(&s_MaterialBlock, 0, sizeof(MaterialBlock));
+	streamBlock(m_renderer->getRenderer(), s_MaterialBlockBuf.get(), ShaderProgram::UniformBlockBindingPoint::MaterialBlock, &s_MaterialBlock, sizeof(MaterialBlock));
 	shader->bindUniformBlock("MaterialBlock", ShaderProgram::UniformBlockBindingPoint::MaterialBlock);
 	shader->bindSubroutineUniforms();
 
 	// draw
-	m_renderer->getRenderer()->executeDrawCommand(task.vao, task.primitive, task.vertexCount, task.indexCount);
+	m_renderer->getRenderer()->executeDrawCommand(task);
 	
-	s_MaterialBlockBuf->unbind();
+	unbindBlock(ShaderProgram::UniformBlockBindingPoint::MaterialBlock);
 	if (strongDiffuseMap) strongDiffuseMap->unbindFromTextureUnit();
 	if (strongNormalMap) strongNormalMap->unbindFromTextureUnit();
 	if (strongSpecularMap) strongSpecularMap->unbindFromTextureUnit();
 	if (strongMetallicMap) strongMetallicMap->unbindFromTextureUnit();
 	if (strongroughnessMap) strongroughnessMap->unbindFromTextureUnit();
-	if (task.boneCount > 0) s_SkinPoseBlockBuf->unbind();
+	if (task.boneCount > 0) unbindBlock(ShaderProgram::UniformBlockBindingPoint::SkinPoseBlock);
 }
\ No newline at end of file
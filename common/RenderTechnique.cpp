@@ -2,9 +2,20 @@
 #include"Renderer.h"
 #include"ShaderProgamMgr.h"
 #include"VertexArray.h"
+#include"Buffer.h"
 
 
 
+void IRenderTechnique::renderBatch(const MeshRenderItem_t* items, size_t count) {
+	size_t i = 0;
+	while (i < count) {
+		MeshRenderItem_t batch;
+		i += m_renderer->batchItems(items + i, count - i, batch);
+		render(batch);
+	}
+}
+
+
 RenderTechniqueBase::RenderTechniqueBase(Renderer* renderer) :IRenderTechnique(renderer)
 , m_pass(RenderPass::None)
 , m_passShader()
@@ -57,4 +68,15 @@ void RenderTechniqueBase::drawSkyBox(const SkyBox_t& skyBox, const Camera_t& cam
 	
 	render(skyBox);
 	m_renderer->popShadrProgram();
-}
\ No newline at end of file
+}
+
+
+void RenderTechniqueBase::bindLightBlock(Buffer* fallback, const void* data, size_t dataSz) {
+	int bindingPoint = int(ShaderProgram::UniformBlockBindingPoint::LightBlock);
+	if (m_renderer->getBlockRing()->bindData(Buffer::Target::UniformBuffer, bindingPoint, data, dataSz))
+		return;
+
+	fallback->bind(Buffer::Target::UniformBuffer);
+	fallback->loadSubData(data, 0, dataSz);
+	fallback->bindBase(Buffer::Target::UniformBuffer, bindingPoint);
+}
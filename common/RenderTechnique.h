@@ -6,6 +6,7 @@
 
 class ShaderProgram;
 class Texture;
+class Buffer;
 
 class IRenderTechnique {
 public:
@@ -19,6 +20,7 @@ public:
 	virtual void render(const MeshRenderItem_t& task) = 0;
 	virtual void render(const SkyBox_t& skyBox) = 0;
 	virtual void render(const Scene_t& scene) = 0;
+	void renderBatch(const MeshRenderItem_t* items, size_t count); // runs of same material go as one instanced or multi draw task
 	virtual Texture* getRenderedFrame() = 0;
 
 	virtual void onWindowResize(float w, float h) = 0;
@@ -62,6 +64,7 @@ protected:
 
 protected:
 	void drawSkyBox(const SkyBox_t& skyBox, const Camera_t& camera);
+	void bindLightBlock(Buffer* fallback, const void* data, size_t dataSz); // streamed through renderer's block ring, fallback ubo takes it when ring is full
 
 protected:
 	std::shared_ptr<ShaderProgram> m_passShader; // current pass used shader
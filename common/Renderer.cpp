@@ -1,4 +1,5 @@
 #include"Renderer.h"
+#include"Geometry3D.h"
 #include"Util.h"
 #include"Scene.h"
 #include"ShaderProgamMgr.h"
@@ -7,7 +8,9 @@
 #include"Texture.h"
 #include"VertexLayoutDescription.h"
 #include"ForwardPlusRenderer.h"
+#include"DeferredRenderer.h"
 #include"GuiMgr.h"
+#include"Profiler.h"
 #include<glm/gtx/transform.hpp>
 #include<functional>
 
@@ -25,8 +28,26 @@ Renderer::Renderer(const glm::vec2& renderSz, Mode mode) : m_pipelineStates()
 , m_quadVAO(nullptr)
 , m_quadVBO(nullptr)
 , m_quadIBO(nullptr)
+, m_blockRing(nullptr)
+, m_instanceRing(nullptr)
+, m_indirectRing(nullptr)
 , m_renderSize(renderSz)
 , m_shadowMapResolution(1024, 1024)
+, m_frameAlloc()
+, m_opaqueQueue(&m_frameAlloc, 0, RenderQueue::SortOrder::FrontToBack)
+, m_cutOutQueue(&m_frameAlloc, 1, RenderQueue::SortOrder::FrontToBack)
+, m_transparentQueue(&m_frameAlloc, 2, RenderQueue::SortOrder::BackToFront)
+, m_frameStats()
+, m_glStateStats()
+, m_culler()
+, m_shadowCasters()
+, m_isFrustumCulling(true)
+, m_isInstancing(true)
+, m_numInstancedDraws(0)
+, m_numInstancedItems(0)
+, m_isMultiDraw(true)
+, m_numMultiDraws(0)
+, m_numMultiDrawCommands(0)
 , m_mainCamera(nullptr)
 , m_skyBox()
 , m_scene()
@@ -43,6 +64,9 @@ Renderer::~Renderer() {
 	m_quadVAO.release();
 	m_quadVBO.release();
 	m_quadIBO.release();
+	m_blockRing.reset(nullptr);
+	m_instanceRing.reset(nullptr);
+	m_indirectRing.reset(nullptr);
 	
 	m_postProcessingMgr.cleanUp();
 }
@@ -50,6 +74,19 @@ Renderer::~Renderer() {
 
 bool Renderer::initialize() {
 	m_postProcessingMgr.registerStandardFilters();
+
+	m_blockRing.reset(new RingBuffer());
+	if (!m_blockRing->initialize(BLOCK_RING_REGION_SIZE))
+		return false;
+
+	m_instanceRing.reset(new RingBuffer());
+	if (!m_instanceRing->initialize(INSTANCE_RING_REGION_SIZE))
+		return false;
+
+	m_indirectRing.reset(new RingBuffer());
+	if (!m_indirectRing->initialize(INDIRECT_RING_REGION_SIZE))
+		return false;
+
 	return setupFullScreenQuad() && m_postProcessingMgr.initialize();
 }
 
@@ -57,7 +94,7 @@ bool Renderer::initialize() {
 void Renderer::cleanUp() {
 	if (m_renderTechnique) {
 		m_renderTechnique->cleanUp();
-		m_renderTechnique.release();
+		m_renderTechnique.reset(nullptr);
 		m_renderMode = Mode::None;
 	}
 	
@@ -71,36 +108,29 @@ void Renderer::cleanUp() {
 
 
 bool Renderer::setRenderMode(Mode mode) {
-	if (m_renderMode != Mode::None)
+	if (m_renderMode == mode)
 		return true;
 
 	cleanUp();
 
-	//if (mode == Mode::Forward) {
-	//	m_renderTechnique.reset(new ForwardRenderer(this));
-	//	if (!m_renderTechnique->intialize()) {
-	//		m_renderTechnique.release();
-	//		m_renderMode = Mode::None;
-	//		return false;
-	//	}
-
-	//	m_renderMode = mode;
-	//	return true;
-
-	//} else if (mode == Mode::Deferred) {	
-	//	m_renderTechnique.reset(new DeferredRenderer(this));
-	//	if (!m_renderTechnique->intialize()) {
-	//		m_renderTechnique.release();
-	//		m_renderMode = mode;
-	//		return false;
-	//	}
-	//	
-	//	m_renderMode = mode;
-	//	return true;
-	//}
-	
-	m_renderTechnique.reset(new ForwardPlusRenderer(this));
-	ASSERT(m_renderTechnique->intialize());
+	// forward mode is served by forward+ technique
+	if (mode == Mode::Forward) {
+		m_renderTechnique.reset(new ForwardPlusRenderer(this));
+	} else if (mode == Mode::Deferred) {
+		m_renderTechnique.reset(new DeferredRenderer(this));
+	} else {
+		m_renderMode = Mode::None;
+		return false;
+	}
+
+	if (!m_renderTechnique->intialize()) {
+#ifdef _DEBUG
+		ASSERT(false);
+#endif // _DEBUG
+		m_renderTechnique.reset(nullptr);
+		m_renderMode = Mode::None;
+		return false;
+	}
 
 	m_renderMode = mode;
 
@@ -160,7 +190,7 @@ void Renderer::popRenderTarget() {
 	
 	m_renderTargets.pop();
 	if (m_renderTargets.empty()) {
-		GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+		GLStateCache::getInstance()->bindFramebuffer(GL_FRAMEBUFFER, 0);
 	} else {
 		m_renderTargets.top()->bind();
 	}
@@ -172,7 +202,7 @@ void Renderer::clearRenerTargets() {
 		m_renderTargets.pop();
 	}
 
-	GLCALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+	GLStateCache::getInstance()->bindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 
@@ -184,7 +214,7 @@ void Renderer::pushShaderProgram(ShaderProgram* shader) {
 	if (!m_shaders.empty()) {
 		m_shaders.top()->bind();
 	} else {
-		GLCALL(glUseProgram(0));
+		GLStateCache::getInstance()->useProgram(0);
 	}
 }
 
@@ -198,7 +228,7 @@ void Renderer::popShadrProgram() {
 		m_shaders.top()->bind();
 	}
 	else {
-		GLCALL(glUseProgram(0));
+		GLStateCache::getInstance()->useProgram(0);
 	}
 }
 
@@ -207,7 +237,7 @@ void Renderer::clearShaderPrograms() {
 		m_shaders.pop();
 	}
 
-	GLCALL(glUseProgram(0));
+	GLStateCache::getInstance()->useProgram(0);
 }
 
 ShaderProgram* Renderer::getActiveShaderProgram() const {
@@ -279,10 +309,90 @@ void Renderer::submitLight(const Light_t& light) {
 	}
 }
 
+void Renderer::cullRenderQueues() {
+	PROFILE_SCOPE("Renderer::cull");
+	if (!m_isFrustumCulling || !m_mainCamera)
+		return;
+
+	Frustum frustum = Frustum::FromMatrix(m_mainCamera->projMatrix * m_mainCamera->viewMatrix);
+	m_opaqueQueue.cull(frustum, m_culler);
+	m_cutOutQueue.cull(frustum, m_culler);
+	m_transparentQueue.cull(frustum, m_culler);
+}
+
+void Renderer::sortRenderQueues() {
+	m_opaqueQueue.sort(m_mainCamera);
+	m_cutOutQueue.sort(m_mainCamera);
+	m_transparentQueue.sort(m_mainCamera);
+
+	m_scene.opaqueItems = m_opaqueQueue.items();
+	m_scene.numOpaqueItems = m_opaqueQueue.visibleSize();
+	m_scene.numOpaqueCasters = m_opaqueQueue.size();
+	m_scene.cutOutItems = m_cutOutQueue.items();
+	m_scene.numCutOutItems = m_cutOutQueue.visibleSize();
+	m_scene.numCutOutCasters = m_cutOutQueue.size();
+	m_scene.transparentItems = m_transparentQueue.items();
+	m_scene.numTransparentItems = m_transparentQueue.visibleSize();
+	m_scene.numTransparentCasters = m_transparentQueue.size();
+
+	m_frameStats.reset();
+	m_frameStats += m_opaqueQueue.getStats();
+	m_frameStats += m_cutOutQueue.getStats();
+	m_frameStats += m_transparentQueue.getStats();
+
+	auto profiler = Profiler::getInstance();
+	profiler->addCounter("RenderQueue::items", m_frameStats.numItems);
+	profiler->addCounter("RenderQueue::dropped", m_frameStats.numDropped);
+	profiler->addCounter("Culling::cameraVisible", m_frameStats.numItems - m_frameStats.numCulled);
+	profiler->addCounter("Culling::cameraCulled", m_frameStats.numCulled);
+	profiler->addCounter("RenderQueue::stateChanges", m_frameStats.numStateChanges());
+}
+
+
+void Renderer::uploadInstances() {
+	m_numInstancedDraws = 0;
+	m_numInstancedItems = 0;
+	m_numMultiDraws = 0;
+	m_numMultiDrawCommands = 0;
+	if (!m_isInstancing)
+		return;
+
+	// every queued item (casters included) gets a slot in queue order, so equal neighbours stay consecutive
+	RenderQueue* queues[] = { &m_opaqueQueue, &m_cutOutQueue, &m_transparentQueue };
+	size_t numItems = 0;
+	for (auto queue : queues)
+		numItems += queue->size();
+
+	size_t offset = 0;
+	glm::mat4* matrices = numItems > 0 ? (glm::mat4*)m_instanceRing->allocate(sizeof(glm::mat4) * numItems, offset) : nullptr;
+	if (!matrices)
+		return; // items keep invalid instance index and are drawn one by one
+
+	uint32_t slot = 0;
+	for (auto queue : queues) {
+		MeshRenderItem_t* items = queue->items();
+		for (size_t i = 0; i < queue->size(); i++) {
+			items[i].instanceIndex = slot;
+			matrices[slot++] = items[i].modelMatrix;
+		}
+	}
+
+	m_instanceRing->bindRange(Buffer::Target::ShaderStorageBuffer, INSTANCE_BUFFER_BINDING, offset, sizeof(glm::mat4) * numItems);
+}
+
+
 void Renderer::resetScene() {
+	m_opaqueQueue.reset();
+	m_cutOutQueue.reset();
+	m_transparentQueue.reset();
+	m_frameAlloc.clearFrame();
+
 	m_scene.numOpaqueItems = 0;
+	m_scene.numOpaqueCasters = 0;
 	m_scene.numCutOutItems = 0;
+	m_scene.numCutOutCasters = 0;
 	m_scene.numTransparentItems = 0;
+	m_scene.numTransparentCasters = 0;
 	m_scene.numMainLights = 0;
 	m_scene.numLights = 0;
 	m_scene.numCameras = 0;
@@ -291,15 +401,16 @@ void Renderer::resetScene() {
 
 	m_numFilters = 0;
 
-	m_scene.opaqueItems = m_opaqueItems.data();
-	m_scene.cutOutItems = m_cutOutItems.data();
-	m_scene.transparentItems = m_transparentItems.data();
+	m_scene.opaqueItems = nullptr;
+	m_scene.cutOutItems = nullptr;
+	m_scene.transparentItems = nullptr;
 	m_scene.mainLights = m_mainLights.data();
 	m_scene.lights = m_lights.data();
 	m_scene.cameras = m_cameras.data();
 }
 
 void Renderer::flush() {
+	PROFILE_SCOPE("Renderer::flush");
 	ASSERT(m_mainCamera);
 
 	clearShaderPrograms();
@@ -309,7 +420,14 @@ void Renderer::flush() {
 	setColorMask(true);
 	setStencilMask(0xffffffff);
 	clearScreen(ClearFlags::Color | ClearFlags::Depth | ClearFlags::Stencil);
+	m_blockRing->beginFrame();
+	m_instanceRing->beginFrame();
+	m_indirectRing->beginFrame();
 	
+	cullRenderQueues();
+	sortRenderQueues();
+	uploadInstances();
+	m_shadowCasters.update(m_scene);
 
 	m_renderTechnique->render(m_scene);
 	
@@ -319,7 +437,39 @@ void Renderer::flush() {
 
 	presentFrame(finalFrame);
 
+	m_blockRing->endFrame();
+	m_instanceRing->endFrame();
+	m_indirectRing->endFrame();
+	auto profiler = Profiler::getInstance();
+	profiler->addCounter("BlockRing::bytesStreamed", m_blockRing->getBytesStreamed());
+	profiler->addCounter("BlockRing::overflows", m_blockRing->getNumOverflows());
+	profiler->addCounter("Instancing::draws", m_numInstancedDraws);
+	profiler->addCounter("Instancing::drawsSaved", m_numInstancedItems - m_numInstancedDraws);
+	profiler->addCounter("MultiDraw::draws", m_numMultiDraws);
+	profiler->addCounter("MultiDraw::commands", m_numMultiDrawCommands);
+
+	const ShadowCacheStats_t& shadowStats = m_shadowCasters.getStats();
+	profiler->addCounter("ShadowCache::hits", shadowStats.numHits);
+	profiler->addCounter("ShadowCache::rendered", shadowStats.numRendered);
+	profiler->addCounter("ShadowCache::staticRendered", shadowStats.numStaticRendered);
+	profiler->addCounter("ShadowCache::staticCasters", shadowStats.numStaticCasters);
+	profiler->addCounter("ShadowCache::dynamicCasters", shadowStats.numDynamicCasters);
+	profiler->addCounter("Culling::shadowLightCulled", shadowStats.numLightCulled);
+
 	resetScene();
+	recordGLStateStats();
+}
+
+
+void Renderer::recordGLStateStats() {
+	// counted since last flush, includes resource binds done by scene update
+	auto stateCache = GLStateCache::getInstance();
+	m_glStateStats = stateCache->getStats();
+	stateCache->resetStats();
+
+	auto profiler = Profiler::getInstance();
+	profiler->addCounter("GLState::issued", m_glStateStats.numIssued);
+	profiler->addCounter("GLState::elided", m_glStateStats.numElided);
 }
 
 void Renderer::presentFrame(Texture* frame) {
@@ -370,14 +520,14 @@ void Renderer::setCullFaceMode(CullFaceMode mode) {
 	switch (mode)
 	{
 	case CullFaceMode::None:
-		GLCALL(glDisable(GL_CULL_FACE));
+		GLStateCache::getInstance()->setCapability(GL_CULL_FACE, false);
 		break;
 
 	case CullFaceMode::Front:
 	case CullFaceMode::Back:
 	case CullFaceMode::Both:
-		GLCALL(glEnable(GL_CULL_FACE));
-		GLCALL(glCullFace(int(mode)));
+		GLStateCache::getInstance()->setCapability(GL_CULL_FACE, true);
+		GLStateCache::getInstance()->cullFace(GLenum(mode));
 		break;
 
 	default:
@@ -386,103 +536,91 @@ void Renderer::setCullFaceMode(CullFaceMode mode) {
 }
 
 void Renderer::setFaceWindingOrder(FaceWindingOrder order) {
-	GLCALL(glFrontFace(int(order)));
+	GLStateCache::getInstance()->frontFace(GLenum(order));
 }
 
 void Renderer::setShadeMode(ShadeMode mode) {
-	GLCALL(glShadeModel(int(mode)));
+	GLStateCache::getInstance()->shadeModel(GLenum(mode));
 }
 
 void Renderer::setFillMode(FillMode mode) {
-	GLCALL(glPolygonMode(GL_FRONT_AND_BACK, int(mode)));
+	GLStateCache::getInstance()->polygonMode(GLenum(mode));
 }
 
 void Renderer::setDepthMode(DepthMode mode) {
-	if (mode == DepthMode::Enable) {
-		GLCALL(glEnable(GL_DEPTH_TEST));
-	} else {
-		GLCALL(glDisable(GL_DEPTH_TEST));
-	}
+	GLStateCache::getInstance()->setCapability(GL_DEPTH_TEST, mode == DepthMode::Enable);
 }
 
 void Renderer::setDepthFunc(DepthFunc func) {
-	GLCALL(glDepthFunc(int(func)));
+	GLStateCache::getInstance()->depthFunc(GLenum(func));
 }
 
 void Renderer::setDepthMask(bool writable) {
-	GLCALL(glDepthMask(writable));
+	GLStateCache::getInstance()->depthMask(writable);
 }
 
 void Renderer::setStencilMode(StencilMode mode) {
-	if (mode == StencilMode::Enable) {
-		GLCALL(glEnable(GL_STENCIL_TEST));
-	} else {
-		GLCALL(glDisable(GL_STENCIL_TEST));
-	}
+	GLStateCache::getInstance()->setCapability(GL_STENCIL_TEST, mode == StencilMode::Enable);
 }
 
 void Renderer::setStencilMask(int mask) {
-	GLCALL(glStencilMask(mask));
+	GLStateCache::getInstance()->stencilMask(GLuint(mask));
 }
 
 void Renderer::setStencil(StencilFunc func, int refVal, int mask) {
-	GLCALL(glStencilFunc(int(func), refVal, mask));
+	GLStateCache::getInstance()->stencilFunc(GLenum(func), refVal, GLuint(mask));
 }
 
 void Renderer::setStencilOp(StencilOp passOp, StencilOp sFailOp, StencilOp dFailOp) {
-	GLCALL(glStencilOp(int(sFailOp), int(dFailOp), int(passOp)));
+	GLStateCache::getInstance()->stencilOp(GLenum(sFailOp), GLenum(dFailOp), GLenum(passOp));
 }
 
 void Renderer::setColorMask(bool writteable) {
-	GLCALL(glColorMask(writteable, writteable, writteable, writteable));
+	GLStateCache::getInstance()->colorMask(writteable, writteable, writteable, writteable);
 }
 
 void Renderer::setColorMask(bool r, bool g, bool b, bool a) {
-	GLCALL(glColorMask(r, g, b, a));
+	GLStateCache::getInstance()->colorMask(r, g, b, a);
 }
 
 void Renderer::setColorMask(int buffer, bool writteable) {
-	GLCALL(glColorMaski(buffer, writteable, writteable, writteable, writteable));
+	GLStateCache::getInstance()->colorMaski(buffer, writteable, writteable, writteable, writteable);
 }
 
 void Renderer::setColorMask(int buffer, bool r, bool g, bool b, bool a) {
-	GLCALL(glColorMaski(buffer, r, g, b, a));
+	GLStateCache::getInstance()->colorMaski(buffer, r, g, b, a);
 }
 
 void Renderer::setBlendMode(BlendMode mode)	 {
-	if (mode == BlendMode::Enable) {
-		GLCALL(glEnable(GL_BLEND));
-	} else {
-		GLCALL(glDisable(GL_BLEND));
-	}
+	GLStateCache::getInstance()->setCapability(GL_BLEND, mode == BlendMode::Enable);
 }
 
 void Renderer::setBlendFactor(BlendFactor src, BlendFactor dst) {
-	GLCALL(glBlendFunc(int(src), int(dst)));
+	GLStateCache::getInstance()->blendFuncSeparate(GLenum(src), GLenum(dst), GLenum(src), GLenum(dst));
 }
 
 void Renderer::setBlendFactor(int buffer, BlendFactor src, BlendFactor dst) {
-	GLCALL(glBlendFunci(buffer, int(src), int(dst)));
+	GLStateCache::getInstance()->blendFuncSeparatei(buffer, GLenum(src), GLenum(dst), GLenum(src), GLenum(dst));
 }
 
 void Renderer::setBlendFactorSeparate(BlendFactor srcGRB, BlendFactor dstRGB, BlendFactor srcA, BlendFactor dstA) {
-	GLCALL(glBlendFuncSeparate(int(srcGRB), int(dstRGB), int(srcA), int(dstA)));
+	GLStateCache::getInstance()->blendFuncSeparate(GLenum(srcGRB), GLenum(dstRGB), GLenum(srcA), GLenum(dstA));
 }
 
 void Renderer::setBlendFactorSeparate(int buffer, BlendFactor srcGRB, BlendFactor dstRGB, BlendFactor srcA, BlendFactor dstA) {
-	GLCALL(glBlendFuncSeparatei(buffer, int(srcGRB), int(dstRGB), int(srcA), int(dstA)));
+	GLStateCache::getInstance()->blendFuncSeparatei(buffer, GLenum(srcGRB), GLenum(dstRGB), GLenum(srcA), GLenum(dstA));
 }
 
 void Renderer::setBlendFunc(BlendFunc func) {
-	GLCALL(glBlendEquation(int(func)));
+	GLStateCache::getInstance()->blendEquation(GLenum(func));
 }
 
 void Renderer::setBlendFunc(int buffer, BlendFunc func) {
-	GLCALL(glBlendEquationi(buffer, int(func)));
+	GLStateCache::getInstance()->blendEquationi(buffer, GLenum(func));
 }
 
 void Renderer::setBlendColor(const glm::vec4& c) {
-	GLCALL(glBlendColor(c.r, c.g, c.b, c.a));
+	GLStateCache::getInstance()->blendColor(c);
 }
 
 
@@ -544,9 +682,19 @@ bool Renderer::setupFullScreenQuad() {
 }
 
 
-void Renderer::executeDrawCommand(const VertexArray* vao, PrimitiveType pt, size_t numVert, size_t numIndex) {
+void Renderer::executeDrawCommand(const VertexArray* vao, PrimitiveType pt, size_t numVert, size_t numIndex, size_t numInstance) {
 	vao->bind();
-	if (numIndex > 0) {
+	if (numInstance > 1) {
+		if (numIndex > 0) {
+			GLCALL(glDrawElementsInstanced(GLenum(pt), numIndex, GL_UNSIGNED_INT, 0, numInstance));
+		}
+		else {
+			GLCALL(glDrawArraysInstanced(GLenum(pt), 0, numVert, numInstance));
+		}
+		m_numInstancedDraws++;
+		m_numInstancedItems += numInstance;
+	}
+	else if (numIndex > 0) {
 		GLCALL(glDrawElements(GLenum(pt), numIndex, GL_UNSIGNED_INT, 0));
 	}
 	else {
@@ -556,6 +704,88 @@ void Renderer::executeDrawCommand(const VertexArray* vao, PrimitiveType pt, size
 }
 
 
+void Renderer::executeDrawCommand(const MeshRenderItem_t& task) {
+	if (task.drawCount == 0 && task.indexOffset == 0 && task.vertexOffset == 0) {
+		executeDrawCommand(task.vao, task.primitive, task.vertexCount, task.indexCount, task.instanceCount);
+		return;
+	}
+
+	task.vao->bind();
+	if (task.drawCount > 0) {
+		m_indirectRing->bind(Buffer::Target::DrawIndirectBuffer);
+		GLCALL(glMultiDrawElementsIndirect(GLenum(task.primitive), GL_UNSIGNED_INT, (const void*)task.indirectOffset, task.drawCount, 0));
+		m_numMultiDraws++;
+		m_numMultiDrawCommands += task.drawCount;
+	}
+	else if (task.indexCount > 0) {
+		const void* indices = (const void*)(task.indexOffset * sizeof(Index_t));
+		if (task.instanceCount > 1) {
+			GLCALL(glDrawElementsInstancedBaseVertex(GLenum(task.primitive), task.indexCount, GL_UNSIGNED_INT, indices, task.instanceCount, task.vertexOffset));
+			m_numInstancedDraws++;
+			m_numInstancedItems += task.instanceCount;
+		}
+		else {
+			GLCALL(glDrawElementsBaseVertex(GLenum(task.primitive), task.indexCount, GL_UNSIGNED_INT, indices, task.vertexOffset));
+		}
+	}
+	else {
+		if (task.instanceCount > 1) {
+			GLCALL(glDrawArraysInstanced(GLenum(task.primitive), task.vertexOffset, task.vertexCount, task.instanceCount));
+			m_numInstancedDraws++;
+			m_numInstancedItems += task.instanceCount;
+		}
+		else {
+			GLCALL(glDrawArrays(GLenum(task.primitive), task.vertexOffset, task.vertexCount));
+		}
+	}
+	task.vao->unbind();
+}
+
+
+size_t Renderer::batchItems(const MeshRenderItem_t* items, size_t count, MeshRenderItem_t& batch) {
+	batch = items[0];
+	size_t n = m_isMultiDraw ? multiDrawRunLength(items, count) : 1;
+
+	// a run of one mesh is cheaper as plain instanced draw
+	size_t first = instanceRunLength(items, n);
+	if (first >= n) {
+		n = instanceRunLength(items, count);
+		batch.instanceCount = uint32_t(n);
+		return n;
+	}
+
+	size_t numCommand = 0;
+	for (size_t i = 0; i < n; i += instanceRunLength(items + i, n - i))
+		numCommand++;
+
+	size_t offset = 0;
+	DrawElementsIndirectCommand_t* commands = (DrawElementsIndirectCommand_t*)m_indirectRing->allocate(sizeof(DrawElementsIndirectCommand_t) * numCommand, offset);
+	if (!commands) {
+		batch.instanceCount = uint32_t(first);
+		return first;
+	}
+
+	// one command per instanced sub run, baseInstance points instance slot stream at the sub run's matrices
+	size_t i = 0;
+	for (size_t c = 0; c < numCommand; c++) {
+		const MeshRenderItem_t& item = items[i];
+		size_t k = instanceRunLength(items + i, n - i);
+		commands[c].count = GLuint(item.indexCount);
+		commands[c].instanceCount = GLuint(k);
+		commands[c].firstIndex = GLuint(item.indexOffset);
+		commands[c].baseVertex = GLint(item.vertexOffset);
+		commands[c].baseInstance = GLuint(item.instanceIndex);
+		i += k;
+	}
+
+	batch.drawCount = uint32_t(numCommand);
+	batch.indirectOffset = offset;
+	batch.instanceCount = 1;
+
+	return n;
+}
+
+
 
 void Renderer::flushDrawCommands() {
 	GLCALL(glFlush());
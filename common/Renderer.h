@@ -7,21 +7,27 @@
 #include"RenderTechnique.h"
 #include"FrameAllocator.h"
 #include"PostProcessingManager.h"
+#include"RenderQueue.h"
+#include"GLStateCache.h"
+#include"FrustumCuller.h"
+#include"ShadowMapCache.h"
 
 class Scene;
 class Texture;
 class Buffer;
+class RingBuffer;
 class VertexArray;
 class RenderTarget;
 
 
-#define MAX_NUM_OPAQUES 1024
-#define MAX_NUM_CUTOUTS 512
-#define MAX_NUM_TRANSPARENCES 64
 #define MAX_NUM_MAIN_LIGHTS 16
 #define MAX_NUM_LIGHTS 1024
 #define MAX_NUM_CAMERAS 8
 #define MAX_NUM_FILTERS 16
+#define BLOCK_RING_REGION_SIZE (4 * 1024 * 1024) // per frame bytes of streamed uniform blocks
+#define INSTANCE_RING_REGION_SIZE (MAX_NUM_INSTANCES * sizeof(glm::mat4)) // per frame bytes of instance model matrices
+#define INDIRECT_RING_REGION_SIZE (1024 * 1024) // per frame bytes of multi draw indirect commands, 51k commands
+#define INSTANCE_BUFFER_BINDING 7 // shader storage binding of instance model matrices
 
 const int MAX_NUM_TOTAL_LIGHTS = MAX_NUM_MAIN_LIGHTS + MAX_NUM_LIGHTS;
 
@@ -109,20 +115,17 @@ public:
 
 	inline void submitOpaqueItem(const MeshRenderItem_t& item) {
 		ASSERT(item.vao->isVailde());
-		if (m_scene.numOpaqueItems < MAX_NUM_OPAQUES)
-			m_opaqueItems[m_scene.numOpaqueItems++] = item;
+		m_opaqueQueue.push(item);
 	}
 
 	inline void submitCutOutItem(const MeshRenderItem_t& item) {
 		ASSERT(item.vao->isVailde());
-		if (m_scene.numCutOutItems < MAX_NUM_CUTOUTS)
-			m_cutOutItems[m_scene.numCutOutItems++] = item;
+		m_cutOutQueue.push(item);
 	}
 
 	inline void submitTransparentItem(const MeshRenderItem_t& item) {
 		ASSERT(item.vao->isVailde());
-		if (m_scene.numTransparentItems < MAX_NUM_TRANSPARENCES)
-			m_transparentItems[m_scene.numTransparentItems++] = item;
+		m_transparentQueue.push(item);
 	}
 
 	inline void submitPostProcessingFilter(const FilterComponent* filter) {
@@ -144,7 +147,11 @@ public:
 		GLCALL(glDispatchCompute(numGroupX, numGroupY, numGroupZ));
 	}
 
-	void executeDrawCommand(const VertexArray* vao, PrimitiveType pt, size_t numVert, size_t numIndex);
+	void executeDrawCommand(const VertexArray* vao, PrimitiveType pt, size_t numVert, size_t numIndex, size_t numInstance = 1);
+	void executeDrawCommand(const MeshRenderItem_t& task); // honours instancing, mesh buffer offsets & multi draw batches
+
+	// merge leading run of items into one draw (instanced or multi draw indirect), return number of items consumed
+	size_t batchItems(const MeshRenderItem_t* items, size_t count, MeshRenderItem_t& batch);
 	void flushDrawCommands();
 	void drawFullScreenQuad();
 	void presentFrame(Texture* frame);
@@ -186,6 +193,50 @@ public:
 		return m_renderTechnique.get();
 	}
 
+	inline const RenderQueueStats& getFrameStats() const {
+		return m_frameStats;
+	}
+
+	inline const GLStateCacheStats& getGLStateStats() const {
+		return m_glStateStats;
+	}
+
+	inline void setFrustumCullingEnabled(bool enable) {
+		m_isFrustumCulling = enable;
+	}
+
+	inline bool isFrustumCullingEnabled() const {
+		return m_isFrustumCulling;
+	}
+
+	// consecutive queued items sharing static mesh & material are drawn instanced
+	inline void setInstancingEnabled(bool enable) {
+		m_isInstancing = enable;
+	}
+
+	inline bool isInstancingEnabled() const {
+		return m_isInstancing;
+	}
+
+	// consecutive queued items sharing a mesh buffer vao & material go in one multi draw indirect call
+	inline void setMultiDrawEnabled(bool enable) {
+		m_isMultiDraw = enable;
+	}
+
+	inline bool isMultiDrawEnabled() const {
+		return m_isMultiDraw;
+	}
+
+	// per draw uniform blocks are streamed through it
+	inline RingBuffer* getBlockRing() const {
+		return m_blockRing.get();
+	}
+
+	// which shadow casters moved this frame, and shadow map cache stats
+	inline ShadowCasterTracker* getShadowCasterTracker() {
+		return &m_shadowCasters;
+	}
+
 protected:
 	void setGPUPipelineState(const GPUPipelineState& pipelineState);
 	bool setupFullScreenQuad();
@@ -195,6 +246,10 @@ protected:
 	}
 
 	void resetScene();
+	void cullRenderQueues();
+	void sortRenderQueues();
+	void uploadInstances();
+	void recordGLStateStats();
 
 	// clipping states
 	void setCullFaceMode(CullFaceMode mode);
@@ -244,10 +299,26 @@ protected:
 	std::unique_ptr<Buffer> m_quadVBO;
 	std::unique_ptr<Buffer> m_quadIBO;
 
+	std::unique_ptr<RingBuffer> m_blockRing;
+	std::unique_ptr<RingBuffer> m_instanceRing;
+	std::unique_ptr<RingBuffer> m_indirectRing;
+
 	// renderable scene
-	std::array<MeshRenderItem_t, MAX_NUM_OPAQUES> m_opaqueItems;
-	std::array<MeshRenderItem_t, MAX_NUM_CUTOUTS> m_cutOutItems;
-	std::array<MeshRenderItem_t, MAX_NUM_TRANSPARENCES> m_transparentItems;
+	FrameAllocator m_frameAlloc;
+	RenderQueue m_opaqueQueue;
+	RenderQueue m_cutOutQueue;
+	RenderQueue m_transparentQueue;
+	RenderQueueStats m_frameStats;
+	GLStateCacheStats m_glStateStats;
+	FrustumCuller m_culler;
+	ShadowCasterTracker m_shadowCasters;
+	bool m_isFrustumCulling;
+	bool m_isInstancing;
+	size_t m_numInstancedDraws;
+	size_t m_numInstancedItems;
+	bool m_isMultiDraw;
+	size_t m_numMultiDraws;
+	size_t m_numMultiDrawCommands;
 	std::array<Light_t, MAX_NUM_MAIN_LIGHTS> m_mainLights;
 	std::array<Light_t, MAX_NUM_LIGHTS> m_lights;
 	std::array<Camera_t, MAX_NUM_CAMERAS> m_cameras;
@@ -4,6 +4,7 @@
 #include<glm/gtc/matrix_transform.hpp>
 #include<vector>
 #include<algorithm>
+#include<limits>
 
 
 Vertex_t::Vertex_t(): position(0.f)
@@ -132,6 +133,35 @@ maximum(0.f) {
 
 }
 
+AABB_t::AABB_t(const glm::vec3& min, const glm::vec3& max) : minimum(min),
+maximum(max) {
+
+}
+
+void AABB_t::reset() {
+	minimum = glm::vec3(std::numeric_limits<float>::max());
+	maximum = glm::vec3(std::numeric_limits<float>::lowest());
+}
+
+void AABB_t::expand(const glm::vec3& p) {
+	minimum = glm::min(minimum, p);
+	maximum = glm::max(maximum, p);
+}
+
+AABB_t AABB_t::transform(const glm::mat4& m) const {
+	if (!isValid())
+		return *this;
+
+	// transform center, project extents with absolute rotation-scale part
+	glm::vec3 center = (minimum + maximum) * 0.5f;
+	glm::vec3 extent = (maximum - minimum) * 0.5f;
+	glm::mat3 absM(glm::abs(glm::vec3(m[0])), glm::abs(glm::vec3(m[1])), glm::abs(glm::vec3(m[2])));
+	glm::vec3 c = glm::vec3(m * glm::vec4(center, 1.f));
+	glm::vec3 e = absM * extent;
+
+	return AABB_t(c - e, c + e);
+}
+
 
 Light_t::Light_t(): type(LightType::Unknown)
 , position(0.f)
@@ -160,8 +190,78 @@ MeshRenderItem_t::MeshRenderItem_t(): vao(nullptr)
 , indexCount(0)
 , vertexCount(0)
 , boneCount(0)
+, indexOffset(0)
+, vertexOffset(0)
 , primitive(PrimitiveType::Unknown)
-, modelMatrix(1.f) {
+, modelMatrix(1.f)
+, bounds()
+, instanceIndex(INVALID_INSTANCE_INDEX)
+, instanceCount(1)
+, drawCount(0)
+, indirectOffset(0) {
+	bounds.reset();
+}
+
+
+size_t instanceRunLength(const MeshRenderItem_t* items, size_t count) {
+	if (count <= 1)
+		return count;
+
+	const MeshRenderItem_t& first = items[0];
+	if (first.boneCount > 0 || first.instanceIndex == INVALID_INSTANCE_INDEX)
+		return 1;
+
+	size_t n = 1;
+	while (n < count && n < MAX_INSTANCES_PER_DRAW) {
+		const MeshRenderItem_t& item = items[n];
+		if (item.vao != first.vao
+			|| item.material != first.material
+			|| item.primitive != first.primitive
+			|| item.indexCount != first.indexCount
+			|| item.vertexCount != first.vertexCount
+			|| item.indexOffset != first.indexOffset
+			|| item.vertexOffset != first.vertexOffset
+			|| item.boneCount > 0
+			|| item.instanceIndex != first.instanceIndex + n)
+			break;
+		n++;
+	}
+
+	return n;
+}
+
+
+size_t multiDrawRunLength(const MeshRenderItem_t* items, size_t count) {
+	if (count <= 1)
+		return count;
+
+	const MeshRenderItem_t& first = items[0];
+	if (first.boneCount > 0 || first.indexCount == 0 || first.instanceIndex == INVALID_INSTANCE_INDEX)
+		return 1;
+
+	// draws are counted at mesh changes, run ends before it would need too many
+	size_t n = 1;
+	size_t numDraw = 1;
+	while (n < count) {
+		const MeshRenderItem_t& item = items[n];
+		const MeshRenderItem_t& prev = items[n - 1];
+		if (item.vao != first.vao
+			|| item.material != first.material
+			|| item.primitive != first.primitive
+			|| item.indexCount == 0
+			|| item.boneCount > 0
+			|| item.instanceIndex != first.instanceIndex + n)
+			break;
+
+		if (item.indexOffset != prev.indexOffset || item.vertexOffset != prev.vertexOffset || item.indexCount != prev.indexCount) {
+			if (numDraw >= MAX_DRAWS_PER_MULTI_DRAW)
+				break;
+			numDraw++;
+		}
+		n++;
+	}
+
+	return n;
 }
 
 
@@ -176,12 +276,15 @@ void Scene_t::clear() {
 void Scene_t::reset() {
 	opaqueItems = nullptr;
 	numOpaqueItems = 0;
+	numOpaqueCasters = 0;
 
 	cutOutItems = nullptr;
 	numCutOutItems = 0;
+	numCutOutCasters = 0;
 	
 	transparentItems = nullptr;
 	numTransparentItems = 0;
+	numTransparentCasters = 0;
 
 	mainLights = nullptr;
 	numMainLights = 0;
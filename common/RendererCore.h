@@ -2,6 +2,7 @@
 #include<glm/glm.hpp>
 #include<glad/glad.h>
 #include"Containers.h"
+#include<cstdint>
 
 class VertexArray;
 class Texture;
@@ -120,6 +121,15 @@ struct AABB_t {
 	glm::vec3 maximum;
 
 	AABB_t();
+	AABB_t(const glm::vec3& min, const glm::vec3& max);
+
+	void reset(); // empty box, grows by expand()
+	void expand(const glm::vec3& p);
+	AABB_t transform(const glm::mat4& m) const;
+
+	inline bool isValid() const {
+		return minimum.x <= maximum.x && minimum.y <= maximum.y && minimum.z <= maximum.z;
+	}
 };
 
 
@@ -193,22 +203,61 @@ struct MeshRenderItem_t {
 	size_t vertexCount;
 	size_t boneCount;
 
+	// first index & vertex of the mesh when its vao is shared with other meshes
+	size_t indexOffset;
+	size_t vertexOffset;
+
 	PrimitiveType primitive;
 	glm::mat4 modelMatrix;
+	AABB_t bounds; // world space, invalid bounds are never culled
+
+	// slot of model matrix in renderer's per frame instance buffer, instanceCount consecutive slots are drawn by one call
+	uint32_t instanceIndex;
+	uint32_t instanceCount;
+
+	// drawCount > 0 draws indirect commands at indirectOffset of renderer's indirect buffer in one call
+	uint32_t drawCount;
+	size_t indirectOffset;
 
 	MeshRenderItem_t();
 };
 
 
+// layout read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand_t {
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+
+#define INVALID_INSTANCE_INDEX 0xffffffffu
+#define MAX_NUM_INSTANCES (128 * 1024) // instance slots per frame
+#define MAX_INSTANCES_PER_DRAW 4096
+#define MAX_DRAWS_PER_MULTI_DRAW 4096 // distinct meshes per multi draw
+
+// number of leading items drawable as instances of the first one: same static mesh & material in consecutive instance slots
+size_t instanceRunLength(const MeshRenderItem_t* items, size_t count);
+
+// number of leading items drawable by one multi draw: indexed static meshes of the same vao & material in consecutive instance slots
+size_t multiDrawRunLength(const MeshRenderItem_t* items, size_t count);
+
+
 struct Scene_t {
+	// items visible to main camera come first, shadow casters outside of it follow
 	MeshRenderItem_t* opaqueItems;
 	size_t numOpaqueItems;
+	size_t numOpaqueCasters;
 
 	MeshRenderItem_t* cutOutItems;
 	size_t numCutOutItems;
+	size_t numCutOutCasters;
 	
 	MeshRenderItem_t* transparentItems;
 	size_t numTransparentItems;
+	size_t numTransparentCasters;
 
 	Light_t* mainLights; // lights cast shadow
 	size_t	numMainLights; 
@@ -449,6 +498,50 @@ struct MaterialBlock {
 };
 
 
+// LightBlock of per light deferred shaders, std140
+struct DirectionalLightBlock {
+	glm::vec4 color; // rgb(color) a(intensity)
+	glm::vec3 inverseDiretion;
+	float _padding;
+
+	DirectionalLightBlock() : color(0.f)
+		, inverseDiretion(0.f)
+		, _padding(0.f) {
+
+	}
+};
+
+
+struct PointLightBlock {
+	glm::vec4 position; // xyz(position) w(range)
+	glm::vec4 color; // rgb(color) a(intensity)
+
+	PointLightBlock() : position(0.f)
+		, color(0.f) {
+
+	}
+};
+
+
+struct SpotLightBlock {
+	glm::vec4 position; // xyz(position) w(range)
+	glm::vec4 color; // rgb(color) a(intensity)
+	glm::vec3 inverseDirection;
+	float _padding;
+	glm::vec2 angles; // inner, outter cone
+	glm::vec2 _padding2;
+
+	SpotLightBlock() : position(0.f)
+		, color(0.f)
+		, inverseDirection(0.f)
+		, _padding(0.f)
+		, angles(0.f)
+		, _padding2(0.f) {
+
+	}
+};
+
+
 template<size_t N>
 struct CascadeShadowBlock {
 	glm::mat4 lightVP[N];
@@ -8,19 +8,29 @@
 #include"AnimatorComponent.h"
 #include"SkinMeshRenderComponent.h"
 #include"Renderer.h"
+#include"Profiler.h"
+#include"JobSystem.h"
 #include<glm/glm.hpp>
 #include<glm/gtc/matrix_transform.hpp>
 #include<algorithm>
 
 
+// components per job in concurrent update
+#define CONCURRENT_UPDATE_GRAIN 4
+
+
 Scene::Scene(const std::string& name): m_name(name)
 , m_isInitialize(false)
 , m_id(0)
+, m_transformSystem()
 , m_mainCamera()
-, m_renderContext() {
+, m_renderContext()
+, m_concurrentUpdates()
+, m_pendingModels() {
 	m_id = reinterpret_cast<unsigned long>(this);
 	m_rootObject = std::make_unique<SceneObject>("root");
 	m_rootObject->m_parentScene = this;
+	m_rootObject->m_transform.moveToSystem(&m_transformSystem);
 }
 
 
@@ -39,6 +49,7 @@ bool Scene::initialize() {
 
 
 void Scene::update(double dt) {
+	PROFILE_SCOPE("Scene::update");
 	if (!m_isInitialize)
 		if (!initialize()) {
 #ifdef _DEBUG
@@ -47,7 +58,24 @@ void Scene::update(double dt) {
 			return;
 		}
 
-	m_rootObject->update(dt);
+	attachLoadedModels();
+
+	// components which only touch their own state (animators) are updated on job threads
+	m_concurrentUpdates.clear();
+	m_rootObject->update(dt, &m_concurrentUpdates);
+
+	{
+		PROFILE_SCOPE("Scene::concurrentUpdate");
+		JobSystem::getInstance()->parallelFor(m_concurrentUpdates.size(), CONCURRENT_UPDATE_GRAIN, [this, dt](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++)
+				m_concurrentUpdates[i]->update(dt);
+		});
+	}
+
+	{
+		PROFILE_SCOPE("TransformSystem::update");
+		m_transformSystem.update();
+	}
 }
 
 
@@ -60,6 +88,7 @@ glm::vec2 Scene::getRenderSize() const {
 
 
 void Scene::render() {
+	PROFILE_SCOPE("Scene::render");
 	Renderer* renderer = m_renderContext.getRenderer();
 	if (!renderer) {
 #ifdef _DEBUG
@@ -110,7 +139,28 @@ SceneObject* Scene::addModel(const std::string& file, int loadOptions, const std
 
 	std::string modelName = name.empty() ? model->getName() : name;
 	SceneObject* obj = addObject(modelName);
-	
+	attachModel(obj, model);
+
+	return obj;
+}
+
+
+SceneObject* Scene::addModelAsync(const std::string& file, int loadOptions, const std::string& name) {
+	auto handle = MeshManager::getInstance()->addMeshAsync(file, loadOptions);
+	auto model = handle->getModel().lock();
+
+	std::string modelName = name.empty() ? model->getName() : name;
+	SceneObject* obj = addObject(modelName);
+	if (handle->isReady())
+		attachModel(obj, model);
+	else
+		m_pendingModels.push_back({ obj->id(), handle });
+
+	return obj;
+}
+
+
+void Scene::attachModel(SceneObject* obj, std::shared_ptr<Model> model) {
 	if (model->hasAnimation()) {
 		SkinMeshRenderComponent* meshRender = obj->addComponent<SkinMeshRenderComponent>();
 		meshRender->setMeshes(model);
@@ -124,11 +174,35 @@ SceneObject* Scene::addModel(const std::string& file, int loadOptions, const std
 		MeshRenderComponent* meshRender = obj->addComponent<MeshRenderComponent>();
 		meshRender->setMeshes(model);
 	}
+}
 
 
-	return obj;
+void Scene::attachLoadedModels() {
+	for (size_t i = 0; i < m_pendingModels.size();) {
+		auto& pending = m_pendingModels[i];
+		if (!pending.second->isDone()) {
+			i++;
+			continue;
+		}
+
+		// object may have been moved under another parent or removed meanwhile
+		SceneObject* obj = nullptr;
+		depthFirstVisit([&](SceneObject* o, bool& stop) {
+			stop = o->id() == pending.first;
+			if (stop)
+				obj = o;
+			return true;
+		});
+
+		auto model = pending.second->getModel().lock();
+		if (obj && model && pending.second->isReady())
+			attachModel(obj, model);
+
+		m_pendingModels.erase(m_pendingModels.begin() + i);
+	}
 }
 
+
 SceneObject* Scene::addGrid(float w, float d, float spacing, std::weak_ptr<IMaterial> mat) {
 	SceneObject* grid = addObject("Grid");
 	auto gridMesh = MeshManager::getInstance()->createGrid(w, d, spacing);
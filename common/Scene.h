@@ -2,6 +2,8 @@
 #include"SceneObject.h"
 #include"RendererCore.h"
 #include"MeshLoader.h"
+#include"TransformSystem.h"
+#include"ModelLoadQueue.h"
 #include<functional>
 
 
@@ -46,6 +48,8 @@ public:
 	void addObject(std::unique_ptr<SceneObject>&& object);
 	
 	SceneObject* addModel( const std::string& file, int loadOptions = MeshLoader::Option::LoadMaterials | MeshLoader::Option::LoadAnimations,const std::string& name = "");
+	// object comes back empty, mesh/animator components are attached by update() once model is loaded
+	SceneObject* addModelAsync(const std::string& file, int loadOptions = MeshLoader::Option::LoadMaterials | MeshLoader::Option::LoadAnimations, const std::string& name = "");
 	SceneObject* addGrid(float w, float d, float spacing, std::weak_ptr<IMaterial> mat = std::weak_ptr<IMaterial>());
 	SceneObject* addPlane(float w, float d, std::weak_ptr<IMaterial> mat = std::weak_ptr<IMaterial>());
 	SceneObject* addCube(std::weak_ptr<IMaterial> mat = std::weak_ptr<IMaterial>());
@@ -130,14 +134,25 @@ public:
 		return m_mainCamera;
 	}
 
+	inline TransformSystem* getTransformSystem() {
+		return &m_transformSystem;
+	}
+
+protected:
+	void attachModel(SceneObject* obj, std::shared_ptr<Model> model);
+	void attachLoadedModels();
+
 private:
 	ID m_id;
 	std::string m_name;
 	bool m_isInitialize;
 
+	TransformSystem m_transformSystem; // must outlive object hierarchy
 	std::unique_ptr<SceneObject> m_rootObject;
 
 	CameraComponent* m_mainCamera;
 	
 	RenderContext m_renderContext;
+	std::vector<Component*> m_concurrentUpdates; // reused every frame
+	std::vector<std::pair<ID, std::shared_ptr<ModelLoadHandle>>> m_pendingModels; // object id, model loading for it
 };
\ No newline at end of file
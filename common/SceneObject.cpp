@@ -67,7 +67,7 @@ bool SceneObject::initialize() {
 	return success;
 }
 
-void SceneObject::update(double dt) {
+void SceneObject::update(double dt, std::vector<Component*>* concurrentUpdates) {
 	depthFirstTraverse([=](SceneObject* obj, bool& stop) {
 		if (!obj->m_isEnable)
 			return false;
@@ -77,6 +77,11 @@ void SceneObject::update(double dt) {
 			if (!c->m_isEnable)
 				continue;
 
+			if (concurrentUpdates && c->isConcurrentUpdate()) {
+				concurrentUpdates->push_back(c);
+				continue;
+			}
+
 			c->update(dt);
 		}
 		return true;
@@ -94,11 +99,10 @@ void SceneObject::render(RenderContext* context) const {
 		}
 	}
 
-	context->pushMatrix(m_transform.getMatrix());
+	// renderables read the cached world matrix, no matrix stack needed
 	for (size_t i = 0; i < m_childs.size(); i++) {
 		m_childs[i]->render(context);
 	}
-	context->popMatrix();
 }
 
 bool SceneObject::addComponent(Component* c) {
@@ -173,6 +177,7 @@ void SceneObject::addChild(std::unique_ptr<SceneObject>&& c) {
 	m_childs.push_back(std::move(c));
 	_c->m_parent = this;
 	_c->m_parentScene = m_parentScene;
+	_c->m_transform.onParentChanged();
 }
 
 void SceneObject::insertChild(SceneObject* c, size_t index) {
@@ -184,6 +189,7 @@ void SceneObject::insertChild(std::unique_ptr<SceneObject>&& c, size_t index) {
 	m_childs.insert(m_childs.begin() + index, std::move(c));
 	_c->m_parent = this;
 	_c->m_parentScene = m_parentScene;
+	_c->m_transform.onParentChanged();
 }
 
 void SceneObject::movechild(size_t srcIndex, size_t dstIndex) {
@@ -265,6 +271,7 @@ std::unique_ptr<SceneObject> SceneObject::removeChildWithID(ID id) {
 		std::unique_ptr<SceneObject> obj = std::move(*pos);
 		m_childs.erase(pos);
 		obj->m_parent = nullptr;
+		obj->m_transform.onParentChanged();
 		return std::move(obj);
 	}
 	
@@ -280,6 +287,7 @@ std::unique_ptr<SceneObject> SceneObject::removeChildWithTag(ID tag) {
 		std::unique_ptr<SceneObject> obj = std::move(*pos);
 		m_childs.erase(pos);
 		obj->m_parent = nullptr;
+		obj->m_transform.onParentChanged();
 		return std::move(obj);
 	}
 
@@ -295,6 +303,7 @@ std::unique_ptr<SceneObject> SceneObject::removeChildWithName(const std::string&
 		std::unique_ptr<SceneObject> obj = std::move(*pos);
 		m_childs.erase(pos);
 		obj->m_parent = nullptr;
+		obj->m_transform.onParentChanged();
 		return std::move(obj);
 	}
 
@@ -310,6 +319,7 @@ std::unique_ptr<SceneObject> SceneObject::removeChild(SceneObject* c) {
 		std::unique_ptr<SceneObject> obj = std::move(*pos);
 		m_childs.erase(pos);
 		obj->m_parent = nullptr;
+		obj->m_transform.onParentChanged();
 		return std::move(obj);
 	}
 
@@ -36,7 +36,7 @@ public:
 	// life cycle
 	//
 	bool initialize();
-	void update(double dt);
+	void update(double dt, std::vector<Component*>* concurrentUpdates = nullptr); // collect instead of update concurrent components if given
 	void render(RenderContext* context) const;
 	
 	//
@@ -23,6 +23,21 @@ std::weak_ptr<ShaderProgram> ShaderProgramManager::addProgram(const std::string&
 }
 
 
+std::weak_ptr<ShaderProgram> ShaderProgramManager::addProgramSource(const std::string& name, const std::string& source) {
+	auto found = getProgram(name);
+	if (!found.expired())
+		return found;
+
+	auto program = std::make_shared<ShaderProgram>(name, getResourcePath(name, false), source);
+	if (program->compileAndLink()) {
+		m_shaderPrograms.insert(std::make_pair(name, program));
+		return std::weak_ptr<ShaderProgram>(program);
+	}
+
+	return std::weak_ptr<ShaderProgram>();
+}
+
+
 bool ShaderProgramManager::hasProgram(const std::string& name) const {
 	return !getProgram(name).expired();
 }
@@ -45,7 +60,7 @@ bool ShaderProgramManager::removeProgram(const std::string& name) {
 }
 
 
-std::string ShaderProgramManager::getResourcePath(const std::string& fileName) const {
+std::string ShaderProgramManager::getResourcePath(const std::string& fileName, bool mustExist) const {
 	auto res = FileSystem::Default.getHomeDirectory();
 	res /= "res";
 	res /= "shader";
@@ -55,7 +70,7 @@ std::string ShaderProgramManager::getResourcePath(const std::string& fileName) c
 	if (!res.has_extension())
 		res.concat(".shader");
 	
-	if (!fs::exists(res)) {
+	if (mustExist && !fs::exists(res)) {
 		std::cerr << "Walling: file \"" << res.string() << "\" not exist!" << std::endl;
 #ifdef _DEBUG
 		ASSERT(false);
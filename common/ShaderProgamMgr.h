@@ -14,6 +14,7 @@ public:
 	ShaderProgramManager() {};
 
 	std::weak_ptr<ShaderProgram> addProgram(const std::string& fileName, std::string name = "");
+	std::weak_ptr<ShaderProgram> addProgramSource(const std::string& name, const std::string& source); // generated program, includes resolve in shader directory
 	std::weak_ptr<ShaderProgram> getProgram(const std::string name) const;
 	bool removeProgram(const std::string& name);
 	bool hasProgram(const std::string& name) const;
@@ -27,7 +28,7 @@ public:
 	}
 
 protected:
-	std::string getResourcePath(const std::string& fileName) const;
+	std::string getResourcePath(const std::string& fileName, bool mustExist = true) const;
 
 private:
 	std::unordered_map<std::string, std::shared_ptr<ShaderProgram>> m_shaderPrograms;
@@ -1,5 +1,6 @@
 #include"ShaderProgram.h"
 #include"Util.h"
+#include"GLStateCache.h"
 #include"FrameAllocator.h"
 #include"Containers.h"
 #include<filesystem>
@@ -8,14 +9,77 @@
 #include<algorithm>
 #include<iterator>
 #include<memory>
+#include<mutex>
+#include<deque>
+
+
+//
+// uniform name interning
+// handles get declared from job system & loader threads too, map is guarded by a mutex.
+// names live in a deque so name() references stay valid while others intern.
+//
+static std::mutex& UniformNameMutex() {
+	static std::mutex s_mutex;
+	return s_mutex;
+}
+
+static std::unordered_map<std::string, int>& UniformNameIds() {
+	static std::unordered_map<std::string, int> s_ids;
+	return s_ids;
+}
+
+static std::deque<std::string>& UniformNames() {
+	static std::deque<std::string> s_names;
+	return s_names;
+}
+
+
+UniformHandle::UniformHandle(const std::string& name) : m_id(-1) {
+	std::lock_guard<std::mutex> lock(UniformNameMutex());
+	auto& ids = UniformNameIds();
+	auto pos = ids.find(name);
+	if (pos != ids.end()) {
+		m_id = pos->second;
+		return;
+	}
+
+	auto& names = UniformNames();
+	m_id = names.size();
+	names.push_back(name);
+	ids.insert({ name, m_id });
+}
+
+
+const std::string& UniformHandle::name() const {
+	static const std::string s_empty;
+	if (!isValid())
+		return s_empty;
+
+	std::lock_guard<std::mutex> lock(UniformNameMutex());
+	return UniformNames()[m_id];
+}
+
+
+size_t UniformHandle::internedCount() {
+	std::lock_guard<std::mutex> lock(UniformNameMutex());
+	return UniformNames().size();
+}
 
 
 
 ShaderProgram::ShaderProgram(const std::string& name, const std::string& file):m_name(name)
 , m_file(file)
+, m_source()
 , m_handler(0)
-, m_linked(false) {
+, m_linked(false)
+, m_uniformCache()
+, m_generation(1) {
+
+}
+
 
+ShaderProgram::ShaderProgram(const std::string& name, const std::string& file, const std::string& source) :ShaderProgram(name, file) {
+	m_source = source;
 }
 
 ShaderProgram::~ShaderProgram() {
@@ -29,7 +93,8 @@ bool ShaderProgram::compileAndLink() {
 	if (m_file.empty())
 		return false;
 
-	auto shaderSrcs = parseShaderSource(m_file);
+	std::istringstream source(m_source);
+	auto shaderSrcs = m_source.empty() ? parseShaderSource(m_file) : parseShaderSource(source);
 	if (shaderSrcs.empty())
 		return false;
 
@@ -97,13 +162,16 @@ bool ShaderProgram::isLinked() const {
 void ShaderProgram::release() {
 	if (m_handler) {
 		GLCALL(glDeleteProgram(m_handler));
+		GLStateCache::getInstance()->onDeleteProgram(m_handler);
 		m_handler = 0;
 		m_linked = false;
 		m_attributes.clear();
 		m_uniforms.clear();
+		m_uniformLocations.clear();
 		m_uniformBlocks.clear();
 		m_shaderStorageBlocks.clear();
 		m_stageSubroutinesInfo.clear();
+		m_generation++; // invalid cached uniform locations
 	}
 }
 
@@ -140,10 +208,11 @@ bool ShaderProgram::hasAttribute(const std::string& name) const {
 }
 
 bool ShaderProgram::hasUniform(const std::string& name) const {
-	auto pos = std::find_if(m_uniforms.begin(), m_uniforms.end(), [&](const ShaderProgram::Uniform& u) {
-		return u.name == name;
-	});
-	return pos != m_uniforms.end();
+	return getUniformLocation(name) != -1;
+}
+
+bool ShaderProgram::hasUniform(const UniformHandle& handle) const {
+	return getUniformLocation(handle) != -1;
 }
 
 bool ShaderProgram::hasUniformBlock(const std::string& name) const {
@@ -160,11 +229,11 @@ bool ShaderProgram::hasSubroutineUniform(Shader::Type shaderStage, const std::st
 
 
 void ShaderProgram::bind() const {
-	GLCALL(glUseProgram(m_handler));
+	GLStateCache::getInstance()->useProgram(m_handler);
 }
 
 void ShaderProgram::unbind() const {
-	GLCALL(glUseProgram(0));
+	GLStateCache::getInstance()->useProgram(0);
 }
 
 bool ShaderProgram::isBinded() const {
@@ -296,6 +365,11 @@ std::unordered_map<Shader::Type, std::string> ShaderProgram::parseShaderSource(c
 	if (!ifs.is_open())
 		return {};
 
+	return parseShaderSource(ifs);
+}
+
+
+std::unordered_map<Shader::Type, std::string> ShaderProgram::parseShaderSource(std::istream& ifs) {
 	std::string line;
 	std::stringstream srcSessions[4];
 	int idx = -1;
@@ -346,8 +420,6 @@ std::unordered_map<Shader::Type, std::string> ShaderProgram::parseShaderSource(c
 		if (idx != -1)
 			srcSessions[idx] << line << "\n";
 	}
-
-	ifs.close();
 	
 	std::unordered_map<Shader::Type, std::string> shaderSources;
 	std::string vs(srcSessions[0].str());
@@ -471,8 +543,10 @@ void ShaderProgram::queryProgramInfo() {
 				continue;
 
 			m_uniforms.push_back(uniform);
+			m_uniformLocations.insert({ uniform.name, uniform.location });
 		}
 	}
+	m_generation++;
 
 
 	// uniform block
@@ -614,14 +688,28 @@ void ShaderProgram::queryProgramInfo() {
 
 
 int ShaderProgram::getUniformLocation(const std::string& name) const {
-	auto pos = std::find_if(m_uniforms.begin(), m_uniforms.end(), [&](const Uniform& u) {
-			return u.name == name;
-		});
+	auto pos = m_uniformLocations.find(name);
+	if (pos == m_uniformLocations.end())
+		return -1;
+
+	return pos->second;
+}
 
-	if (pos == m_uniforms.end())
+
+int ShaderProgram::getUniformLocation(const UniformHandle& handle) const {
+	if (!handle.isValid())
 		return -1;
 
-	return pos->location;
+	if (size_t(handle.id()) >= m_uniformCache.size())
+		m_uniformCache.resize(UniformHandle::internedCount(), { 0, -1 });
+
+	UniformCacheEntry& entry = m_uniformCache[handle.id()];
+	if (entry.generation != m_generation) { // first use or program relinked, resolve once
+		entry.location = getUniformLocation(handle.name());
+		entry.generation = m_generation;
+	}
+
+	return entry.location;
 }
 
 
@@ -688,8 +776,7 @@ bool ShaderProgram::checkSubroutineCompatible(SubroutineUniform* su, Subroutine*
 
 
 template<>
-bool ShaderProgram::setUniform1<float>(const std::string& name, float f1) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform1<float>(int location, float f1) const {
 	if (location == -1)
 		return false;
 
@@ -698,8 +785,7 @@ bool ShaderProgram::setUniform1<float>(const std::string& name, float f1) const
 }
 
 template<>
-bool ShaderProgram::setUniform1<double>(const std::string& name, double d1) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform1<double>(int location, double d1) const {
 	if (location == -1)
 		return false;
 
@@ -708,8 +794,7 @@ bool ShaderProgram::setUniform1<double>(const std::string& name, double d1) cons
 }
 
 template<>
-bool ShaderProgram::setUniform1<int>(const std::string& name, int i1) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform1<int>(int location, int i1) const {
 	if (location == -1)
 		return false;
 
@@ -718,8 +803,7 @@ bool ShaderProgram::setUniform1<int>(const std::string& name, int i1) const {
 }
 
 template<>
-bool ShaderProgram::setUniform1<unsigned>(const std::string& name, unsigned ui1) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform1<unsigned>(int location, unsigned ui1) const {
 	if (location == -1)
 		return false;
 
@@ -729,8 +813,7 @@ bool ShaderProgram::setUniform1<unsigned>(const std::string& name, unsigned ui1)
 
 
 template<>
-bool ShaderProgram::setUniform2<float>(const std::string& name, float f1, float f2) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform2<float>(int location, float f1, float f2) const {
 	if (location == -1)
 		return false;
 
@@ -739,8 +822,7 @@ bool ShaderProgram::setUniform2<float>(const std::string& name, float f1, float
 }
 
 template<>
-bool ShaderProgram::setUniform2<double>(const std::string& name, double d1, double d2) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform2<double>(int location, double d1, double d2) const {
 	if (location == -1)
 		return false;
 
@@ -750,8 +832,7 @@ bool ShaderProgram::setUniform2<double>(const std::string& name, double d1, doub
 
 
 template<>
-bool ShaderProgram::setUniform2<int>(const std::string& name, int i1, int i2) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform2<int>(int location, int i1, int i2) const {
 	if (location == -1)
 		return false;
 
@@ -763,8 +844,7 @@ bool ShaderProgram::setUniform2<int>(const std::string& name, int i1, int i2) co
 
 
 template<>
-bool ShaderProgram::setUniform3<float>(const std::string& name, float f1, float f2, float f3) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform3<float>(int location, float f1, float f2, float f3) const {
 	if (location == -1)
 		return false;
 
@@ -773,8 +853,7 @@ bool ShaderProgram::setUniform3<float>(const std::string& name, float f1, float
 }
 
 template<>
-bool ShaderProgram::setUniform3<double>(const std::string& name, double d1, double d2, double d3) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform3<double>(int location, double d1, double d2, double d3) const {
 	if (location == -1)
 		return false;
 
@@ -783,8 +862,7 @@ bool ShaderProgram::setUniform3<double>(const std::string& name, double d1, doub
 }
 
 template<>
-bool ShaderProgram::setUniform3<int>(const std::string& name, int i1, int i2, int i3) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform3<int>(int location, int i1, int i2, int i3) const {
 	if (location == -1)
 		return false;
 
@@ -794,8 +872,7 @@ bool ShaderProgram::setUniform3<int>(const std::string& name, int i1, int i2, in
 
 
 template<>
-bool ShaderProgram::setUniform4<float>(const std::string& name, float f1, float f2, float f3, float f4) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform4<float>(int location, float f1, float f2, float f3, float f4) const {
 	if (location == -1)
 		return false;
 
@@ -804,8 +881,7 @@ bool ShaderProgram::setUniform4<float>(const std::string& name, float f1, float
 }
 
 template<>
-bool ShaderProgram::setUniform4<double>(const std::string& name, double d1, double d2, double d3, double d4) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform4<double>(int location, double d1, double d2, double d3, double d4) const {
 	if (location == -1)
 		return false;
 
@@ -814,8 +890,7 @@ bool ShaderProgram::setUniform4<double>(const std::string& name, double d1, doub
 }
 
 template<>
-bool ShaderProgram::setUniform4<int>(const std::string& name, int i1, int i2, int i3, int i4) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform4<int>(int location, int i1, int i2, int i3, int i4) const {
 	if (location == -1)
 		return false;
 
@@ -826,8 +901,7 @@ bool ShaderProgram::setUniform4<int>(const std::string& name, int i1, int i2, in
 
 
 template<>
-bool ShaderProgram::setUniform1v<float>(const std::string& name, const float* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform1v<float>(int location, const float* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -837,8 +911,7 @@ bool ShaderProgram::setUniform1v<float>(const std::string& name, const float* da
 
 
 template<>
-bool ShaderProgram::setUniform1v<double>(const std::string& name, const double* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform1v<double>(int location, const double* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -848,8 +921,7 @@ bool ShaderProgram::setUniform1v<double>(const std::string& name, const double*
 
 
 template<>
-bool ShaderProgram::setUniform1v<int>(const std::string& name, const int* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform1v<int>(int location, const int* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -859,8 +931,7 @@ bool ShaderProgram::setUniform1v<int>(const std::string& name, const int* data,
 
 
 template<>
-bool ShaderProgram::setUniform2v<float>(const std::string& name, const float* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform2v<float>(int location, const float* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -869,8 +940,7 @@ bool ShaderProgram::setUniform2v<float>(const std::string& name, const float* da
 };
 
 template<>
-bool ShaderProgram::setUniform2v<double>(const std::string& name, const double* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform2v<double>(int location, const double* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -879,8 +949,7 @@ bool ShaderProgram::setUniform2v<double>(const std::string& name, const double*
 };
 
 template<>
-bool ShaderProgram::setUniform2v<int>(const std::string& name, const int* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform2v<int>(int location, const int* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -889,8 +958,7 @@ bool ShaderProgram::setUniform2v<int>(const std::string& name, const int* data,
 };
 
 template<>
-bool ShaderProgram::setUniform3v<float>(const std::string& name, const float* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform3v<float>(int location, const float* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -899,8 +967,7 @@ bool ShaderProgram::setUniform3v<float>(const std::string& name, const float* da
 };
 
 template<>
-bool ShaderProgram::setUniform3v<double>(const std::string& name, const double* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform3v<double>(int location, const double* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -909,8 +976,7 @@ bool ShaderProgram::setUniform3v<double>(const std::string& name, const double*
 };
 
 template<>
-bool ShaderProgram::setUniform3v<int>(const std::string& name, const int* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform3v<int>(int location, const int* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -920,8 +986,7 @@ bool ShaderProgram::setUniform3v<int>(const std::string& name, const int* data,
 
 
 template<>
-bool ShaderProgram::setUniform4v<float>(const std::string& name, const float* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform4v<float>(int location, const float* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -931,8 +996,7 @@ bool ShaderProgram::setUniform4v<float>(const std::string& name, const float* da
 
 
 template<>
-bool ShaderProgram::setUniform4v<double>(const std::string& name, const double* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform4v<double>(int location, const double* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -942,8 +1006,7 @@ bool ShaderProgram::setUniform4v<double>(const std::string& name, const double*
 
 
 template<>
-bool ShaderProgram::setUniform4v<int>(const std::string& name, const int* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniform4v<int>(int location, const int* data, size_t count) const {
 	if (location == -1)
 		return false;
 
@@ -953,19 +1016,19 @@ bool ShaderProgram::setUniform4v<int>(const std::string& name, const int* data,
 
 
 template<>
-bool ShaderProgram::setUniformMat4v<float>(const std::string& name, const float* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniformMat4v<float>(int location, const float* data, size_t count) const {
 	if (location == -1)
 		return false;
 	GLCALL(glUniformMatrix4fv(location, count, false, data));
+	return true;
 }
 
 template<>
-bool ShaderProgram::setUniformMat4v<double>(const std::string& name, const double* data, size_t count) const {
-	int location = getUniformLocation(name);
+bool ShaderProgram::uploadUniformMat4v<double>(int location, const double* data, size_t count) const {
 	if (location == -1)
 		return false;
 	GLCALL(glUniformMatrix4dv(location, count, false, data));
+	return true;
 }
 
 
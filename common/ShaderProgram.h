@@ -9,6 +9,30 @@
 class ShaderProgramManager;
 
 
+// interned uniform name, it's id is shared by all programs and stable across recompiles.
+// declare once (usually as static) and resolve per program through a flat location cache.
+class UniformHandle {
+public:
+	UniformHandle() : m_id(-1) {}
+	explicit UniformHandle(const std::string& name);
+
+	const std::string& name() const;
+
+	inline int id() const {
+		return m_id;
+	}
+
+	inline bool isValid() const {
+		return m_id >= 0;
+	}
+
+	static size_t internedCount();
+
+private:
+	int m_id;
+};
+
+
 class ShaderProgram {
 	friend class ShaderProgramManager;
 	friend std::ostream& operator << (std::ostream& o, const ShaderProgram& program);
@@ -107,6 +131,7 @@ public:
 
 public:
 	ShaderProgram(const std::string& name, const std::string& file);
+	ShaderProgram(const std::string& name, const std::string& file, const std::string& source); // generated source, file only locates includes
 	~ShaderProgram();
 
 	ShaderProgram(const ShaderProgram& other) = delete;
@@ -121,6 +146,7 @@ public:
 
 	bool hasAttribute(const std::string& name) const;
 	bool hasUniform(const std::string& name) const;
+	bool hasUniform(const UniformHandle& handle) const;
 	bool hasUniformBlock(const std::string& name) const;
 	bool hasShaderStorageBlock(const std::string& name) const;
 	bool hasSubroutineUniform(Shader::Type shaderStage, const std::string& name) const;
@@ -142,31 +168,94 @@ public:
 	const std::vector<SubroutineUniform>& getSubroutineUniforms(Shader::Type shaderStage) const;
 
 	template<typename T>
-	bool setUniform1(const std::string& name, T t1) const;
-	
+	bool setUniform1(const std::string& name, T t1) const {
+		return uploadUniform1<T>(getUniformLocation(name), t1);
+	}
+
 	template<typename T>
-	bool setUniform2(const std::string& name, T t1, T t2) const;
-	
+	bool setUniform1(const UniformHandle& handle, T t1) const {
+		return uploadUniform1<T>(getUniformLocation(handle), t1);
+	}
+
+	template<typename T>
+	bool setUniform2(const std::string& name, T t1, T t2) const {
+		return uploadUniform2<T>(getUniformLocation(name), t1, t2);
+	}
+
+	template<typename T>
+	bool setUniform2(const UniformHandle& handle, T t1, T t2) const {
+		return uploadUniform2<T>(getUniformLocation(handle), t1, t2);
+	}
+
+	template<typename T>
+	bool setUniform3(const std::string& name, T t1, T t2, T t3) const {
+		return uploadUniform3<T>(getUniformLocation(name), t1, t2, t3);
+	}
+
+	template<typename T>
+	bool setUniform3(const UniformHandle& handle, T t1, T t2, T t3) const {
+		return uploadUniform3<T>(getUniformLocation(handle), t1, t2, t3);
+	}
+
+	template<typename T>
+	bool setUniform4(const std::string& name, T t1, T t2, T t3, T t4) const {
+		return uploadUniform4<T>(getUniformLocation(name), t1, t2, t3, t4);
+	}
+
+	template<typename T>
+	bool setUniform4(const UniformHandle& handle, T t1, T t2, T t3, T t4) const {
+		return uploadUniform4<T>(getUniformLocation(handle), t1, t2, t3, t4);
+	}
+
+	template<typename T>
+	bool setUniform1v(const std::string& name, const T* data, size_t count = 1) const {
+		return uploadUniform1v<T>(getUniformLocation(name), data, count);
+	}
+
+	template<typename T>
+	bool setUniform1v(const UniformHandle& handle, const T* data, size_t count = 1) const {
+		return uploadUniform1v<T>(getUniformLocation(handle), data, count);
+	}
+
 	template<typename T>
-	bool setUniform3(const std::string& name, T t1, T t2, T t3) const;
+	bool setUniform2v(const std::string& name, const T* data, size_t count = 1) const {
+		return uploadUniform2v<T>(getUniformLocation(name), data, count);
+	}
+
+	template<typename T>
+	bool setUniform2v(const UniformHandle& handle, const T* data, size_t count = 1) const {
+		return uploadUniform2v<T>(getUniformLocation(handle), data, count);
+	}
 
 	template<typename T>
-	bool setUniform4(const std::string& name, T t1, T t2, T t3, T t4) const;
+	bool setUniform3v(const std::string& name, const T* data, size_t count = 1) const {
+		return uploadUniform3v<T>(getUniformLocation(name), data, count);
+	}
 
 	template<typename T>
-	bool setUniform1v(const std::string& name, const T* data, size_t count = 1) const;
+	bool setUniform3v(const UniformHandle& handle, const T* data, size_t count = 1) const {
+		return uploadUniform3v<T>(getUniformLocation(handle), data, count);
+	}
 
 	template<typename T>
-	bool setUniform2v(const std::string& name, const T* data, size_t count = 1) const;
+	bool setUniform4v(const std::string& name, const T* data, size_t count = 1) const {
+		return uploadUniform4v<T>(getUniformLocation(name), data, count);
+	}
 
 	template<typename T>
-	bool setUniform3v(const std::string& name, const T* data, size_t count = 1) const;
+	bool setUniform4v(const UniformHandle& handle, const T* data, size_t count = 1) const {
+		return uploadUniform4v<T>(getUniformLocation(handle), data, count);
+	}
 
 	template<typename T>
-	bool setUniform4v(const std::string& name, const T* data, size_t count = 1) const;
+	bool setUniformMat4v(const std::string& name, const T* data, size_t count = 1) const {
+		return uploadUniformMat4v<T>(getUniformLocation(name), data, count);
+	}
 
 	template<typename T>
-	bool setUniformMat4v(const std::string& name, const T* data, size_t count = 1) const;
+	bool setUniformMat4v(const UniformHandle& handle, const T* data, size_t count = 1) const {
+		return uploadUniformMat4v<T>(getUniformLocation(handle), data, count);
+	}
 
 
 	inline const std::vector<Attribute>& getAttributes() const {
@@ -187,9 +276,11 @@ public:
 
 protected:
 	std::unordered_map<Shader::Type, std::string> parseShaderSource(const std::string& file);
+	std::unordered_map<Shader::Type, std::string> parseShaderSource(std::istream& is);
 	std::string parseIncludedSource(const std::string& includeExp);
 	void queryProgramInfo();
 	int getUniformLocation(const std::string& name) const;
+	int getUniformLocation(const UniformHandle& handle) const;
 	int getUniformBlockIndex(const std::string& name) const;
 	int getShaderStorageBlockIndex(const std::string& name) const;
 
@@ -197,18 +288,55 @@ protected:
 	Subroutine* getSubroutine(Shader::Type shaderStage, const std::string& name) const;
 	bool checkSubroutineCompatible(SubroutineUniform* su, Subroutine* st) const;
 
+	template<typename T>
+	bool uploadUniform1(int location, T t1) const;
+
+	template<typename T>
+	bool uploadUniform2(int location, T t1, T t2) const;
+
+	template<typename T>
+	bool uploadUniform3(int location, T t1, T t2, T t3) const;
+
+	template<typename T>
+	bool uploadUniform4(int location, T t1, T t2, T t3, T t4) const;
+
+	template<typename T>
+	bool uploadUniform1v(int location, const T* data, size_t count) const;
+
+	template<typename T>
+	bool uploadUniform2v(int location, const T* data, size_t count) const;
+
+	template<typename T>
+	bool uploadUniform3v(int location, const T* data, size_t count) const;
+
+	template<typename T>
+	bool uploadUniform4v(int location, const T* data, size_t count) const;
+
+	template<typename T>
+	bool uploadUniformMat4v(int location, const T* data, size_t count) const;
+
 protected:
 	GLuint m_handler;
 	bool m_linked;
 	std::string m_name;
 	std::string m_file;
+	std::string m_source;
 
 	std::vector<Attribute> m_attributes;
 	std::vector<Uniform> m_uniforms;
+	std::unordered_map<std::string, int> m_uniformLocations;
 	std::vector<UniformBlock> m_uniformBlocks;
 	std::vector<ShaderStorageBlock> m_shaderStorageBlocks;
 	mutable std::unordered_map<Shader::Type, StageSubroutineInfo> m_stageSubroutinesInfo;
 	std::unordered_map<Shader::Type, std::unordered_map<std::string, std::string>> m_subroutineMapping;
+
+	// uniform location cache indexed by UniformHandle id, entries from an older generation are stale
+	struct UniformCacheEntry {
+		unsigned generation;
+		int location;
+	};
+	mutable std::vector<UniformCacheEntry> m_uniformCache;
+	unsigned m_generation;
 };
 
 
@@ -0,0 +1,363 @@
+#include"ShadowMapCache.h"
+#include"RenderTechnique.h"
+#include"Renderer.h"
+#include"Util.h"
+
+
+ShadowCasterTracker::ShadowCasterTracker() : m_queues()
+, m_history()
+, m_frame(0)
+, m_stats() {
+	for (auto& queue : m_queues)
+		queue.items = nullptr;
+}
+
+
+void ShadowCasterTracker::update(const Scene_t& scene) {
+	const MeshRenderItem_t* items[3] = { scene.opaqueItems, scene.cutOutItems, scene.transparentItems };
+	size_t counts[3] = { scene.numOpaqueCasters, scene.numCutOutCasters, scene.numTransparentCasters };
+
+	m_frame++;
+	m_stats = ShadowCacheStats_t();
+
+	for (size_t q = 0; q < 3; q++) {
+		Queue& queue = m_queues[q];
+		queue.items = items[q];
+		queue.keys.resize(counts[q]);
+		queue.isStatic.resize(counts[q]);
+
+		for (size_t i = 0; i < counts[q]; i++) {
+			const MeshRenderItem_t& item = items[q][i];
+			bool isSkinned = item.bonesTransform != nullptr && item.boneCount > 0;
+			uint64_t key = casterKey(item);
+			if (isSkinned)
+				key = mix(key ^ m_frame); // bones move without model matrix telling
+
+			// equal keys this frame are copies of one caster at the same place, they share history
+			auto pos = m_history.find(key);
+			if (pos == m_history.end()) {
+				pos = m_history.insert(std::make_pair(key, History{ 0, m_frame })).first;
+			} else if (pos->second.lastFrame != m_frame) {
+				pos->second.stillFrames++;
+				pos->second.lastFrame = m_frame;
+			}
+
+			bool isStatic = !isSkinned && pos->second.stillFrames >= SHADOW_CASTER_SETTLE_FRAMES;
+			queue.keys[i] = key;
+			queue.isStatic[i] = isStatic;
+			if (isStatic) {
+				m_stats.numStaticCasters++;
+			}
+			else {
+				m_stats.numDynamicCasters++;
+			}
+		}
+	}
+
+	// casters missing this frame moved or are gone, if they show up again they start over
+	for (auto itr = m_history.begin(); itr != m_history.end();) {
+		if (itr->second.lastFrame != m_frame)
+			itr = m_history.erase(itr);
+		else
+			itr++;
+	}
+}
+
+
+const uint64_t* ShadowCasterTracker::getKeys(const MeshRenderItem_t* items) const {
+	for (const auto& queue : m_queues) {
+		if (queue.items == items)
+			return queue.keys.data();
+	}
+
+	return nullptr;
+}
+
+
+const uint8_t* ShadowCasterTracker::getStaticFlags(const MeshRenderItem_t* items) const {
+	for (const auto& queue : m_queues) {
+		if (queue.items == items)
+			return queue.isStatic.data();
+	}
+
+	return nullptr;
+}
+
+
+uint64_t ShadowCasterTracker::hashBytes(const void* data, size_t size, uint64_t seed) { // fnv-1a
+	const uint8_t* bytes = (const uint8_t*)data;
+	uint64_t h = seed;
+	for (size_t i = 0; i < size; i++) {
+		h ^= bytes[i];
+		h *= 1099511628211ull;
+	}
+
+	return h;
+}
+
+
+uint64_t ShadowCasterTracker::mix(uint64_t h) { // splitmix64 finalizer
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ull;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebull;
+	h ^= h >> 31;
+	return h;
+}
+
+
+uint64_t ShadowCasterTracker::casterKey(const MeshRenderItem_t& item) {
+	// material decides alpha tested cut outs, model matrix where caster is
+	uintptr_t identity[] = { uintptr_t(item.vao), uintptr_t(item.material), uintptr_t(item.indexOffset), uintptr_t(item.vertexOffset),
+		uintptr_t(item.indexCount), uintptr_t(item.vertexCount), uintptr_t(item.primitive) };
+	uint64_t h = hashBytes(identity, sizeof(identity));
+	return hashBytes(&item.modelMatrix[0][0], sizeof(glm::mat4), h);
+}
+
+
+uint64_t ShadowCasterTracker::lightKey(const Light_t& light) {
+	// renderer keeps submitted lights in fixed arrays, light of a slot is the same light next frame
+	return mix(uint64_t(uintptr_t(&light)));
+}
+
+
+uint64_t ShadowCasterTracker::lightSignature(const Light_t& light) {
+	float params[] = { light.position.x, light.position.y, light.position.z, light.direction.x, light.direction.y, light.direction.z,
+		light.range, light.outterCone };
+	uint64_t h = hashBytes(params, sizeof(params));
+	return mix(h ^ uint64_t(light.type));
+}
+
+
+
+
+ShadowMapCache::ShadowMapCache(Texture::Target target, size_t numLayers, TargetFactory factory) : m_target(target)
+, m_numLayers(numLayers)
+, m_factory(factory)
+, m_slots()
+, m_current(nullptr)
+, m_selections()
+, m_layerSignature(0)
+, m_signature(0)
+, m_isStaticUpToDate(false)
+, m_isMapStatic(false)
+, m_numCasters(0)
+, m_numStatic(0)
+, m_numDynamic(0) {
+
+}
+
+
+ShadowMapCache::~ShadowMapCache() {
+	clear();
+}
+
+
+void ShadowMapCache::clear() {
+	m_slots.clear();
+	m_current = nullptr;
+}
+
+
+bool ShadowMapCache::begin(const Scene_t& scene, ShadowCasterTracker* tracker, uint64_t lightKey, uint64_t lightSignature, const CasterCuller& culler) {
+	const MeshRenderItem_t* items[3] = { scene.opaqueItems, scene.cutOutItems, scene.transparentItems };
+	size_t counts[3] = { scene.numOpaqueCasters, scene.numCutOutCasters, scene.numTransparentCasters };
+
+	m_numCasters = 0;
+	m_numStatic = 0;
+	m_numDynamic = 0;
+	uint64_t staticSum = 0;
+	uint64_t dynamicSum = 0;
+	for (size_t q = 0; q < 3; q++) {
+		Selection& selection = m_selections[q];
+		selection.items = items[q];
+		selection.count = counts[q];
+		selection.masks.assign(counts[q], 0);
+		if (counts[q] <= 0)
+			continue;
+
+		culler(items[q], counts[q], selection.masks.data());
+
+		// sums don't depend on queue order, which follows main camera
+		const uint64_t* keys = tracker->getKeys(items[q]);
+		const uint8_t* isStatic = tracker->getStaticFlags(items[q]);
+#ifdef _DEBUG
+		ASSERT(keys && isStatic);
+#endif // _DEBUG
+
+		for (size_t i = 0; i < counts[q]; i++) {
+			if (selection.masks[i] == 0)
+				continue;
+
+			if (isStatic[i]) {
+				selection.masks[i] = SHADOW_CASTER_STATIC;
+				staticSum += ShadowCasterTracker::mix(keys[i]);
+				m_numStatic++;
+			}
+			else {
+				selection.masks[i] = SHADOW_CASTER_DYNAMIC;
+				dynamicSum += ShadowCasterTracker::mix(keys[i]);
+				m_numDynamic++;
+			}
+		}
+
+		m_numCasters += counts[q];
+	}
+
+	ShadowCacheStats_t& stats = tracker->getStats();
+	stats.numLightCulled += m_numCasters - m_numStatic - m_numDynamic;
+
+	m_layerSignature = ShadowCasterTracker::mix(lightSignature ^ ShadowCasterTracker::mix(staticSum + m_numStatic));
+	m_signature = m_layerSignature;
+	if (m_numDynamic > 0)
+		m_signature = ShadowCasterTracker::mix(m_layerSignature ^ ShadowCasterTracker::mix(dynamicSum + m_numDynamic));
+
+	m_current = acquire(lightKey, tracker->getFrame());
+	if (m_current->isValid && m_current->signature == m_signature) {
+		stats.numHits++;
+		return false;
+	}
+
+	m_isStaticUpToDate = m_current->isStaticValid && m_current->staticSignature == m_layerSignature;
+	m_isMapStatic = m_current->isValid && m_current->signature == m_layerSignature;
+
+	return true;
+}
+
+
+void ShadowMapCache::render(IRenderTechnique* rt, ShadowCasterTracker* tracker) {
+	if (!m_current)
+		return;
+
+	Slot& slot = *m_current;
+	if (!slot.target)
+		slot.target = m_factory();
+
+#ifdef _DEBUG
+	ASSERT(slot.target);
+#endif // _DEBUG
+
+	if (!slot.target)
+		return;
+
+	if (m_numDynamic <= 0) {
+		if (m_isStaticUpToDate) {
+			copyMap(slot.staticTarget.get(), slot.target.get()); // dynamic casters left light
+		}
+		else {
+			renderLayer(rt, slot.target.get(), SHADOW_CASTER_STATIC, true);
+		}
+	}
+	else {
+		if (!m_isStaticUpToDate) {
+			if (!slot.staticTarget)
+				slot.staticTarget = m_factory();
+
+			if (m_isMapStatic) {
+				copyMap(slot.target.get(), slot.staticTarget.get()); // first caster started moving, map is the static layer
+			}
+			else {
+				renderLayer(rt, slot.staticTarget.get(), SHADOW_CASTER_STATIC, true);
+			}
+		}
+
+		copyMap(slot.staticTarget.get(), slot.target.get());
+		renderLayer(rt, slot.target.get(), SHADOW_CASTER_DYNAMIC, false);
+	}
+
+	commit(tracker);
+}
+
+
+void ShadowMapCache::commit(ShadowCasterTracker* tracker) {
+	if (!m_current)
+		return;
+
+	Slot& slot = *m_current;
+	ShadowCacheStats_t& stats = tracker->getStats();
+	if (m_numDynamic > 0 && !m_isStaticUpToDate) {
+		if (!m_isMapStatic)
+			stats.numStaticRendered++;
+
+		slot.staticSignature = m_layerSignature;
+		slot.isStaticValid = true;
+	}
+
+	slot.signature = m_signature;
+	slot.isValid = true;
+	stats.numRendered++;
+}
+
+
+Texture* ShadowMapCache::getShadowMap(uint64_t lightKey) const {
+	for (const auto& slot : m_slots) {
+		if (slot->lightKey == lightKey && slot->isValid && slot->target)
+			return slot->target->getAttachedTexture(RenderTarget::Slot::Depth);
+	}
+
+	return nullptr;
+}
+
+
+ShadowMapCache::Slot* ShadowMapCache::acquire(uint64_t lightKey, size_t frame) {
+	Slot* lru = nullptr;
+	for (auto& slot : m_slots) {
+		if (slot->lightKey == lightKey) {
+			slot->lastUsed = frame;
+			return slot.get();
+		}
+
+		if (!lru || slot->lastUsed < lru->lastUsed)
+			lru = slot.get();
+	}
+
+	// evicted map keeps its targets, they are the same size
+	if (m_slots.size() < SHADOW_CACHE_MAX_MAPS) {
+		m_slots.push_back(std::unique_ptr<Slot>(new Slot()));
+		lru = m_slots.back().get();
+	}
+
+	lru->lightKey = lightKey;
+	lru->signature = 0;
+	lru->staticSignature = 0;
+	lru->isValid = false;
+	lru->isStaticValid = false;
+	lru->lastUsed = frame;
+
+	return lru;
+}
+
+
+void ShadowMapCache::renderLayer(IRenderTechnique* rt, RenderTarget* target, uint8_t layer, bool isClear) {
+	Renderer* renderer = rt->getRenderer();
+	renderer->pushRenderTarget(target);
+	if (isClear)
+		renderer->clearScreen(ClearFlags::Depth);
+
+	// runs of casters in layer are submitted together so they can be instanced
+	for (const auto& selection : m_selections) {
+		size_t i = 0;
+		while (i < selection.count) {
+			if (selection.masks[i] != layer) {
+				i++;
+				continue;
+			}
+
+			size_t runEnd = i + 1;
+			while (runEnd < selection.count && selection.masks[runEnd] == layer)
+				runEnd++;
+			rt->renderBatch(selection.items + i, runEnd - i);
+			i = runEnd;
+		}
+	}
+
+	renderer->popRenderTarget();
+}
+
+
+void ShadowMapCache::copyMap(RenderTarget* src, RenderTarget* dst) {
+	Texture* srcMap = src->getAttachedTexture(RenderTarget::Slot::Depth);
+	Texture* dstMap = dst->getAttachedTexture(RenderTarget::Slot::Depth);
+	GLCALL(glCopyImageSubData(GLuint(srcMap->getHandler()), GLenum(m_target), 0, 0, 0, 0, GLuint(dstMap->getHandler()), GLenum(m_target), 0, 0, 0, 0,
+		GLsizei(srcMap->getWidth()), GLsizei(srcMap->getHeight()), GLsizei(m_numLayers)));
+}
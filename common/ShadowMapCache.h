@@ -0,0 +1,171 @@
+#pragma once
+#include"RendererCore.h"
+#include"RenderTarget.h"
+#include"Texture.h"
+#include<cstdint>
+#include<functional>
+#include<memory>
+#include<unordered_map>
+#include<vector>
+
+
+// frames a caster has to stay where it is before it moves into static shadow layer
+#define SHADOW_CASTER_SETTLE_FRAMES 8
+
+// maps one shadow mapping caches, lights of its type beyond that evict least recently used map
+#define SHADOW_CACHE_MAX_MAPS 4
+
+// caster masks
+#define SHADOW_CASTER_STATIC 0x1
+#define SHADOW_CASTER_DYNAMIC 0x2
+
+
+class IRenderTechnique;
+
+
+struct ShadowCacheStats_t {
+	size_t numHits; // maps left as they were
+	size_t numRendered; // maps updated
+	size_t numStaticRendered; // static layers re-rendered
+	size_t numStaticCasters;
+	size_t numDynamicCasters;
+	size_t numLightCulled; // casters outside range/cone of a light
+
+	ShadowCacheStats_t() : numHits(0), numRendered(0), numStaticRendered(0), numStaticCasters(0), numDynamicCasters(0), numLightCulled(0) {}
+};
+
+
+//
+// keeps track of which shadow casters moved, per frame.
+// items carry no identity, a caster is keyed by its mesh, material & model matrix: a key seen last frame is a caster
+// that stayed put, a moved caster shows up under a new key. keys still for SHADOW_CASTER_SETTLE_FRAMES frames are static.
+// skinned casters are keyed anew every frame, they never settle.
+//
+class ShadowCasterTracker {
+public:
+	ShadowCasterTracker();
+
+	// classify casters of all queues, once per frame before shadows are rendered
+	void update(const Scene_t& scene);
+
+	// per item of a scene queue, nullptr for items not of current frame's queues
+	const uint64_t* getKeys(const MeshRenderItem_t* items) const;
+	const uint8_t* getStaticFlags(const MeshRenderItem_t* items) const;
+
+	inline size_t getFrame() const {
+		return m_frame;
+	}
+
+	inline ShadowCacheStats_t& getStats() {
+		return m_stats;
+	}
+
+	inline size_t numTracked() const {
+		return m_history.size();
+	}
+
+	static uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull);
+	static uint64_t mix(uint64_t h);
+	static uint64_t casterKey(const MeshRenderItem_t& item);
+	static uint64_t lightKey(const Light_t& light); // which light, stays while light moves
+	static uint64_t lightSignature(const Light_t& light); // where light is & what it covers
+
+private:
+	struct History {
+		size_t stillFrames;
+		size_t lastFrame;
+	};
+
+	struct Queue {
+		const MeshRenderItem_t* items;
+		std::vector<uint64_t> keys;
+		std::vector<uint8_t> isStatic;
+	};
+
+	Queue m_queues[3];
+	std::unordered_map<uint64_t, History> m_history;
+	size_t m_frame;
+	ShadowCacheStats_t m_stats;
+};
+
+
+//
+// shadow maps of one shadow mapping, one per light, re-rendered only when light or its casters change.
+// casters outside light are culled by a callback, the rest split into a static layer, rendered into its own target
+// when static casters change, and dynamic casters rendered over a copy of it.
+//
+class ShadowMapCache {
+public:
+	// set masks[i] non zero for caster i the light can see
+	typedef std::function<void(const MeshRenderItem_t* items, size_t count, uint8_t* masks)> CasterCuller;
+	typedef std::function<std::unique_ptr<RenderTarget>()> TargetFactory;
+
+	ShadowMapCache(Texture::Target target, size_t numLayers, TargetFactory factory);
+	~ShadowMapCache();
+
+	ShadowMapCache(const ShadowMapCache& other) = delete;
+	ShadowMapCache& operator = (const ShadowMapCache& other) = delete;
+
+	// release all maps, eg. shadow map resolution changed
+	void clear();
+
+	// pick map of light, select & classify its casters, return false if map is up to date (cache hit).
+	// lightSignature covers whatever else the map depends on, eg. light matrices
+	bool begin(const Scene_t& scene, ShadowCasterTracker* tracker, uint64_t lightKey, uint64_t lightSignature, const CasterCuller& culler);
+
+	// bring map picked by begin up to date, light's shader & viewport are bound
+	void render(IRenderTechnique* rt, ShadowCasterTracker* tracker);
+
+	// record map picked by begin as up to date, render does it after drawing. headless runs call it alone
+	void commit(ShadowCasterTracker* tracker);
+
+	// map of light, nullptr if none was rendered
+	Texture* getShadowMap(uint64_t lightKey) const;
+
+	inline size_t numCasters() const {
+		return m_numCasters;
+	}
+
+	inline size_t numSelected() const {
+		return m_numStatic + m_numDynamic;
+	}
+
+protected:
+	struct Slot {
+		uint64_t lightKey;
+		uint64_t signature; // of what map holds
+		uint64_t staticSignature; // of what static layer holds
+		bool isValid;
+		bool isStaticValid;
+		size_t lastUsed;
+		std::unique_ptr<RenderTarget> target;
+		std::unique_ptr<RenderTarget> staticTarget;
+	};
+
+	struct Selection {
+		const MeshRenderItem_t* items;
+		size_t count;
+		std::vector<uint8_t> masks;
+	};
+
+	Slot* acquire(uint64_t lightKey, size_t frame);
+	void renderLayer(IRenderTechnique* rt, RenderTarget* target, uint8_t layer, bool isClear);
+	void copyMap(RenderTarget* src, RenderTarget* dst);
+
+protected:
+	Texture::Target m_target;
+	size_t m_numLayers;
+	TargetFactory m_factory;
+
+	std::vector<std::unique_ptr<Slot>> m_slots;
+	Slot* m_current;
+
+	Selection m_selections[3];
+	uint64_t m_layerSignature; // light & static casters
+	uint64_t m_signature; // light & all casters
+	bool m_isStaticUpToDate; // static layer of map holds current static casters
+	bool m_isMapStatic; // map holds current static casters only
+	size_t m_numCasters;
+	size_t m_numStatic;
+	size_t m_numDynamic;
+};
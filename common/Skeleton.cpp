@@ -5,6 +5,22 @@ void Skeleton::set(const Pose& resPose, const Pose& invBindPose, const std::vect
 	m_invBindPose = invBindPose;
 	m_jointsName = jointNames;
 	m_invRootTransform = invRoot;
+
+	// topological order, joint ids are kept since meshes & clips refer to them.
+	// loaders flatten skeletons breadth first, for them it is the identity
+	size_t numJoints = m_resPose.size();
+	std::vector<bool> isOrdered(numJoints, false);
+	std::vector<int> chain;
+	m_jointOrder.clear();
+	m_jointOrder.reserve(numJoints);
+	for (size_t i = 0; i < numJoints; i++) {
+		for (int joint = int(i); joint >= 0 && !isOrdered[joint]; joint = m_resPose.getJointParent(joint)) {
+			isOrdered[joint] = true;
+			chain.push_back(joint);
+		}
+		m_jointOrder.insert(m_jointOrder.end(), chain.rbegin(), chain.rend());
+		chain.clear();
+	}
 }
 
 
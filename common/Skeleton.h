@@ -1,6 +1,7 @@
 #pragma once
 #include"Pose.h"
 #include<string>
+#include<vector>
 
 // skeleton manage bind-pose, inverse-bind-pose that shared
 // by several animation clip
@@ -35,6 +36,11 @@ public:
 		return m_resPose.size();
 	}
 
+	// joint ids with every parent before its children
+	inline const std::vector<int>& getJointOrder() const {
+		return m_jointOrder;
+	}
+
 
 protected:
 	//void calcBindPoseAndInvBindPose(const Pose& worldBindPose);
@@ -44,5 +50,6 @@ protected:
 	//Pose m_bindPose;
 	Pose m_invBindPose;
 	std::vector<std::string> m_jointsName;
+	std::vector<int> m_jointOrder;
 	glm::mat4 m_invRootTransform;
 };
\ No newline at end of file
@@ -5,6 +5,10 @@
 #include"Renderer.h"
 
 
+// fraction of bind pose size added to each side of skinned mesh bounds
+#define SKINNED_BOUNDS_MARGIN 0.5f
+
+
 RTTI_IMPLEMENTATION(SkinMeshRenderComponent)
 
 
@@ -29,11 +33,20 @@ void SkinMeshRenderComponent::render(RenderContext* context) {
 	if (m_animator.expired())
 		return __super::render(context);
 
-	const auto& interpolatedPose = m_animator.lock()->animatedPose();
-	interpolatedPose.getSkinMatrix(m_bonesTransform);
-	
-	for (size_t i = 0; i < m_bonesTransform.size(); i++) {
-		m_bonesTransform[i] =  m_invRootTransform * m_bonesTransform[i] * m_invBindPoseTransform[i];
+	// palette is shared by every renderer of the animator's skeleton, a renderer of other skeleton evaluates its own
+	// (same bone count doesn't make it the same skeleton)
+	auto animator = m_animator.lock();
+	const SkinPalette& palette = animator->skinPalette();
+	const glm::mat4* bonesTransform = palette.getMatrices().data();
+	size_t boneCount = palette.size();
+	if (!palette.isValid() || palette.getSkeleton() != model->getSkeleton() || boneCount != m_invBindPoseTransform.size()) {
+		animator->animatedPose().getSkinMatrix(m_bonesTransform);
+		for (size_t i = 0; i < m_bonesTransform.size(); i++) {
+			m_bonesTransform[i] = m_invRootTransform * m_bonesTransform[i] * m_invBindPoseTransform[i];
+		}
+
+		bonesTransform = m_bonesTransform.data();
+		boneCount = m_bonesTransform.size();
 	}
 
 	for (size_t i = 0; i < model->meshCount(); i++) {
@@ -45,11 +58,14 @@ void SkinMeshRenderComponent::render(RenderContext* context) {
 		task.vao = mesh->vertexArray();
 		task.vertexCount = mesh->verticesCount();
 		task.indexCount = mesh->indicesCount();
+		task.indexOffset = mesh->getIndexOffset();
+		task.vertexOffset = mesh->getVertexOffset();
 		task.primitive = mesh->getPrimitiveType();
 		task.material = mat;
-		task.modelMatrix = context->getMatrix() * m_owner->m_transform.getMatrix(); // mesh->getTransform();
-		task.bonesTransform = m_bonesTransform.data();
-		task.boneCount = m_bonesTransform.size();
+		task.modelMatrix = m_owner->m_transform.getMatrixWorld(); // mesh->getTransform();
+		task.bounds = skinnedBounds(mesh->getBounds()).transform(task.modelMatrix * m_invRootTransform);
+		task.bonesTransform = bonesTransform;
+		task.boneCount = boneCount;
 
 		auto layer = getGameObject()->getLayer();
 		auto renderer = context->getRenderer();
@@ -64,6 +80,16 @@ void SkinMeshRenderComponent::render(RenderContext* context) {
 	}
 }
 
+AABB_t SkinMeshRenderComponent::skinnedBounds(const AABB_t& bindPoseBounds) {
+	// animated vertices may leave bind pose box
+	if (!bindPoseBounds.isValid())
+		return bindPoseBounds;
+
+	glm::vec3 margin = (bindPoseBounds.maximum - bindPoseBounds.minimum) * SKINNED_BOUNDS_MARGIN;
+	return AABB_t(bindPoseBounds.minimum - margin, bindPoseBounds.maximum + margin);
+}
+
+
 void SkinMeshRenderComponent::setMeshes(std::weak_ptr<Model> meshes, bool useEmbededMaterials) {
 	__super::setMeshes(meshes, useEmbededMaterials);
 	if (!m_meshes.expired()) {
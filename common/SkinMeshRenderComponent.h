@@ -25,6 +25,8 @@ public:
 	}
 
 protected:
+	static AABB_t skinnedBounds(const AABB_t& bindPoseBounds);
+
 	std::vector<glm::mat4> m_invBindPoseTransform;
 	std::vector<glm::mat4> m_bonesTransform;
 	std::weak_ptr<AnimatorComponent> m_animator;
@@ -0,0 +1,78 @@
+#include"SkinPalette.h"
+#include"Skeleton.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include<xmmintrin.h>
+#define SKIN_PALETTE_SSE
+#endif
+
+
+SkinPalette::SkinPalette() :m_jointOrder()
+, m_invBindMatrices()
+, m_globalMatrices()
+, m_matrices()
+, m_invRootTransform(1.f)
+, m_skeleton(nullptr)
+, m_isValid(false) {
+
+}
+
+
+void SkinPalette::build(const Skeleton& skeleton) {
+	m_jointOrder = skeleton.getJointOrder();
+	skeleton.getInvBindPose().getSkinMatrix(m_invBindMatrices);
+	m_invRootTransform = skeleton.getInvRootTransform();
+	m_skeleton = &skeleton;
+
+	// sized once, update never allocates
+	m_globalMatrices.resize(m_jointOrder.size());
+	m_matrices.resize(m_jointOrder.size());
+	m_isValid = false;
+}
+
+
+void SkinPalette::update(const Pose& pose) {
+	m_isValid = !m_jointOrder.empty() && pose.size() == m_jointOrder.size();
+	if (!m_isValid)
+		return;
+
+	for (int joint : m_jointOrder) {
+		glm::mat4 local = transform2Mat(pose[joint]);
+		int parent = pose.getJointParent(joint);
+		multiply(parent >= 0 ? m_globalMatrices[parent] : m_invRootTransform, local, m_globalMatrices[joint]);
+		multiply(m_globalMatrices[joint], m_invBindMatrices[joint], m_matrices[joint]);
+	}
+}
+
+
+void SkinPalette::clear() {
+	m_jointOrder.clear();
+	m_invBindMatrices.clear();
+	m_globalMatrices.clear();
+	m_matrices.clear();
+	m_invRootTransform = glm::mat4(1.f);
+	m_skeleton = nullptr;
+	m_isValid = false;
+}
+
+
+void SkinPalette::multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& result) {
+#ifdef SKIN_PALETTE_SSE
+	// column major, every result column is a's columns weighted by b's column
+	const float* pa = &a[0][0];
+	const float* pb = &b[0][0];
+	float* pr = &result[0][0];
+	__m128 a0 = _mm_loadu_ps(pa);
+	__m128 a1 = _mm_loadu_ps(pa + 4);
+	__m128 a2 = _mm_loadu_ps(pa + 8);
+	__m128 a3 = _mm_loadu_ps(pa + 12);
+	for (int c = 0; c < 4; c++) {
+		const float* col = pb + c * 4;
+		__m128 r = _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(col[0])), _mm_mul_ps(a1, _mm_set1_ps(col[1])));
+		r = _mm_add_ps(r, _mm_add_ps(_mm_mul_ps(a2, _mm_set1_ps(col[2])), _mm_mul_ps(a3, _mm_set1_ps(col[3]))));
+		_mm_storeu_ps(pr + c * 4, r);
+	}
+#else
+	result = a * b;
+#endif // SKIN_PALETTE_SSE
+}
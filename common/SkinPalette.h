@@ -0,0 +1,49 @@
+#pragma once
+#include"Pose.h"
+#include<vector>
+
+
+class Skeleton;
+
+
+//
+// skin matrices of an avatar, evaluated once per frame by its animator and read by every skinned renderer of it.
+// joints are visited in skeleton's parents first order, so every global matrix is one multiply of its parent's,
+// skin matrix = invRoot * global * invBind. matrix products use sse when available.
+//
+class SkinPalette {
+public:
+	SkinPalette();
+
+	void build(const Skeleton& skeleton); // cache joint order, inverse root & bind matrices
+	void update(const Pose& pose); // pose must be of the skeleton used to build
+	void clear();
+
+	inline bool isValid() const {
+		return m_isValid;
+	}
+
+	inline size_t size() const {
+		return m_matrices.size();
+	}
+
+	inline const std::vector<glm::mat4>& getMatrices() const {
+		return m_matrices;
+	}
+
+	// skeleton palette was built from, renderers of another skeleton can't share it
+	inline const Skeleton* getSkeleton() const {
+		return m_skeleton;
+	}
+
+	static void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& result); // result = a * b
+
+private:
+	std::vector<int> m_jointOrder;
+	std::vector<glm::mat4> m_invBindMatrices;
+	std::vector<glm::mat4> m_globalMatrices; // with inverse root applied
+	std::vector<glm::mat4> m_matrices;
+	glm::mat4 m_invRootTransform;
+	const Skeleton* m_skeleton;
+	bool m_isValid;
+};
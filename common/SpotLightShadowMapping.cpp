@@ -6,14 +6,14 @@
 #include"ShaderProgamMgr.h"
 #include"Renderer.h"
 #include<glm/gtx/transform.hpp>
+#include<glm/gtc/constants.hpp>
 #include"Util.h"
 
 
 SpotLightShadowMapping::SpotLightShadowMapping(IRenderTechnique* rt, const glm::vec2& shadowMapResolution)
 : IShadowMapping(rt)
-, m_shadowTarget()
+, m_cache(Texture::Target::Texture_2D, 1, [this]() { return createShadowTarget(); })
 , m_shader()
-, m_lightVP(1.f)
 , m_shadowViewport(0.f, 0.f, shadowMapResolution.x, shadowMapResolution.y)
 , m_shadowMapResolution(shadowMapResolution) {
 }
@@ -27,7 +27,18 @@ void SpotLightShadowMapping::renderShadow(const Scene_t& scene, const Light_t& l
 	if (!light.isCastShadow())
 		return;
 
-	updateLightMatrix(light);
+	auto renderer = m_renderTech->getRenderer();
+	auto tracker = renderer->getShadowCasterTracker();
+	auto culler = [&light](const MeshRenderItem_t* items, size_t count, uint8_t* masks) {
+		cullCasters(light, items, count, masks);
+	};
+
+	// map is left as it is while light & casters it sees stay put
+	uint64_t lightKey = ShadowCasterTracker::lightKey(light);
+	if (!m_cache.begin(scene, tracker, lightKey, ShadowCasterTracker::lightSignature(light), culler))
+		return;
+
+	glm::mat4 lightVP = calcLightMatrix(light);
 
 	auto preZShader = ShaderProgramManager::getInstance()->getProgram("DepthPass");
 	if (preZShader.expired())
@@ -35,31 +46,17 @@ void SpotLightShadowMapping::renderShadow(const Scene_t& scene, const Light_t& l
 	ASSERT(!preZShader.expired());
 
 	m_shader = preZShader.lock();
-	auto renderer = m_renderTech->getRenderer();
 	renderer->pushShaderProgram(m_shader.get());
-	renderer->pushRenderTarget(m_shadowTarget.get());
 	renderer->pushViewport(&m_shadowViewport);
-	renderer->clearScreen(ClearFlags::Depth);
 
 	// set view project matrix
 	if (m_shader->hasUniform("u_VPMat")) {
-		m_shader->setUniformMat4v("u_VPMat", &m_lightVP[0][0]);
+		m_shader->setUniformMat4v("u_VPMat", &lightVP[0][0]);
 	}
 	
-	for (size_t i = 0; i < scene.numOpaqueItems; i++) {
-		m_renderTech->render(scene.opaqueItems[i]);
-	}
-
-	for (size_t i = 0; i < scene.numCutOutItems; i++) {
-		m_renderTech->render(scene.cutOutItems[i]);
-	}
-
-	for (size_t i = 0; i < scene.numTransparentItems; i++) {
-		m_renderTech->render(scene.transparentItems[i]);
-	}
+	m_cache.render(m_renderTech, tracker);
 
 	renderer->popViewport();
-	renderer->popRenderTarget();
 	renderer->popShadrProgram();
 	m_shader->unbindSubroutineUniforms();
 	m_shader = nullptr;
@@ -77,7 +74,7 @@ void SpotLightShadowMapping::beginRenderLight(const Light_t& light, ShaderProgra
 	if (shader->hasUniform("u_shadowMap")) {
 		shader->setUniform1("u_hasShadowMap", int(light.isCastShadow()));
 		if (light.isCastShadow()) {
-			Texture* shadowMap = m_shadowTarget->getAttachedTexture(RenderTarget::Slot::Depth);
+			Texture* shadowMap = m_cache.getShadowMap(ShadowCasterTracker::lightKey(light));
 			if (shadowMap) {
 				shadowMap->bindToTextureUnit(Texture::Unit::ShadowMap);
 				shader->setUniform1("u_shadowMap", int(Texture::Unit::ShadowMap));
@@ -90,15 +87,17 @@ void SpotLightShadowMapping::beginRenderLight(const Light_t& light, ShaderProgra
 		if (shader->hasUniform("u_shadowBias"))
 			shader->setUniform1("u_shadowBias", light.shadowBias);
 
-		if (shader->hasUniform("u_lightVP"))
-			shader->setUniformMat4v("u_lightVP", &m_lightVP[0][0]);
+		if (shader->hasUniform("u_lightVP")) {
+			glm::mat4 lightVP = calcLightMatrix(light);
+			shader->setUniformMat4v("u_lightVP", &lightVP[0][0]);
+		}
 	}
 }
 
 
 void SpotLightShadowMapping::endRenderLight(const Light_t& light, ShaderProgram* shader) {
 	if (light.isCastShadow()) {
-		if (auto shadowMap = m_shadowTarget->getAttachedTexture(RenderTarget::Slot::Depth))
+		if (auto shadowMap = m_cache.getShadowMap(ShadowCasterTracker::lightKey(light)))
 			shadowMap->unbindFromTextureUnit();
 	}
 }
@@ -107,32 +106,62 @@ void SpotLightShadowMapping::endRenderLight(const Light_t& light, ShaderProgram*
 void SpotLightShadowMapping::onShadowMapResolutionChange(float w, float h) {
 	m_shadowMapResolution = { w, h };
 	m_shadowViewport = Viewport_t(0.f, 0.f, w, h);
-	ASSERT(setupShadowRenderTarget());
+	m_cache.clear(); // maps are re-created at new resolution when lights render next
+}
+
+
+void SpotLightShadowMapping::cullCasters(const Light_t& light, const MeshRenderItem_t* items, size_t count, uint8_t* masks) {
+	float halfAngle = light.outterCone * 0.5f;
+	float sinAngle = sinf(halfAngle);
+	float cosAngle = cosf(halfAngle);
+	glm::vec3 axis = glm::normalize(light.direction);
+
+	for (size_t i = 0; i < count; i++) {
+		const AABB_t& bounds = items[i].bounds;
+		if (!bounds.isValid()) { // never culled
+			masks[i] = 1;
+			continue;
+		}
+
+		glm::vec3 center = (bounds.minimum + bounds.maximum) * 0.5f;
+		float radius = glm::length(bounds.maximum - center);
+		glm::vec3 v = center - light.position;
+		float lenSq = glm::dot(v, v);
+		float axial = glm::dot(v, axis);
+
+		// shadow ray of a lit point never leaves cone or range, sphere has to reach into both
+		bool isInRange = lenSq <= (light.range + radius) * (light.range + radius);
+		bool isInCone = axial >= -radius && cosAngle * sqrtf(glm::max(lenSq - axial * axial, 0.f)) - axial * sinAngle <= radius;
+		if (halfAngle >= glm::half_pi<float>())
+			isInCone = true;
+
+		masks[i] = isInRange && isInCone ? 1 : 0;
+	}
 }
 
 
-void SpotLightShadowMapping::updateLightMatrix(const Light_t& light) {
+glm::mat4 SpotLightShadowMapping::calcLightMatrix(const Light_t& light) const {
 	auto v = glm::lookAt(light.position, light.position + light.direction, glm::vec3(0.f, 1.f, 0.f));
-	auto p = m_lightVP * glm::perspective(light.outterCone, 1.f, 0.1f, light.range * 1.5f);
-	m_lightVP = p * v;
+	auto p = glm::perspective(light.outterCone, 1.f, 0.1f, light.range * 1.5f);
+	return p * v;
 }
 
 
-bool SpotLightShadowMapping::setupShadowRenderTarget() {
-	m_shadowTarget.reset(new RenderTarget(m_shadowMapResolution));
-	m_shadowTarget->bind();
+std::unique_ptr<RenderTarget> SpotLightShadowMapping::createShadowTarget() {
+	std::unique_ptr<RenderTarget> shadowTarget(new RenderTarget(m_shadowMapResolution));
+	shadowTarget->bind();
 
-	if (!m_shadowTarget->attachTexture2D(Texture::Format::Depth24, RenderTarget::Slot::Depth)) {
-		m_shadowTarget->unBind();
-		return false;
+	if (!shadowTarget->attachTexture2D(Texture::Format::Depth24, RenderTarget::Slot::Depth)) {
+		shadowTarget->unBind();
+		return nullptr;
 	}
 
-	if (!m_shadowTarget->isValid()) {
-		m_shadowTarget->unBind();
-		return false;
+	if (!shadowTarget->isValid()) {
+		shadowTarget->unBind();
+		return nullptr;
 	}
 
-	m_shadowTarget->unBind();
+	shadowTarget->unBind();
 
-	return true;
+	return shadowTarget;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include"ShadowMapping.h"
 #include"RenderTarget.h"
+#include"ShadowMapCache.h"
 #include<memory>
 
 
@@ -14,11 +15,11 @@ public:
 	~SpotLightShadowMapping();
 
 	inline bool initialize() override {
-		return setupShadowRenderTarget();
+		return true;
 	}
 
 	inline void cleanUp() override {
-		m_shadowTarget.release();
+		m_cache.clear();
 	}
 
 	void renderShadow(const Scene_t& scene, const Light_t& light) override;
@@ -26,16 +27,17 @@ public:
 	void endRenderLight(const Light_t& light, ShaderProgram* shader) override;
 	void onShadowMapResolutionChange(float w, float h) override;
 
+	// casters whose bounding sphere touches light cone within range
+	static void cullCasters(const Light_t& light, const MeshRenderItem_t* items, size_t count, uint8_t* masks);
+
 private:
-	bool setupShadowRenderTarget();
-	void updateLightMatrix(const Light_t& light);
+	std::unique_ptr<RenderTarget> createShadowTarget();
+	glm::mat4 calcLightMatrix(const Light_t& light) const;
 
 private:
-	std::unique_ptr<RenderTarget> m_shadowTarget;
+	ShadowMapCache m_cache;
 	std::shared_ptr<ShaderProgram> m_shader;
 	
 	Viewport_t m_shadowViewport;;
 	glm::vec2 m_shadowMapResolution;
-
-	glm::mat4 m_lightVP;
 };
\ No newline at end of file
@@ -2,7 +2,36 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include<stb_image/stb_image.h>
 #include"Util.h"
+#include"GLStateCache.h"
 #include"Buffer.h"
+#include"JobSystem.h"
+#include"TextureCooker.h"
+
+
+TextureImage_t::TextureImage_t() :file()
+, width(0)
+, height(0)
+, numChannels(0)
+, pixels(nullptr) {
+
+}
+
+
+TextureImage_t::~TextureImage_t() {
+	release();
+}
+
+
+void TextureImage_t::release() {
+	if (pixels)
+		stbi_image_free(pixels);
+
+	pixels = nullptr;
+	width = 0;
+	height = 0;
+	numChannels = 0;
+}
+
 
 
 Texture::Texture():m_handler(0)
@@ -12,6 +41,7 @@ Texture::Texture():m_handler(0)
 , m_numLayer(0)
 , m_depth(0)
 , m_format(Format::Unknown)
+, m_isLoadFailed(false)
 , m_bindedTexUnit(Unit::Defualt)
 , m_bindedTarget(Target::Unknown)
 , m_bindedImageUnit(-1) {
@@ -31,24 +61,27 @@ int Texture::maximumAvaliableTextureUnit() {
 }
 
 
-bool Texture::loadImage2DFromFile(const std::string& file, bool flipUV, bool genMipMap) {
-	int channelCnt = 0;
-	stbi_set_flip_vertically_on_load(flipUV);
-	auto data = stbi_load(file.c_str(), &m_width, &m_height, &channelCnt, 0);
+bool Texture::decodeImage(const std::string& file, TextureImage_t& image, bool flipUV) {
+	image.release();
 
-	if (data) {
-		auto fmt = getGenericFormat(channelCnt);
-		loadImage2DFromMemory(fmt, fmt, FormatDataType::UByte, m_width, m_height, data, genMipMap);
-		stbi_image_free(data);
-		m_file = file;
+	// flip flag is per thread, decoders running side by side don't race on it
+	stbi_set_flip_vertically_on_load_thread(flipUV);
+	image.pixels = stbi_load(file.c_str(), &image.width, &image.height, &image.numChannels, 0);
+	image.file = file;
 
-		return true;
-	}
+	return image.pixels != nullptr;
+}
+
+
+bool Texture::loadImage2DFromFile(const std::string& file, bool flipUV, bool genMipMap) {
+	TextureImage_t image;
+	if (decodeImage(file, image, flipUV))
+		return loadImage2DFromImage(image, genMipMap);
 
 #ifdef _DEBUG
 	std::string msg;
 	msg += "[Texture Load error] Failed to load texture: ";
-	msg += m_file;
+	msg += file;
 	CONSOLELOG(msg);
 #endif // _DEBUG
 
@@ -56,6 +89,33 @@ bool Texture::loadImage2DFromFile(const std::string& file, bool flipUV, bool gen
 }
 
 
+bool Texture::loadImage2DFromImage(const TextureImage_t& image, bool genMipMap) {
+	if (!image.pixels)
+		return false;
+
+	auto fmt = getGenericFormat(image.numChannels);
+	loadImage2DFromMemory(fmt, fmt, FormatDataType::UByte, image.width, image.height, image.pixels, genMipMap);
+	m_file = image.file;
+
+	return true;
+}
+
+
+bool Texture::loadImage2DFromBuffer(Buffer* buf, Format gpuFmt, Format cpuFmt, FormatDataType fmtDataType, size_t width, size_t height, size_t byteOffset, bool genMipMap) {
+	// level 0 storage first, its pixels are sourced from unpack buffer
+	loadImage2DFromMemory(cpuFmt, gpuFmt, fmtDataType, width, height, nullptr, false);
+
+	bindToTextureUnit();
+	subDataImage2DFromBuffer(buf, cpuFmt, fmtDataType, 0, 0, width, height, 0, byteOffset);
+	if (genMipMap) {
+		GLCALL(glGenerateMipmap(GLenum(m_bindedTarget)));
+	}
+	unbindFromTextureUnit();
+
+	return true;
+}
+
+
 bool Texture::loadImage2DFromMemory(Format cpuFmt, Format gpuFmt, 
 									FormatDataType mtDataType, 
 									size_t width, 
@@ -96,6 +156,44 @@ bool Texture::loadImage2DFromMemory(Format cpuFmt, Format gpuFmt,
 }
 
 
+bool Texture::loadCompressedImage2D(const CookedTexture_t& cooked, Buffer* buf, size_t byteOffset) {
+	static const Format formats[] = { Format::BC1, Format::BC3, Format::BC5, Format::BC7 };
+	if (!cooked.isValid())
+		return false;
+
+	Format fmt = formats[int(cooked.format)];
+	bindToTextureUnit();
+	if (buf)
+		buf->bind(Buffer::Target::PixelUnpackBuffer);
+
+	for (size_t i = 0; i < cooked.levels.size(); i++) {
+		const CookedTextureLevel_t& level = cooked.levels[i];
+		const void* data = buf ? reinterpret_cast<const void*>(byteOffset + level.offset) : cooked.blocks + level.offset;
+		GLCALL(glCompressedTexImage2D(GL_TEXTURE_2D, i, GLenum(fmt), level.width, level.height, 0, level.size, data));
+	}
+
+	if (buf)
+		buf->unbind();
+
+	// chain is baked, no mipmap generation at load
+	GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, GLint(cooked.levels.size() - 1)));
+	GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, cooked.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+	GLCALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+	setWrapMode(WrapType::S, WrapMode::Clamp_To_Edge);
+	setWrapMode(WrapType::T, WrapMode::Clamp_To_Edge);
+
+	m_format = fmt;
+	m_width = cooked.width;
+	m_height = cooked.height;
+	m_numLayer = 1;
+	m_depth = 1;
+
+	unbindFromTextureUnit();
+
+	return true;
+}
+
+
 bool Texture::loadCubeMapFromFiles(const std::string& right,
 									const std::string& left,
 									const std::string& top,
@@ -105,29 +203,22 @@ bool Texture::loadCubeMapFromFiles(const std::string& right,
 									bool flipUV,
 									bool genMipMap) {
 	std::string faces[] = { right, left, top, bottom, front, back };
-	std::vector<void*> datas;
-	int channelCnt = 0;
-	bool ok = true;
-	for (size_t i = 0; i < 6; i++) {
-		stbi_set_flip_vertically_on_load(flipUV);
-		auto data = stbi_load(faces[i].c_str(), &m_width, &m_height, &channelCnt, 0);
-		if (!data) {
-			ok = false;
-			break;
-		}
-
-		datas.push_back(data);
-	}
+	TextureImage_t images[6];
 
-	if (!ok) {
-		for (auto data : datas) {
-			stbi_image_free(data);
-		}
-		return false;
+	// faces decode independently, one job each
+	JobSystem::getInstance()->parallelFor(6, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++)
+			decodeImage(faces[i], images[i], flipUV);
+	});
+
+	for (const auto& image : images) {
+		if (!image.pixels || image.width != images[0].width || image.height != images[0].height || image.numChannels != images[0].numChannels)
+			return false;
 	}
 
-	Format fmt = getGenericFormat(channelCnt);
-	if (!loadCubeMapFromMemory(fmt, fmt, FormatDataType::UByte, m_width, m_height, datas[0], datas[1], datas[2], datas[3], datas[4], datas[5], genMipMap))
+	Format fmt = getGenericFormat(images[0].numChannels);
+	if (!loadCubeMapFromMemory(fmt, fmt, FormatDataType::UByte, images[0].width, images[0].height, 
+		images[0].pixels, images[1].pixels, images[2].pixels, images[3].pixels, images[4].pixels, images[5].pixels, genMipMap))
 		return false;
 
 	return true;
@@ -289,8 +380,7 @@ bool Texture::subDataImage2DArrayFromBuffer(Buffer* buf, Format fmt, FormatDataT
 
 
 bool Texture::bindToTextureUnit(Unit unit, Target target)  const {
-	GLCALL(glActiveTexture(GL_TEXTURE0 + int(unit)));
-	GLCALL(glBindTexture(int(target), m_handler));
+	GLStateCache::getInstance()->bindTexture(GLuint(unit), GLenum(target), m_handler);
 	m_bindedTexUnit = unit;
 	m_bindedTarget = target;
 	return true;
@@ -299,8 +389,7 @@ bool Texture::bindToTextureUnit(Unit unit, Target target)  const {
 
 void Texture::unbindFromTextureUnit() const {
 	if (m_bindedTarget != Target::Unknown) {
-		GLCALL(glActiveTexture(GL_TEXTURE0 + int(m_bindedTexUnit)));
-		GLCALL(glBindTexture(int(m_bindedTarget), 0));
+		GLStateCache::getInstance()->bindTexture(GLuint(m_bindedTexUnit), GLenum(m_bindedTarget), 0);
 		m_bindedTarget = Target::Unknown;
 		m_bindedTexUnit = Unit::Defualt;
 	}
@@ -406,6 +495,7 @@ void Texture::release() {
 		unbindFromTextureUnit();
 		unbindFromImageUnit();
 		glDeleteTextures(1, &m_handler);
+		GLStateCache::getInstance()->onDeleteTexture(m_handler);
 		m_handler = 0;
 		m_width = 0;
 		m_height = 0;
@@ -413,6 +503,7 @@ void Texture::release() {
 		m_depth = 0;
 		m_file.clear();
 		m_format = Format::Unknown;
+		m_isLoadFailed = false;
 		m_bindedTexUnit = Unit::Defualt;
 		m_bindedTarget = Target::Unknown;
 	}
@@ -4,10 +4,46 @@
 #include"RendererCore.h"
 
 
+// s3tc is an extension, not in generated gl header
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+
 class Buffer;
+struct CookedTexture_t;
+
+
+//
+// pixels of an image file decoded on cpu, decoding makes no gl call and is safe on any thread
+//
+struct TextureImage_t {
+	std::string file;
+	int width;
+	int height;
+	int numChannels;
+	unsigned char* pixels;
+
+	TextureImage_t();
+	~TextureImage_t();
+
+	TextureImage_t(const TextureImage_t& other) = delete;
+	TextureImage_t& operator = (const TextureImage_t& other) = delete;
+
+	void release();
+
+	inline size_t size() const {
+		return size_t(width) * height * numChannels;
+	}
+};
+
 
 class Texture {
 	friend class SkyboxComponent;
+	friend class TextureLoadQueue;
 
 public:
 	enum class Unit {
@@ -121,6 +157,12 @@ public:
 		RGB32UI = GL_RGB32UI,
 		RGBA32I = GL_RGBA32I,
 		RGBA32UI = GL_RGBA32UI,
+
+		// block compressed format
+		BC1 = GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+		BC3 = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+		BC5 = GL_COMPRESSED_RG_RGTC2,
+		BC7 = GL_COMPRESSED_RGBA_BPTC_UNORM,
 	};
 
 	enum class FormatDataType {
@@ -197,10 +239,16 @@ public:
 	Texture& operator = (Texture&& rv) = delete;
 
 	static int maximumAvaliableTextureUnit();
+	static bool decodeImage(const std::string& file, TextureImage_t& image, bool flipUV = true);
 
 	// load functions can accept unsized/sized internal(gpu) format, unsized external(cpu) format
 	bool loadImage2DFromFile(const std::string& file, bool flipUV = true, bool genMipMap = true);
 	bool loadImage2DFromMemory(Format gpuFmt, Format cpuFmt, FormatDataType fmtDataType, size_t width, size_t height, const void* data, bool genMipMap = false);
+	bool loadImage2DFromImage(const TextureImage_t& image, bool genMipMap = true);
+	// pixels are read from a pixel unpack buffer at byteOffset, call returns before gpu finished copying them
+	bool loadImage2DFromBuffer(Buffer* buf, Format gpuFmt, Format cpuFmt, FormatDataType fmtDataType, size_t width, size_t height, size_t byteOffset = 0, bool genMipMap = false);
+	// whole mip chain of a cooked texture, level blocks read from unpack buffer at byteOffset when one is given
+	bool loadCompressedImage2D(const CookedTexture_t& cooked, Buffer* buf = nullptr, size_t byteOffset = 0);
 	bool loadCubeMapFromFiles(const std::string& right, const std::string& left, const std::string& top, const std::string& bottom, const std::string& front, const std::string& back, bool flipUV = false, bool genMipMap = false);	
 	bool loadCubeMapFromMemory(Format gpuFmt, Format cpuFmt, FormatDataType cpuFmtDataType, float w, float h, const void* right = nullptr, const void* left = nullptr, const void* top = nullptr, const void* bottom = nullptr, const void* front = nullptr, const void* back = nullptr, bool genMipMap = false);
 
@@ -246,6 +294,11 @@ public:
 		return m_file;
 	}
 
+	// async load of source file failed, texture still holds its fallback texel
+	inline bool isLoadFailed() const {
+		return m_isLoadFailed;
+	}
+
 	inline Format getFormat() const {
 		return m_format;
 	}
@@ -264,7 +317,7 @@ public:
 	}
 
 protected:
-	Format getGenericFormat(size_t channelCnt);
+	static Format getGenericFormat(size_t channelCnt);
 
 private:
 	std::string m_file;
@@ -273,6 +326,7 @@ private:
 	int m_numLayer;
 	int m_depth;
 	Format m_format;
+	bool m_isLoadFailed;
 
 	mutable Target m_bindedTarget;
 	mutable Unit m_bindedTexUnit;
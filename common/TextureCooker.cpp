@@ -0,0 +1,795 @@
+#include"TextureCooker.h"
+#include"Texture.h"
+#include"Util.h"
+#include<algorithm>
+#include<cfloat>
+#include<cmath>
+#include<cstring>
+#include<fstream>
+#include<system_error>
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include<emmintrin.h>
+#define TEXTURE_COOKER_SSE
+#endif
+
+
+// power iterations finding principal axis of a block's colors
+#define PRINCIPAL_AXIS_ITERATIONS 8
+
+#define COOK_OPTION_FLIP_UV 0x1
+#define COOK_OPTION_NORMAL_MAP 0x2
+#define COOK_OPTION_HIGH_QUALITY 0x4
+
+
+// bc7 4 bit index interpolation weights, out of 64
+static const int s_bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+
+//
+// struct of arrays, 4 entries are compared against a texel in one sse op.
+// size is a multiple of 4
+//
+struct BlockPalette_t {
+	alignas(16) float channels[4][16];
+	int size;
+};
+
+
+class BlockBitWriter {
+public:
+	BlockBitWriter(uint8_t* out, size_t numBytes) : m_out(out), m_pos(0) {
+		memset(out, 0, numBytes);
+	}
+
+	void put(uint32_t value, int numBits) {
+		for (int b = 0; b < numBits; b++, m_pos++) {
+			if ((value >> b) & 1)
+				m_out[m_pos / 8] |= uint8_t(1 << (m_pos % 8));
+		}
+	}
+
+private:
+	uint8_t* m_out;
+	size_t m_pos;
+};
+
+
+class BlockBitReader {
+public:
+	BlockBitReader(const uint8_t* in) : m_in(in), m_pos(0) {}
+
+	uint32_t get(int numBits) {
+		uint32_t value = 0;
+		for (int b = 0; b < numBits; b++, m_pos++)
+			value |= uint32_t((m_in[m_pos / 8] >> (m_pos % 8)) & 1) << b;
+		return value;
+	}
+
+private:
+	const uint8_t* m_in;
+	size_t m_pos;
+};
+
+
+
+static void nearestIndices(const float texels[16][4], const BlockPalette_t& palette, int numChannels, uint8_t indices[16]) {
+	for (int t = 0; t < 16; t++) {
+#ifdef TEXTURE_COOKER_SSE
+		__m128 bestDist = _mm_set1_ps(FLT_MAX);
+		__m128 bestIndex = _mm_setzero_ps();
+		for (int e = 0; e < palette.size; e += 4) {
+			__m128 dist = _mm_setzero_ps();
+			for (int c = 0; c < numChannels; c++) {
+				__m128 d = _mm_sub_ps(_mm_set1_ps(texels[t][c]), _mm_load_ps(&palette.channels[c][e]));
+				dist = _mm_add_ps(dist, _mm_mul_ps(d, d));
+			}
+
+			__m128 isCloser = _mm_cmplt_ps(dist, bestDist);
+			__m128 index = _mm_add_ps(_mm_set1_ps(float(e)), _mm_set_ps(3.f, 2.f, 1.f, 0.f));
+			bestDist = _mm_or_ps(_mm_and_ps(isCloser, dist), _mm_andnot_ps(isCloser, bestDist));
+			bestIndex = _mm_or_ps(_mm_and_ps(isCloser, index), _mm_andnot_ps(isCloser, bestIndex));
+		}
+
+		float dists[4], lanes[4];
+		_mm_storeu_ps(dists, bestDist);
+		_mm_storeu_ps(lanes, bestIndex);
+		int best = 0;
+		for (int l = 1; l < 4; l++) {
+			if (dists[l] < dists[best] || (dists[l] == dists[best] && lanes[l] < lanes[best]))
+				best = l;
+		}
+		indices[t] = uint8_t(lanes[best]);
+#else
+		float bestDist = FLT_MAX;
+		for (int e = 0; e < palette.size; e++) {
+			float dist = 0.f;
+			for (int c = 0; c < numChannels; c++) {
+				float d = texels[t][c] - palette.channels[c][e];
+				dist += d * d;
+			}
+
+			if (dist < bestDist) {
+				bestDist = dist;
+				indices[t] = uint8_t(e);
+			}
+		}
+#endif // TEXTURE_COOKER_SSE
+	}
+}
+
+
+// end points of the segment through block's colors along their principal axis
+static void principalEndpoints(const float texels[16][4], int numChannels, float lo[4], float hi[4]) {
+	float mean[4] = { 0.f, 0.f, 0.f, 0.f };
+	float boxMin[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+	float boxMax[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (int t = 0; t < 16; t++) {
+		for (int c = 0; c < numChannels; c++) {
+			mean[c] += texels[t][c] / 16.f;
+			boxMin[c] = MIN(boxMin[c], texels[t][c]);
+			boxMax[c] = MAX(boxMax[c], texels[t][c]);
+		}
+	}
+
+	float cov[4][4] = {};
+	for (int t = 0; t < 16; t++) {
+		for (int i = 0; i < numChannels; i++) {
+			for (int j = 0; j < numChannels; j++)
+				cov[i][j] += (texels[t][i] - mean[i]) * (texels[t][j] - mean[j]);
+		}
+	}
+
+	// start from bounding box diagonal, power iteration converges to the dominant eigen vector
+	float axis[4] = { 0.f, 0.f, 0.f, 0.f };
+	for (int c = 0; c < numChannels; c++)
+		axis[c] = boxMax[c] - boxMin[c];
+
+	for (int i = 0; i < PRINCIPAL_AXIS_ITERATIONS; i++) {
+		float next[4] = { 0.f, 0.f, 0.f, 0.f };
+		float len = 0.f;
+		for (int r = 0; r < numChannels; r++) {
+			for (int c = 0; c < numChannels; c++)
+				next[r] += cov[r][c] * axis[c];
+			len += next[r] * next[r];
+		}
+
+		if (len < 1e-8f)
+			break;
+
+		len = 1.f / sqrtf(len);
+		for (int c = 0; c < numChannels; c++)
+			axis[c] = next[c] * len;
+	}
+
+	float len = 0.f;
+	for (int c = 0; c < numChannels; c++)
+		len += axis[c] * axis[c];
+
+	float minT = 0.f, maxT = 0.f;
+	if (len > 1e-8f) {
+		len = 1.f / sqrtf(len);
+		for (int c = 0; c < numChannels; c++)
+			axis[c] *= len;
+
+		minT = FLT_MAX;
+		maxT = -FLT_MAX;
+		for (int t = 0; t < 16; t++) {
+			float proj = 0.f;
+			for (int c = 0; c < numChannels; c++)
+				proj += (texels[t][c] - mean[c]) * axis[c];
+			minT = MIN(minT, proj);
+			maxT = MAX(maxT, proj);
+		}
+	}
+
+	for (int c = 0; c < 4; c++) {
+		lo[c] = c < numChannels ? glm::clamp(mean[c] + axis[c] * minT, 0.f, 255.f) : 0.f;
+		hi[c] = c < numChannels ? glm::clamp(mean[c] + axis[c] * maxT, 0.f, 255.f) : 0.f;
+	}
+}
+
+
+static uint16_t packRGB565(const float color[4]) {
+	uint32_t r = uint32_t(color[0] * 31.f / 255.f + 0.5f);
+	uint32_t g = uint32_t(color[1] * 63.f / 255.f + 0.5f);
+	uint32_t b = uint32_t(color[2] * 31.f / 255.f + 0.5f);
+	return uint16_t((r << 11) | (g << 5) | b);
+}
+
+
+static void unpackRGB565(uint16_t packed, int color[3]) {
+	int r = (packed >> 11) & 0x1f;
+	int g = (packed >> 5) & 0x3f;
+	int b = packed & 0x1f;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+
+static void encodeBC1(const float texels[16][4], uint8_t* out) {
+	float lo[4], hi[4];
+	principalEndpoints(texels, 3, lo, hi);
+
+	// c0 > c1 selects 4 color mode
+	uint16_t c0 = packRGB565(hi);
+	uint16_t c1 = packRGB565(lo);
+	if (c0 < c1)
+		std::swap(c0, c1);
+
+	uint32_t bits = 0;
+	if (c0 != c1) {
+		int p0[3], p1[3];
+		unpackRGB565(c0, p0);
+		unpackRGB565(c1, p1);
+
+		BlockPalette_t palette = {};
+		palette.size = 4;
+		for (int c = 0; c < 3; c++) {
+			palette.channels[c][0] = float(p0[c]);
+			palette.channels[c][1] = float(p1[c]);
+			palette.channels[c][2] = float((2 * p0[c] + p1[c]) / 3);
+			palette.channels[c][3] = float((p0[c] + 2 * p1[c]) / 3);
+		}
+
+		uint8_t indices[16];
+		nearestIndices(texels, palette, 3, indices);
+		for (int t = 0; t < 16; t++)
+			bits |= uint32_t(indices[t]) << (t * 2);
+	}
+
+	out[0] = uint8_t(c0);
+	out[1] = uint8_t(c0 >> 8);
+	out[2] = uint8_t(c1);
+	out[3] = uint8_t(c1 >> 8);
+	for (int i = 0; i < 4; i++)
+		out[4 + i] = uint8_t(bits >> (i * 8));
+}
+
+
+// single channel block, alpha of bc3 and each channel of bc5
+static void encodeBC4(const float texels[16][4], int channel, uint8_t* out) {
+	float single[16][4] = {};
+	float lo = 255.f, hi = 0.f;
+	for (int t = 0; t < 16; t++) {
+		single[t][0] = texels[t][channel];
+		lo = MIN(lo, single[t][0]);
+		hi = MAX(hi, single[t][0]);
+	}
+
+	// a0 > a1 selects 8 value mode
+	int a0 = int(hi + 0.5f);
+	int a1 = int(lo + 0.5f);
+	uint64_t bits = 0;
+	if (a0 > a1) {
+		BlockPalette_t palette = {};
+		palette.size = 8;
+		palette.channels[0][0] = float(a0);
+		palette.channels[0][1] = float(a1);
+		for (int i = 2; i < 8; i++)
+			palette.channels[0][i] = float(((8 - i) * a0 + (i - 1) * a1) / 7);
+
+		uint8_t indices[16];
+		nearestIndices(single, palette, 1, indices);
+		for (int t = 0; t < 16; t++)
+			bits |= uint64_t(indices[t]) << (t * 3);
+	}
+
+	out[0] = uint8_t(a0);
+	out[1] = uint8_t(a1);
+	for (int i = 0; i < 6; i++)
+		out[2 + i] = uint8_t(bits >> (i * 8));
+}
+
+
+// 7 bit endpoint plus shared p bit, p bit picked by smaller error over all channels
+static void quantizeBC7Endpoint(const float endpoint[4], int quantized[4], int& pBit) {
+	float bestError = FLT_MAX;
+	for (int p = 0; p < 2; p++) {
+		int q[4];
+		float error = 0.f;
+		for (int c = 0; c < 4; c++) {
+			q[c] = glm::clamp(int((endpoint[c] - p) * 0.5f + 0.5f), 0, 127);
+			float d = float((q[c] << 1) | p) - endpoint[c];
+			error += d * d;
+		}
+
+		if (error < bestError) {
+			bestError = error;
+			pBit = p;
+			memcpy(quantized, q, sizeof(q));
+		}
+	}
+}
+
+
+// mode 6 only: one subset, rgba endpoints & 4 bit indices
+static void encodeBC7(const float texels[16][4], uint8_t* out) {
+	float lo[4], hi[4];
+	principalEndpoints(texels, 4, lo, hi);
+
+	int e[2][4], p[2];
+	quantizeBC7Endpoint(lo, e[0], p[0]);
+	quantizeBC7Endpoint(hi, e[1], p[1]);
+
+	BlockPalette_t palette = {};
+	palette.size = 16;
+	for (int c = 0; c < 4; c++) {
+		int v0 = (e[0][c] << 1) | p[0];
+		int v1 = (e[1][c] << 1) | p[1];
+		for (int i = 0; i < 16; i++)
+			palette.channels[c][i] = float(((64 - s_bc7Weights4[i]) * v0 + s_bc7Weights4[i] * v1 + 32) >> 6);
+	}
+
+	uint8_t indices[16];
+	nearestIndices(texels, palette, 4, indices);
+
+	// anchor index has its top bit implied 0, flip the segment when it's set
+	if (indices[0] & 8) {
+		std::swap(e[0], e[1]);
+		std::swap(p[0], p[1]);
+		for (auto& index : indices)
+			index = uint8_t(15 - index);
+	}
+
+	BlockBitWriter writer(out, 16);
+	writer.put(1 << 6, 7);
+	for (int c = 0; c < 4; c++) {
+		writer.put(e[0][c], 7);
+		writer.put(e[1][c], 7);
+	}
+	writer.put(p[0], 1);
+	writer.put(p[1], 1);
+	writer.put(indices[0], 3);
+	for (int t = 1; t < 16; t++)
+		writer.put(indices[t], 4);
+}
+
+
+static void decodeBC1(const uint8_t* in, uint8_t texels[16][4]) {
+	uint16_t c0 = uint16_t(in[0] | (in[1] << 8));
+	uint16_t c1 = uint16_t(in[2] | (in[3] << 8));
+	uint32_t bits = uint32_t(in[4]) | (uint32_t(in[5]) << 8) | (uint32_t(in[6]) << 16) | (uint32_t(in[7]) << 24);
+
+	int p[4][4];
+	unpackRGB565(c0, p[0]);
+	unpackRGB565(c1, p[1]);
+	p[0][3] = p[1][3] = p[2][3] = p[3][3] = 255;
+	for (int c = 0; c < 3; c++) {
+		if (c0 > c1) {
+			p[2][c] = (2 * p[0][c] + p[1][c]) / 3;
+			p[3][c] = (p[0][c] + 2 * p[1][c]) / 3;
+		} else {
+			p[2][c] = (p[0][c] + p[1][c]) / 2;
+			p[3][c] = 0;
+		}
+	}
+	if (c0 <= c1)
+		p[3][3] = 0;
+
+	for (int t = 0; t < 16; t++) {
+		int index = (bits >> (t * 2)) & 3;
+		for (int c = 0; c < 4; c++)
+			texels[t][c] = uint8_t(p[index][c]);
+	}
+}
+
+
+static void decodeBC4(const uint8_t* in, int channel, uint8_t texels[16][4]) {
+	int a0 = in[0], a1 = in[1];
+	int p[8] = { a0, a1 };
+	for (int i = 2; i < 8; i++) {
+		if (a0 > a1)
+			p[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+		else
+			p[i] = i < 6 ? ((6 - i) * a0 + (i - 1) * a1) / 5 : (i == 6 ? 0 : 255);
+	}
+
+	uint64_t bits = 0;
+	for (int i = 0; i < 6; i++)
+		bits |= uint64_t(in[2 + i]) << (i * 8);
+
+	for (int t = 0; t < 16; t++)
+		texels[t][channel] = uint8_t(p[(bits >> (t * 3)) & 7]);
+}
+
+
+static bool decodeBC7(const uint8_t* in, uint8_t texels[16][4]) {
+	BlockBitReader reader(in);
+	if (reader.get(7) != (1 << 6))
+		return false;
+
+	int e[2][4], p[2];
+	for (int c = 0; c < 4; c++) {
+		e[0][c] = reader.get(7);
+		e[1][c] = reader.get(7);
+	}
+	p[0] = reader.get(1);
+	p[1] = reader.get(1);
+
+	for (int t = 0; t < 16; t++) {
+		int index = reader.get(t == 0 ? 3 : 4);
+		int w = s_bc7Weights4[index];
+		for (int c = 0; c < 4; c++) {
+			int v0 = (e[0][c] << 1) | p[0];
+			int v1 = (e[1][c] << 1) | p[1];
+			texels[t][c] = uint8_t(((64 - w) * v0 + w * v1 + 32) >> 6);
+		}
+	}
+
+	return true;
+}
+
+
+static void expandRGBA(const TextureImage_t& image, std::vector<uint8_t>& rgba) {
+	size_t numTexels = size_t(image.width) * image.height;
+	rgba.resize(numTexels * 4);
+	for (size_t i = 0; i < numTexels; i++) {
+		const uint8_t* src = image.pixels + i * image.numChannels;
+		uint8_t* dst = &rgba[i * 4];
+		switch (image.numChannels) {
+		case 1:
+			dst[0] = dst[1] = dst[2] = src[0];
+			dst[3] = 255;
+			break;
+		case 2:
+			dst[0] = dst[1] = dst[2] = src[0];
+			dst[3] = src[1];
+			break;
+		case 3:
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst[2] = src[2];
+			dst[3] = 255;
+			break;
+		default:
+			memcpy(dst, src, 4);
+			break;
+		}
+	}
+}
+
+
+// 2x2 box filter, odd edges repeat their last texel. normal map texels are renormalized
+static void downsample(const std::vector<uint8_t>& src, uint32_t width, uint32_t height, std::vector<uint8_t>& dst, uint32_t dstWidth, uint32_t dstHeight, bool isNormalMap) {
+	dst.resize(size_t(dstWidth) * dstHeight * 4);
+	for (uint32_t y = 0; y < dstHeight; y++) {
+		for (uint32_t x = 0; x < dstWidth; x++) {
+			uint32_t x0 = MIN(x * 2, width - 1), x1 = MIN(x * 2 + 1, width - 1);
+			uint32_t y0 = MIN(y * 2, height - 1), y1 = MIN(y * 2 + 1, height - 1);
+			float sum[4];
+			for (int c = 0; c < 4; c++) {
+				sum[c] = (float(src[(size_t(y0) * width + x0) * 4 + c]) + float(src[(size_t(y0) * width + x1) * 4 + c])
+					+ float(src[(size_t(y1) * width + x0) * 4 + c]) + float(src[(size_t(y1) * width + x1) * 4 + c])) * 0.25f;
+			}
+
+			if (isNormalMap) {
+				glm::vec3 n = glm::vec3(sum[0], sum[1], sum[2]) / 255.f * 2.f - 1.f;
+				float len = glm::length(n);
+				n = len > 1e-6f ? n / len : glm::vec3(0.f, 0.f, 1.f);
+				for (int c = 0; c < 3; c++)
+					sum[c] = (n[c] * 0.5f + 0.5f) * 255.f;
+			}
+
+			uint8_t* texel = &dst[(size_t(y) * dstWidth + x) * 4];
+			for (int c = 0; c < 4; c++)
+				texel[c] = uint8_t(glm::clamp(sum[c] + 0.5f, 0.f, 255.f));
+		}
+	}
+}
+
+
+static void encodeLevel(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, CookedTexture_t::BlockFormat format, uint8_t* out) {
+	size_t blockBytes = CookedTexture_t::blockBytes(format);
+	uint32_t blocksX = (width + 3) / 4;
+	uint32_t blocksY = (height + 3) / 4;
+	float texels[16][4];
+	for (uint32_t by = 0; by < blocksY; by++) {
+		for (uint32_t bx = 0; bx < blocksX; bx++, out += blockBytes) {
+			// blocks hanging over an edge repeat edge texels
+			for (int t = 0; t < 16; t++) {
+				uint32_t x = MIN(bx * 4 + t % 4, width - 1);
+				uint32_t y = MIN(by * 4 + t / 4, height - 1);
+				const uint8_t* texel = &rgba[(size_t(y) * width + x) * 4];
+				for (int c = 0; c < 4; c++)
+					texels[t][c] = float(texel[c]);
+			}
+
+			switch (format) {
+			case CookedTexture_t::BlockFormat::BC1:
+				encodeBC1(texels, out);
+				break;
+			case CookedTexture_t::BlockFormat::BC3:
+				encodeBC4(texels, 3, out);
+				encodeBC1(texels, out + 8);
+				break;
+			case CookedTexture_t::BlockFormat::BC5:
+				encodeBC4(texels, 0, out);
+				encodeBC4(texels, 1, out + 8);
+				break;
+			case CookedTexture_t::BlockFormat::BC7:
+				encodeBC7(texels, out);
+				break;
+			}
+		}
+	}
+}
+
+
+
+CookedTexture_t::CookedTexture_t() :format(BlockFormat::BC1)
+, width(0)
+, height(0)
+, levels()
+, storage()
+, file()
+, blocks(nullptr) {
+
+}
+
+
+void CookedTexture_t::release() {
+	levels.clear();
+	storage.clear();
+	file.reset();
+	blocks = nullptr;
+	width = 0;
+	height = 0;
+}
+
+
+size_t CookedTexture_t::uncompressedSize() const {
+	size_t size = 0;
+	for (const auto& level : levels)
+		size += size_t(level.width) * level.height * 4;
+	return size;
+}
+
+
+size_t CookedTexture_t::blockBytes(BlockFormat format) {
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+
+
+fs::path TextureCooker::cookedPath(const std::string& sourceFile) {
+	return fs::path(sourceFile + COOKED_TEXTURE_EXT);
+}
+
+
+CookedTexture_t::BlockFormat TextureCooker::chooseFormat(const TextureImage_t& image, const Options& options) {
+	if (options.isNormalMap)
+		return CookedTexture_t::BlockFormat::BC5;
+
+	if (options.quality == Quality::High)
+		return CookedTexture_t::BlockFormat::BC7;
+
+	bool hasAlpha = false;
+	if (image.numChannels == 2 || image.numChannels == 4) {
+		size_t numTexels = size_t(image.width) * image.height;
+		for (size_t i = 0; i < numTexels && !hasAlpha; i++)
+			hasAlpha = image.pixels[i * image.numChannels + image.numChannels - 1] < 255;
+	}
+
+	return hasAlpha ? CookedTexture_t::BlockFormat::BC3 : CookedTexture_t::BlockFormat::BC1;
+}
+
+
+bool TextureCooker::cook(const TextureImage_t& image, const Options& options, CookedTexture_t& cooked) {
+	return cook(image, chooseFormat(image, options), options.isNormalMap, cooked);
+}
+
+
+bool TextureCooker::cook(const TextureImage_t& image, CookedTexture_t::BlockFormat format, bool isNormalMap, CookedTexture_t& cooked) {
+	cooked.release();
+	if (!image.pixels || image.width <= 0 || image.height <= 0)
+		return false;
+
+	cooked.format = format;
+	cooked.width = uint32_t(image.width);
+	cooked.height = uint32_t(image.height);
+
+	// full chain down to 1x1
+	uint32_t w = cooked.width, h = cooked.height;
+	uint64_t offset = 0;
+	while (true) {
+		CookedTextureLevel_t level;
+		level.width = w;
+		level.height = h;
+		level.offset = offset;
+		level.size = uint64_t((w + 3) / 4) * ((h + 3) / 4) * CookedTexture_t::blockBytes(format);
+		cooked.levels.push_back(level);
+		offset += level.size;
+
+		if (w == 1 && h == 1)
+			break;
+		w = MAX(w / 2, 1u);
+		h = MAX(h / 2, 1u);
+	}
+
+	cooked.storage.resize(size_t(offset));
+	cooked.blocks = cooked.storage.data();
+
+	std::vector<uint8_t> rgba, next;
+	expandRGBA(image, rgba);
+	for (size_t i = 0; i < cooked.levels.size(); i++) {
+		const CookedTextureLevel_t& level = cooked.levels[i];
+		if (i > 0) {
+			const CookedTextureLevel_t& prev = cooked.levels[i - 1];
+			downsample(rgba, prev.width, prev.height, next, level.width, level.height, isNormalMap);
+			rgba.swap(next);
+		}
+		encodeLevel(rgba, level.width, level.height, format, cooked.storage.data() + level.offset);
+	}
+
+	return true;
+}
+
+
+bool TextureCooker::read(const fs::path& cookedFile, const std::string& sourceFile, const Options& options, CookedTexture_t& cooked) {
+	cooked.release();
+	uint64_t sourceSize = 0;
+	int64_t sourceTime = 0;
+	if (!FileSystem::Default.fileStamp(sourceFile, sourceSize, sourceTime))
+		return false;
+
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (!file->open(cookedFile) || file->size() < sizeof(CookedTextureHeader_t))
+		return false;
+
+	CookedTextureHeader_t header;
+	memcpy(&header, file->data(), sizeof(header));
+	if (header.magic != COOKED_TEXTURE_MAGIC
+		|| header.version != COOKED_TEXTURE_VERSION
+		|| header.sourceSize != sourceSize
+		|| header.sourceTime != sourceTime
+		|| header.options != cookOptions(options)
+		|| header.format > uint32_t(CookedTexture_t::BlockFormat::BC7)
+		|| header.numLevels == 0)
+		return false;
+
+	size_t tableSize = sizeof(CookedTextureLevel_t) * header.numLevels;
+	size_t dataOffset = (sizeof(header) + tableSize + COOKED_TEXTURE_ALIGNMENT - 1) / COOKED_TEXTURE_ALIGNMENT * COOKED_TEXTURE_ALIGNMENT;
+	if (header.numLevels > 32 || dataOffset > file->size())
+		return false;
+
+	cooked.levels.resize(header.numLevels);
+	memcpy(cooked.levels.data(), file->data() + sizeof(header), tableSize);
+
+	uint64_t dataSize = file->size() - dataOffset;
+	for (const auto& level : cooked.levels) {
+		if (level.offset > dataSize || level.size > dataSize - level.offset) {
+			cooked.release();
+			return false;
+		}
+	}
+
+	cooked.format = CookedTexture_t::BlockFormat(header.format);
+	cooked.width = header.width;
+	cooked.height = header.height;
+	cooked.blocks = file->data() + dataOffset;
+	cooked.file = file;
+
+	return true;
+}
+
+
+bool TextureCooker::write(const fs::path& cookedFile, const std::string& sourceFile, const Options& options, const CookedTexture_t& cooked) {
+	CookedTextureHeader_t header;
+	memset(&header, 0, sizeof(header));
+	if (!cooked.isValid() || !FileSystem::Default.fileStamp(sourceFile, header.sourceSize, header.sourceTime))
+		return false;
+
+	header.magic = COOKED_TEXTURE_MAGIC;
+	header.version = COOKED_TEXTURE_VERSION;
+	header.options = cookOptions(options);
+	header.format = uint32_t(cooked.format);
+	header.width = cooked.width;
+	header.height = cooked.height;
+	header.numLevels = uint32_t(cooked.levels.size());
+
+	size_t tableSize = sizeof(CookedTextureLevel_t) * cooked.levels.size();
+	size_t dataOffset = (sizeof(header) + tableSize + COOKED_TEXTURE_ALIGNMENT - 1) / COOKED_TEXTURE_ALIGNMENT * COOKED_TEXTURE_ALIGNMENT;
+	static const char zeros[COOKED_TEXTURE_ALIGNMENT] = {};
+
+	// written aside and renamed, a reader never maps a half written file
+	fs::path tempFile = cookedFile;
+	tempFile += ".tmp";
+	{
+		std::ofstream stream(tempFile, std::ios::binary | std::ios::trunc);
+		if (!stream)
+			return false;
+
+		stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		stream.write(reinterpret_cast<const char*>(cooked.levels.data()), tableSize);
+		stream.write(zeros, dataOffset - sizeof(header) - tableSize);
+		stream.write(reinterpret_cast<const char*>(cooked.blocks), cooked.size());
+		if (!stream)
+			return false;
+	}
+
+	std::error_code error;
+	fs::rename(tempFile, cookedFile, error);
+	if (error) {
+		fs::remove(tempFile, error);
+		return false;
+	}
+
+	return true;
+}
+
+
+bool TextureCooker::load(const std::string& sourceFile, const Options& options, CookedTexture_t& cooked) {
+	fs::path cookedFile = cookedPath(sourceFile);
+	if (read(cookedFile, sourceFile, options, cooked))
+		return true;
+
+	TextureImage_t image;
+	if (!Texture::decodeImage(sourceFile, image, options.flipUV) || !cook(image, options, cooked))
+		return false;
+
+	if (!write(cookedFile, sourceFile, options, cooked)) {
+#ifdef _DEBUG
+		std::cerr << "[Texture Cook warning] Failed to write cooked texture: \"" << cookedFile.string() << "\"" << std::endl;
+#endif // _DEBUG
+	}
+
+	return true;
+}
+
+
+bool TextureCooker::decode(const CookedTexture_t& cooked, size_t level, std::vector<uint8_t>& rgba) {
+	if (!cooked.isValid() || level >= cooked.levels.size())
+		return false;
+
+	const CookedTextureLevel_t& info = cooked.levels[level];
+	size_t blockBytes = CookedTexture_t::blockBytes(cooked.format);
+	uint32_t blocksX = (info.width + 3) / 4;
+	uint32_t blocksY = (info.height + 3) / 4;
+	const uint8_t* in = cooked.blocks + info.offset;
+	rgba.resize(size_t(info.width) * info.height * 4);
+
+	for (uint32_t by = 0; by < blocksY; by++) {
+		for (uint32_t bx = 0; bx < blocksX; bx++, in += blockBytes) {
+			uint8_t texels[16][4] = {};
+			switch (cooked.format) {
+			case CookedTexture_t::BlockFormat::BC1:
+				decodeBC1(in, texels);
+				break;
+			case CookedTexture_t::BlockFormat::BC3:
+				decodeBC1(in + 8, texels);
+				decodeBC4(in, 3, texels);
+				break;
+			case CookedTexture_t::BlockFormat::BC5:
+				decodeBC4(in, 0, texels);
+				decodeBC4(in + 8, 1, texels);
+				for (auto& texel : texels) {
+					float x = texel[0] / 255.f * 2.f - 1.f, y = texel[1] / 255.f * 2.f - 1.f;
+					texel[2] = uint8_t((sqrtf(MAX(1.f - x * x - y * y, 0.f)) * 0.5f + 0.5f) * 255.f + 0.5f);
+					texel[3] = 255;
+				}
+				break;
+			case CookedTexture_t::BlockFormat::BC7:
+				if (!decodeBC7(in, texels))
+					return false;
+				break;
+			}
+
+			for (int t = 0; t < 16; t++) {
+				uint32_t x = bx * 4 + t % 4;
+				uint32_t y = by * 4 + t / 4;
+				if (x < info.width && y < info.height)
+					memcpy(&rgba[(size_t(y) * info.width + x) * 4], texels[t], 4);
+			}
+		}
+	}
+
+	return true;
+}
+
+
+uint32_t TextureCooker::cookOptions(const Options& options) {
+	return (options.flipUV ? COOK_OPTION_FLIP_UV : 0)
+		| (options.isNormalMap ? COOK_OPTION_NORMAL_MAP : 0)
+		| (options.quality == Quality::High ? COOK_OPTION_HIGH_QUALITY : 0);
+}
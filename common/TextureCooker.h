@@ -0,0 +1,127 @@
+#pragma once
+#include"FileSystem.h"
+#include<cstdint>
+#include<memory>
+#include<string>
+#include<vector>
+
+
+// cooked file sits next to its source, "wall.jpg" -> "wall.jpg.ctex"
+#define COOKED_TEXTURE_EXT ".ctex"
+#define COOKED_TEXTURE_MAGIC 0x58455443u // "CTEX"
+#define COOKED_TEXTURE_VERSION 1u
+
+// level blocks start at multiples of it
+#define COOKED_TEXTURE_ALIGNMENT 16
+
+
+struct TextureImage_t;
+
+
+struct CookedTextureHeader_t {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t sourceSize; // cooked file is stale when source size, time or cook options differ
+	int64_t sourceTime;
+	uint32_t options;
+	uint32_t format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t numLevels;
+	uint32_t reserved;
+};
+
+
+struct CookedTextureLevel_t {
+	uint32_t width;
+	uint32_t height;
+	uint64_t offset; // from first level
+	uint64_t size;
+};
+
+
+//
+// block compressed mip chain, blocks either owned or pointing into a mapped cooked file
+//
+struct CookedTexture_t {
+	enum class BlockFormat {
+		BC1, // rgb, 4 bits per texel
+		BC3, // rgba, 8 bits per texel
+		BC5, // two channel normal map, z is rebuilt in shader
+		BC7, // rgba high quality, 8 bits per texel
+	};
+
+	BlockFormat format;
+	uint32_t width;
+	uint32_t height;
+	std::vector<CookedTextureLevel_t> levels;
+	std::vector<uint8_t> storage;
+	std::shared_ptr<const MappedFile> file;
+	const uint8_t* blocks;
+
+	CookedTexture_t();
+
+	CookedTexture_t(const CookedTexture_t& other) = delete;
+	CookedTexture_t& operator = (const CookedTexture_t& other) = delete;
+
+	void release();
+
+	inline bool isValid() const {
+		return blocks != nullptr && !levels.empty();
+	}
+
+	// all levels
+	inline size_t size() const {
+		return levels.empty() ? 0 : size_t(levels.back().offset + levels.back().size);
+	}
+
+	// same mip chain as rgba8, what the texture would take uncompressed
+	size_t uncompressedSize() const;
+
+	static size_t blockBytes(BlockFormat format);
+};
+
+
+//
+// cpu texture compression, runs without gl so it can cook on build machines.
+// a source image gets a box filtered mip chain, then every level is encoded into 4x4 blocks:
+// bc1 for opaque color, bc3 or bc7 with alpha (bc7 for high quality color), bc5 for normal maps.
+// endpoints come from principal axis of a block, indices from nearest palette entry, searched 4 entries at a time with sse.
+//
+class TextureCooker {
+public:
+	enum class Quality {
+		Fast, // bc1/bc3
+		High, // bc7 for color
+	};
+
+	struct Options {
+		bool flipUV;
+		bool isNormalMap;
+		Quality quality;
+
+		Options(bool flip = true, bool normalMap = false, Quality q = Quality::Fast) : flipUV(flip), isNormalMap(normalMap), quality(q) {}
+	};
+
+public:
+	static fs::path cookedPath(const std::string& sourceFile);
+
+	// pick format, build mip chain & encode it
+	static bool cook(const TextureImage_t& image, const Options& options, CookedTexture_t& cooked);
+	static bool cook(const TextureImage_t& image, CookedTexture_t::BlockFormat format, bool isNormalMap, CookedTexture_t& cooked);
+
+	// false if there is no up to date cooked file for source & options
+	static bool read(const fs::path& cookedFile, const std::string& sourceFile, const Options& options, CookedTexture_t& cooked);
+	static bool write(const fs::path& cookedFile, const std::string& sourceFile, const Options& options, const CookedTexture_t& cooked);
+
+	// read cooked file, otherwise decode source, cook it & write cooked file
+	static bool load(const std::string& sourceFile, const Options& options, CookedTexture_t& cooked);
+
+	// expand one level back to rgba8, for checking encoder error
+	static bool decode(const CookedTexture_t& cooked, size_t level, std::vector<uint8_t>& rgba);
+
+	static CookedTexture_t::BlockFormat chooseFormat(const TextureImage_t& image, const Options& options);
+
+protected:
+	static uint32_t cookOptions(const Options& options);
+};
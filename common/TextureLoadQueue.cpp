@@ -0,0 +1,190 @@
+#include"TextureLoadQueue.h"
+#include"Buffer.h"
+#include"Profiler.h"
+#include"Util.h"
+#include<cstring>
+
+
+TextureLoadQueue::TextureLoadQueue() :m_threads()
+, m_mutex()
+, m_wakeCondition()
+, m_queued()
+, m_decoded()
+, m_numInFlight(0)
+, m_isQuit(false)
+, m_staging(nullptr) {
+
+}
+
+
+TextureLoadQueue::~TextureLoadQueue() {
+	shutdown();
+}
+
+
+void TextureLoadQueue::load(std::weak_ptr<Texture> placeholder, const std::string& file, const TextureCooker::Options& options, bool isCompressed) {
+	std::unique_ptr<Request> request(new Request());
+	request->texture = placeholder;
+	request->file = file;
+	request->options = options;
+	request->isCompressed = isCompressed;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isQuit = false;
+		m_queued.push_back(std::move(request));
+		m_numInFlight++;
+
+		// threads start with first request, apps never loading in background pay nothing
+		while (m_threads.size() < TEXTURE_DECODER_THREADS)
+			m_threads.emplace_back(&TextureLoadQueue::decoderLoop, this);
+	}
+	m_wakeCondition.notify_one();
+}
+
+
+void TextureLoadQueue::update(double budgetMs) {
+	if (m_numInFlight == 0)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_decoded.empty())
+			return;
+	}
+
+	PROFILE_SCOPE("TextureLoadQueue::update");
+	auto start = Profiler::Clock::now();
+
+	if (!m_staging) {
+		m_staging.reset(new RingBuffer());
+		if (!m_staging->initialize(TEXTURE_STAGING_REGION_SIZE))
+			m_staging.reset(nullptr);
+	}
+
+	if (m_staging)
+		m_staging->beginFrame();
+
+	// at least one image per frame even if budget is already gone, so every load makes progress
+	while (true) {
+		std::unique_ptr<Request> request;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_decoded.empty())
+				break;
+			request = std::move(m_decoded.front());
+			m_decoded.pop_front();
+		}
+
+		if (!upload(*request)) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_decoded.push_front(std::move(request));
+			break;
+		}
+
+		m_numInFlight--;
+		if (std::chrono::duration<double, std::milli>(Profiler::Clock::now() - start).count() >= budgetMs)
+			break;
+	}
+
+	if (m_staging)
+		m_staging->endFrame();
+}
+
+
+void TextureLoadQueue::shutdown() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_isQuit = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (auto& t : m_threads)
+		t.join();
+
+	m_threads.clear();
+	m_queued.clear();
+	m_decoded.clear();
+	m_numInFlight = 0;
+	m_staging.reset(nullptr);
+}
+
+
+void TextureLoadQueue::decoderLoop() {
+	while (true) {
+		std::unique_ptr<Request> request;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCondition.wait(lock, [this]() { return m_isQuit || !m_queued.empty(); });
+			if (m_isQuit)
+				return;
+			request = std::move(m_queued.front());
+			m_queued.pop_front();
+		}
+
+		// texture removed while queued, nothing to decode for
+		if (!request->texture.expired()) {
+			bool isDecoded = request->isCompressed ? TextureCooker::load(request->file, request->options, request->cooked)
+				: Texture::decodeImage(request->file, request->image, request->options.flipUV);
+			if (!isDecoded)
+				std::cerr << "[Texture Load error] Failed to decode texture: \"" << request->file << "\", fallback kept" << std::endl;
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_decoded.push_back(std::move(request));
+	}
+}
+
+
+bool TextureLoadQueue::upload(Request& request) {
+	auto texture = request.texture.lock();
+	if (!texture)
+		return true;
+
+	// failed decode keeps fallback texel, texture is marked so materials using it can tell
+	bool isCompressed = request.cooked.isValid();
+	if (!isCompressed && !request.image.pixels) {
+		texture->m_file = request.file;
+		texture->m_isLoadFailed = true;
+		return true;
+	}
+
+	size_t size = isCompressed ? request.cooked.size() : request.image.size();
+	size_t offset = 0;
+	void* staged = m_staging ? m_staging->allocate(size, offset) : nullptr;
+	if (!staged && m_staging && size <= m_staging->getRegionSize() && m_staging->getBytesStreamed() > 0)
+		return false;
+
+	if (isCompressed) {
+		if (staged)
+			memcpy(staged, request.cooked.blocks, size);
+		texture->loadCompressedImage2D(request.cooked, staged ? m_staging.get() : nullptr, offset);
+		texture->m_file = request.file;
+
+		size_t uncompressed = request.cooked.uncompressedSize();
+		Profiler::getInstance()->addCounter("TextureLoad::savedBytes", double(uncompressed - size));
+#ifdef _DEBUG
+		std::cout << "[Texture] " << request.file << ": " << (size / 1024) << "KB compressed, " << ((uncompressed - size) / 1024) << "KB saved" << std::endl;
+#endif // _DEBUG
+	} else {
+		const TextureImage_t& image = request.image;
+
+		// rows of stbi images are tightly packed
+		GLCALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+		if (staged) {
+			memcpy(staged, image.pixels, size);
+			Texture::Format fmt = Texture::getGenericFormat(image.numChannels);
+			texture->loadImage2DFromBuffer(m_staging.get(), fmt, fmt, Texture::FormatDataType::UByte, image.width, image.height, offset, true);
+			texture->m_file = image.file;
+		} else {
+			texture->loadImage2DFromImage(image, true);
+		}
+		GLCALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+	}
+
+	Profiler::getInstance()->addCounter("TextureLoad::uploadedBytes", double(size));
+	request.image.release();
+	request.cooked.release();
+
+	return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include"Texture.h"
+#include"TextureCooker.h"
+#include<atomic>
+#include<condition_variable>
+#include<deque>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+
+// images decoding at the same time
+#define TEXTURE_DECODER_THREADS 4
+
+// main thread time per frame spent uploading decoded images
+#define TEXTURE_UPLOAD_BUDGET_MS 2.0
+
+// pixel unpack staging per frame, 16mb takes one 2k rgba image (or a 4k bc3 chain). larger images upload straight from client memory
+#define TEXTURE_STAGING_REGION_SIZE (16 * 1024 * 1024)
+
+
+class RingBuffer;
+
+
+//
+// two stage texture loading.
+// decoder threads run stbi decode of queued files, or read their cooked block compressed file (cooking it first if missing).
+// main thread copies decoded pixels/blocks into a persistently mapped pixel unpack ring in update() within a time budget,
+// texture storage is then sourced from the ring so the driver never blocks on a client memory copy.
+// textures are placeholders owned by texture manager, they are refilled in place once their image is uploaded.
+//
+class TextureLoadQueue {
+public:
+	TextureLoadQueue();
+	~TextureLoadQueue();
+
+	TextureLoadQueue(const TextureLoadQueue& other) = delete;
+	TextureLoadQueue& operator = (const TextureLoadQueue& other) = delete;
+
+	// compressed loads take baked mip chain of the cooked file, raw loads generate mipmaps on upload
+	void load(std::weak_ptr<Texture> placeholder, const std::string& file, const TextureCooker::Options& options, bool isCompressed = true);
+	void update(double budgetMs = TEXTURE_UPLOAD_BUDGET_MS); // main thread
+	void shutdown(); // drop queued requests, wait decodes in flight, release staging ring
+
+	inline size_t numInFlight() const {
+		return m_numInFlight.load(std::memory_order_acquire);
+	}
+
+protected:
+	struct Request {
+		std::weak_ptr<Texture> texture;
+		std::string file;
+		TextureCooker::Options options;
+		bool isCompressed;
+		TextureImage_t image;
+		CookedTexture_t cooked;
+	};
+
+	void decoderLoop();
+	bool upload(Request& request); // false if staging region of this frame is full
+
+private:
+	std::vector<std::thread> m_threads;
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::deque<std::unique_ptr<Request>> m_queued; // waiting for a decoder thread
+	std::deque<std::unique_ptr<Request>> m_decoded; // waiting for main thread upload
+	std::atomic<size_t> m_numInFlight;
+	bool m_isQuit;
+
+	std::unique_ptr<RingBuffer> m_staging;
+};
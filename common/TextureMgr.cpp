@@ -2,7 +2,20 @@
 #include"Util.h"
 
 
-std::weak_ptr<Texture> TextureManager::addTexture(const std::string& fileName, std::string name) {
+TextureManager::TextureManager() :m_textures()
+, m_isAsyncLoading(true)
+, m_isCompressed(true)
+, m_loadQueue() {
+
+}
+
+
+TextureManager::~TextureManager() {
+	m_loadQueue.shutdown();
+}
+
+
+std::weak_ptr<Texture> TextureManager::addTexture(const std::string& fileName, std::string name, Fallback fallback) {
 	if (name.empty())
 		name = ExtractFileNameFromPath(fileName);
 
@@ -15,14 +28,44 @@ std::weak_ptr<Texture> TextureManager::addTexture(const std::string& fileName, s
 		return std::weak_ptr<Texture>();
 
 	auto texture = std::make_shared<Texture>();
-	if (!texture->loadImage2DFromFile(imagePath.second))
-		return std::weak_ptr<Texture>();
+	TextureCooker::Options options(true, fallback == Fallback::FlatNormal);
+	if (m_isAsyncLoading) {
+		loadFallback(texture.get(), fallback);
+		m_loadQueue.load(texture, imagePath.second, options, m_isCompressed);
+	} else {
+		// synchronous loads take a cooked file when present but never cook on the calling thread
+		CookedTexture_t cooked;
+		bool isLoaded = false;
+		if (m_isCompressed && TextureCooker::read(TextureCooker::cookedPath(imagePath.second), imagePath.second, options, cooked))
+			isLoaded = texture->loadCompressedImage2D(cooked);
+		else
+			isLoaded = texture->loadImage2DFromFile(imagePath.second);
+
+		if (!isLoaded)
+			return std::weak_ptr<Texture>();
+	}
 
 	m_textures.insert(std::make_pair(name, texture));
 	
 	return std::weak_ptr<Texture>(texture);
 }
 
+void TextureManager::updateLoading(double budgetMs) {
+	m_loadQueue.update(budgetMs);
+}
+
+
+void TextureManager::loadFallback(Texture* texture, Fallback fallback) {
+	static const uint8_t texels[][4] = {
+		{ 255, 255, 255, 255 }, // White
+		{ 0, 0, 0, 255 }, // Black
+		{ 128, 128, 255, 255 }, // FlatNormal, +z in tangent space
+	};
+
+	texture->loadImage2DFromMemory(Texture::Format::RGBA, Texture::Format::RGBA, Texture::FormatDataType::UByte, 1, 1, texels[int(fallback)]);
+}
+
+
 std::weak_ptr<Texture> TextureManager::getTexture(const std::string& name) const {
 	auto pos = m_textures.find(name);
 	if (pos != m_textures.end())
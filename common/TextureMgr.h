@@ -2,15 +2,31 @@
 #include"Singleton.h"
 #include"Texture.h"
 #include"FileSystem.h"
+#include"TextureLoadQueue.h"
 #include<unordered_map>
 #include<string>
 #include<memory>
 
 
+//
+// textures are loaded in background by default, addTexture() returns at once with a 1x1 fallback texture
+// which is refilled in place when its image is uploaded, so weak pointers handed out early stay valid.
+//
 class TextureManager : public Singleton<TextureManager> {
 public:
+	// texel shown until image is ready, neutral for the map it stands in for.
+	// FlatNormal also marks a normal map, it is cooked into two channel blocks
+	enum class Fallback {
+		White,
+		Black,
+		FlatNormal,
+	};
 
-	std::weak_ptr<Texture> addTexture(const std::string& fileName, std::string name = "");
+public:
+	TextureManager();
+	~TextureManager();
+
+	std::weak_ptr<Texture> addTexture(const std::string& fileName, std::string name = "", Fallback fallback = Fallback::White);
 	std::weak_ptr<Texture> getTexture(const std::string& name) const;
 	bool removeTexture(const std::string& name);
 	bool hasTexture(const std::string& name) const;
@@ -19,6 +35,30 @@ public:
 		m_textures.clear();
 	}
 
+	void updateLoading(double budgetMs = TEXTURE_UPLOAD_BUDGET_MS); // main thread, once per frame
+
+	// synchronous loading decodes & uploads inside addTexture()
+	inline void setAsyncLoading(bool isAsync) {
+		m_isAsyncLoading = isAsync;
+	}
+
+	inline bool isAsyncLoading() const {
+		return m_isAsyncLoading;
+	}
+
+	// compressed textures come from cooked block compressed files, missing ones are cooked by background loading
+	inline void setCompression(bool isCompressed) {
+		m_isCompressed = isCompressed;
+	}
+
+	inline bool isCompression() const {
+		return m_isCompressed;
+	}
+
+	inline size_t numLoading() const {
+		return m_loadQueue.numInFlight();
+	}
+
 	inline size_t textureCount() const {
 		return m_textures.size();
 	}
@@ -26,7 +66,13 @@ public:
 
 	std::pair<bool, std::string> getResourcePath(const std::string& fileName) const;
 
+protected:
+	static void loadFallback(Texture* texture, Fallback fallback);
+
 private:
 	std::unordered_map<std::string, std::shared_ptr<Texture>> m_textures;
+	bool m_isAsyncLoading;
+	bool m_isCompressed;
+	TextureLoadQueue m_loadQueue; // last member, decoder threads stop before textures go away
 };
 
@@ -7,65 +7,50 @@
 
 RTTI_IMPLEMENTATION(TransformComponent)
 
-TransformComponent::TransformComponent(SceneObject* owner) :m_position(glm::vec3(0))
-, m_rotation(glm::vec3(0))
-, m_scale(glm::vec3(1))
-, m_rightAxis(Local_Right_Axis)
-, m_upAxis(Local_Up_Axis)
-, m_forwardAxis(Local_Forward_Axis)
-, m_matrix(glm::mat4(1.f)) {
+TransformComponent::TransformComponent(SceneObject* owner) :m_system(TransformSystem::detached())
+, m_handle(INVALID_TRANSFORM_HANDLE) {
 	m_owner = owner;
+	m_handle = m_system->create();
 }
 
 TransformComponent::TransformComponent(SceneObject* owner, const glm::vec3& pos, const glm::vec3& rotate, const glm::vec3& scale)
 : TransformComponent(owner) {
-	m_position = pos;
-	m_rotation = rotate;
-	m_scale = scale;
-	calcTransform();
+	setTRS(pos, rotate, scale);
+}
+
+TransformComponent::~TransformComponent() {
+	m_system->destroy(m_handle);
 }
 
 TransformComponent& TransformComponent::operator = (const TransformComponent& other) {
-	m_position = other.m_position;
-	m_rotation = other.m_rotation;
-	m_scale = other.m_rotation;
-	m_rightAxis = other.m_rightAxis;
-	m_upAxis = other.m_upAxis;
-	m_forwardAxis = other.m_forwardAxis;
-	m_matrix = other.m_matrix;
+	setTRS(other.getPosition(), other.getRotation(), other.getScale());
 	
 	return *this;
 }
 
 
 void TransformComponent::setPosition(const glm::vec3& pos) {
-	m_position = pos;
-	calcTransform();
+	setTRS(pos, getRotation(), getScale());
 }
 
 void TransformComponent::setRotation(const glm::vec3& rotate) {
-	m_rotation = rotate;
-	calcTransform();
+	setTRS(getPosition(), rotate, getScale());
 }
 
 void TransformComponent::setScale(const glm::vec3& scale) {
-	m_scale = scale;
-	calcTransform();
+	setTRS(getPosition(), getRotation(), scale);
 }
 
 void TransformComponent::translateBy(const glm::vec3& t) {
-	m_position += t;
-	calcTransform();
+	setTRS(getPosition() + t, getRotation(), getScale());
 }
 
 void TransformComponent::rotateBy(const glm::vec3& r) {
-	m_rotation += r;
-	calcTransform();
+	setTRS(getPosition(), getRotation() + r, getScale());
 }
 
 void TransformComponent::scaleBy(const glm::vec3& s) {
-	m_scale += s;
-	calcTransform();
+	setTRS(getPosition(), getRotation(), getScale() + s);
 }
 
 
@@ -85,13 +70,7 @@ void TransformComponent::lookAt(const glm::vec3& dir, const glm::vec3& up) {
 
 
 void TransformComponent::resetTransform() {
-	m_position = glm::vec3(0.f);
-	m_rotation = glm::vec3(0.f);
-	m_scale = glm::vec3(1.f);
-	m_rightAxis = Local_Right_Axis;
-	m_upAxis = Local_Up_Axis;
-	m_forwardAxis = Local_Forward_Axis;
-	m_matrix = glm::mat4(1.f);
+	setTRS(glm::vec3(0.f), glm::vec3(0.f), glm::vec3(1.f));
 }
 
 
@@ -101,40 +80,42 @@ Component* TransformComponent::copy() const {
 
 
 glm::vec3 TransformComponent::getForward() const {
-	return m_forwardAxis;
+	glm::vec3 forward;
+	calcLocalAxes(getMatrix(), nullptr, nullptr, &forward);
+	return forward;
 }
 
 glm::vec3 TransformComponent::getUp() const {
-	return m_upAxis;
+	glm::vec3 up;
+	calcLocalAxes(getMatrix(), nullptr, &up, nullptr);
+	return up;
 }
 
 glm::vec3 TransformComponent::getRight() const {
-	return m_rightAxis;
+	glm::vec3 right;
+	calcLocalAxes(getMatrix(), &right, nullptr, nullptr);
+	return right;
 }
 
 
 void TransformComponent::getCartesianAxesLocal(glm::vec3* origin, glm::vec3* xAxis, glm::vec3* yAxis, glm::vec3* zAxis) const {
 	if (origin)
-		*origin = m_position;
-	if (xAxis)
-		*xAxis = m_rightAxis;
-	if (yAxis)
-		*yAxis = m_upAxis;
-	if (zAxis)
-		*zAxis = m_forwardAxis;
+		*origin = getPosition();
+	calcLocalAxes(getMatrix(), xAxis, yAxis, zAxis);
 }
 
 void TransformComponent::getCartesianAxesWorld(glm::vec3* origin, glm::vec3* xAxis, glm::vec3* yAxis, glm::vec3* zAxis) const {
 	glm::mat4 parentTransform = getParentMatrixRecursive();
 	if (origin)
-		*origin = parentTransform * glm::vec4(m_position, 1.f);
+		*origin = parentTransform * glm::vec4(getPosition(), 1.f);
 
 	if (xAxis || yAxis || zAxis) {
 		glm::vec3 right(0);
 		glm::vec3 up(0);
 		glm::vec3 forward(0);
-		right = glm::normalize(glm::mat3(parentTransform) * m_rightAxis);
-		up = glm::normalize(glm::mat3(parentTransform) * m_upAxis);
+		calcLocalAxes(getMatrix(), &right, &up, nullptr);
+		right = glm::normalize(glm::mat3(parentTransform) * right);
+		up = glm::normalize(glm::mat3(parentTransform) * up);
 		forward = glm::normalize(glm::cross(up, right));
 		up = glm::normalize(glm::cross(right, forward));
 
@@ -149,11 +130,11 @@ void TransformComponent::getCartesianAxesWorld(glm::vec3* origin, glm::vec3* xAx
 
 
 glm::mat4 TransformComponent::getMatrix() const {
-	return   m_matrix;
+	return m_system->getLocalMatrix(m_handle);
 }
 
 glm::mat4 TransformComponent::getMatrixWorld() const {
-	return getParentMatrixRecursive() * getMatrix();
+	return m_system->getWorldMatrix(m_handle);
 }
 
 glm::mat4 TransformComponent::getParentMatrix() const {
@@ -173,32 +154,60 @@ glm::mat4 TransformComponent::getParentMatrixRecursive() const {
 	ASSERT(m_owner != nullptr);
 #endif // _DEBUG
 
-	glm::mat4 m(1);
 	SceneObject* parent = m_owner->getParent();
-	while (parent) {
-		m = parent->m_transform.getMatrix() * m;
-		parent = parent->getParent();
-	}
-	
-	return m;
+	if (parent)
+		return parent->m_transform.getMatrixWorld();
+
+	return glm::mat4(1);
 }
 
-void TransformComponent::calcTransform() {
-	glm::mat4 m(1);
-	m = glm::translate(m, m_position);
-	m = glm::rotate(m, glm::radians(m_rotation.z), World_Z_Axis);
-	m = glm::rotate(m, glm::radians(m_rotation.y), World_Y_Axis);
-	m = glm::rotate(m, glm::radians(m_rotation.x), World_X_Axis);
-	//m = glm::yawPitchRoll(glm::radians(m_rotation.y), glm::radians(m_rotation.x), glm::radians(m_rotation.z)) * m;
-	m = glm::scale(m, m_scale);
-	m_matrix = m;
+void TransformComponent::setTRS(const glm::vec3& pos, const glm::vec3& rotate, const glm::vec3& scale) {
+	m_system->setTRS(m_handle, pos, rotate, scale);
+}
 
-	updateLocalAxes();
+void TransformComponent::onParentChanged() {
+#ifdef _DEBUG
+	ASSERT(m_owner != nullptr);
+#endif // _DEBUG
+
+	SceneObject* parent = m_owner->getParent();
+	moveToSystem(parent ? parent->m_transform.m_system : TransformSystem::detached());
+	m_system->setParent(m_handle, parent ? parent->m_transform.m_handle : INVALID_TRANSFORM_HANDLE);
+}
+
+void TransformComponent::moveToSystem(TransformSystem* system) {
+	if (m_system == system)
+		return;
+
+	glm::vec3 pos = getPosition();
+	glm::vec3 rotate = getRotation();
+	glm::vec3 scale = getScale();
+	m_system->destroy(m_handle);
+
+	m_system = system;
+	m_handle = m_system->create();
+	setTRS(pos, rotate, scale);
+
+	if (!m_owner)
+		return;
+
+	for (size_t i = 0; i < m_owner->childCount(); i++) {
+		auto& child = m_owner->childAt(i)->m_transform;
+		child.moveToSystem(system);
+		m_system->setParent(child.m_handle, m_handle);
+	}
 }
 
-void TransformComponent::updateLocalAxes() {
-	m_rightAxis = glm::normalize(glm::mat3(m_matrix) * World_X_Axis);
-	m_upAxis = glm::normalize(glm::mat3(m_matrix) * World_Y_Axis);
-	m_forwardAxis = glm::normalize(glm::cross(m_upAxis, m_rightAxis));
-	m_upAxis = glm::normalize(glm::cross(m_rightAxis, m_forwardAxis));
+void TransformComponent::calcLocalAxes(const glm::mat4& m, glm::vec3* right, glm::vec3* up, glm::vec3* forward) {
+	glm::vec3 r = glm::normalize(glm::mat3(m) * World_X_Axis);
+	glm::vec3 u = glm::normalize(glm::mat3(m) * World_Y_Axis);
+	glm::vec3 f = glm::normalize(glm::cross(u, r));
+	u = glm::normalize(glm::cross(r, f));
+
+	if (right)
+		*right = r;
+	if (up)
+		*up = u;
+	if (forward)
+		*forward = f;
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include"Component.h"
 #include"Util.h"
+#include"TransformSystem.h"
 #include<glm/glm.hpp>
 
 
@@ -13,11 +14,13 @@
 
 class SceneObject;
 class CameraComponent;
+class Scene;
 
 
 class TransformComponent : public Component {
 	friend class SceneObject;
 	friend class CameraComponent;
+	friend class Scene;
 
 	RTTI_DECLARATION(TransformComponent)
 
@@ -26,6 +29,8 @@ protected:
 	TransformComponent(SceneObject* owner, const glm::vec3& pos, const glm::vec3& rotate, const glm::vec3& scale);
 
 public:
+	~TransformComponent();
+
 	TransformComponent() = delete;
 	TransformComponent(const TransformComponent& other) = delete;
 	TransformComponent(TransformComponent&& rv) = delete;
@@ -71,34 +76,42 @@ public:
 	glm::mat4 getParentMatrix() const;
 	glm::mat4 getParentMatrixRecursive() const;
 
+	inline bool isWorldDirty() const {
+		return m_system->isDirty(m_handle);
+	}
+
+	inline TransformSystem* getSystem() const {
+		return m_system;
+	}
+
+	inline TransformSystem::Handle getHandle() const {
+		return m_handle;
+	}
+
 	//
 	// public getter setter
 	//
 	inline glm::vec3 getPosition() const {
-		return m_position;
+		return m_system->getPosition(m_handle);
 	}
 
 	inline glm::vec3 getRotation() const {
-		return m_rotation;
+		return m_system->getRotation(m_handle);
 	}
 
 	inline glm::vec3 getScale() const {
-		return m_scale;
+		return m_system->getScale(m_handle);
 	}
 
 private:
-	void calcTransform();
-	void updateLocalAxes();
+	void setTRS(const glm::vec3& pos, const glm::vec3& rotate, const glm::vec3& scale);
+	void onParentChanged(); // relink to parent's transform, may move whole subtree to parent's system
+	void moveToSystem(TransformSystem* system);
+
+	static void calcLocalAxes(const glm::mat4& m, glm::vec3* right, glm::vec3* up, glm::vec3* forward);
 
 private:
-	glm::vec3 m_position;
-	glm::vec3 m_rotation;
-	glm::vec3 m_scale;
-	
-	glm::vec3 m_rightAxis;
-	glm::vec3 m_upAxis;
-	glm::vec3 m_forwardAxis;
-	
-	glm::mat4 m_matrix;
-	//glm::mat4 m_applyedTransform;
+	// transform data lives in the owner scene's transform system, this is only a handle
+	TransformSystem* m_system;
+	TransformSystem::Handle m_handle;
 };
\ No newline at end of file
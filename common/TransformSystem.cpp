@@ -0,0 +1,291 @@
+#include"TransformSystem.h"
+#include"Util.h"
+#include"JobSystem.h"
+#include<glm/ext/matrix_transform.hpp>
+
+
+#define INVALID_TRANSFORM_INDEX 0xffffffff
+
+// nodes per job when a level is split across job threads
+#define TRANSFORM_UPDATE_GRAIN 1024
+
+
+template<typename T>
+static void swapRemove(std::vector<T>& v, size_t index) {
+	if (index != v.size() - 1)
+		v[index] = v.back();
+	v.pop_back();
+}
+
+
+template<typename T>
+static void permute(std::vector<T>& v, const std::vector<uint32_t>& order) {
+	std::vector<T> sorted;
+	sorted.reserve(v.size());
+	for (auto index : order)
+		sorted.push_back(v[index]);
+	v.swap(sorted);
+}
+
+
+
+TransformSystem::TransformSystem() :m_positions()
+, m_rotations()
+, m_scales()
+, m_locals()
+, m_worlds()
+, m_parentIndices()
+, m_parents()
+, m_firstChilds()
+, m_nextSiblings()
+, m_dirty()
+, m_indexToHandle()
+, m_handleToIndex()
+, m_freeHandles()
+, m_levelOffsets()
+, m_isSorted(true) {
+
+}
+
+
+TransformSystem* TransformSystem::detached() {
+	static TransformSystem s_detached;
+	return &s_detached;
+}
+
+
+TransformSystem::Handle TransformSystem::create() {
+	Handle h;
+	if (!m_freeHandles.empty()) {
+		h = m_freeHandles.back();
+		m_freeHandles.pop_back();
+	} else {
+		h = Handle(m_handleToIndex.size());
+		m_handleToIndex.push_back(INVALID_TRANSFORM_INDEX);
+	}
+
+	m_handleToIndex[h] = uint32_t(m_indexToHandle.size());
+	m_positions.push_back(glm::vec3(0.f));
+	m_rotations.push_back(glm::vec3(0.f));
+	m_scales.push_back(glm::vec3(1.f));
+	m_locals.push_back(glm::mat4(1.f));
+	m_worlds.push_back(glm::mat4(1.f));
+	m_parentIndices.push_back(INVALID_TRANSFORM_INDEX);
+	m_parents.push_back(INVALID_TRANSFORM_HANDLE);
+	m_firstChilds.push_back(INVALID_TRANSFORM_HANDLE);
+	m_nextSiblings.push_back(INVALID_TRANSFORM_HANDLE);
+	m_dirty.push_back(1);
+	m_indexToHandle.push_back(h);
+	m_isSorted = false;
+
+	return h;
+}
+
+
+void TransformSystem::destroy(Handle h) {
+	unlink(h);
+
+	uint32_t index = m_handleToIndex[h];
+	Handle child = m_firstChilds[index];
+	while (child != INVALID_TRANSFORM_HANDLE) {
+		uint32_t childIndex = m_handleToIndex[child];
+		Handle next = m_nextSiblings[childIndex];
+		m_parents[childIndex] = INVALID_TRANSFORM_HANDLE;
+		m_nextSiblings[childIndex] = INVALID_TRANSFORM_HANDLE;
+		markDirty(child);
+		child = next;
+	}
+
+	swapRemove(m_positions, index);
+	swapRemove(m_rotations, index);
+	swapRemove(m_scales, index);
+	swapRemove(m_locals, index);
+	swapRemove(m_worlds, index);
+	swapRemove(m_parentIndices, index);
+	swapRemove(m_parents, index);
+	swapRemove(m_firstChilds, index);
+	swapRemove(m_nextSiblings, index);
+	swapRemove(m_dirty, index);
+	swapRemove(m_indexToHandle, index);
+	if (index < m_indexToHandle.size())
+		m_handleToIndex[m_indexToHandle[index]] = index;
+
+	m_handleToIndex[h] = INVALID_TRANSFORM_INDEX;
+	m_freeHandles.push_back(h);
+	m_isSorted = false;
+}
+
+
+void TransformSystem::unlink(Handle h) {
+	uint32_t index = m_handleToIndex[h];
+	Handle parent = m_parents[index];
+	if (parent == INVALID_TRANSFORM_HANDLE)
+		return;
+
+	uint32_t parentIndex = m_handleToIndex[parent];
+	if (m_firstChilds[parentIndex] == h) {
+		m_firstChilds[parentIndex] = m_nextSiblings[index];
+	} else {
+		Handle prev = m_firstChilds[parentIndex];
+		while (prev != INVALID_TRANSFORM_HANDLE) {
+			uint32_t prevIndex = m_handleToIndex[prev];
+			if (m_nextSiblings[prevIndex] == h) {
+				m_nextSiblings[prevIndex] = m_nextSiblings[index];
+				break;
+			}
+			prev = m_nextSiblings[prevIndex];
+		}
+	}
+
+	m_parents[index] = INVALID_TRANSFORM_HANDLE;
+	m_nextSiblings[index] = INVALID_TRANSFORM_HANDLE;
+}
+
+
+void TransformSystem::setParent(Handle h, Handle parent) {
+	uint32_t index = m_handleToIndex[h];
+	if (m_parents[index] == parent)
+		return;
+
+	unlink(h);
+	if (parent != INVALID_TRANSFORM_HANDLE) {
+		uint32_t parentIndex = m_handleToIndex[parent];
+		m_parents[index] = parent;
+		m_nextSiblings[index] = m_firstChilds[parentIndex];
+		m_firstChilds[parentIndex] = h;
+	}
+
+	m_isSorted = false;
+	markDirty(h);
+}
+
+
+void TransformSystem::setTRS(Handle h, const glm::vec3& pos, const glm::vec3& rotation, const glm::vec3& scale) {
+	uint32_t index = m_handleToIndex[h];
+	m_positions[index] = pos;
+	m_rotations[index] = rotation;
+	m_scales[index] = scale;
+	m_locals[index] = composeMatrix(pos, rotation, scale);
+	markDirty(h);
+}
+
+
+bool TransformSystem::markDirty(Handle h) {
+	// a dirty node always has dirty descendants, stop at the first one
+	uint32_t index = m_handleToIndex[h];
+	if (m_dirty[index])
+		return false;
+
+	m_dirty[index] = 1;
+	for (Handle child = m_firstChilds[index]; child != INVALID_TRANSFORM_HANDLE; child = m_nextSiblings[m_handleToIndex[child]])
+		markDirty(child);
+
+	return true;
+}
+
+
+const glm::mat4& TransformSystem::getWorldMatrix(Handle h) {
+	uint32_t index = m_handleToIndex[h];
+	if (m_dirty[index]) {
+		Handle parent = m_parents[index];
+		if (parent != INVALID_TRANSFORM_HANDLE) {
+			m_worlds[index] = getWorldMatrix(parent) * m_locals[index];
+		} else {
+			m_worlds[index] = m_locals[index];
+		}
+		m_dirty[index] = 0;
+	}
+
+	return m_worlds[index];
+}
+
+
+void TransformSystem::update() {
+	sort();
+
+	// nodes in the same level are independent of each other
+	auto jobSystem = JobSystem::getInstance();
+	for (size_t level = 0; level < levelCount(); level++) {
+		size_t offset = m_levelOffsets[level];
+		jobSystem->parallelFor(m_levelOffsets[level + 1] - offset, TRANSFORM_UPDATE_GRAIN, [this, offset](size_t begin, size_t end) {
+			updateRange(offset + begin, offset + end);
+		});
+	}
+}
+
+
+void TransformSystem::updateRange(size_t begin, size_t end) {
+	for (size_t i = begin; i < end; i++) {
+		if (!m_dirty[i])
+			continue;
+
+		uint32_t parentIndex = m_parentIndices[i];
+		if (parentIndex != INVALID_TRANSFORM_INDEX) {
+			m_worlds[i] = m_worlds[parentIndex] * m_locals[i];
+		} else {
+			m_worlds[i] = m_locals[i];
+		}
+		m_dirty[i] = 0;
+	}
+}
+
+
+void TransformSystem::sort() {
+	if (m_isSorted)
+		return;
+
+	// breadth first from the roots, each frontier is one level
+	std::vector<uint32_t> order;
+	order.reserve(size());
+	for (size_t i = 0; i < size(); i++) {
+		if (m_parents[i] == INVALID_TRANSFORM_HANDLE)
+			order.push_back(uint32_t(i));
+	}
+
+	m_levelOffsets.clear();
+	m_levelOffsets.push_back(0);
+	size_t begin = 0;
+	while (begin < order.size()) {
+		size_t end = order.size();
+		for (size_t i = begin; i < end; i++) {
+			for (Handle child = m_firstChilds[order[i]]; child != INVALID_TRANSFORM_HANDLE; child = m_nextSiblings[m_handleToIndex[child]])
+				order.push_back(m_handleToIndex[child]);
+		}
+		m_levelOffsets.push_back(end);
+		begin = end;
+	}
+
+#ifdef _DEBUG
+	ASSERT(order.size() == size());
+#endif // _DEBUG
+
+	permute(m_positions, order);
+	permute(m_rotations, order);
+	permute(m_scales, order);
+	permute(m_locals, order);
+	permute(m_worlds, order);
+	permute(m_parents, order);
+	permute(m_firstChilds, order);
+	permute(m_nextSiblings, order);
+	permute(m_dirty, order);
+	permute(m_indexToHandle, order);
+
+	for (size_t i = 0; i < size(); i++)
+		m_handleToIndex[m_indexToHandle[i]] = uint32_t(i);
+
+	for (size_t i = 0; i < size(); i++)
+		m_parentIndices[i] = m_parents[i] == INVALID_TRANSFORM_HANDLE ? INVALID_TRANSFORM_INDEX : m_handleToIndex[m_parents[i]];
+
+	m_isSorted = true;
+}
+
+
+glm::mat4 TransformSystem::composeMatrix(const glm::vec3& pos, const glm::vec3& rotation, const glm::vec3& scale) {
+	glm::mat4 m(1);
+	m = glm::translate(m, pos);
+	m = glm::rotate(m, glm::radians(rotation.z), glm::vec3(0.f, 0.f, 1.f));
+	m = glm::rotate(m, glm::radians(rotation.y), glm::vec3(0.f, 1.f, 0.f));
+	m = glm::rotate(m, glm::radians(rotation.x), glm::vec3(1.f, 0.f, 0.f));
+	m = glm::scale(m, scale);
+	return m;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include<glm/glm.hpp>
+#include<vector>
+#include<cstdint>
+
+
+#define INVALID_TRANSFORM_HANDLE 0xffffffff
+
+
+//
+// structure of arrays storage for a transform hierarchy.
+// nodes are kept sorted by hierarchy depth, parents always come before their children,
+// so world matrices are rebuilt with one linear pass per level.
+// handles are stable, array indices change whenever the hierarchy is re-sorted.
+//
+class TransformSystem {
+public:
+	typedef uint32_t Handle;
+
+public:
+	TransformSystem();
+	~TransformSystem() = default;
+
+	TransformSystem(const TransformSystem& other) = delete;
+	TransformSystem& operator = (const TransformSystem& other) = delete;
+
+	Handle create();
+	void destroy(Handle h); // children become roots
+	void setParent(Handle h, Handle parent);
+
+	void setTRS(Handle h, const glm::vec3& pos, const glm::vec3& rotation, const glm::vec3& scale);
+	bool markDirty(Handle h); // mark node & descendants, false if it was dirty already
+
+	// resolve dirty chain on demand, O(1) for clean nodes
+	const glm::mat4& getWorldMatrix(Handle h);
+
+	// re-sort if hierarchy changed, then rebuild all dirty world matrices level by level, a level is split across job threads
+	void update();
+
+	inline const glm::vec3& getPosition(Handle h) const {
+		return m_positions[m_handleToIndex[h]];
+	}
+
+	inline const glm::vec3& getRotation(Handle h) const {
+		return m_rotations[m_handleToIndex[h]];
+	}
+
+	inline const glm::vec3& getScale(Handle h) const {
+		return m_scales[m_handleToIndex[h]];
+	}
+
+	inline const glm::mat4& getLocalMatrix(Handle h) const {
+		return m_locals[m_handleToIndex[h]];
+	}
+
+	inline Handle getParent(Handle h) const {
+		return m_parents[m_handleToIndex[h]];
+	}
+
+	inline bool isDirty(Handle h) const {
+		return m_dirty[m_handleToIndex[h]] != 0;
+	}
+
+	inline size_t size() const {
+		return m_indexToHandle.size();
+	}
+
+	inline size_t levelCount() const {
+		return m_levelOffsets.empty() ? 0 : m_levelOffsets.size() - 1;
+	}
+
+	// storage of transforms not belong to any scene
+	static TransformSystem* detached();
+
+protected:
+	void sort();
+	void updateRange(size_t begin, size_t end);
+	void unlink(Handle h);
+
+	static glm::mat4 composeMatrix(const glm::vec3& pos, const glm::vec3& rotation, const glm::vec3& scale);
+
+private:
+	// per node, indexed by array index
+	std::vector<glm::vec3> m_positions;
+	std::vector<glm::vec3> m_rotations;
+	std::vector<glm::vec3> m_scales;
+	std::vector<glm::mat4> m_locals;
+	std::vector<glm::mat4> m_worlds;
+	std::vector<uint32_t> m_parentIndices; // valid while sorted
+	std::vector<Handle> m_parents;
+	std::vector<Handle> m_firstChilds;
+	std::vector<Handle> m_nextSiblings;
+	std::vector<uint8_t> m_dirty;
+	std::vector<Handle> m_indexToHandle;
+
+	// per handle
+	std::vector<uint32_t> m_handleToIndex;
+	std::vector<Handle> m_freeHandles;
+
+	std::vector<size_t> m_levelOffsets;
+	bool m_isSorted;
+};
@@ -39,7 +39,7 @@ bool TransformTrack::isValid() const {
 	return posValid || scaleValid || rotateValid;
 }
 
-void TransformTrack::sample(const Transform& inTransform, Transform& outTransform, float time, LoopType loop) const {
+void TransformTrack::sample(const Transform& inTransform, Transform& outTransform, float time, LoopType loop, int* cursors) const {
 	if (&inTransform != &outTransform)
 		outTransform = inTransform;
 
@@ -47,9 +47,9 @@ void TransformTrack::sample(const Transform& inTransform, Transform& outTransfor
 		return;
 
 	if (m_positionTrack.isValid())
-		outTransform.position = m_positionTrack.sample(time, loop);
+		outTransform.position = m_positionTrack.sample(time, loop, cursors ? &cursors[0] : nullptr);
 	if (m_scaleTrack.isValid())
-		outTransform.scale = m_scaleTrack.sample(time, loop);
+		outTransform.scale = m_scaleTrack.sample(time, loop, cursors ? &cursors[1] : nullptr);
 	if (m_rotationTrack.isValid())
-		outTransform.rotation = m_rotationTrack.sample(time, loop);
+		outTransform.rotation = m_rotationTrack.sample(time, loop, cursors ? &cursors[2] : nullptr);
 }
\ No newline at end of file
@@ -18,7 +18,8 @@ public:
 	float getDuration() const;
 	bool isValid() const;
 
-	void sample(const Transform& inTransform, Transform& outTransform, float time, LoopType loop) const;
+	// cursors: key search state of position, scale & rotation track, may be null
+	void sample(const Transform& inTransform, Transform& outTransform, float time, LoopType loop, int* cursors = nullptr) const;
 
 	inline VectorTrack& getPositionTrack() {
 		return m_positionTrack;
@@ -1,5 +1,6 @@
 #include"VertexArray.h"
 #include"Util.h"
+#include"GLStateCache.h"
 
 
 VertexArray::VertexArray():m_handler(0) {
@@ -11,11 +12,11 @@ VertexArray::~VertexArray() {
 }
 
 void VertexArray::bind() const {
-	GLCALL(glBindVertexArray(m_handler));
+	GLStateCache::getInstance()->bindVertexArray(m_handler);
 }
 
 void VertexArray::unbind() const {
-	GLCALL(glBindVertexArray(0));
+	GLStateCache::getInstance()->bindVertexArray(0);
 }
 
 void VertexArray::storeVertexLayout(const VertexLayoutDescription& vbDesc) {
@@ -39,6 +40,9 @@ void VertexArray::storeVertexLayout(const VertexLayoutDescription& vbDesc) {
 				stride,
 				reinterpret_cast<void*>(offset)));
 		}
+		if (a.divisor > 0) {
+			GLCALL(glVertexAttribDivisor(a.location, a.divisor));
+		}
 		offset += a.packedSize;
 	}
 }
@@ -47,6 +51,7 @@ void VertexArray::storeVertexLayout(const VertexLayoutDescription& vbDesc) {
 void VertexArray::release() {
 	if (m_handler != 0) {
 		GLCALL(glDeleteVertexArrays(1, &m_handler));
+		GLStateCache::getInstance()->onDeleteVertexArray(m_handler);
 		m_handler = 0;
 	}
 }
@@ -7,12 +7,13 @@ VertexLayoutDescription::VertexAttribute::VertexAttribute():VertexAttribute(Vert
 }
 
 
-VertexLayoutDescription::VertexAttribute::VertexAttribute(VertexLayoutDescription::AttributeElementType et, size_t ec, size_t ps, int loc, bool nor) {
+VertexLayoutDescription::VertexAttribute::VertexAttribute(VertexLayoutDescription::AttributeElementType et, size_t ec, size_t ps, int loc, bool nor, size_t div) {
 	elementType = et;
 	elementCount = ec;
 	packedSize = ps;
 	location = loc;
 	normalized = nor;
+	divisor = div;
 }
 
 VertexLayoutDescription::VertexLayoutDescription(size_t stride) :m_stride(stride) {
@@ -20,11 +21,11 @@ VertexLayoutDescription::VertexLayoutDescription(size_t stride) :m_stride(stride
 }
 
 
-void VertexLayoutDescription::pushAttribute(AttributeElementType et, size_t ec, int loc, size_t packedSz, bool normalize) {
+void VertexLayoutDescription::pushAttribute(AttributeElementType et, size_t ec, int loc, size_t packedSz, bool normalize, size_t divisor) {
 	if (packedSz <= 0) {
 		packedSz = ec * getAttributeElmentSize(et);
 	}
-	m_attributes.push_back(VertexAttribute(et, ec, packedSz, loc, normalize));
+	m_attributes.push_back(VertexAttribute(et, ec, packedSz, loc, normalize, divisor));
 }
 
 
@@ -24,16 +24,17 @@ public:
 		size_t packedSize;
 		int location;
 		bool normalized;
+		size_t divisor; // 0 advances per vertex, n advances every n instances
 
 		VertexAttribute();
-		VertexAttribute(VertexLayoutDescription::AttributeElementType et, size_t ec, size_t ps, int loc, bool nor);
+		VertexAttribute(VertexLayoutDescription::AttributeElementType et, size_t ec, size_t ps, int loc, bool nor, size_t div = 0);
 	};
 
 
 public:
 	VertexLayoutDescription(size_t stride = 0);
 	
-	void pushAttribute(AttributeElementType et, size_t ec, int loc, size_t packedSz = 0, bool normalize = false);
+	void pushAttribute(AttributeElementType et, size_t ec, int loc, size_t packedSz = 0, bool normalize = false, size_t divisor = 0);
 	
 	void reset();
 
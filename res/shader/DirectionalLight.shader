@@ -169,7 +169,7 @@ void main() {
 
 	vec3 N = fs_in.normal_W;
 	if (u_HasANRMMap.g == 1) {
-		vec3 normal = (texture(u_NormalMap, fs_in.uv).xyz - 0.5) * 2;
+		vec3 normal = sampleNormalMap(fs_in.uv);
 		vec3 biTangent = normalize(cross(fs_in.normal_W, fs_in.tangent_W));
 		N = normalize(mat3(fs_in.tangent_W, biTangent, fs_in.normal_W) * normal);
 	}
@@ -0,0 +1,20 @@
+#shader compute
+#version 450 core
+
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+uniform sampler2D u_Input; // linear filtered
+layout(binding = 0) writeonly uniform image2D u_Output;
+
+
+// bilinear fetch at output texel center, halving size averages a 2x2 block, doubling it interpolates
+void main() {
+	ivec2 dim = imageSize(u_Output);
+	ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
+	if (any(greaterThanEqual(pix, dim)))
+		return;
+
+	vec2 uv = (vec2(pix) + 0.5) / vec2(dim);
+	imageStore(u_Output, pix, textureLod(u_Input, uv, 0));
+}
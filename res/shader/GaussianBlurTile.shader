@@ -0,0 +1,59 @@
+#shader compute
+#version 450 core
+
+#define TILE_SIZE 128
+#define MAX_RADIUS 18
+#define MAX_TAPS (MAX_RADIUS / 2 + 1)
+
+
+// one group blurs TILE_SIZE pixels of a row (pass 0) or column (pass 1)
+layout(local_size_x = TILE_SIZE) in;
+
+uniform sampler2D u_Input;
+layout(binding = 0) writeonly uniform image2D u_Output; // output format is set by image binding
+
+uniform int u_Pass;
+uniform int u_Radius;
+uniform int u_NumTaps;
+uniform float u_TapOffsets[MAX_TAPS]; // paired taps, [0] is center
+uniform float u_TapWeights[MAX_TAPS];
+
+shared vec4 tileShared[TILE_SIZE + 2 * MAX_RADIUS]; // tile & its apron, loaded once per group
+
+
+void main() {
+	ivec2 dim = textureSize(u_Input, 0);
+	ivec2 axis = u_Pass == 0 ? ivec2(1, 0) : ivec2(0, 1);
+	int size = u_Pass == 0 ? dim.x : dim.y;
+	int line = int(gl_WorkGroupID.y);
+	int tileStart = int(gl_WorkGroupID.x) * TILE_SIZE;
+
+	// edges clamp like a clamp to edge fetch
+	for (int i = int(gl_LocalInvocationIndex); i < TILE_SIZE + 2 * u_Radius; i += TILE_SIZE) {
+		int pos = clamp(tileStart - u_Radius + i, 0, size - 1);
+		tileShared[i] = texelFetch(u_Input, axis * pos + (ivec2(1) - axis) * line, 0);
+	}
+	barrier();
+
+	int pos = tileStart + int(gl_LocalInvocationIndex);
+	if (pos >= size)
+		return;
+
+	// lerp of two neighbours in shared memory is the weighted sum of a tap pair
+	int center = int(gl_LocalInvocationIndex) + u_Radius;
+	vec4 sum = tileShared[center] * u_TapWeights[0];
+	for (int t = 1; t < u_NumTaps; t++) {
+		int i = int(u_TapOffsets[t]);
+		float f = u_TapOffsets[t] - i;
+		vec4 right = tileShared[center + i];
+		vec4 left = tileShared[center - i];
+		// unpaired last tap of an odd radius sits on the apron edge, its neighbour is outside the tile
+		if (f > 0.0) {
+			right = mix(right, tileShared[center + i + 1], f);
+			left = mix(left, tileShared[center - i - 1], f);
+		}
+		sum += (right + left) * u_TapWeights[t];
+	}
+
+	imageStore(u_Output, axis * pos + (ivec2(1) - axis) * line, sum);
+}
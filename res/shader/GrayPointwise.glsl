@@ -0,0 +1,7 @@
+// gray scale pointwise stage, see IFilter::getPointwiseSource()
+
+
+vec4 STAGE_apply(vec4 color) {
+	float lum = dot(color.rgb, vec3(0.2126f, 0.7152f, 0.0722f));
+	return vec4(vec3(lum), 1.f);
+}
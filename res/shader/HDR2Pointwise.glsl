@@ -0,0 +1,16 @@
+// exposure tone mapping pointwise stage, see IFilter::getPointwiseSource()
+
+
+uniform float STAGE_Exposure;
+
+
+vec4 STAGE_apply(vec4 color) {
+	const float gamma = 2.2f;
+
+	// exposure tone mapping
+	vec3 mapped = vec3(1.0) - exp(-color.rgb * STAGE_Exposure);
+	// gamma correction 
+	mapped = pow(mapped, vec3(1.0 / gamma));
+
+	return vec4(mapped, 1.f);
+}
@@ -1,6 +1,8 @@
 #shader compute
 #version 450 core
 
+#define NUM_BINS 256
+
 
 layout(local_size_x = 256) in;
 
@@ -8,29 +10,51 @@ layout(std430) readonly buffer Hist {
 	uint b_Hist[];
 };
 
-layout(r16f) uniform image2D u_OutAveLum;
+// stays on gpu between frames, tone mapping reads adaptedLuminance
+layout(std430) buffer Exposure {
+	float b_AverageLuminance;
+	float b_AdaptedLuminance;
+	uint b_NumPixels;
+	uint b_Reserved;
+};
 
-uniform uint u_NumPixel;
+uniform vec2 u_LogLumRange; // (min log2 luminance, 1 / range)
+uniform float u_DeltaTime;
+uniform float u_AdaptationRate;
 
-shared uint lumSumShared[256];
+shared uint lumSumShared[NUM_BINS];
+shared uint countShared[NUM_BINS];
 
 
 void main() {
-	lumSumShared[gl_LocalInvocationIndex] = b_Hist[gl_LocalInvocationIndex] * gl_LocalInvocationIndex;
-	groupMemoryBarrier();
+	uint count = gl_LocalInvocationIndex == 0 ? 0 : b_Hist[gl_LocalInvocationIndex];
+	lumSumShared[gl_LocalInvocationIndex] = count * gl_LocalInvocationIndex;
+	countShared[gl_LocalInvocationIndex] = count;
+	barrier();
 
-	for (uint i = 256 >> 1; i > 0; i >>= 1) {
+	for (uint i = NUM_BINS >> 1; i > 0; i >>= 1) {
 		if (gl_LocalInvocationIndex < i) {
 			lumSumShared[gl_LocalInvocationIndex] += lumSumShared[gl_LocalInvocationIndex + i];
+			countShared[gl_LocalInvocationIndex] += countShared[gl_LocalInvocationIndex + i];
 		}
-		groupMemoryBarrier();
+		barrier();
 	}
 
 	if (gl_LocalInvocationIndex == 0) {
-		float aveLum = (lumSumShared[0] / float(u_NumPixel) - 1.0) / 254.0;
-		imageStore(u_OutAveLum, ivec2(0, 0), vec4(exp(aveLum), 0.f, 0.f, 0.f));
+		uint numPixels = countShared[0];
+		float aveLevel = numPixels > 0 ? lumSumShared[0] / float(numPixels) : 1.0;
+		float aveLogLum = (aveLevel - 1.0) / 254.0 / u_LogLumRange.y + u_LogLumRange.x;
+		float aveLum = exp2(aveLogLum);
+
+		// exponential approach, frame rate independent. nothing adapted yet snaps to this frame
+		float adaptedLum = b_AdaptedLuminance;
+		if (adaptedLum > 0.0)
+			adaptedLum += (aveLum - adaptedLum) * (1.0 - exp(-u_DeltaTime * u_AdaptationRate));
+		else
+			adaptedLum = aveLum;
+
+		b_AverageLuminance = aveLum;
+		b_AdaptedLuminance = adaptedLum;
+		b_NumPixels = numPixels;
 	}
-};
-
-
-
+}
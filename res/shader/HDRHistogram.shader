@@ -1,53 +1,58 @@
 #shader compute
 #version 450 core
 
-#define EPSILON 0.05
+#define NUM_BINS 256
+#define DOWNSAMPLE 4
 
 
 layout(local_size_x = 16, local_size_y = 16) in;
 
 
-layout(rgba16f) readonly uniform image2D u_InputImage; // input image for calculate histogram
+uniform sampler2D u_InputTexture; // input image for calculate histogram
+uniform vec2 u_LogLumRange; // (min log2 luminance, 1 / range)
 
-layout(std430) buffer Hist { // buffer to store total histogram
+layout(std430) buffer Hist { // buffer to store total histogram, cleared before dispatch
 	uint b_Hist[];
 };
 
-shared uint histShared[256]; // share memory to store local group histogram
-
-layout(binding = 0, offset = 0) uniform atomic_uint u_pixelCounter;
+shared uint histShared[NUM_BINS]; // share memory to store local group histogram
 
 
 
+// bin 0 holds black & everything under range, it is left out of average
 uint RGB2LuminanceLevel(vec3 rgb) {
-	float lum = log(dot(rgb, vec3(0.2125, 0.7154, 0.0721)));
-	if (lum < EPSILON)
+	float lum = dot(rgb, vec3(0.2125, 0.7154, 0.0721));
+	if (lum < 0.0001)
 		return 0;
 
-	lum = clamp(lum, 0.0, 1.0);
+	float logLum = clamp((log2(lum) - u_LogLumRange.x) * u_LogLumRange.y, 0.0, 1.0);
 	
-	return uint(lum * 254 + 1);
+	return uint(logLum * 254.0 + 1.0);
 }
 
 
 
 void main() {
 	histShared[gl_LocalInvocationIndex] = 0;
-	groupMemoryBarrier();
+	barrier();
 
-	ivec2 dim = imageSize(u_InputImage);
-	ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 dim = textureSize(u_InputTexture, 0);
+	ivec2 pix = ivec2(gl_GlobalInvocationID.xy) * DOWNSAMPLE;
 	if (all(lessThan(pix, dim))) {
-		atomicCounterIncrement(u_pixelCounter);
-
-		uint lum = RGB2LuminanceLevel(imageLoad(u_InputImage, pix).rgb);
-		atomicAdd(histShared[lum], 1);
-		
-		groupMemoryBarrier(); // sync all invocation in this group
-
-		atomicAdd(b_Hist[gl_LocalInvocationIndex], histShared[gl_LocalInvocationIndex]); // add local hist to global hist
+		// four bilinear taps, each between 2x2 texels, average the whole 4x4 block
+		vec2 texelSize = 1.0 / vec2(dim);
+		vec2 uv = (vec2(pix) + 1.0) * texelSize;
+		vec3 rgb = textureLod(u_InputTexture, uv, 0).rgb;
+		rgb += textureLod(u_InputTexture, uv + vec2(2.0, 0.0) * texelSize, 0).rgb;
+		rgb += textureLod(u_InputTexture, uv + vec2(0.0, 2.0) * texelSize, 0).rgb;
+		rgb += textureLod(u_InputTexture, uv + vec2(2.0, 2.0) * texelSize, 0).rgb;
+
+		atomicAdd(histShared[RGB2LuminanceLevel(rgb * 0.25)], 1);
 	}
-}
-
 
+	barrier(); // sync all invocation in this group
 
+	uint count = histShared[gl_LocalInvocationIndex];
+	if (count > 0)
+		atomicAdd(b_Hist[gl_LocalInvocationIndex], count); // add local hist to global hist
+}
@@ -0,0 +1,45 @@
+// auto exposure tone mapping pointwise stage, see IFilter::getPointwiseSource()
+
+
+// written by auto exposure compute pass
+layout(std430) readonly buffer STAGE_Exposure {
+	float averageLuminance;
+	float adaptedLuminance;
+	uint numPixels;
+	uint reserved;
+} STAGE_exposure;
+
+uniform float STAGE_exposureScale;
+uniform float STAGE_white;
+
+
+const mat3 STAGE_rgb2xyz = mat3(
+	0.4124564, 0.2126729, 0.0193339,
+	0.3575761, 0.7151522, 0.1191920,
+	0.1804375, 0.0721750, 0.9503041);
+
+const mat3 STAGE_xyz2rgb = mat3(
+	3.2404542, -0.9692660, 0.0556434,
+	-1.5371385, 1.8760108, -0.2040259,
+	-0.4985314, 0.0415560, 1.0572252);
+
+
+// convert from RGB to CIE-XYZ, then to CIE-xyY
+// modify luminance
+// convert from CIE-xyY to CIE-XYZ, then to RGB
+vec4 STAGE_apply(vec4 color) {
+	vec3 xyzColor = STAGE_rgb2xyz * color.rgb;
+	
+	float xyzSum = xyzColor.x + xyzColor.y + xyzColor.z;
+	
+	vec3 xyYColor = vec3(xyzColor.x / xyzSum, xyzColor.y / xyzSum, xyzColor.y);
+	
+	float L = (STAGE_exposureScale * xyYColor.z) / max(STAGE_exposure.adaptedLuminance, 0.0001);
+	L = (L * (1 + L / (STAGE_white * STAGE_white))) / (1 + L); // new luminance
+
+	xyzColor.x = (L * xyYColor.x) / (xyYColor.y);
+	xyzColor.y = L;
+	xyzColor.z = (L * (1 - xyYColor.x - xyYColor.y)) / xyYColor.y;
+
+	return vec4(STAGE_xyz2rgb * xyzColor, 1.f);
+}
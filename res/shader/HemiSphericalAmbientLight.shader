@@ -60,7 +60,8 @@ vec3 sRGB2RGB(vec3 rgb) {
 vec3 calcAmibientLight() {
 	vec3 normalW = fs_in.normal_W;
 	if (u_HasANMap.y == 1) {
-		vec3 normal = (texture(u_NormalMap, fs_in.uv).xyz - 0.5) * 2;
+		vec2 xy = texture(u_NormalMap, fs_in.uv).xy * 2.f - 1.f; // z rebuilt, bc5 normal maps have two channels
+		vec3 normal = vec3(xy, sqrt(max(1.f - dot(xy, xy), 0.f)));
 		vec3 biTangent = normalize(cross(fs_in.normal_W, fs_in.tangent_W));
 		normalW = normalize(mat3(fs_in.tangent_W, biTangent, fs_in.normal_W) * normal);
 	}
@@ -0,0 +1,84 @@
+#shader compute
+#version 450 core
+
+#define LIGHT_BATCH_SIZE 64
+
+// one invocation per cluster, lights are streamed through shared memory batch by batch
+layout(local_size_x = LIGHT_BATCH_SIZE) in;
+
+
+layout(std430) readonly buffer ClusterBounds { // (min, max) view space aabb per cluster
+	vec4 b_ClusterBounds[];
+};
+
+layout(std430) readonly buffer LightSpheres { // (xyz) view space center (w) radius per local light
+	vec4 b_LightSpheres[];
+};
+
+layout(std430) readonly buffer LightExtents { // (min, max) cluster coordinates per local light, inclusive
+	ivec4 b_LightExtents[];
+};
+
+layout(std430) writeonly buffer LightGrid { // (offset, count) into light index list per cluster
+	uvec2 b_LightGrid[];
+};
+
+layout(std430) writeonly buffer LightIndices {
+	uint b_LightIndices[];
+};
+
+uniform ivec3 u_ClusterDims;
+uniform uint u_NumClusters;
+uniform uint u_NumLocalLights;
+uniform uint u_LightIndexBase; // index of first local light in Lights buffer
+uniform uint u_MaxLightsPerCluster;
+
+shared vec4 sharedSpheres[LIGHT_BATCH_SIZE];
+shared ivec4 sharedExtentMins[LIGHT_BATCH_SIZE];
+shared ivec4 sharedExtentMaxs[LIGHT_BATCH_SIZE];
+
+
+
+void main() {
+	uint cluster = gl_GlobalInvocationID.x;
+	bool isValid = cluster < u_NumClusters;
+
+	ivec3 coord = ivec3(int(cluster) % u_ClusterDims.x, (int(cluster) / u_ClusterDims.x) % u_ClusterDims.y, int(cluster) / (u_ClusterDims.x * u_ClusterDims.y));
+	vec3 aabbMin = vec3(0.f);
+	vec3 aabbMax = vec3(0.f);
+	if (isValid) {
+		aabbMin = b_ClusterBounds[cluster * 2].xyz;
+		aabbMax = b_ClusterBounds[cluster * 2 + 1].xyz;
+	}
+
+	// every cluster owns a fixed range of index list
+	uint offset = cluster * u_MaxLightsPerCluster;
+	uint count = 0;
+
+	for (uint batch = 0; batch < u_NumLocalLights; batch += LIGHT_BATCH_SIZE) {
+		uint light = batch + gl_LocalInvocationIndex;
+		if (light < u_NumLocalLights) {
+			sharedSpheres[gl_LocalInvocationIndex] = b_LightSpheres[light];
+			sharedExtentMins[gl_LocalInvocationIndex] = b_LightExtents[light * 2];
+			sharedExtentMaxs[gl_LocalInvocationIndex] = b_LightExtents[light * 2 + 1];
+		}
+		barrier();
+
+		uint batchSize = min(uint(LIGHT_BATCH_SIZE), u_NumLocalLights - batch);
+		for (uint i = 0; isValid && i < batchSize && count < u_MaxLightsPerCluster; i++) {
+			if (any(lessThan(coord, sharedExtentMins[i].xyz)) || any(greaterThan(coord, sharedExtentMaxs[i].xyz)))
+				continue;
+
+			vec4 sphere = sharedSpheres[i];
+			vec3 d = sphere.xyz - clamp(sphere.xyz, aabbMin, aabbMax);
+			if (dot(d, d) <= sphere.w * sphere.w) {
+				b_LightIndices[offset + count] = u_LightIndexBase + batch + i;
+				count++;
+			}
+		}
+		barrier();
+	}
+
+	if (isValid)
+		b_LightGrid[cluster] = uvec2(offset, count);
+}
@@ -21,93 +21,136 @@ layout(std430) buffer Lights {
 	Light b_Lights[];
 };
 
-uniform int u_NumLights;
+layout(std430) readonly buffer LightGrid { // (offset, count) into light index list per cluster
+	uvec2 b_LightGrid[];
+};
+
+layout(std430) readonly buffer LightIndices {
+	uint b_LightIndices[];
+};
 
+uniform ivec2 u_GlobalLights; // [begin, end) of lights shading every fragment, point/spot lights are looked up by cluster
+uniform mat4 u_ViewMat;
+uniform ivec3 u_ClusterDims;
+uniform vec2 u_ClusterTileSize; // pixels
+uniform vec2 u_ClusterDepthParams; // (scale, bias) turning log(view depth) into slice
+
+
+uvec2 ClusterLights(vec3 Pos) {
+	float depth = max(-(u_ViewMat * vec4(Pos, 1.f)).z, 1e-4f);
+	ivec2 tile = min(ivec2(gl_FragCoord.xy / u_ClusterTileSize), u_ClusterDims.xy - 1);
+	int slice = clamp(int(floor(log(depth) * u_ClusterDepthParams.x + u_ClusterDepthParams.y)), 0, u_ClusterDims.z - 1);
+
+	return b_LightGrid[(slice * u_ClusterDims.y + tile.y) * u_ClusterDims.x + tile.x];
+}
+
+
+vec3 PhongLight(int i, vec3 Pos, vec3 N, vec3 V, vec3 A, vec3 S, float shinness) {
+	vec3 I, L, C = vec3(0.f);
+
+	switch (b_Lights[i].type) {
+	case DIRECTIONAL: {
+		L = b_Lights[i].direction;
+		I = b_Lights[i].color.rgb * b_Lights[i].color.a;
+		C += Phong(I, L, N, V, A, S, shinness);
+	} break;
+
+	case POINT: {
+		vec3 l = b_Lights[i].position.xyz - Pos;
+		float distance = length(l);
+		float rangeAtten = 1.f - smoothstep(0.f, b_Lights[i].position.w, distance);
+		L = l / distance;
+		I = b_Lights[i].color.rgb * b_Lights[i].color.a * rangeAtten;
+		C += Phong(I, L, N, V, A, S, shinness);
+	} break;
+
+	case SPOT: {
+		vec3 l = b_Lights[i].position.xyz - Pos;
+		float distance = length(l);
+		float rangeAtten = 1.f - smoothstep(0.f, b_Lights[i].position.w, distance);
+		L = l / distance;
+		float angleAtten = 1.f -  smoothstep(b_Lights[i].angles.x * 0.5f, b_Lights[i].angles.y * 0.5f, acos(dot(L, b_Lights[i].direction)));
+		I = b_Lights[i].color.rgb * b_Lights[i].color.a * rangeAtten * angleAtten;
+		C += Phong(I, L, N, V, A, S, shinness);
+	} break;
+
+	case AMBIENT: {
+		vec3 HA = mix(b_Lights[i].angles, b_Lights[i].color.rgb, N.y * 0.5f + 0.5f) * b_Lights[i].color.a;
+		C += HA * A;
+	} break;
 
-vec3 PhongLightting(vec3 Pos, vec3 N, vec3 Eye, vec3 A, vec3 S, float shinness) {
-	vec3 I, L, V, C;
-
-	V = normalize(Eye - Pos);
-
-	for (int i = 0; i < u_NumLights; i++) {
-		switch (b_Lights[i].type) {
-		case DIRECTIONAL: {
-			L = b_Lights[i].direction;
-			I = b_Lights[i].color.rgb * b_Lights[i].color.a;
-			C += Phong(I, L, N, V, A, S, shinness);
-		} break;
-
-		case POINT: {
-			vec3 l = b_Lights[i].position.xyz - Pos;
-			float distance = length(l);
-			float rangeAtten = 1.f - smoothstep(0.f, b_Lights[i].position.w, distance);
-			L = l / distance;
-			I = b_Lights[i].color.rgb * b_Lights[i].color.a * rangeAtten;
-			C += Phong(I, L, N, V, A, S, shinness);
-		} break;
-
-		case SPOT: {
-			vec3 l = b_Lights[i].position.xyz - Pos;
-			float distance = length(l);
-			float rangeAtten = 1.f - smoothstep(0.f, b_Lights[i].position.w, distance);
-			L = l / distance;
-			float angleAtten = 1.f -  smoothstep(b_Lights[i].angles.x * 0.5f, b_Lights[i].angles.y * 0.5f, acos(dot(L, b_Lights[i].direction)));
-			I = b_Lights[i].color.rgb * b_Lights[i].color.a * rangeAtten * angleAtten;
-			C += Phong(I, L, N, V, A, S, shinness);
-		} break;
-
-		case AMBIENT: {
-			vec3 HA = mix(b_Lights[i].angles, b_Lights[i].color.rgb, N.y * 0.5f + 0.5f) * b_Lights[i].color.a;
-			C += HA * A;
-		} break;
-
-		}
 	}
-	
+
 	return C;
 }
 
 
+vec3 PhongLightting(vec3 Pos, vec3 N, vec3 Eye, vec3 A, vec3 S, float shinness) {
+	vec3 V = normalize(Eye - Pos);
+	vec3 C = vec3(0.f);
 
-vec3 PBRLightting(vec3 Pos, vec3 N, vec3 Eye, vec3 A, float M, float R) {
-	vec3 I, L, V, C;
+	for (int i = u_GlobalLights.x; i < u_GlobalLights.y; i++)
+		C += PhongLight(i, Pos, N, V, A, S, shinness);
 
-	V = normalize(Eye - Pos);
+	uvec2 cluster = ClusterLights(Pos);
+	for (uint i = cluster.x; i < cluster.x + cluster.y; i++)
+		C += PhongLight(int(b_LightIndices[i]), Pos, N, V, A, S, shinness);
 	
-	for (int i = 0; i < u_NumLights; i++) {
-		switch (b_Lights[i].type) {
-		case DIRECTIONAL: {
-			L = b_Lights[i].direction;
-			I = b_Lights[i].color.rgb * b_Lights[i].color.a;
-			C += PBR(I, L, N, V, A, M, R);
-		} break;
-
-		case POINT: {
-			vec3 l = b_Lights[i].position.xyz - Pos;
-			float distance = length(l);
-			float rangeAtten = 1.f - smoothstep(0.f, b_Lights[i].position.w, distance);
-			L = l / distance;
-			I = b_Lights[i].color.rgb * b_Lights[i].color.a * rangeAtten;
-			C += PBR(I, L, N, V, A, M, R);
-		} break;
-
-		case SPOT: {
-			vec3 l = b_Lights[i].position.xyz - Pos;
-			float distance = length(l);
-			float rangeAtten = 1.f - smoothstep(0.f, b_Lights[i].position.w, distance);
-			L = l / distance;
-			float angleAtten = 1.f -  smoothstep(b_Lights[i].angles.x * 0.5f, b_Lights[i].angles.y * 0.5f, acos(dot(L, b_Lights[i].direction)));
-			I = b_Lights[i].color.rgb * b_Lights[i].color.a * rangeAtten * angleAtten;
-			C += PBR(I, L, N, V, A, M, R);
-		} break;
-
-		case AMBIENT: {
-			vec3 HA = mix(b_Lights[i].angles, b_Lights[i].color.rgb, N.y * 0.5f + 0.5f) * b_Lights[i].color.a;
-			C += HA * A;
-		} break;
-
-		}
+	return C;
+}
+
+
+
+vec3 PBRLight(int i, vec3 Pos, vec3 N, vec3 V, vec3 A, float M, float R) {
+	vec3 I, L, C = vec3(0.f);
+
+	switch (b_Lights[i].type) {
+	case DIRECTIONAL: {
+		L = b_Lights[i].direction;
+		I = b_Lights[i].color.rgb * b_Lights[i].color.a;
+		C += PBR(I, L, N, V, A, M, R);
+	} break;
+
+	case POINT: {
+		vec3 l = b_Lights[i].position.xyz - Pos;
+		float distance = length(l);
+		float rangeAtten = 1.f - smoothstep(0.f, b_Lights[i].position.w, distance);
+		L = l / distance;
+		I = b_Lights[i].color.rgb * b_Lights[i].color.a * rangeAtten;
+		C += PBR(I, L, N, V, A, M, R);
+	} break;
+
+	case SPOT: {
+		vec3 l = b_Lights[i].position.xyz - Pos;
+		float distance = length(l);
+		float rangeAtten = 1.f - smoothstep(0.f, b_Lights[i].position.w, distance);
+		L = l / distance;
+		float angleAtten = 1.f -  smoothstep(b_Lights[i].angles.x * 0.5f, b_Lights[i].angles.y * 0.5f, acos(dot(L, b_Lights[i].direction)));
+		I = b_Lights[i].color.rgb * b_Lights[i].color.a * rangeAtten * angleAtten;
+		C += PBR(I, L, N, V, A, M, R);
+	} break;
+
+	case AMBIENT: {
+		vec3 HA = mix(b_Lights[i].angles, b_Lights[i].color.rgb, N.y * 0.5f + 0.5f) * b_Lights[i].color.a;
+		C += HA * A;
+	} break;
+
 	}
+
+	return C;
+}
+
+
+vec3 PBRLightting(vec3 Pos, vec3 N, vec3 Eye, vec3 A, float M, float R) {
+	vec3 V = normalize(Eye - Pos);
+	vec3 C = vec3(0.f);
+
+	for (int i = u_GlobalLights.x; i < u_GlobalLights.y; i++)
+		C += PBRLight(i, Pos, N, V, A, M, R);
+
+	uvec2 cluster = ClusterLights(Pos);
+	for (uint i = cluster.x; i < cluster.x + cluster.y; i++)
+		C += PBRLight(int(b_LightIndices[i]), Pos, N, V, A, M, R);
 	
 	return C;
 }
\ No newline at end of file
@@ -18,4 +18,11 @@ uniform ivec4 u_HasANRMMap; // xyz for Phong material has albedo/normal/specular
 
 vec3 sRGB2RGB(in vec3 color) {
 	return pow(color, vec3(2.2f));
+}
+
+
+// tangent space normal, z is rebuilt from xy so two channel (bc5) normal maps read the same as rgb ones
+vec3 sampleNormalMap(in vec2 uv) {
+	vec2 xy = texture(u_NormalMap, uv).xy * 2.f - 1.f;
+	return vec3(xy, sqrt(max(1.f - dot(xy, xy), 0.f)));
 }
\ No newline at end of file
@@ -2,13 +2,11 @@
 #version 450 core
 
 layout(location = 0) in vec3 a_pos;
-layout(location = 1) in vec2 a_uv;
 
-out vec2 f_uv;
+uniform mat4 u_MVP; // light volume to clip space
 
 void main() {
-	gl_Position = vec4(a_pos, 1.f);
-	f_uv = a_uv;
+	gl_Position = u_MVP * vec4(a_pos, 1.f);
 }
 
 
@@ -32,9 +30,10 @@ const vec3 sampleOffsetDirections[20] = {
 
 
 
-in vec2 f_uv;
 out vec4 frag_color;
 
+uniform vec2 u_ScreenSize;
+
 
 uniform sampler2D u_PosW;
 uniform sampler2D u_NormalW;
@@ -92,6 +91,7 @@ float softShadow(vec3 posW) {
 
 
 void main() {
+	vec2 f_uv = gl_FragCoord.xy / u_ScreenSize;
 	vec3 P = texture(u_PosW, f_uv).xyz;
 	
 	vec3 l = u_lightPos.xyz - P;
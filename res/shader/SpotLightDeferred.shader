@@ -2,13 +2,11 @@
 #version 450 core
 
 layout(location = 0) in vec3 a_pos;
-layout(location = 1) in vec2 a_uv;
 
-out vec2 f_uv;
+uniform mat4 u_MVP; // light volume to clip space
 
 void main() {
-	gl_Position = vec4(a_pos, 1.f);
-	f_uv = a_uv;
+	gl_Position = u_MVP * vec4(a_pos, 1.f);
 }
 
 
@@ -22,9 +20,10 @@ void main() {
 
 const int PCFCornelSize = 5;
 
-in vec2 f_uv;
 out vec4 frag_color;
 
+uniform vec2 u_ScreenSize;
+
 
 uniform sampler2D u_PosW;
 uniform sampler2D u_NormalW;
@@ -97,6 +96,7 @@ float softShadow(vec3 P) {
 
 
 void main() {
+	vec2 f_uv = gl_FragCoord.xy / u_ScreenSize;
 	vec3 P = texture(u_PosW, f_uv).xyz;
 
 	vec3 l = u_lightPos.xyz - P;
@@ -104,7 +104,7 @@ void main() {
 	vec3 L = l / distance;
 
 	float rangeAtten = 1.f - smoothstep(0.f, u_lightPos.w, distance);
-	float angleAtten = smoothstep(u_angles.x * 0.5f, u_angles.y * 0.5f, acos(dot(L, u_toLight)));
+	float angleAtten = 1.f - smoothstep(u_angles.x * 0.5f, u_angles.y * 0.5f, acos(dot(L, u_toLight)));
 
 	vec3 I = u_lightColor.rgb * u_lightColor.a * rangeAtten * angleAtten;
 	vec3 N = (texture(u_NormalW, f_uv).xyz - 0.5) * 2;
@@ -0,0 +1,145 @@
+#shader compute
+#version 450 core
+#include "Phong.glsl"
+#include "PBR.glsl"
+
+#define POINT 2
+#define SPOT 3
+
+#define TILE_SIZE 16
+#define MAX_LIGHTS_PER_TILE 256
+
+// one group per screen tile, lights are culled against tile frustum then every pixel shades the tile's list
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+
+
+struct Light {
+	vec4 position; // (xyz)position (w)range
+	vec4 color; // (rgb)color (a)intensity
+	vec3 toLight;
+	vec3 angles; // spot angles
+	int type;
+	vec4 bounds; // (xyz)world space bounding sphere center (w)radius
+};
+
+layout(std430) readonly buffer Lights {
+	Light b_Lights[];
+};
+
+layout(rgba16f) uniform image2D u_OutputImage; // lighting accumulates into it
+
+uniform sampler2D u_PosW;
+uniform sampler2D u_NormalW;
+uniform sampler2D u_Albedo;
+uniform sampler2D u_Specular;
+uniform sampler2D u_EMR; // emissive/metallic/roughness
+uniform sampler2D u_ShadeMode;
+
+uniform uint u_NumLights;
+uniform float u_maxShininess;
+uniform vec3 u_cameraPosW;
+uniform mat4 u_ViewMat;
+uniform mat4 u_InvProjMat;
+uniform vec2 u_ScreenSize;
+
+shared uint sharedMinDepth;
+shared uint sharedMaxDepth;
+shared uint sharedNumLights;
+shared uint sharedLights[MAX_LIGHTS_PER_TILE];
+
+
+
+// view space plane through eye and two points on far plane, normal points into tile
+vec4 tilePlane(vec3 p0, vec3 p1) {
+	return vec4(normalize(cross(p0, p1)), 0.f);
+}
+
+
+vec3 viewRay(vec2 pixel) {
+	vec2 ndc = pixel / u_ScreenSize * 2.f - 1.f;
+	vec4 p = u_InvProjMat * vec4(ndc, 1.f, 1.f);
+	return p.xyz / p.w;
+}
+
+
+void main() {
+	ivec2 pix = ivec2(gl_GlobalInvocationID.xy);
+	bool isValid = all(lessThan(vec2(pix), u_ScreenSize));
+	int Mode = isValid ? int(texelFetch(u_ShadeMode, pix, 0).r) : 0;
+	vec3 P = isValid ? texelFetch(u_PosW, pix, 0).xyz : vec3(0.f);
+
+	if (gl_LocalInvocationIndex == 0) {
+		sharedMinDepth = 0x7f7fffffu; // FLT_MAX
+		sharedMaxDepth = 0;
+		sharedNumLights = 0;
+	}
+	barrier();
+
+	// positive view depth orders the same as its bits, background is left out of tile depth range
+	if (Mode != 0) {
+		uint depth = floatBitsToUint(max(-(u_ViewMat * vec4(P, 1.f)).z, 0.f));
+		atomicMin(sharedMinDepth, depth);
+		atomicMax(sharedMaxDepth, depth);
+	}
+	barrier();
+
+	float minDepth = uintBitsToFloat(sharedMinDepth);
+	float maxDepth = uintBitsToFloat(sharedMaxDepth);
+
+	// tile side planes in view space
+	vec2 tileMin = vec2(gl_WorkGroupID.xy * TILE_SIZE);
+	vec2 tileMax = tileMin + TILE_SIZE;
+	vec3 c00 = viewRay(tileMin);
+	vec3 c10 = viewRay(vec2(tileMax.x, tileMin.y));
+	vec3 c01 = viewRay(vec2(tileMin.x, tileMax.y));
+	vec3 c11 = viewRay(tileMax);
+	vec4 planes[4] = { tilePlane(c00, c01), tilePlane(c11, c10), tilePlane(c10, c00), tilePlane(c01, c11) };
+
+	for (uint i = gl_LocalInvocationIndex; i < u_NumLights && minDepth <= maxDepth; i += TILE_SIZE * TILE_SIZE) {
+		vec4 sphere = b_Lights[i].bounds;
+		vec3 center = (u_ViewMat * vec4(sphere.xyz, 1.f)).xyz;
+		if (-center.z + sphere.w < minDepth || -center.z - sphere.w > maxDepth)
+			continue;
+
+		bool isInside = true;
+		for (int p = 0; p < 4 && isInside; p++)
+			isInside = dot(planes[p].xyz, center) >= -sphere.w;
+
+		if (isInside) {
+			uint slot = atomicAdd(sharedNumLights, 1);
+			if (slot < MAX_LIGHTS_PER_TILE)
+				sharedLights[slot] = i;
+		}
+	}
+	barrier();
+
+	if (Mode == 0)
+		return;
+
+	vec3 N = (texelFetch(u_NormalW, pix, 0).xyz - 0.5) * 2;
+	vec3 V = normalize(u_cameraPosW - P);
+	vec3 A = texelFetch(u_Albedo, pix, 0).rgb;
+	vec3 EMR = texelFetch(u_EMR, pix, 0).rgb;
+	vec4 S = texelFetch(u_Specular, pix, 0);
+
+	vec3 C = vec3(0.f);
+	uint numLights = min(sharedNumLights, uint(MAX_LIGHTS_PER_TILE));
+	for (uint i = 0; i < numLights; i++) {
+		Light light = b_Lights[sharedLights[i]];
+		vec3 l = light.position.xyz - P;
+		float distance = length(l);
+		vec3 L = l / distance;
+		float atten = 1.f - smoothstep(0.f, light.position.w, distance);
+		if (light.type == SPOT)
+			atten *= 1.f - smoothstep(light.angles.x * 0.5f, light.angles.y * 0.5f, acos(dot(L, light.toLight)));
+
+		vec3 I = light.color.rgb * light.color.a * atten;
+		if (Mode == 1)
+			C += Phong(I, L, N, V, A, S.rgb, S.a * u_maxShininess);
+		else if (Mode == 2)
+			C += PBR(I, L, N, V, A, EMR.g, EMR.b);
+	}
+
+	vec4 dst = imageLoad(u_OutputImage, pix);
+	imageStore(u_OutputImage, pix, vec4(dst.rgb + C, dst.a));
+}
@@ -7,6 +7,16 @@ uniform SkinPoseBlock {
 	 mat4 u_SkinPose[MAX_NUM_BONE];
 };
 
+// model matrix per queued item, an instanced draw reads u_InstanceBase + gl_InstanceID
+layout(std430) readonly buffer Instances {
+	mat4 b_InstanceMats[];
+};
+
+uniform int u_InstanceBase;
+
+// pooled mesh vaos stream instance slot per instance, a multi draw command offsets it by baseInstance
+layout(location = 6) in uint a_instanceSlot;
+
 subroutine vec4 TransformType(vec4 pos, ivec4 bones, vec4 weights);
 subroutine uniform TransformType u_Transform;
 
@@ -15,6 +25,16 @@ vec4 staticMesh(vec4 pos, ivec4 bones, vec4 weights) {
 	return u_ModelMat * pos;
 }
 
+subroutine(TransformType)
+vec4 instancedMesh(vec4 pos, ivec4 bones, vec4 weights) {
+	return b_InstanceMats[u_InstanceBase + gl_InstanceID] * pos;
+}
+
+subroutine(TransformType)
+vec4 multiDrawMesh(vec4 pos, ivec4 bones, vec4 weights) {
+	return b_InstanceMats[a_instanceSlot] * pos;
+}
+
 subroutine(TransformType)
 vec4 skinMesh(vec4 pos, ivec4 bones, vec4 weights) {
 	mat4 skinMat = u_SkinPose[bones.x] * weights.x